@@ -32,12 +32,19 @@ void VolControl::OBSVolumeChanged(void *data, float db)
 	QMetaObject::invokeMethod(volControl, "VolumeChanged");
 }
 
-void VolControl::OBSVolumeLevel(void *data,
-	const float magnitude[MAX_AUDIO_CHANNELS],
-	const float peak[MAX_AUDIO_CHANNELS],
-	const float inputPeak[MAX_AUDIO_CHANNELS])
+void VolControl::OBSVolumeLevel(void *data, calldata_t *calldata)
 {
 	VolControl *volControl = static_cast<VolControl*>(data);
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float inputPeak[MAX_AUDIO_CHANNELS];
+
+	if (!calldata_get_data(calldata, "magnitude", magnitude,
+				sizeof(magnitude)) ||
+	    !calldata_get_data(calldata, "peak", peak, sizeof(peak)) ||
+	    !calldata_get_data(calldata, "input_peak", inputPeak,
+				sizeof(inputPeak)))
+		return;
 
 	volControl->volMeter->setLevels(magnitude, peak, inputPeak);
 }
@@ -192,7 +199,11 @@ VolControl::VolControl(OBSSource source_, bool showConfig)
 	setLayout(mainLayout);
 
 	obs_fader_add_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_add_callback(obs_volmeter, OBSVolumeLevel, this);
+	/* levels come from the audio thread; don't let the meter stall it */
+	signal_handler_connect_flags(
+			obs_volmeter_get_signal_handler(obs_volmeter),
+			"levels_updated", OBSVolumeLevel, this,
+			SIGNAL_DEFERRED | SIGNAL_COALESCE);
 
 	signal_handler_connect(obs_source_get_signal_handler(source),
 			"mute", OBSVolumeMuted, this);
@@ -214,7 +225,9 @@ VolControl::VolControl(OBSSource source_, bool showConfig)
 VolControl::~VolControl()
 {
 	obs_fader_remove_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_remove_callback(obs_volmeter, OBSVolumeLevel, this);
+	signal_handler_disconnect(
+			obs_volmeter_get_signal_handler(obs_volmeter),
+			"levels_updated", OBSVolumeLevel, this);
 
 	signal_handler_disconnect(obs_source_get_signal_handler(source),
 			"mute", OBSVolumeMuted, this);
@@ -1142,6 +1142,8 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_string(basicConfig, "Video", "ColorSpace", "601");
 	config_set_default_string(basicConfig, "Video", "ColorRange",
 			"Partial");
+	config_set_default_uint  (basicConfig, "Video", "ConversionWorkers",
+			0);
 
 	config_set_default_string(basicConfig, "Audio", "MonitoringDeviceId",
 			"default");
@@ -2929,7 +2931,7 @@ void OBSBasic::RenderMain(void *data, uint32_t cx, uint32_t cy)
 		OBSScene scene = window->GetCurrentScene();
 		obs_source_t *source = obs_scene_get_source(scene);
 		if (source)
-			obs_source_video_render(source);
+			obs_source_video_render_cached(source);
 	} else {
 		obs_render_main_texture();
 	}
@@ -3122,8 +3124,11 @@ int OBSBasic::ResetVideo()
 			ResizeProgram(ovi.base_width, ovi.base_height);
 	}
 
-	if (ret == OBS_VIDEO_SUCCESS)
+	if (ret == OBS_VIDEO_SUCCESS) {
+		obs_set_video_conversion_workers((uint32_t)config_get_uint(
+				basicConfig, "Video", "ConversionWorkers"));
 		OBSBasicStats::InitializeValues();
+	}
 
 	return ret;
 }
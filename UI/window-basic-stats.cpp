@@ -67,12 +67,14 @@ OBSBasicStats::OBSBasicStats(QWidget *parent)
 	renderTime = new QLabel(this);
 	skippedFrames = new QLabel(this);
 	missedFrames = new QLabel(this);
+	sceneRenders = new QLabel(this);
 	row = 0;
 
 	newStatBare("FPS", fps, 2);
 	newStat("AverageTimeToRender", renderTime, 2);
 	newStat("MissedFrames", missedFrames, 2);
 	newStat("SkippedFrames", skippedFrames, 2);
+	newStat("SceneRenders", sceneRenders, 2);
 
 	/* --------------------------------------------- */
 
@@ -380,6 +382,16 @@ void OBSBasicStats::Update()
 	else
 		setThemeID(missedFrames, "");
 
+	/* ------------------ */
+
+	uint32_t scene_renders, scene_renders_saved;
+	obs_get_scene_render_stats(&scene_renders, &scene_renders_saved);
+
+	str = QTStr("Basic.Stats.SceneRenders.Saved").arg(
+			QString::number(scene_renders),
+			QString::number(scene_renders_saved));
+	sceneRenders->setText(str);
+
 	/* ------------------------------------------- */
 	/* recording/streaming stats                   */
 
@@ -22,6 +22,7 @@ class OBSBasicStats : public QWidget {
 	QLabel *renderTime = nullptr;
 	QLabel *skippedFrames = nullptr;
 	QLabel *missedFrames = nullptr;
+	QLabel *sceneRenders = nullptr;
 
 	QGridLayout *outputLayout = nullptr;
 
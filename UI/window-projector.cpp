@@ -462,7 +462,7 @@ void OBSProjector::OBSRenderMultiview(void *data, uint32_t cx, uint32_t cy)
 		gs_matrix_scale3f(qiScaleX, qiScaleY, 1.0f);
 
 		setRegion(qiX, qiY, qiCX, qiCY);
-		obs_source_video_render(src);
+		obs_source_video_render_cached(src);
 		resetRegion();
 
 		gs_effect_set_color(color, 0xFFFFFFFF);
@@ -502,7 +502,7 @@ void OBSProjector::OBSRenderMultiview(void *data, uint32_t cx, uint32_t cy)
 	setRegion(sourceX, sourceY, hiCX, hiCY);
 
 	if (studioMode) {
-		obs_source_video_render(previewSrc);
+		obs_source_video_render_cached(previewSrc);
 	} else {
 		obs_render_main_texture();
 	}
@@ -634,7 +634,7 @@ void OBSProjector::OBSRender(void *data, uint32_t cx, uint32_t cy)
 	}
 
 	if (source) {
-		obs_source_video_render(source);
+		obs_source_video_render_cached(source);
 	} else {
 		obs_render_main_texture();
 	}
@@ -24,6 +24,7 @@ struct audio_monitor {
 	size_t                buffer_size;
 	size_t                wait_size;
 	uint32_t              channels;
+	uint32_t              sample_rate;
 
 	volatile bool         active;
 	bool                  paused;
@@ -117,10 +118,29 @@ static void on_audio_playback(void *param, obs_source_t *source,
 	pthread_mutex_unlock(&monitor->mutex);
 }
 
+static void publish_clock(struct audio_monitor *monitor)
+{
+	AudioTimeStamp time = {0};
+	OSStatus stat;
+
+	if (!monitor->sample_rate)
+		return;
+
+	stat = AudioQueueGetCurrentTime(monitor->queue, NULL, &time, NULL);
+	if (stat != noErr || !(time.mFlags & kAudioTimeStampSampleTimeValid))
+		return;
+
+	audio_monitor_publish_clock(monitor,
+			(uint64_t)(time.mSampleTime * 1000000000.0 /
+			(double)monitor->sample_rate));
+}
+
 static void buffer_audio(void *data, AudioQueueRef aq, AudioQueueBufferRef buf)
 {
 	struct audio_monitor *monitor = data;
 
+	publish_clock(monitor);
+
 	pthread_mutex_lock(&monitor->mutex);
 	circlebuf_push_back(&monitor->empty_buffers, &buf, sizeof(buf));
 	while (monitor->empty_buffers.size > 0) {
@@ -163,6 +183,7 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 	monitor->source = source;
 
 	monitor->channels = channels;
+	monitor->sample_rate = info->samples_per_sec;
 	monitor->buffer_size =
 		channels * sizeof(float) * info->samples_per_sec / 100 * 3;
 	monitor->wait_size = monitor->buffer_size * 3;
@@ -282,6 +303,8 @@ static void audio_monitor_free(struct audio_monitor *monitor)
 	circlebuf_free(&monitor->empty_buffers);
 	circlebuf_free(&monitor->new_data);
 	pthread_mutex_destroy(&monitor->mutex);
+
+	audio_monitor_release_clock(monitor);
 }
 
 static void audio_monitor_init_final(struct audio_monitor *monitor)
@@ -330,12 +353,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
-		audio_monitor_free(monitor);
-
 		pthread_mutex_lock(&obs->audio.monitoring_mutex);
 		da_erase_item(obs->audio.monitors, &monitor);
 		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 
+		audio_monitor_free(monitor);
 		bfree(monitor);
 	}
 }
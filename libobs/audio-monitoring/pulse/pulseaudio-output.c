@@ -236,8 +236,12 @@ unlock:
 
 static void pulseaudio_stream_write(pa_stream *p, size_t nbytes, void *userdata)
 {
-	UNUSED_PARAMETER(p);
 	PULSE_DATA(userdata);
+	pa_usec_t usec;
+
+	/* runs on the mainloop thread, which already holds its lock */
+	if (pa_stream_get_time(p, &usec) == 0)
+		audio_monitor_publish_clock(data, (uint64_t)usec * 1000);
 
 	pthread_mutex_lock(&data->playback_mutex);
 	data->bytesRemaining += nbytes;
@@ -496,6 +500,8 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 	pulseaudio_unref();
 
 	bfree(monitor->device);
+
+	audio_monitor_release_clock(monitor);
 }
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source)
@@ -541,12 +547,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
-		audio_monitor_free(monitor);
-
 		pthread_mutex_lock(&obs->audio.monitoring_mutex);
 		da_erase_item(obs->audio.monitors, &monitor);
 		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 
+		audio_monitor_free(monitor);
 		bfree(monitor);
 	}
 }
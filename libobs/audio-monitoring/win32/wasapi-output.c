@@ -22,12 +22,17 @@ ACTUALLY_DEFINE_GUID(IID_IAudioClient,
 ACTUALLY_DEFINE_GUID(IID_IAudioRenderClient,
 	0xF294ACFC, 0x3146, 0x4483,
 	0xA7, 0xBF, 0xAD, 0xDC, 0xA7, 0xC2, 0x60, 0xE2);
+ACTUALLY_DEFINE_GUID(IID_IAudioClock,
+	0xCD63314F, 0x3FBA, 0x4A1B,
+	0x81, 0x2C, 0xEF, 0x96, 0x35, 0x87, 0x28, 0xE7);
 
 struct audio_monitor {
 	obs_source_t       *source;
 	IMMDevice          *device;
 	IAudioClient       *client;
 	IAudioRenderClient *render;
+	IAudioClock        *clock;
+	UINT64             clock_freq;
 
 	uint64_t           last_recv_time;
 	uint64_t           prev_video_ts;
@@ -135,6 +140,24 @@ static bool process_audio_delay(struct audio_monitor *monitor,
 	return false;
 }
 
+static void publish_clock(struct audio_monitor *monitor)
+{
+	UINT64 pos;
+	HRESULT hr;
+
+	if (!monitor->clock || !monitor->clock_freq)
+		return;
+
+	hr = monitor->clock->lpVtbl->GetPosition(monitor->clock, &pos, NULL);
+	if (FAILED(hr))
+		return;
+
+	audio_monitor_publish_clock(monitor,
+			pos / monitor->clock_freq * 1000000000ULL +
+			pos % monitor->clock_freq * 1000000000ULL /
+			monitor->clock_freq);
+}
+
 static void on_audio_playback(void *param, obs_source_t *source,
 		const struct audio_data *audio_data, bool muted)
 {
@@ -201,6 +224,8 @@ static void on_audio_playback(void *param, obs_source_t *source,
 	render->lpVtbl->ReleaseBuffer(render, resample_frames,
 			muted ? AUDCLNT_BUFFERFLAGS_SILENT : 0);
 
+	publish_clock(monitor);
+
 unlock:
 	pthread_mutex_unlock(&monitor->playback_mutex);
 }
@@ -221,9 +246,12 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 	safe_release(monitor->device);
 	safe_release(monitor->client);
 	safe_release(monitor->render);
+	safe_release(monitor->clock);
 	audio_resampler_destroy(monitor->resampler);
 	circlebuf_free(&monitor->delay_buffer);
 	da_free(monitor->buf);
+
+	audio_monitor_release_clock(monitor);
 }
 
 static enum speaker_layout convert_speaker_layout(DWORD layout, WORD channels)
@@ -355,6 +383,17 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 		goto fail;
 	}
 
+	/* the device clock is optional, it is only used when the audio
+	 * thread is slaved to the monitoring device */
+	hr = monitor->client->lpVtbl->GetService(monitor->client,
+			&IID_IAudioClock, (void**)&monitor->clock);
+	if (SUCCEEDED(hr)) {
+		hr = monitor->clock->lpVtbl->GetFrequency(monitor->clock,
+				&monitor->clock_freq);
+		if (FAILED(hr))
+			monitor->clock_freq = 0;
+	}
+
 	if (pthread_mutex_init(&monitor->playback_mutex, NULL) != 0) {
 		goto fail;
 	}
@@ -429,12 +468,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
-		audio_monitor_free(monitor);
-
 		pthread_mutex_lock(&obs->audio.monitoring_mutex);
 		da_erase_item(obs->audio.monitors, &monitor);
 		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 
+		audio_monitor_free(monitor);
 		bfree(monitor);
 	}
 }
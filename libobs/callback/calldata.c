@@ -20,6 +20,7 @@
 #include "../util/base.h"
 
 #include "calldata.h"
+#include "decl.h"
 
 /*
  *   Uses a data stack.  Probably more complex than it should be, but reduces
@@ -39,6 +40,11 @@
  *
  *   Strings and string sizes always include the null terminator to allow for
  * direct referencing.
+ *
+ *   The stack starts out in the calldata's inline buffer, and only moves to
+ * the heap once it outgrows it.  Calldata initialized from a declaration
+ * starts out with the declaration's fixed size parameters already on the
+ * stack (see build_layout in decl.c), so their offsets are known.
  */
 
 static inline void cd_serialize(uint8_t **pos, void *ptr, size_t size)
@@ -126,11 +132,14 @@ static inline void cd_set_first_param(calldata_t *data, const char *name,
 	capacity = sizeof(size_t)*3 + name_len + size;
 	data->size = capacity;
 
-	if (capacity < 128)
-		capacity = 128;
+	if (capacity <= CALLDATA_INLINE_SIZE) {
+		capacity    = CALLDATA_INLINE_SIZE;
+		data->stack = data->inline_stack;
+	} else {
+		data->stack = bmalloc(capacity);
+	}
 
 	data->capacity = capacity;
-	data->stack    = bmalloc(capacity);
 
 	pos = data->stack;
 	cd_copy_string(&pos, name, name_len);
@@ -157,7 +166,13 @@ static inline bool cd_ensure_capacity(calldata_t *data, uint8_t **pos,
 	if (new_capacity < new_size)
 		new_capacity = new_size;
 
-	data->stack    = brealloc(data->stack, new_capacity);
+	if (data->stack == data->inline_stack) {
+		data->stack = bmalloc(new_capacity);
+		memcpy(data->stack, data->inline_stack, data->size);
+	} else {
+		data->stack = brealloc(data->stack, new_capacity);
+	}
+
 	data->capacity = new_capacity;
 
 	*pos = data->stack + offset;
@@ -203,6 +218,11 @@ void calldata_set_data(calldata_t *data, const char *name, const void *in,
 		size_t cur_size;
 		memcpy(&cur_size, pos, sizeof(size_t));
 
+		/* moves everything after it, so the layout no longer applies */
+		if (cur_size != size && data->indexed &&
+		    (size_t)(pos - data->stack) < data->decl->layout_size)
+			data->indexed = false;
+
 		if (cur_size < size) {
 			size_t offset = size - cur_size;
 			size_t bytes = data->size;
@@ -248,3 +268,87 @@ bool calldata_get_string(const calldata_t *data, const char *name,
 	*str = cd_serialize_string(&pos);
 	return true;
 }
+
+/* ------------------------------------------------------------------------- */
+
+void calldata_init_decl(calldata_t *data, const struct decl_info *decl)
+{
+	/* the inline stack is overwritten by the layout, skip clearing it */
+	data->stack    = NULL;
+	data->size     = 0;
+	data->capacity = 0;
+	data->fixed    = false;
+	data->decl     = NULL;
+	data->indexed  = false;
+
+	if (!decl || !decl->layout)
+		return;
+
+	if (decl->layout_size <= CALLDATA_INLINE_SIZE) {
+		data->stack    = data->inline_stack;
+		data->capacity = CALLDATA_INLINE_SIZE;
+	} else {
+		data->stack    = bmalloc(decl->layout_size);
+		data->capacity = decl->layout_size;
+	}
+
+	memcpy(data->stack, decl->layout, decl->layout_size);
+	data->size    = decl->layout_size;
+	data->decl    = decl;
+	data->indexed = true;
+}
+
+static inline const struct decl_param *cd_getindexed(const calldata_t *data,
+		size_t idx, uint8_t **pos)
+{
+	const struct decl_param *param;
+
+	if (!data || !data->decl || idx >= data->decl->params.num)
+		return NULL;
+
+	param = data->decl->params.array + idx;
+	*pos = (data->indexed && param->offset) ?
+		data->stack + param->offset : NULL;
+	return param;
+}
+
+bool calldata_get_indexed(const calldata_t *data, size_t idx, void *out,
+		size_t size)
+{
+	const struct decl_param *param;
+	uint8_t *pos;
+
+	param = cd_getindexed(data, idx, &pos);
+	if (!param)
+		return false;
+	if (!pos)
+		return calldata_get_data(data, param->name, out, size);
+
+	if (cd_serialize_size(&pos) != size)
+		return false;
+
+	memcpy(out, pos, size);
+	return true;
+}
+
+void calldata_set_indexed(calldata_t *data, size_t idx, const void *in,
+		size_t size)
+{
+	const struct decl_param *param;
+	uint8_t *pos;
+	size_t cur_size;
+
+	param = cd_getindexed(data, idx, &pos);
+	if (!param)
+		return;
+
+	if (pos) {
+		memcpy(&cur_size, pos, sizeof(size_t));
+		if (cur_size == size) {
+			memcpy(pos + sizeof(size_t), in, size);
+			return;
+		}
+	}
+
+	calldata_set_data(data, param->name, in, size);
+}
@@ -29,6 +29,11 @@ extern "C" {
  *
  *   This is used to store parameters (and return value) sent to/from signals,
  * procedures, and callbacks.
+ *
+ *   Parameters are stored in a small buffer inside the structure until they
+ * no longer fit, so most calls never allocate.  Calldata initialized from a
+ * declaration (see calldata_init_decl) can also access its parameters by
+ * their index in the declaration instead of searching by name.
  */
 
 enum call_param_type {
@@ -37,17 +42,29 @@ enum call_param_type {
 	CALL_PARAM_TYPE_FLOAT,
 	CALL_PARAM_TYPE_BOOL,
 	CALL_PARAM_TYPE_PTR,
-	CALL_PARAM_TYPE_STRING
+	CALL_PARAM_TYPE_STRING,
+	CALL_PARAM_TYPE_DATA
 };
 
 #define CALL_PARAM_IN  (1<<0)
 #define CALL_PARAM_OUT (1<<1)
 
+#define CALLDATA_INLINE_SIZE 256
+
+struct decl_info;
+
 struct calldata {
 	uint8_t *stack;
 	size_t  size;     /* size of the stack, in bytes */
 	size_t  capacity; /* capacity of the stack, in bytes */
 	bool    fixed;    /* fixed size (using call stack) */
+
+	/* declaration the stack was laid out from, and whether its
+	 * parameters are still at their laid out offsets */
+	const struct decl_info *decl;
+	bool    indexed;
+
+	uint8_t inline_stack[CALLDATA_INLINE_SIZE];
 };
 
 typedef struct calldata calldata_t;
@@ -71,10 +88,29 @@ static inline void calldata_init_fixed(struct calldata *data, uint8_t *stack,
 
 static inline void calldata_free(struct calldata *data)
 {
-	if (!data->fixed)
+	if (!data->fixed && data->stack != data->inline_stack)
 		bfree(data->stack);
 }
 
+/**
+ * Initializes calldata with every parameter of a declaration that has a
+ * fixed size (int, float, bool and ptr) already in place and zeroed, so
+ * they can be set and retrieved by index in constant time.  String and data
+ * parameters are added when they're set.  The declaration must outlive the
+ * calldata.
+ */
+EXPORT void calldata_init_decl(calldata_t *data, const struct decl_info *decl);
+
+/**
+ * Gets/sets a parameter by its index in the declaration the calldata was
+ * initialized from.  Falls back to looking the parameter up by name if it
+ * isn't laid out (strings and data), or if it was resized by name since.
+ */
+EXPORT bool calldata_get_indexed(const calldata_t *data, size_t idx,
+		void *out, size_t size);
+EXPORT void calldata_set_indexed(calldata_t *data, size_t idx,
+		const void *in, size_t size);
+
 EXPORT bool calldata_get_data(const calldata_t *data, const char *name,
 		void *out, size_t size);
 EXPORT void calldata_set_data(calldata_t *data, const char *name,
@@ -86,6 +122,9 @@ static inline void calldata_clear(struct calldata *data)
 		data->size = sizeof(size_t);
 		memset(data->stack, 0, sizeof(size_t));
 	}
+
+	data->decl = NULL;
+	data->indexed = false;
 }
 
 static inline calldata_t *calldata_create(void)
@@ -204,6 +243,57 @@ static inline void calldata_set_string(calldata_t *data, const char *name,
 		calldata_set_data(data, name, NULL, 0);
 }
 
+/* ------------------------------------------------------------------------- */
+/* indexed versions, for calldata initialized with calldata_init_decl */
+
+static inline bool calldata_get_indexed_int(const calldata_t *data,
+		size_t idx, long long *val)
+{
+	return calldata_get_indexed(data, idx, val, sizeof(*val));
+}
+
+static inline bool calldata_get_indexed_float(const calldata_t *data,
+		size_t idx, double *val)
+{
+	return calldata_get_indexed(data, idx, val, sizeof(*val));
+}
+
+static inline bool calldata_get_indexed_bool(const calldata_t *data,
+		size_t idx, bool *val)
+{
+	return calldata_get_indexed(data, idx, val, sizeof(*val));
+}
+
+static inline bool calldata_get_indexed_ptr(const calldata_t *data,
+		size_t idx, void *p_ptr)
+{
+	return calldata_get_indexed(data, idx, p_ptr, sizeof(p_ptr));
+}
+
+static inline void calldata_set_indexed_int(calldata_t *data, size_t idx,
+		long long val)
+{
+	calldata_set_indexed(data, idx, &val, sizeof(val));
+}
+
+static inline void calldata_set_indexed_float(calldata_t *data, size_t idx,
+		double val)
+{
+	calldata_set_indexed(data, idx, &val, sizeof(val));
+}
+
+static inline void calldata_set_indexed_bool(calldata_t *data, size_t idx,
+		bool val)
+{
+	calldata_set_indexed(data, idx, &val, sizeof(val));
+}
+
+static inline void calldata_set_indexed_ptr(calldata_t *data, size_t idx,
+		void *ptr)
+{
+	calldata_set_indexed(data, idx, &ptr, sizeof(ptr));
+}
+
 #ifdef __cplusplus
 }
 #endif
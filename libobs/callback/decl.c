@@ -72,6 +72,8 @@ static bool get_type(struct strref *ref, enum call_param_type *type,
 		*type = CALL_PARAM_TYPE_PTR;
 	else if (strref_cmp(ref, "string") == 0)
 		*type = CALL_PARAM_TYPE_STRING;
+	else if (strref_cmp(ref, "data") == 0)
+		*type = CALL_PARAM_TYPE_DATA;
 	else if (is_return && strref_cmp(ref, "void") == 0)
 		*type = CALL_PARAM_TYPE_VOID;
 	else
@@ -174,6 +176,65 @@ static void parse_params(struct cf_parser *cfp, struct decl_info *decl)
 		cf_next_token_should_be(cfp, ")", NULL, NULL);
 }
 
+static size_t param_data_size(enum call_param_type type)
+{
+	switch (type) {
+	case CALL_PARAM_TYPE_INT:   return sizeof(long long);
+	case CALL_PARAM_TYPE_FLOAT: return sizeof(double);
+	case CALL_PARAM_TYPE_BOOL:  return sizeof(bool);
+	case CALL_PARAM_TYPE_PTR:   return sizeof(void*);
+	default:                    return 0;
+	}
+}
+
+/*
+ * Lays out the fixed size parameters in calldata stack format, in
+ * declaration order.  Strings and data change size when set, so they're left
+ * out and get appended after the laid out parameters, which keeps the
+ * offsets of the laid out parameters valid.
+ */
+static void build_layout(struct decl_info *decl)
+{
+	size_t size = 0;
+	uint8_t *pos;
+
+	for (size_t i = 0; i < decl->params.num; i++) {
+		struct decl_param *param = decl->params.array+i;
+		size_t data_size = param_data_size(param->type);
+
+		if (!data_size)
+			continue;
+
+		size += sizeof(size_t) + strlen(param->name) + 1;
+		param->offset = size;
+		size += sizeof(size_t) + data_size;
+	}
+
+	/* terminating name size */
+	size += sizeof(size_t);
+
+	decl->layout      = bzalloc(size);
+	decl->layout_size = size;
+
+	pos = decl->layout;
+	for (size_t i = 0; i < decl->params.num; i++) {
+		struct decl_param *param = decl->params.array+i;
+		size_t name_size = strlen(param->name) + 1;
+		size_t data_size;
+
+		if (!param->offset)
+			continue;
+
+		data_size = param_data_size(param->type);
+
+		memcpy(pos, &name_size, sizeof(size_t));
+		memcpy(pos + sizeof(size_t), param->name, name_size);
+		memcpy(decl->layout + param->offset, &data_size,
+				sizeof(size_t));
+		pos = decl->layout + param->offset + sizeof(size_t) + data_size;
+	}
+}
+
 static void print_errors(struct cf_parser *cfp, const char *decl_string)
 {
 	char *errors = error_data_buildstring(&cfp->error_list);
@@ -229,7 +290,9 @@ fail:
 		da_push_back(decl->params, &ret_param);
 	}
 
-	if (!success)
+	if (success)
+		build_layout(decl);
+	else
 		decl_info_free(decl);
 
 	print_errors(&cfp, decl_string);
@@ -27,6 +27,10 @@ struct decl_param {
 	char                 *name;
 	enum call_param_type type;
 	uint32_t             flags;
+
+	/* offset of the parameter's data size in the layout, 0 if it isn't
+	 * laid out */
+	size_t               offset;
 };
 
 static inline void decl_param_free(struct decl_param *param)
@@ -40,6 +44,11 @@ struct decl_info {
 	char                      *name;
 	const char                *decl_string;
 	DARRAY(struct decl_param) params;
+
+	/* calldata stack with the fixed size parameters laid out, used by
+	 * calldata_init_decl */
+	uint8_t                   *layout;
+	size_t                    layout_size;
 };
 
 static inline void decl_info_free(struct decl_info *decl)
@@ -49,6 +58,7 @@ static inline void decl_info_free(struct decl_info *decl)
 			decl_param_free(decl->params.array+i);
 		da_free(decl->params);
 
+		bfree(decl->layout);
 		bfree(decl->name);
 		memset(decl, 0, sizeof(struct decl_info));
 	}
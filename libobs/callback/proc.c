@@ -72,19 +72,36 @@ void proc_handler_add(proc_handler_t *handler, const char *decl_string,
 	da_push_back(handler->procs, &pi);
 }
 
+static struct proc_info *getproc(proc_handler_t *handler, const char *name)
+{
+	for (size_t i = 0; i < handler->procs.num; i++) {
+		struct proc_info *info = handler->procs.array+i;
+
+		if (strcmp(info->func.name, name) == 0)
+			return info;
+	}
+
+	return NULL;
+}
+
 bool proc_handler_call(proc_handler_t *handler, const char *name,
 		calldata_t *params)
 {
 	if (!handler) return false;
 
-	for (size_t i = 0; i < handler->procs.num; i++) {
-		struct proc_info *info = handler->procs.array+i;
+	struct proc_info *info = getproc(handler, name);
+	if (!info)
+		return false;
 
-		if (strcmp(info->func.name, name) == 0) {
-			info->callback(info->data, params);
-			return true;
-		}
-	}
+	info->callback(info->data, params);
+	return true;
+}
+
+bool proc_handler_init_calldata(proc_handler_t *handler, const char *name,
+		calldata_t *params)
+{
+	struct proc_info *info = handler ? getproc(handler, name) : NULL;
 
-	return false;
+	calldata_init_decl(params, info ? &info->func : NULL);
+	return info != NULL;
 }
@@ -49,6 +49,16 @@ EXPORT void proc_handler_add(proc_handler_t *handler, const char *decl_string,
 EXPORT bool proc_handler_call(proc_handler_t *handler, const char *name,
 		calldata_t *params);
 
+/**
+ * Initializes calldata from a procedure's declaration, so its parameters can
+ * be set with calldata_set_indexed_* in declaration order, with "return"
+ * last.  Returns false (and initializes empty calldata) if the named
+ * procedure is not found.  Don't add procedures to the handler while the
+ * calldata is in use.
+ */
+EXPORT bool proc_handler_init_calldata(proc_handler_t *handler,
+		const char *name, calldata_t *params);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,45 +14,778 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+
 #include "../util/darray.h"
 #include "../util/threading.h"
+#include "../util/platform.h"
 
 #include "decl.h"
 #include "signal.h"
 
+/*
+ *   Callbacks are kept in arrays that are never modified once published;
+ * connecting or disconnecting publishes a new copy (copy on write), so
+ * signalling never takes a lock and never waits for connect/disconnect.
+ *
+ *   Signalling threads count themselves in the 'calls' of a callback while
+ * they call it.  Disconnecting flags the callback as removed, which stops new
+ * calls from starting, then waits on an event for the calls already in
+ * progress on other threads to return, so once disconnect returns the
+ * callback is not being called and will not be called again, just like when
+ * the callbacks were locked.  Signals starting in the meantime can't delay
+ * it.
+ *
+ *   Signalling threads also count themselves in 'emitting' while they use an
+ * array.  Replaced arrays and disconnected callbacks are retired, and freed
+ * the next time the list is seen with no signal in progress.
+ *
+ *   Deferred callbacks are not called by the signalling thread.  It copies
+ * the parameters into an event and pushes it on a lock-free queue, which the
+ * dispatcher thread drains.  Coalesced callbacks have a single event which
+ * is only queued once; signalling again before it's dispatched just replaces
+ * its parameters.
+ */
+
+#define MAX_DEFERRED_EVENTS 4096
+
+typedef void (*callback_func_t)(void);
+
+struct callback_list;
+struct signal_callback;
+struct signal_dispatcher;
+
+struct deferred_event {
+	struct deferred_event    *volatile next;
+	struct signal_callback   *cb;
+	size_t                   size; /* calldata stack follows */
+};
+
+struct deferred_callback {
+	struct signal_dispatcher *dispatcher;
+
+	/* coalesced only: the latest parameters */
+	pthread_mutex_t          mutex;
+	DARRAY(uint8_t)          latest;
+	bool                     queued;
+	struct deferred_event    event;
+};
+
 struct signal_callback {
-	signal_callback_t callback;
-	void              *data;
-	bool              remove;
+	callback_func_t          func;
+	void                     *data;
+	volatile bool            removed;
+
+	/* threads calling (or queueing) it right now, and the event they
+	 * signal once it's removed, created by the disconnect waiting */
+	volatile long            calls;
+	os_event_t               *volatile calls_done;
+
+	/* the list, plus each queued deferred event */
+	volatile long            refs;
+	uint32_t                 flags;
+	struct callback_list     *list;
+	struct deferred_callback *deferred;
+};
+
+struct callback_array {
+	size_t                   num;
+	struct signal_callback   **callbacks;
+};
+
+struct callback_list {
+	struct callback_array    *volatile array;
+	volatile long            num;
+	volatile long            emitting;
+	volatile bool            has_retired;
+
+	/* only used by connect/disconnect, and to free retired memory */
+	pthread_mutex_t          mutex;
+	DARRAY(struct callback_array*) retired_arrays;
+	DARRAY(struct signal_callback*) retired_callbacks;
+};
+
+/* signals being emitted by the current thread, innermost first */
+struct emit_frame {
+	struct callback_list     *list;
+	struct signal_callback   *cur;
+	bool                     calling;
+	bool                     remove_cur;
+	struct emit_frame        *prev;
+};
+
+static THREAD_LOCAL struct emit_frame *emit_frames = NULL;
+
+static inline struct callback_array *callback_array_create(size_t num)
+{
+	struct callback_array *array = bmalloc(sizeof(*array) +
+			num * sizeof(struct signal_callback*));
+	array->num = num;
+	array->callbacks = (struct signal_callback**)(array + 1);
+	return array;
+}
+
+static inline struct callback_array *get_array(struct callback_list *list)
+{
+	return os_atomic_load_ptr((void *const volatile*)&list->array);
+}
+
+static inline bool callback_list_init(struct callback_list *list)
+{
+	list->array = NULL;
+	list->num = 0;
+	list->emitting = 0;
+	list->has_retired = false;
+	da_init(list->retired_arrays);
+	da_init(list->retired_callbacks);
+	return pthread_mutex_init(&list->mutex, NULL) == 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Deferred delivery */
+
+struct signal_dispatcher {
+	/* the thread, plus each deferred callback using it */
+	volatile long            refs;
+
+	/* deferred callbacks still connected, locked by dispatcher_mutex */
+	long                     users;
+
+	pthread_t                thread;
+	os_sem_t                 *sem;
+	volatile bool            stop;
+
+	/* locked while a callback is being called */
+	pthread_mutex_t          dispatch_mutex;
+
+	/* multiple producer, single consumer queue */
+	struct deferred_event    *volatile head;
+	struct deferred_event    *tail;
+	struct deferred_event    stub;
+	volatile long            pending;
+	volatile long            dropped;
+
+	DARRAY(uint8_t)          coalesce_buf;
 };
 
+static pthread_mutex_t dispatcher_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct signal_dispatcher *dispatcher = NULL;
+
+static THREAD_LOCAL struct signal_callback *deferred_cur = NULL;
+static THREAD_LOCAL bool deferred_remove_cur = false;
+
+static void callback_list_remove(struct callback_list *list,
+		callback_func_t func, void *data);
+
+static inline struct deferred_event *next_event(struct deferred_event *ev)
+{
+	return os_atomic_load_ptr((void *const volatile*)&ev->next);
+}
+
+/* can be called from any number of threads at once */
+static void queue_push(struct signal_dispatcher *d, struct deferred_event *ev)
+{
+	struct deferred_event *prev;
+
+	ev->next = NULL;
+	prev = os_atomic_set_ptr((void *volatile*)&d->head, ev);
+	os_atomic_set_ptr((void *volatile*)&prev->next, ev);
+}
+
+/* dispatcher thread only.  returns NULL if empty, or if a push is still in
+ * progress, in which case the semaphore gets posted again once it's done */
+static struct deferred_event *queue_pop(struct signal_dispatcher *d)
+{
+	struct deferred_event *tail = d->tail;
+	struct deferred_event *next = next_event(tail);
+
+	if (tail == &d->stub) {
+		if (!next)
+			return NULL;
+
+		d->tail = next;
+		tail = next;
+		next = next_event(next);
+	}
+
+	if (next) {
+		d->tail = next;
+		return tail;
+	}
+
+	if (tail != os_atomic_load_ptr((void *const volatile*)&d->head))
+		return NULL;
+
+	queue_push(d, &d->stub);
+
+	next = next_event(tail);
+	if (next) {
+		d->tail = next;
+		return tail;
+	}
+
+	return NULL;
+}
+
+static void dispatcher_release(struct signal_dispatcher *d)
+{
+	if (os_atomic_dec_long(&d->refs) != 0)
+		return;
+
+	if (d->dropped)
+		blog(LOG_WARNING, "signal dispatcher: dropped %ld deferred "
+				"signals", d->dropped);
+
+	da_free(d->coalesce_buf);
+	pthread_mutex_destroy(&d->dispatch_mutex);
+	os_sem_destroy(d->sem);
+	bfree(d);
+}
+
+static void callback_release(struct signal_callback *cb)
+{
+	if (os_atomic_dec_long(&cb->refs) != 0)
+		return;
+
+	if (cb->deferred) {
+		struct deferred_callback *dc = cb->deferred;
+
+		dispatcher_release(dc->dispatcher);
+		da_free(dc->latest);
+		pthread_mutex_destroy(&dc->mutex);
+		bfree(dc);
+	}
+
+	if (cb->calls_done)
+		os_event_destroy(cb->calls_done);
+	bfree(cb);
+}
+
+static void dispatch_event(struct signal_dispatcher *d,
+		struct deferred_event *ev)
+{
+	struct signal_callback *cb = ev->cb;
+	bool coalesce = (cb->flags & SIGNAL_COALESCE) != 0;
+	calldata_t params;
+
+	calldata_init(&params);
+	params.stack = (uint8_t*)(ev + 1);
+	params.size  = ev->size;
+
+	if (coalesce) {
+		struct deferred_callback *dc = cb->deferred;
+
+		pthread_mutex_lock(&dc->mutex);
+		da_copy(d->coalesce_buf, dc->latest);
+		dc->queued = false;
+		pthread_mutex_unlock(&dc->mutex);
+
+		params.stack = d->coalesce_buf.array;
+		params.size  = d->coalesce_buf.num;
+	}
+
+	params.capacity = params.size;
+	params.fixed    = true;
+
+	pthread_mutex_lock(&d->dispatch_mutex);
+
+	if (!os_atomic_load_bool(&cb->removed)) {
+		deferred_cur = cb;
+		((signal_callback_t)cb->func)(cb->data, &params);
+		deferred_cur = NULL;
+	}
+
+	/* still locked, so the signal handler can't be destroyed meanwhile */
+	if (deferred_remove_cur) {
+		deferred_remove_cur = false;
+		callback_list_remove(cb->list, cb->func, cb->data);
+	}
+
+	pthread_mutex_unlock(&d->dispatch_mutex);
+
+	if (!coalesce)
+		bfree(ev);
+
+	os_atomic_dec_long(&d->pending);
+	callback_release(cb);
+}
+
+static void *dispatcher_thread(void *param)
+{
+	struct signal_dispatcher *d = param;
+	struct deferred_event *ev;
+
+	os_set_thread_name("signal dispatcher");
+
+	while (os_sem_wait(d->sem) == 0) {
+		while ((ev = queue_pop(d)) != NULL)
+			dispatch_event(d, ev);
+
+		if (os_atomic_load_bool(&d->stop))
+			break;
+	}
+
+	/* nothing can be queued any more, what's left is only released */
+	while ((ev = queue_pop(d)) != NULL)
+		dispatch_event(d, ev);
+
+	dispatcher_release(d);
+	return NULL;
+}
+
+static struct signal_dispatcher *dispatcher_create(void)
+{
+	struct signal_dispatcher *d = bzalloc(sizeof(*d));
+
+	d->refs = 1;
+	d->head = &d->stub;
+	d->tail = &d->stub;
+
+	if (os_sem_init(&d->sem, 0) != 0)
+		goto fail_sem;
+	if (pthread_mutex_init(&d->dispatch_mutex, NULL) != 0)
+		goto fail_mutex;
+	if (pthread_create(&d->thread, NULL, dispatcher_thread, d) != 0)
+		goto fail_thread;
+
+	return d;
+
+fail_thread:
+	pthread_mutex_destroy(&d->dispatch_mutex);
+fail_mutex:
+	os_sem_destroy(d->sem);
+fail_sem:
+	blog(LOG_ERROR, "Couldn't create signal dispatcher");
+	bfree(d);
+	return NULL;
+}
+
+/* the dispatcher thread runs while deferred callbacks are connected */
+static struct signal_dispatcher *dispatcher_add_user(void)
+{
+	struct signal_dispatcher *d;
+
+	pthread_mutex_lock(&dispatcher_mutex);
+
+	if (!dispatcher)
+		dispatcher = dispatcher_create();
+
+	d = dispatcher;
+	if (d) {
+		d->users++;
+		os_atomic_inc_long(&d->refs);
+	}
+
+	pthread_mutex_unlock(&dispatcher_mutex);
+	return d;
+}
+
+/* called once nothing can queue events for the callback any more */
+static void dispatcher_remove_user(struct signal_dispatcher *d)
+{
+	bool self = pthread_equal(pthread_self(), d->thread) != 0;
+	pthread_t thread = d->thread;
+	bool stop;
+
+	/* make sure the callback isn't being called right now */
+	if (!self) {
+		pthread_mutex_lock(&d->dispatch_mutex);
+		pthread_mutex_unlock(&d->dispatch_mutex);
+	}
+
+	pthread_mutex_lock(&dispatcher_mutex);
+	stop = --d->users == 0;
+	if (stop && dispatcher == d)
+		dispatcher = NULL;
+	pthread_mutex_unlock(&dispatcher_mutex);
+
+	if (!stop)
+		return;
+
+	os_atomic_set_bool(&d->stop, true);
+	os_sem_post(d->sem);
+
+	/* last deferred callback disconnected from within a deferred
+	 * callback, the thread exits after the callback returns */
+	if (self)
+		pthread_detach(thread);
+	else
+		pthread_join(thread, NULL);
+}
+
+static void defer_callback(struct signal_callback *cb, calldata_t *params)
+{
+	struct deferred_callback *dc = cb->deferred;
+	struct signal_dispatcher *d = dc->dispatcher;
+	size_t size = params ? params->size : 0;
+	struct deferred_event *ev;
+
+	if (cb->flags & SIGNAL_COALESCE) {
+		bool queued;
+
+		pthread_mutex_lock(&dc->mutex);
+		da_resize(dc->latest, size);
+		if (size)
+			memcpy(dc->latest.array, params->stack, size);
+		queued = dc->queued;
+		dc->queued = true;
+		pthread_mutex_unlock(&dc->mutex);
+
+		if (queued)
+			return;
+
+		ev = &dc->event;
+
+	} else {
+		if (os_atomic_load_long(&d->pending) >= MAX_DEFERRED_EVENTS) {
+			os_atomic_inc_long(&d->dropped);
+			return;
+		}
+
+		ev = bmalloc(sizeof(*ev) + size);
+		ev->size = size;
+		if (size)
+			memcpy(ev + 1, params->stack, size);
+	}
+
+	ev->cb = cb;
+	os_atomic_inc_long(&cb->refs);
+	os_atomic_inc_long(&d->pending);
+
+	queue_push(d, ev);
+	os_sem_post(d->sem);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void free_retired(struct callback_array **arrays,
+		size_t num_arrays, struct signal_callback **callbacks,
+		size_t num_callbacks)
+{
+	for (size_t i = 0; i < num_arrays; i++)
+		bfree(arrays[i]);
+	for (size_t i = 0; i < num_callbacks; i++)
+		callback_release(callbacks[i]);
+}
+
+static void callback_list_free(struct callback_list *list)
+{
+	struct callback_array *array = list->array;
+
+	if (array) {
+		for (size_t i = 0; i < array->num; i++) {
+			struct signal_callback *cb = array->callbacks[i];
+
+			if (cb->deferred) {
+				os_atomic_set_bool(&cb->removed, true);
+				dispatcher_remove_user(
+						cb->deferred->dispatcher);
+			}
+
+			callback_release(cb);
+		}
+		bfree(array);
+	}
+
+	free_retired(list->retired_arrays.array, list->retired_arrays.num,
+			list->retired_callbacks.array,
+			list->retired_callbacks.num);
+	da_free(list->retired_arrays);
+	da_free(list->retired_callbacks);
+	pthread_mutex_destroy(&list->mutex);
+}
+
+/* doesn't touch the array, which can only be used while counted in
+ * 'emitting' */
+static inline bool callback_list_empty(struct callback_list *list)
+{
+	return os_atomic_load_long(&list->num) == 0;
+}
+
+static inline size_t callback_array_find(struct callback_array *array,
+		callback_func_t func, void *data)
+{
+	if (array) {
+		for (size_t i = 0; i < array->num; i++) {
+			struct signal_callback *cb = array->callbacks[i];
+			if (cb->func == func && cb->data == data)
+				return i;
+		}
+	}
+
+	return DARRAY_INVALID;
+}
+
+/* must be called with the list mutex locked */
+static inline void publish_array(struct callback_list *list,
+		struct callback_array *array)
+{
+	struct callback_array *old = os_atomic_set_ptr(
+			(void *volatile*)&list->array, array);
+	os_atomic_set_long(&list->num, (long)array->num);
+	if (old) {
+		da_push_back(list->retired_arrays, &old);
+		os_atomic_set_bool(&list->has_retired, true);
+	}
+}
+
+/* frees what has been retired if no signal is in progress.  anything retired
+ * was replaced before it was retired, and signals load the array after
+ * counting themselves in 'emitting', so signals starting later can't be
+ * using it */
+static void callback_list_reclaim(struct callback_list *list, bool try_lock)
+{
+	DARRAY(struct callback_array*) arrays;
+	DARRAY(struct signal_callback*) callbacks;
+
+	if (!try_lock)
+		pthread_mutex_lock(&list->mutex);
+	else if (pthread_mutex_trylock(&list->mutex) != 0)
+		return;
+
+	if (!os_atomic_load_bool(&list->has_retired) ||
+	    os_atomic_load_long(&list->emitting) != 0) {
+		pthread_mutex_unlock(&list->mutex);
+		return;
+	}
+
+	arrays.da = list->retired_arrays.da;
+	callbacks.da = list->retired_callbacks.da;
+	da_init(list->retired_arrays);
+	da_init(list->retired_callbacks);
+	os_atomic_set_bool(&list->has_retired, false);
+
+	pthread_mutex_unlock(&list->mutex);
+
+	free_retired(arrays.array, arrays.num, callbacks.array, callbacks.num);
+	da_free(arrays);
+	da_free(callbacks);
+}
+
+static void callback_list_add(struct callback_list *list,
+		callback_func_t func, void *data, uint32_t flags)
+{
+	struct callback_array *array;
+	struct callback_array *new_array;
+	struct signal_callback *cb;
+	size_t num;
+
+	pthread_mutex_lock(&list->mutex);
+
+	array = list->array;
+	if (callback_array_find(array, func, data) != DARRAY_INVALID) {
+		pthread_mutex_unlock(&list->mutex);
+		return;
+	}
+
+	num = array ? array->num : 0;
+
+	cb = bzalloc(sizeof(*cb));
+	cb->func  = func;
+	cb->data  = data;
+	cb->refs  = 1;
+	cb->flags = flags;
+	cb->list  = list;
+
+	if (flags & (SIGNAL_DEFERRED | SIGNAL_COALESCE)) {
+		struct deferred_callback *dc = bzalloc(sizeof(*dc));
+
+		dc->dispatcher = dispatcher_add_user();
+		if (!dc->dispatcher ||
+		    pthread_mutex_init(&dc->mutex, NULL) != 0) {
+			if (dc->dispatcher)
+				dispatcher_remove_user(dc->dispatcher);
+			pthread_mutex_unlock(&list->mutex);
+			bfree(dc);
+			bfree(cb);
+			return;
+		}
+
+		cb->flags |= SIGNAL_DEFERRED;
+		cb->deferred = dc;
+	}
+
+	new_array = callback_array_create(num + 1);
+	if (num)
+		memcpy(new_array->callbacks, array->callbacks,
+				num * sizeof(struct signal_callback*));
+	new_array->callbacks[num] = cb;
+
+	/* the old array is freed by the next disconnect, once nothing can be
+	 * using it any more */
+	publish_array(list, new_array);
+
+	pthread_mutex_unlock(&list->mutex);
+}
+
+/* calls of the callback the current thread is in the middle of */
+static inline long own_calls(struct signal_callback *cb)
+{
+	long count = 0;
+
+	for (struct emit_frame *frame = emit_frames; frame;
+			frame = frame->prev) {
+		if (frame->calling && frame->cur == cb)
+			count++;
+	}
+
+	return count;
+}
+
+/* the callback is flagged as removed, so new calls don't start and only the
+ * calls already in progress are waited for */
+static void wait_for_calls(struct signal_callback *cb, long own)
+{
+	os_event_t *event;
+
+	if (os_atomic_load_long(&cb->calls) <= own)
+		return;
+
+	if (os_event_init(&event, OS_EVENT_TYPE_AUTO) != 0) {
+		while (os_atomic_load_long(&cb->calls) > own)
+			os_sleep_ms(1);
+		return;
+	}
+
+	/* every call returning from now on signals it, and the count is
+	 * checked again after publishing it so no return is missed */
+	os_atomic_set_ptr((void *volatile*)&cb->calls_done, event);
+
+	while (os_atomic_load_long(&cb->calls) > own)
+		os_event_wait(event);
+}
+
+static void callback_list_remove(struct callback_list *list,
+		callback_func_t func, void *data)
+{
+	struct callback_array *array;
+	struct callback_array *new_array;
+	struct signal_callback *cb;
+	size_t idx;
+
+	pthread_mutex_lock(&list->mutex);
+
+	array = list->array;
+	idx = callback_array_find(array, func, data);
+	if (idx == DARRAY_INVALID) {
+		pthread_mutex_unlock(&list->mutex);
+		return;
+	}
+
+	/* signals in progress skip it from now on */
+	cb = array->callbacks[idx];
+	os_atomic_set_bool(&cb->removed, true);
+
+	new_array = callback_array_create(array->num - 1);
+	memcpy(new_array->callbacks, array->callbacks,
+			idx * sizeof(struct signal_callback*));
+	memcpy(new_array->callbacks + idx, array->callbacks + idx + 1,
+			(array->num - idx - 1) * sizeof(struct signal_callback*));
+	publish_array(list, new_array);
+
+	da_push_back(list->retired_callbacks, &cb);
+
+	pthread_mutex_unlock(&list->mutex);
+
+	/* no lock is held while waiting, so callbacks on other threads can
+	 * still connect and disconnect */
+	wait_for_calls(cb, own_calls(cb));
+
+	if (cb->deferred)
+		dispatcher_remove_user(cb->deferred->dispatcher);
+
+	callback_list_reclaim(list, false);
+}
+
+static inline void callback_list_begin(struct callback_list *list,
+		struct emit_frame *frame, struct callback_array **array)
+{
+	frame->list = list;
+	frame->cur = NULL;
+	frame->calling = false;
+	frame->remove_cur = false;
+	frame->prev = emit_frames;
+
+	/* counted before loading the array, so arrays retired after this
+	 * point are not freed until this signal ends */
+	os_atomic_inc_long(&list->emitting);
+	*array = get_array(list);
+	emit_frames = frame;
+}
+
+static inline void callback_list_end(struct callback_list *list,
+		struct emit_frame *frame)
+{
+	emit_frames = frame->prev;
+
+	if (os_atomic_dec_long(&list->emitting) == 0 &&
+	    os_atomic_load_bool(&list->has_retired))
+		callback_list_reclaim(list, true);
+}
+
+static inline bool callback_active(struct signal_callback *cb)
+{
+	return !os_atomic_load_bool(&cb->removed);
+}
+
+static inline void callback_leave(struct signal_callback *cb)
+{
+	os_event_t *event;
+
+	os_atomic_dec_long(&cb->calls);
+	if (callback_active(cb))
+		return;
+
+	event = os_atomic_load_ptr((void *const volatile*)&cb->calls_done);
+	if (event)
+		os_event_signal(event);
+}
+
+/* checked before counting the call too, so that once a callback is removed
+ * new signals don't touch its count and can't delay the disconnect */
+static inline bool callback_enter(struct signal_callback *cb)
+{
+	if (!callback_active(cb))
+		return false;
+
+	os_atomic_inc_long(&cb->calls);
+	if (callback_active(cb))
+		return true;
+
+	callback_leave(cb);
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+
 struct signal_info {
 	struct decl_info               func;
-	DARRAY(struct signal_callback) callbacks;
+	struct signal_handler          *handler;
+	struct callback_list           callbacks;
+
+	struct signal_info             *volatile next;
+};
+
+struct signal_handler {
+	struct signal_info *volatile   first;
+
+	/* only used when adding signals, lookups don't lock */
 	pthread_mutex_t                mutex;
-	bool                           signalling;
 
-	struct signal_info             *next;
+	struct callback_list           global_callbacks;
 };
 
-static inline struct signal_info *signal_info_create(struct decl_info *info)
+static inline struct signal_info *signal_info_create(
+		struct signal_handler *handler, struct decl_info *info)
 {
-	pthread_mutexattr_t attr;
 	struct signal_info *si;
 
-	if (pthread_mutexattr_init(&attr) != 0)
-		return NULL;
-	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
-		return NULL;
-
 	si = bmalloc(sizeof(struct signal_info));
 
-	si->func       = *info;
-	si->next       = NULL;
-	si->signalling = false;
-	da_init(si->callbacks);
+	si->func    = *info;
+	si->handler = handler;
+	si->next    = NULL;
 
-	if (pthread_mutex_init(&si->mutex, &attr) != 0) {
+	if (!callback_list_init(&si->callbacks)) {
 		blog(LOG_ERROR, "Could not create signal");
 
 		decl_info_free(&si->func);
@@ -66,53 +799,31 @@ static inline struct signal_info *signal_info_create(struct decl_info *info)
 static inline void signal_info_destroy(struct signal_info *si)
 {
 	if (si) {
-		pthread_mutex_destroy(&si->mutex);
+		callback_list_free(&si->callbacks);
 		decl_info_free(&si->func);
-		da_free(si->callbacks);
 		bfree(si);
 	}
 }
 
-static inline size_t signal_get_callback_idx(struct signal_info *si,
-		signal_callback_t callback, void *data)
+static inline struct signal_info *next_signal(struct signal_info *si)
 {
-	for (size_t i = 0; i < si->callbacks.num; i++) {
-		struct signal_callback *sc = si->callbacks.array+i;
-
-		if (sc->callback == callback && sc->data == data)
-			return i;
-	}
-
-	return DARRAY_INVALID;
+	return os_atomic_load_ptr((void *const volatile*)&si->next);
 }
 
-struct global_callback_info {
-	global_signal_callback_t callback;
-	void                     *data;
-	long                     signaling;
-	bool                     remove;
-};
-
-struct signal_handler {
-	struct signal_info *first;
-	pthread_mutex_t    mutex;
-
-	DARRAY(struct global_callback_info) global_callbacks;
-	pthread_mutex_t                     global_callbacks_mutex;
-};
-
+/* signals are only ever appended, and are fully set up before they're
+ * linked in, so the list can be walked without locking */
 static struct signal_info *getsignal(signal_handler_t *handler,
 		const char *name, struct signal_info **p_last)
 {
 	struct signal_info *signal, *last= NULL;
 
-	signal = handler->first;
+	signal = os_atomic_load_ptr((void *const volatile*)&handler->first);
 	while (signal != NULL) {
 		if (strcmp(signal->func.name, name) == 0)
 			break;
 
 		last = signal;
-		signal = signal->next;
+		signal = next_signal(signal);
 	}
 
 	if (p_last)
@@ -127,18 +838,12 @@ signal_handler_t *signal_handler_create(void)
 	struct signal_handler *handler = bzalloc(sizeof(struct signal_handler));
 	handler->first = NULL;
 
-	pthread_mutexattr_t attr;
-	if (pthread_mutexattr_init(&attr) != 0)
-		return NULL;
-	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
-		return NULL;
-
 	if (pthread_mutex_init(&handler->mutex, NULL) != 0) {
 		blog(LOG_ERROR, "Couldn't create signal handler mutex!");
 		bfree(handler);
 		return NULL;
 	}
-	if (pthread_mutex_init(&handler->global_callbacks_mutex, &attr) != 0) {
+	if (!callback_list_init(&handler->global_callbacks)) {
 		blog(LOG_ERROR, "Couldn't create signal handler global "
 				"callbacks mutex!");
 		pthread_mutex_destroy(&handler->mutex);
@@ -159,8 +864,7 @@ void signal_handler_destroy(signal_handler_t *handler)
 			sig = next;
 		}
 
-		da_free(handler->global_callbacks);
-		pthread_mutex_destroy(&handler->global_callbacks_mutex);
+		callback_list_free(&handler->global_callbacks);
 		pthread_mutex_destroy(&handler->mutex);
 		bfree(handler);
 	}
@@ -185,11 +889,14 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 		decl_info_free(&func);
 		success = false;
 	} else {
-		sig = signal_info_create(&func);
-		if (!last)
-			handler->first = sig;
+		sig = signal_info_create(handler, &func);
+		if (!sig)
+			success = false;
+		else if (!last)
+			os_atomic_set_ptr((void *volatile*)&handler->first,
+					sig);
 		else
-			last->next = sig;
+			os_atomic_set_ptr((void *volatile*)&last->next, sig);
 	}
 
 	pthread_mutex_unlock(&handler->mutex);
@@ -197,181 +904,173 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 	return success;
 }
 
+signal_handle_t *signal_handler_get_handle(signal_handler_t *handler,
+		const char *signal)
+{
+	return (handler && signal) ? getsignal(handler, signal, NULL) : NULL;
+}
+
 void signal_handler_connect(signal_handler_t *handler, const char *signal,
 		signal_callback_t callback, void *data)
 {
-	struct signal_info *sig, *last;
-	struct signal_callback cb_data = {callback, data, false};
-	size_t idx;
+	signal_handler_connect_flags(handler, signal, callback, data, 0);
+}
+
+void signal_handler_connect_flags(signal_handler_t *handler,
+		const char *signal, signal_callback_t callback, void *data,
+		uint32_t flags)
+{
+	struct signal_info *sig;
 
 	if (!handler)
 		return;
 
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, signal, &last);
-	pthread_mutex_unlock(&handler->mutex);
-
+	sig = getsignal(handler, signal, NULL);
 	if (!sig) {
 		blog(LOG_WARNING, "signal_handler_connect: "
 		                  "signal '%s' not found", signal);
 		return;
 	}
 
-	/* -------------- */
-
-	pthread_mutex_lock(&sig->mutex);
-
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (idx == DARRAY_INVALID)
-		da_push_back(sig->callbacks, &cb_data);
-
-	pthread_mutex_unlock(&sig->mutex);
+	callback_list_add(&sig->callbacks, (callback_func_t)callback, data,
+			flags);
 }
 
-static inline struct signal_info *getsignal_locked(signal_handler_t *handler,
-		const char *name)
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
+		signal_callback_t callback, void *data)
 {
 	struct signal_info *sig;
 
 	if (!handler)
-		return NULL;
+		return;
 
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, name, NULL);
-	pthread_mutex_unlock(&handler->mutex);
+	sig = getsignal(handler, signal, NULL);
+	if (sig)
+		callback_list_remove(&sig->callbacks,
+				(callback_func_t)callback, data);
+}
 
-	return sig;
+void signal_handler_remove_current(void)
+{
+	if (emit_frames && emit_frames->cur)
+		emit_frames->remove_cur = true;
+	else if (deferred_cur)
+		deferred_remove_cur = true;
 }
 
-void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
-		signal_callback_t callback, void *data)
+/* called after the callback returns, so the removal only waits for other
+ * threads */
+static inline void remove_if_requested(struct emit_frame *frame)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
-	size_t idx;
+	if (frame->remove_cur) {
+		struct signal_callback *cb = frame->cur;
+		frame->remove_cur = false;
+		callback_list_remove(frame->list, cb->func, cb->data);
+	}
+}
 
-	if (!sig)
+static void signal_global(signal_handler_t *handler, const char *signal,
+		calldata_t *params)
+{
+	struct callback_array *array;
+	struct emit_frame frame;
+
+	if (callback_list_empty(&handler->global_callbacks))
 		return;
 
-	pthread_mutex_lock(&sig->mutex);
+	callback_list_begin(&handler->global_callbacks, &frame, &array);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (idx != DARRAY_INVALID) {
-		if (sig->signalling)
-			sig->callbacks.array[idx].remove = true;
-		else
-			da_erase(sig->callbacks, idx);
-	}
+	for (size_t i = 0; i < array->num; i++) {
+		struct signal_callback *cb = array->callbacks[i];
+		if (!callback_enter(cb))
+			continue;
 
-	pthread_mutex_unlock(&sig->mutex);
-}
+		frame.cur = cb;
+		frame.calling = true;
+		((global_signal_callback_t)cb->func)(cb->data, signal, params);
+		frame.calling = false;
 
-static THREAD_LOCAL struct signal_callback *current_signal_cb = NULL;
-static THREAD_LOCAL struct global_callback_info *current_global_cb = NULL;
+		callback_leave(cb);
+		remove_if_requested(&frame);
+	}
 
-void signal_handler_remove_current(void)
-{
-	if (current_signal_cb)
-		current_signal_cb->remove = true;
-	else if (current_global_cb)
-		current_global_cb->remove = true;
+	callback_list_end(&handler->global_callbacks, &frame);
 }
 
-void signal_handler_signal(signal_handler_t *handler, const char *signal,
-		calldata_t *params)
+void signal_handle_emit(signal_handle_t *sig, calldata_t *params)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
+	struct callback_array *array;
+	struct emit_frame frame;
 
 	if (!sig)
 		return;
 
-	pthread_mutex_lock(&sig->mutex);
-	sig->signalling = true;
+	if (!callback_list_empty(&sig->callbacks)) {
+		callback_list_begin(&sig->callbacks, &frame, &array);
 
-	for (size_t i = 0; i < sig->callbacks.num; i++) {
-		struct signal_callback *cb = sig->callbacks.array+i;
-		if (!cb->remove) {
-			current_signal_cb = cb;
-			cb->callback(cb->data, params);
-			current_signal_cb = NULL;
-		}
-	}
+		for (size_t i = 0; i < array->num; i++) {
+			struct signal_callback *cb = array->callbacks[i];
+			if (!callback_enter(cb))
+				continue;
 
-	for (size_t i = sig->callbacks.num; i > 0; i--) {
-		struct signal_callback *cb = sig->callbacks.array+i-1;
-		if (cb->remove)
-			da_erase(sig->callbacks, i-1);
-	}
+			if (cb->deferred) {
+				defer_callback(cb, params);
+				callback_leave(cb);
+				continue;
+			}
 
-	sig->signalling = false;
-	pthread_mutex_unlock(&sig->mutex);
+			frame.cur = cb;
+			frame.calling = true;
+			((signal_callback_t)cb->func)(cb->data, params);
+			frame.calling = false;
 
-	pthread_mutex_lock(&handler->global_callbacks_mutex);
+			callback_leave(cb);
+			remove_if_requested(&frame);
+		}
 
-	if (handler->global_callbacks.num) {
-		for (size_t i = 0; i < handler->global_callbacks.num; i++) {
-			struct global_callback_info *cb =
-				handler->global_callbacks.array + i;
+		callback_list_end(&sig->callbacks, &frame);
+	}
 
-			if (!cb->remove) {
-				cb->signaling++;
-				current_global_cb = cb;
-				cb->callback(cb->data, signal, params);
-				current_global_cb = NULL;
-				cb->signaling--;
-			}
-		}
+	signal_global(sig->handler, sig->func.name, params);
+}
 
-		for (size_t i = handler->global_callbacks.num; i > 0; i--) {
-			struct global_callback_info *cb =
-				handler->global_callbacks.array + (i - 1);
+bool signal_handle_has_callbacks(signal_handle_t *sig)
+{
+	if (!sig)
+		return false;
 
-			if (cb->remove && !cb->signaling)
-				da_erase(handler->global_callbacks, i - 1);
-		}	
-	}
+	return !callback_list_empty(&sig->callbacks) ||
+	       !callback_list_empty(&sig->handler->global_callbacks);
+}
 
-	pthread_mutex_unlock(&handler->global_callbacks_mutex);
+void signal_handle_init_calldata(signal_handle_t *sig, calldata_t *params)
+{
+	calldata_init_decl(params, sig ? &sig->func : NULL);
+}
+
+void signal_handler_signal(signal_handler_t *handler, const char *signal,
+		calldata_t *params)
+{
+	if (handler)
+		signal_handle_emit(getsignal(handler, signal, NULL), params);
 }
 
 void signal_handler_connect_global(signal_handler_t *handler,
 		global_signal_callback_t callback, void *data)
 {
-	struct global_callback_info cb_data = {callback, data, 0, false};
-	size_t idx;
-
 	if (!handler || !callback)
 		return;
 
-	pthread_mutex_lock(&handler->global_callbacks_mutex);
-
-	idx = da_find(handler->global_callbacks, &cb_data, 0);
-	if (idx == DARRAY_INVALID)
-		da_push_back(handler->global_callbacks, &cb_data);
-
-	pthread_mutex_unlock(&handler->global_callbacks_mutex);
+	callback_list_add(&handler->global_callbacks,
+			(callback_func_t)callback, data, 0);
 }
 
 void signal_handler_disconnect_global(signal_handler_t *handler,
 		global_signal_callback_t callback, void *data)
 {
-	struct global_callback_info cb_data = {callback, data, false};
-	size_t idx;
-
 	if (!handler || !callback)
 		return;
 
-	pthread_mutex_lock(&handler->global_callbacks_mutex);
-
-	idx = da_find(handler->global_callbacks, &cb_data, 0);
-	if (idx != DARRAY_INVALID) {
-		struct global_callback_info *cb =
-			handler->global_callbacks.array + idx;
-
-		if (cb->signaling)
-			cb->remove = true;
-		else
-			da_erase(handler->global_callbacks, idx);
-	}
-
-	pthread_mutex_unlock(&handler->global_callbacks_mutex);
+	callback_list_remove(&handler->global_callbacks,
+			(callback_func_t)callback, data);
 }
@@ -32,7 +32,9 @@ extern "C" {
  */
 
 struct signal_handler;
+struct signal_info;
 typedef struct signal_handler signal_handler_t;
+typedef struct signal_info    signal_handle_t;
 typedef void (*global_signal_callback_t)(void*, const char*, calldata_t*);
 typedef void (*signal_callback_t)(void*, calldata_t*);
 
@@ -58,6 +60,28 @@ static inline bool signal_handler_add_array(signal_handler_t *handler,
 
 EXPORT void signal_handler_connect(signal_handler_t *handler,
 		const char *signal, signal_callback_t callback, void *data);
+
+/**
+ * The callback is called from a dispatcher thread instead of the thread
+ * that signals, with a copy of the parameters, so a slow callback can't
+ * delay the audio or graphics threads.  Out parameters are not returned, and
+ * pointers in the parameters are not guaranteed to still be valid.
+ * Disconnecting still guarantees the callback won't be called any more once
+ * it returns, so deferred callbacks must not wait on the thread that
+ * disconnects them.
+ */
+#define SIGNAL_DEFERRED (1<<0)
+
+/**
+ * Deferred, and if the callback hasn't been called yet for the previous
+ * signal, only the latest parameters are delivered.  For level meters and
+ * other signals where only the latest value matters.
+ */
+#define SIGNAL_COALESCE (1<<1)
+
+EXPORT void signal_handler_connect_flags(signal_handler_t *handler,
+		const char *signal, signal_callback_t callback, void *data,
+		uint32_t flags);
 EXPORT void signal_handler_disconnect(signal_handler_t *handler,
 		const char *signal, signal_callback_t callback, void *data);
 
@@ -71,6 +95,31 @@ EXPORT void signal_handler_remove_current(void);
 EXPORT void signal_handler_signal(signal_handler_t *handler, const char *signal,
 		calldata_t *params);
 
+/**
+ * Resolves a signal name once so that frequently emitted signals don't need
+ * to be looked up by name every time.  Handles stay valid for the lifetime
+ * of the signal handler.  Returns NULL if the signal hasn't been added.
+ */
+EXPORT signal_handle_t *signal_handler_get_handle(signal_handler_t *handler,
+		const char *signal);
+
+/** Same as signal_handler_signal, with a pre-resolved signal */
+EXPORT void signal_handle_emit(signal_handle_t *signal, calldata_t *params);
+
+/**
+ * Returns whether anything would be called by emitting the signal, to skip
+ * preparing the parameters of signals nobody listens to
+ */
+EXPORT bool signal_handle_has_callbacks(signal_handle_t *signal);
+
+/**
+ * Initializes calldata from the signal's declaration, so its parameters can
+ * be set with calldata_set_indexed_* in declaration order.  Like any
+ * calldata, it must be freed with calldata_free.
+ */
+EXPORT void signal_handle_init_calldata(signal_handle_t *signal,
+		calldata_t *params);
+
 #ifdef __cplusplus
 }
 #endif
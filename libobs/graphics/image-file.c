@@ -119,20 +119,16 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path)
 
 	image->is_animated_gif = (image->gif.frame_count > 1 && result >= 0);
 	if (image->is_animated_gif) {
-		gif_decode_frame(&image->gif, 0);
-
+		/* frames are decoded into the cache as they're first shown,
+		 * so the cache memory is left uninitialized until then */
 		image->animation_frame_cache = bzalloc(
 				image->gif.frame_count * sizeof(uint8_t*));
-		image->animation_frame_data = bzalloc(
+		image->animation_frame_data = bmalloc(
 				get_full_decoded_gif_size(image));
 
-		for (unsigned int i = 0; i < image->gif.frame_count; i++) {
-			if (gif_decode_frame(&image->gif, i) != GIF_OK)
-				blog(LOG_WARNING, "Couldn't decode frame %u "
-						"of '%s'", i, path);
-		}
-
-		gif_decode_frame(&image->gif, 0);
+		if (gif_decode_frame(&image->gif, 0) != GIF_OK)
+			blog(LOG_WARNING, "Couldn't decode first frame "
+					"of '%s'", path);
 
 		image->cx = (uint32_t)image->gif.width;
 		image->cy = (uint32_t)image->gif.height;
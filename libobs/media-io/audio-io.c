@@ -26,6 +26,7 @@
 
 #include "audio-io.h"
 #include "audio-resampler.h"
+#include "audio-math.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
@@ -66,6 +67,11 @@ struct audio_output {
 	void                       *input_param;
 	pthread_mutex_t            input_mutex;
 	struct audio_mix           mixes[MAX_AUDIO_MIXES];
+
+	volatile bool              precise_timing;
+	pthread_mutex_t            clock_mutex;
+	audio_clock_callback_t     clock_cb;
+	void                       *clock_param;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -164,7 +170,8 @@ static inline void do_audio_output(struct audio_output *audio,
 	pthread_mutex_unlock(&audio->input_mutex);
 }
 
-static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
+static inline void clamp_audio_output(struct audio_output *audio, size_t bytes,
+		uint32_t active_mixes)
 {
 	size_t float_size = bytes / sizeof(float);
 
@@ -172,20 +179,11 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		if ((active_mixes & (1 << mix_idx)) == 0)
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val >  1.0f) ?  1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			audio_clamp_floats(mix->buffer[plane], float_size);
 	}
 }
 
@@ -213,12 +211,14 @@ static void input_and_output(struct audio_output *audio,
 	}
 	pthread_mutex_unlock(&audio->input_mutex);
 
-	/* clear mix buffers */
+	/* clear mix buffers, only active mixes are mixed into and output, so
+	 * there is no need to touch the rest */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
-		memset(mix->buffer[0], 0, AUDIO_OUTPUT_FRAMES *
-				MAX_AUDIO_CHANNELS * sizeof(float));
+		if ((active_mixes & (1 << mix_idx)) != 0)
+			memset(mix->buffer[0], 0, AUDIO_OUTPUT_FRAMES *
+					MAX_AUDIO_CHANNELS * sizeof(float));
 
 		for (size_t i = 0; i < audio->planes; i++)
 			data[mix_idx].data[i] = mix->buffer[i];
@@ -231,24 +231,93 @@ static void input_and_output(struct audio_output *audio,
 		return;
 
 	/* clamps audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+	clamp_audio_output(audio, bytes, active_mixes);
 
 	/* output */
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if ((active_mixes & (1 << i)) != 0)
+			do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	}
+}
+
+/* the furthest the device clock is allowed to pull the tick deadlines away
+ * from the system clock, anything beyond that is treated as the device being
+ * changed or restarted */
+#define MAX_CLOCK_OFFSET_NS 50000000LL
+
+struct audio_clock_state {
+	bool     valid;
+	uint64_t device_base;
+	uint64_t sys_base;
+	int64_t  offset;
+};
+
+static inline void reset_clock_state(struct audio_clock_state *clock,
+		uint64_t device_ts, uint64_t sys_ts)
+{
+	clock->valid       = true;
+	clock->device_base = device_ts;
+	clock->sys_base    = sys_ts;
+	clock->offset      = 0;
+}
+
+/* updates how far the system clock has run ahead of (or behind) the device
+ * clock since the device clock was picked up.  device clocks tend to advance
+ * in buffer sized steps, so the offset is smoothed to keep those steps from
+ * showing up as tick jitter. */
+static void update_clock_state(struct audio_output *audio,
+		struct audio_clock_state *clock)
+{
+	uint64_t device_ts = 0;
+	uint64_t sys_ts;
+	int64_t offset;
+	bool have_clock = false;
+
+	pthread_mutex_lock(&audio->clock_mutex);
+	if (audio->clock_cb)
+		have_clock = audio->clock_cb(audio->clock_param, &device_ts);
+	sys_ts = os_gettime_ns();
+	pthread_mutex_unlock(&audio->clock_mutex);
+
+	if (!have_clock) {
+		clock->valid = false;
+		return;
+	}
+
+	if (!clock->valid) {
+		reset_clock_state(clock, device_ts, sys_ts);
+		return;
+	}
+
+	offset = (int64_t)(sys_ts - clock->sys_base) -
+		(int64_t)(device_ts - clock->device_base);
+
+	if (llabs(offset - clock->offset) > MAX_CLOCK_OFFSET_NS) {
+		reset_clock_state(clock, device_ts, sys_ts);
+		return;
+	}
+
+	clock->offset += (offset - clock->offset) / 16;
+	clock->offset = CLAMP(clock->offset, -MAX_CLOCK_OFFSET_NS,
+			MAX_CLOCK_OFFSET_NS);
+}
+
+static inline int64_t clock_offset(const struct audio_clock_state *clock)
+{
+	return clock->valid ? clock->offset : 0;
 }
 
 static void *audio_thread(void *param)
 {
 	struct audio_output *audio = param;
+	struct audio_clock_state clock = {0};
 	size_t rate = audio->info.samples_per_sec;
 	uint64_t samples = 0;
 	uint64_t start_time = os_gettime_ns();
 	uint64_t prev_time = start_time;
 	uint64_t audio_time = prev_time;
-	uint32_t audio_wait_time =
-		(uint32_t)(audio_frames_to_ns(rate, AUDIO_OUTPUT_FRAMES) /
-				1000000);
+	uint64_t tick_ns = audio_frames_to_ns(rate, AUDIO_OUTPUT_FRAMES);
+	uint32_t audio_wait_time = (uint32_t)(tick_ns / 1000000);
 
 	os_set_thread_name("audio-io: audio thread");
 
@@ -256,14 +325,26 @@ static void *audio_thread(void *param)
 		profile_store_name(obs_get_profiler_name_store(),
 				"audio_thread(%s)", audio->info.name);
 
+	/* time between calls of the root is the tick jitter */
+	profile_register_root(audio_thread_name, tick_ns);
+
 	while (os_event_try(audio->stop_event) == EAGAIN) {
 		uint64_t cur_time;
 
-		os_sleep_ms(audio_wait_time);
+		if (audio->precise_timing) {
+			/* the next tick is due once the end of the previous
+			 * one has been reached */
+			update_clock_state(audio, &clock);
+			os_sleepto_ns(audio_time + clock_offset(&clock));
+		} else {
+			clock.valid = false;
+			os_sleep_ms(audio_wait_time);
+		}
 
 		profile_start(audio_thread_name);
 
-		cur_time = os_gettime_ns();
+		cur_time = os_gettime_ns() - clock_offset(&clock);
+
 		while (audio_time <= cur_time) {
 			samples += AUDIO_OUTPUT_FRAMES;
 			audio_time = start_time +
@@ -408,6 +489,8 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 	if (!out)
 		goto fail;
 
+	pthread_mutex_init_value(&out->clock_mutex);
+
 	memcpy(&out->info, info, sizeof(struct audio_output_info));
 	out->channels   = get_audio_channels(info->speakers);
 	out->planes     = planar ? out->channels : 1;
@@ -422,6 +505,8 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 		goto fail;
 	if (pthread_mutex_init(&out->input_mutex, &attr) != 0)
 		goto fail;
+	if (pthread_mutex_init(&out->clock_mutex, NULL) != 0)
+		goto fail;
 	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
@@ -458,9 +543,33 @@ void audio_output_close(audio_t *audio)
 	}
 
 	os_event_destroy(audio->stop_event);
+	pthread_mutex_destroy(&audio->clock_mutex);
 	bfree(audio);
 }
 
+void audio_output_set_precise_timing(audio_t *audio, bool precise)
+{
+	if (audio)
+		audio->precise_timing = precise;
+}
+
+bool audio_output_precise_timing_enabled(const audio_t *audio)
+{
+	return audio ? audio->precise_timing : false;
+}
+
+void audio_output_set_clock(audio_t *audio,
+		audio_clock_callback_t callback, void *param)
+{
+	if (!audio)
+		return;
+
+	pthread_mutex_lock(&audio->clock_mutex);
+	audio->clock_cb    = callback;
+	audio->clock_param = param;
+	pthread_mutex_unlock(&audio->clock_mutex);
+}
+
 const struct audio_output_info *audio_output_get_info(const audio_t *audio)
 {
 	return audio ? &audio->info : NULL;
@@ -227,6 +227,29 @@ EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *audio_output_get_info(
 		const audio_t *audio);
 
+/**
+ * Device clock used to pace the audio thread.  Stores the current time of the
+ * device clock in nanoseconds (on any epoch) in ts, and returns false if the
+ * clock is currently unavailable.
+ */
+typedef bool (*audio_clock_callback_t)(void *param, uint64_t *ts);
+
+/**
+ * Enables absolute-deadline timing for the audio thread.  When disabled (the
+ * default), the thread polls in millisecond sleeps and catches up on
+ * however many ticks have elapsed.
+ */
+EXPORT void audio_output_set_precise_timing(audio_t *audio, bool precise);
+EXPORT bool audio_output_precise_timing_enabled(const audio_t *audio);
+
+/**
+ * Slaves the tick deadlines of the audio thread to an external device clock.
+ * Only used with precise timing.  Pass NULL to go back to the system clock;
+ * once this returns the previous callback will no longer be called.
+ */
+EXPORT void audio_output_set_clock(audio_t *audio,
+		audio_clock_callback_t callback, void *param);
+
 
 #ifdef __cplusplus
 }
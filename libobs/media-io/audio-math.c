@@ -0,0 +1,482 @@
+/******************************************************************************
+    Copyright (C) 2026 by the OBS Studio contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-math.h"
+#include "../util/platform.h"
+#include "../util/base.h"
+#include <string.h>
+#include <xmmintrin.h>
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_AVX
+#endif
+
+/* every routine performs the same per-sample operations in the same order as
+ * the scalar loops it replaced, so the output is bit-identical regardless of
+ * which instruction set gets selected.  the exception is the sum of squares
+ * used for metering, which is accumulated per lane */
+
+static inline float clamp_float(float val)
+{
+	val = (val >  1.0f) ?  1.0f : val;
+	val = (val < -1.0f) ? -1.0f : val;
+	return val;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Scalar */
+
+static void mix_floats_c(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void mul_floats_c(float *data, float mul, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= mul;
+}
+
+static void mul_floats_varying_c(float *data, const float *mul, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= mul[i];
+}
+
+static void clamp_floats_c(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = clamp_float(data[i]);
+}
+
+static void peak_power_c(const float *data, size_t count, float *peak,
+		float *sum_squares)
+{
+	float max = 0.0f;
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < count; i++) {
+		max = fmaxf(max, fabsf(data[i]));
+		sum += data[i] * data[i];
+	}
+
+	*peak = max;
+	*sum_squares = sum;
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE */
+
+static void mix_floats_sse(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, _mm_add_ps(
+				_mm_loadu_ps(dst + i),
+				_mm_loadu_ps(src + i)));
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void mul_floats_sse(float *data, float mul, size_t count)
+{
+	__m128 mul_val = _mm_set1_ps(mul);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(data + i, _mm_mul_ps(
+				_mm_loadu_ps(data + i), mul_val));
+
+	for (; i < count; i++)
+		data[i] *= mul;
+}
+
+static void mul_floats_varying_sse(float *data, const float *mul,
+		size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(data + i, _mm_mul_ps(
+				_mm_loadu_ps(data + i),
+				_mm_loadu_ps(mul + i)));
+
+	for (; i < count; i++)
+		data[i] *= mul[i];
+}
+
+/* min/max return the second operand when either is NaN, so NaN passes
+ * through just like with the scalar comparisons */
+static void clamp_floats_sse(float *data, size_t count)
+{
+	__m128 pos_one = _mm_set1_ps(1.0f);
+	__m128 neg_one = _mm_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		val = _mm_min_ps(pos_one, val);
+		val = _mm_max_ps(neg_one, val);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	for (; i < count; i++)
+		data[i] = clamp_float(data[i]);
+}
+
+/* max(val, peak) returns peak when val is NaN, which matches fmaxf */
+static void peak_power_sse(const float *data, size_t count, float *peak,
+		float *sum_squares)
+{
+	__m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 peak_val = _mm_setzero_ps();
+	__m128 sum_val = _mm_setzero_ps();
+	float lanes_peak[4];
+	float lanes_sum[4];
+	float max = 0.0f;
+	float sum = 0.0f;
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		peak_val = _mm_max_ps(_mm_and_ps(val, abs_mask), peak_val);
+		sum_val = _mm_add_ps(sum_val, _mm_mul_ps(val, val));
+	}
+
+	_mm_storeu_ps(lanes_peak, peak_val);
+	_mm_storeu_ps(lanes_sum, sum_val);
+
+	for (size_t lane = 0; lane < 4; lane++) {
+		max = fmaxf(max, lanes_peak[lane]);
+		sum += lanes_sum[lane];
+	}
+
+	for (; i < count; i++) {
+		max = fmaxf(max, fabsf(data[i]));
+		sum += data[i] * data[i];
+	}
+
+	*peak = max;
+	*sum_squares = sum;
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX */
+
+TARGET_AVX
+static void mix_floats_avx(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(
+				_mm256_loadu_ps(dst + i),
+				_mm256_loadu_ps(src + i)));
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+TARGET_AVX
+static void mul_floats_avx(float *data, float mul, size_t count)
+{
+	__m256 mul_val = _mm256_set1_ps(mul);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(
+				_mm256_loadu_ps(data + i), mul_val));
+
+	for (; i < count; i++)
+		data[i] *= mul;
+}
+
+TARGET_AVX
+static void mul_floats_varying_avx(float *data, const float *mul,
+		size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(
+				_mm256_loadu_ps(data + i),
+				_mm256_loadu_ps(mul + i)));
+
+	for (; i < count; i++)
+		data[i] *= mul[i];
+}
+
+TARGET_AVX
+static void clamp_floats_avx(float *data, size_t count)
+{
+	__m256 pos_one = _mm256_set1_ps(1.0f);
+	__m256 neg_one = _mm256_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		val = _mm256_min_ps(pos_one, val);
+		val = _mm256_max_ps(neg_one, val);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	for (; i < count; i++)
+		data[i] = clamp_float(data[i]);
+}
+
+TARGET_AVX
+static void peak_power_avx(const float *data, size_t count, float *peak,
+		float *sum_squares)
+{
+	__m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 peak_val = _mm256_setzero_ps();
+	__m256 sum_val = _mm256_setzero_ps();
+	float lanes_peak[8];
+	float lanes_sum[8];
+	float max = 0.0f;
+	float sum = 0.0f;
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		peak_val = _mm256_max_ps(_mm256_and_ps(val, abs_mask),
+				peak_val);
+		sum_val = _mm256_add_ps(sum_val, _mm256_mul_ps(val, val));
+	}
+
+	_mm256_storeu_ps(lanes_peak, peak_val);
+	_mm256_storeu_ps(lanes_sum, sum_val);
+
+	for (size_t lane = 0; lane < 8; lane++) {
+		max = fmaxf(max, lanes_peak[lane]);
+		sum += lanes_sum[lane];
+	}
+
+	for (; i < count; i++) {
+		max = fmaxf(max, fabsf(data[i]));
+		sum += data[i] * data[i];
+	}
+
+	*peak = max;
+	*sum_squares = sum;
+}
+
+/* ------------------------------------------------------------------------- */
+/* True peak
+ *
+ *   4x oversampling with a 48 tap windowed sinc interpolator, as suggested by
+ * ITU-R BS.1770.  The coefficients are grouped by input sample so that the
+ * four interpolated phases of an input sample are computed in one vector. */
+
+#define TRUE_PEAK_PHASES 4
+#define TRUE_PEAK_TAPS   (AUDIO_TRUE_PEAK_HISTORY + 1)
+#define TRUE_PEAK_CHUNK  256
+
+static float true_peak_coefs[TRUE_PEAK_TAPS][TRUE_PEAK_PHASES];
+
+static void init_true_peak_coefs(void)
+{
+	const double pi = 3.14159265358979323846;
+	const int num = TRUE_PEAK_TAPS * TRUE_PEAK_PHASES;
+	const double center = (double)(num - 1) / 2.0;
+
+	for (int phase = 0; phase < TRUE_PEAK_PHASES; phase++) {
+		double sum = 0.0;
+
+		for (int tap = 0; tap < TRUE_PEAK_TAPS; tap++) {
+			int k = tap * TRUE_PEAK_PHASES + phase;
+			double x = ((double)k - center) / TRUE_PEAK_PHASES;
+			double sinc = sin(pi * x) / (pi * x);
+			double window = 0.5 - 0.5 * cos(2.0 * pi *
+					((double)k + 0.5) / num);
+
+			true_peak_coefs[tap][phase] = (float)(sinc * window);
+			sum += sinc * window;
+		}
+
+		/* unity gain for every phase */
+		for (int tap = 0; tap < TRUE_PEAK_TAPS; tap++)
+			true_peak_coefs[tap][phase] /= (float)sum;
+	}
+}
+
+static float true_peak_chunk(const float *samples, size_t count)
+{
+	__m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 coefs[TRUE_PEAK_TAPS];
+	__m128 peak_val = _mm_setzero_ps();
+	float lanes[4];
+	float max = 0.0f;
+
+	for (size_t tap = 0; tap < TRUE_PEAK_TAPS; tap++)
+		coefs[tap] = _mm_loadu_ps(true_peak_coefs[tap]);
+
+	/* samples[AUDIO_TRUE_PEAK_HISTORY + i] is the current input sample,
+	 * preceded by the history */
+	for (size_t i = 0; i < count; i++) {
+		const float *cur = samples + AUDIO_TRUE_PEAK_HISTORY + i;
+		__m128 val = _mm_setzero_ps();
+
+		for (size_t tap = 0; tap < TRUE_PEAK_TAPS; tap++)
+			val = _mm_add_ps(val, _mm_mul_ps(coefs[tap],
+					_mm_set1_ps(cur[-(ptrdiff_t)tap])));
+
+		peak_val = _mm_max_ps(_mm_and_ps(val, abs_mask), peak_val);
+	}
+
+	_mm_storeu_ps(lanes, peak_val);
+	for (size_t lane = 0; lane < 4; lane++)
+		max = fmaxf(max, lanes[lane]);
+	return max;
+}
+
+float audio_get_true_peak(float *history, const float *data, size_t count)
+{
+	float samples[AUDIO_TRUE_PEAK_HISTORY + TRUE_PEAK_CHUNK];
+	float peak = 0.0f;
+
+	memcpy(samples, history, AUDIO_TRUE_PEAK_HISTORY * sizeof(float));
+
+	while (count) {
+		size_t chunk = count < TRUE_PEAK_CHUNK ?
+			count : TRUE_PEAK_CHUNK;
+
+		memcpy(samples + AUDIO_TRUE_PEAK_HISTORY, data,
+				chunk * sizeof(float));
+		peak = fmaxf(peak, true_peak_chunk(samples, chunk));
+
+		memmove(samples, samples + chunk,
+				AUDIO_TRUE_PEAK_HISTORY * sizeof(float));
+		data += chunk;
+		count -= chunk;
+	}
+
+	memcpy(history, samples, AUDIO_TRUE_PEAK_HISTORY * sizeof(float));
+	return peak;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Runtime dispatch */
+
+struct audio_math_funcs {
+	const char *name;
+	void (*mix)(float *dst, const float *src, size_t count);
+	void (*mul)(float *data, float mul, size_t count);
+	void (*mul_varying)(float *data, const float *mul, size_t count);
+	void (*clamp)(float *data, size_t count);
+	void (*peak_power)(const float *data, size_t count, float *peak,
+			float *sum_squares);
+};
+
+static const struct audio_math_funcs funcs_c = {
+	"C",
+	mix_floats_c,
+	mul_floats_c,
+	mul_floats_varying_c,
+	clamp_floats_c,
+	peak_power_c
+};
+
+static const struct audio_math_funcs funcs_sse = {
+	"SSE",
+	mix_floats_sse,
+	mul_floats_sse,
+	mul_floats_varying_sse,
+	clamp_floats_sse,
+	peak_power_sse
+};
+
+static const struct audio_math_funcs funcs_avx = {
+	"AVX",
+	mix_floats_avx,
+	mul_floats_avx,
+	mul_floats_varying_avx,
+	clamp_floats_avx,
+	peak_power_avx
+};
+
+static const struct audio_math_funcs *funcs = &funcs_sse;
+
+const char *audio_math_select(uint32_t features)
+{
+	features &= os_get_cpu_features();
+
+	if (features & OS_CPU_AVX)
+		funcs = &funcs_avx;
+	else if (features & OS_CPU_SSE2)
+		funcs = &funcs_sse;
+	else
+		funcs = &funcs_c;
+
+	return funcs->name;
+}
+
+void audio_math_init(void)
+{
+	const char *name;
+
+	init_true_peak_coefs();
+	name = audio_math_select(os_get_cpu_features());
+
+	blog(LOG_INFO, "Audio math: using %s routines", name);
+}
+
+void audio_mix_floats(float *dst, const float *src, size_t count)
+{
+	funcs->mix(dst, src, count);
+}
+
+void audio_mul_floats(float *data, float mul, size_t count)
+{
+	funcs->mul(data, mul, count);
+}
+
+void audio_mul_floats_varying(float *data, const float *mul, size_t count)
+{
+	funcs->mul_varying(data, mul, count);
+}
+
+void audio_clamp_floats(float *data, size_t count)
+{
+	funcs->clamp(data, count);
+}
+
+void audio_get_peak_and_power(const float *data, size_t count, float *peak,
+		float *sum_squares)
+{
+	funcs->peak_power(data, count, peak, sum_squares);
+}
+
+void audio_downmix_to_mono_planar(float **data, size_t channels,
+		size_t frames)
+{
+	const float channels_i = 1.0f / (float)channels;
+
+	for (size_t channel = 1; channel < channels; channel++)
+		funcs->mix(data[0], data[channel], frames);
+
+	funcs->mul(data[0], channels_i, frames);
+
+	for (size_t channel = 1; channel < channels; channel++)
+		memcpy(data[channel], data[0], frames * sizeof(float));
+}
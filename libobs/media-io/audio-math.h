@@ -20,6 +20,63 @@
 #include "../util/c99defs.h"
 #include <math.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Vectorized float buffer primitives used by audio mixing.  The fastest
+ * implementation supported by the CPU is selected by audio_math_init (called
+ * from obs_startup).  Results are identical to plain scalar loops, except
+ * for the sum of squares of audio_get_peak_and_power, which is accumulated
+ * per lane and can differ in the last bits.
+ */
+
+EXPORT void audio_math_init(void);
+
+/**
+ * Selects the fastest routines that only use the given OS_CPU_* features (and
+ * that the CPU supports), and returns their name.  0 selects the scalar
+ * routines.  Used to compare the routines against each other.
+ */
+EXPORT const char *audio_math_select(uint32_t features);
+
+/** dst[i] += src[i] */
+EXPORT void audio_mix_floats(float *dst, const float *src, size_t count);
+/** data[i] *= mul */
+EXPORT void audio_mul_floats(float *data, float mul, size_t count);
+/** data[i] *= mul[i] */
+EXPORT void audio_mul_floats_varying(float *data, const float *mul,
+		size_t count);
+/** clamps data[i] to [-1.0, 1.0] */
+EXPORT void audio_clamp_floats(float *data, size_t count);
+/**
+ * gets the largest absolute value and the sum of squares of data.  the sum is
+ * accumulated in a different order than a scalar loop would, so it isn't
+ * bit-identical to one
+ */
+EXPORT void audio_get_peak_and_power(const float *data, size_t count,
+		float *peak, float *sum_squares);
+
+/** number of previous samples audio_get_true_peak needs to keep */
+#define AUDIO_TRUE_PEAK_HISTORY 11
+
+/**
+ * gets the largest absolute value of data oversampled 4x (true peak).
+ * history carries the last input samples over to the next call, and starts
+ * out zeroed
+ */
+EXPORT float audio_get_true_peak(float *history, const float *data,
+		size_t count);
+
+/** averages all planes into every plane */
+EXPORT void audio_downmix_to_mono_planar(float **data, size_t channels,
+		size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
 #ifdef _MSC_VER
 #include <float.h>
 
@@ -16,8 +16,20 @@
 ******************************************************************************/
 
 #include "format-conversion.h"
+#include "../util/platform.h"
+#include "../util/base.h"
 #include <xmmintrin.h>
 #include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
  * CPU usage to boost by a tremendous amount in debug builds. */
@@ -89,7 +101,7 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
-void compress_uyvx_to_i420(
+static void compress_uyvx_to_i420_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -127,7 +139,7 @@ void compress_uyvx_to_i420(
 	}
 }
 
-void compress_uyvx_to_nv12(
+static void compress_uyvx_to_nv12_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -163,7 +175,7 @@ void compress_uyvx_to_nv12(
 	}
 }
 
-void convert_uyvx_to_i444(
+static void convert_uyvx_to_i444_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -202,7 +214,7 @@ void convert_uyvx_to_i444(
 	}
 }
 
-void decompress_420(
+static void decompress_420_c(
 		const uint8_t *const input[], const uint32_t in_linesize[],
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize)
@@ -237,7 +249,7 @@ void decompress_420(
 	}
 }
 
-void decompress_nv12(
+static void decompress_nv12_c(
 		const uint8_t *const input[], const uint32_t in_linesize[],
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize)
@@ -271,7 +283,7 @@ void decompress_nv12(
 	}
 }
 
-void decompress_422(
+static void decompress_422_c(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize,
@@ -322,3 +334,889 @@ void decompress_422(
 		}
 	}
 }
+
+/* ------------------------------------------------------------------------- */
+/* SSSE3 */
+
+#define Z -1
+
+static const int8_t shuf_uyvx_lum[16]  = {1, 5, 9,13, Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z};
+static const int8_t shuf_uyvx_u[16]    = {0, 4, 8,12, Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z};
+static const int8_t shuf_uyvx_v[16]    = {2, 6,10,14, Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z};
+
+/* chroma sums of two 2x2 blocks live in bytes 0/2 (block a) and 8/10
+ * (block b) after averaging */
+static const int8_t shuf_avg_2plane[16] = {0, 8, 2,10, Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z};
+static const int8_t shuf_avg_1plane[16] = {0, 2, 8,10, Z,Z,Z,Z, Z,Z,Z,Z, Z,Z,Z,Z};
+
+/* 422 -> 444: second pixel of each pair copies the second luma sample */
+static const int8_t shuf_422_lum[16]  = {0,1,2,3, 2,1,2,3, 4,5,6,7, 6,5,6,7};
+static const int8_t shuf_422_chr[16]  = {0,1,2,3, 0,3,2,3, 4,5,6,7, 4,7,6,7};
+
+/* 420 -> packed V,U,Y,0 (chroma pairs pre-interleaved as V,U) */
+static const int8_t shuf_420_chroma[4][16] = {
+	{ 0, 1,Z,Z,  0, 1,Z,Z,  2, 3,Z,Z,  2, 3,Z,Z},
+	{ 4, 5,Z,Z,  4, 5,Z,Z,  6, 7,Z,Z,  6, 7,Z,Z},
+	{ 8, 9,Z,Z,  8, 9,Z,Z, 10,11,Z,Z, 10,11,Z,Z},
+	{12,13,Z,Z, 12,13,Z,Z, 14,15,Z,Z, 14,15,Z,Z}
+};
+static const int8_t shuf_420_lum[4][16] = {
+	{Z,Z, 0,Z, Z,Z, 1,Z, Z,Z, 2,Z, Z,Z, 3,Z},
+	{Z,Z, 4,Z, Z,Z, 5,Z, Z,Z, 6,Z, Z,Z, 7,Z},
+	{Z,Z, 8,Z, Z,Z, 9,Z, Z,Z,10,Z, Z,Z,11,Z},
+	{Z,Z,12,Z, Z,Z,13,Z, Z,Z,14,Z, Z,Z,15,Z}
+};
+
+/* nv12 -> packed Y,U,V,0 */
+static const int8_t shuf_nv12_chroma[4][16] = {
+	{Z, 0, 1,Z, Z, 0, 1,Z, Z, 2, 3,Z, Z, 2, 3,Z},
+	{Z, 4, 5,Z, Z, 4, 5,Z, Z, 6, 7,Z, Z, 6, 7,Z},
+	{Z, 8, 9,Z, Z, 8, 9,Z, Z,10,11,Z, Z,10,11,Z},
+	{Z,12,13,Z, Z,12,13,Z, Z,14,15,Z, Z,14,15,Z}
+};
+static const int8_t shuf_nv12_lum[4][16] = {
+	{ 0,Z,Z,Z,  1,Z,Z,Z,  2,Z,Z,Z,  3,Z,Z,Z},
+	{ 4,Z,Z,Z,  5,Z,Z,Z,  6,Z,Z,Z,  7,Z,Z,Z},
+	{ 8,Z,Z,Z,  9,Z,Z,Z, 10,Z,Z,Z, 11,Z,Z,Z},
+	{12,Z,Z,Z, 13,Z,Z,Z, 14,Z,Z,Z, 15,Z,Z,Z}
+};
+
+#undef Z
+
+#define load_shuf(table) _mm_loadu_si128((const __m128i*)(table))
+
+#define store_u32(dst, val) \
+	*(uint32_t*)(dst) = (uint32_t)_mm_cvtsi128_si32(val)
+
+/* sums the U/V samples of each 2x2 block; the averages end up in the low
+ * byte of every 16bit word of dwords 0 and 2 (matching pack_ch_*) */
+#define avg_chroma(line1, line2, uv_mask, out)                                \
+do {                                                                          \
+	__m128i sum = _mm_add_epi16(                                          \
+			_mm_and_si128(line1, uv_mask),                        \
+			_mm_and_si128(line2, uv_mask));                       \
+	sum = _mm_add_epi16(sum,                                              \
+			_mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));     \
+	out = _mm_srli_epi16(sum, 2);                                         \
+} while (false)
+
+TARGET_SSSE3
+static void compress_uyvx_to_i420_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane   = output[0];
+	uint8_t  *u_plane     = output[1];
+	uint8_t  *v_plane     = output[2];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m128i lum_shuf = load_shuf(shuf_uyvx_lum);
+	__m128i uv_shuf  = load_shuf(shuf_avg_2plane);
+	__m128i uv_mask  = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos        = y      * in_linesize;
+		uint32_t chroma_y_pos = (y>>1) * out_linesize[1];
+		uint32_t lum_y_pos    = y      * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x*4;
+			uint32_t lum_pos0  = lum_y_pos + x;
+			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
+			uint32_t chroma_pos = chroma_y_pos + (x>>1);
+			uint32_t packed_vals;
+			__m128i avg;
+
+			__m128i line1 = _mm_load_si128((const __m128i*)img);
+			__m128i line2 = _mm_load_si128(
+					(const __m128i*)(img + in_linesize));
+
+			store_u32(lum_plane + lum_pos0,
+					_mm_shuffle_epi8(line1, lum_shuf));
+			store_u32(lum_plane + lum_pos1,
+					_mm_shuffle_epi8(line2, lum_shuf));
+
+			avg_chroma(line1, line2, uv_mask, avg);
+			packed_vals = (uint32_t)_mm_cvtsi128_si32(
+					_mm_shuffle_epi8(avg, uv_shuf));
+
+			*(uint16_t*)(u_plane+chroma_pos) = (uint16_t)(packed_vals);
+			*(uint16_t*)(v_plane+chroma_pos) = (uint16_t)(packed_vals>>16);
+		}
+	}
+}
+
+TARGET_SSSE3
+static void compress_uyvx_to_nv12_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane    = output[0];
+	uint8_t *chroma_plane = output[1];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m128i lum_shuf = load_shuf(shuf_uyvx_lum);
+	__m128i uv_shuf  = load_shuf(shuf_avg_1plane);
+	__m128i uv_mask  = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos        = y      * in_linesize;
+		uint32_t chroma_y_pos = (y>>1) * out_linesize[1];
+		uint32_t lum_y_pos    = y      * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x*4;
+			uint32_t lum_pos0  = lum_y_pos + x;
+			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
+			__m128i avg;
+
+			__m128i line1 = _mm_load_si128((const __m128i*)img);
+			__m128i line2 = _mm_load_si128(
+					(const __m128i*)(img + in_linesize));
+
+			store_u32(lum_plane + lum_pos0,
+					_mm_shuffle_epi8(line1, lum_shuf));
+			store_u32(lum_plane + lum_pos1,
+					_mm_shuffle_epi8(line2, lum_shuf));
+
+			avg_chroma(line1, line2, uv_mask, avg);
+			store_u32(chroma_plane + chroma_y_pos + x,
+					_mm_shuffle_epi8(avg, uv_shuf));
+		}
+	}
+}
+
+TARGET_SSSE3
+static void convert_uyvx_to_i444_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane   = output[0];
+	uint8_t  *u_plane     = output[1];
+	uint8_t  *v_plane     = output[2];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m128i lum_shuf = load_shuf(shuf_uyvx_lum);
+	__m128i u_shuf   = load_shuf(shuf_uyvx_u);
+	__m128i v_shuf   = load_shuf(shuf_uyvx_v);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint8_t *img_line = input + y * in_linesize;
+		uint32_t lum_y_pos      = y * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x < width; x += 4) {
+			__m128i line = _mm_load_si128(
+					(const __m128i*)(img_line + x*4));
+
+			store_u32(lum_plane + lum_y_pos + x,
+					_mm_shuffle_epi8(line, lum_shuf));
+			store_u32(u_plane + lum_y_pos + x,
+					_mm_shuffle_epi8(line, u_shuf));
+			store_u32(v_plane + lum_y_pos + x,
+					_mm_shuffle_epi8(line, v_shuf));
+		}
+	}
+}
+
+#define decompress_4px_ssse3(out0, out1, chroma, lum0, lum1, c_tbl, l_tbl, g) \
+do {                                                                          \
+	__m128i c = _mm_shuffle_epi8(chroma, load_shuf(c_tbl[g]));            \
+	__m128i l_shuf = load_shuf(l_tbl[g]);                                 \
+	_mm_storeu_si128((__m128i*)(out0) + g,                                \
+			_mm_or_si128(c, _mm_shuffle_epi8(lum0, l_shuf)));     \
+	_mm_storeu_si128((__m128i*)(out1) + g,                                \
+			_mm_or_si128(c, _mm_shuffle_epi8(lum1, l_shuf)));     \
+} while (false)
+
+TARGET_SSSE3
+static void decompress_420_ssse3(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y/2;
+	uint32_t width_d2   = in_linesize[0]/2;
+	uint32_t height_d2  = end_y/2;
+	uint32_t y;
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0, *lum1;
+		uint32_t *output0, *output1;
+		uint32_t x;
+
+		lum0 = input[0] + y * 2 * in_linesize[0];
+		lum1 = lum0 + in_linesize[0];
+		output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
+
+		for (x = 0; x + 8 <= width_d2; x += 8) {
+			__m128i u  = _mm_loadl_epi64(
+					(const __m128i*)(chroma0 + x));
+			__m128i v  = _mm_loadl_epi64(
+					(const __m128i*)(chroma1 + x));
+			__m128i vu = _mm_unpacklo_epi8(v, u);
+			__m128i l0 = _mm_loadu_si128(
+					(const __m128i*)(lum0 + x*2));
+			__m128i l1 = _mm_loadu_si128(
+					(const __m128i*)(lum1 + x*2));
+			uint32_t *out0 = output0 + x*2;
+			uint32_t *out1 = output1 + x*2;
+
+			decompress_4px_ssse3(out0, out1, vu, l0, l1,
+					shuf_420_chroma, shuf_420_lum, 0);
+			decompress_4px_ssse3(out0, out1, vu, l0, l1,
+					shuf_420_chroma, shuf_420_lum, 1);
+			decompress_4px_ssse3(out0, out1, vu, l0, l1,
+					shuf_420_chroma, shuf_420_lum, 2);
+			decompress_4px_ssse3(out0, out1, vu, l0, l1,
+					shuf_420_chroma, shuf_420_lum, 3);
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = (chroma0[x] << 8) | chroma1[x];
+
+			output0[x*2]   = (lum0[x*2]   << 16) | out;
+			output0[x*2+1] = (lum0[x*2+1] << 16) | out;
+			output1[x*2]   = (lum1[x*2]   << 16) | out;
+			output1[x*2+1] = (lum1[x*2+1] << 16) | out;
+		}
+	}
+}
+
+TARGET_SSSE3
+static void decompress_nv12_ssse3(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y/2;
+	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2  = end_y/2;
+	uint32_t y;
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint16_t *chroma;
+		const uint8_t *lum0, *lum1;
+		uint32_t *output0, *output1;
+		uint32_t x;
+
+		chroma = (const uint16_t*)(input[1] + y * in_linesize[1]);
+		lum0 = input[0] + y * 2 * in_linesize[0];
+		lum1 = lum0 + in_linesize[0];
+		output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
+
+		for (x = 0; x + 8 <= width_d2; x += 8) {
+			__m128i uv = _mm_loadu_si128(
+					(const __m128i*)(chroma + x));
+			__m128i l0 = _mm_loadu_si128(
+					(const __m128i*)(lum0 + x*2));
+			__m128i l1 = _mm_loadu_si128(
+					(const __m128i*)(lum1 + x*2));
+			uint32_t *out0 = output0 + x*2;
+			uint32_t *out1 = output1 + x*2;
+
+			decompress_4px_ssse3(out0, out1, uv, l0, l1,
+					shuf_nv12_chroma, shuf_nv12_lum, 0);
+			decompress_4px_ssse3(out0, out1, uv, l0, l1,
+					shuf_nv12_chroma, shuf_nv12_lum, 1);
+			decompress_4px_ssse3(out0, out1, uv, l0, l1,
+					shuf_nv12_chroma, shuf_nv12_lum, 2);
+			decompress_4px_ssse3(out0, out1, uv, l0, l1,
+					shuf_nv12_chroma, shuf_nv12_lum, 3);
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = chroma[x] << 8;
+
+			output0[x*2]   = lum0[x*2]   | out;
+			output0[x*2+1] = lum0[x*2+1] | out;
+			output1[x*2]   = lum1[x*2]   | out;
+			output1[x*2+1] = lum1[x*2+1] | out;
+		}
+	}
+}
+
+static FORCE_INLINE uint32_t expand_422_pair(uint32_t dw, bool leading_lum)
+{
+	if (leading_lum) {
+		dw &= 0xFFFFFF00;
+		dw |= (uint8_t)(dw>>16);
+	} else {
+		dw &= 0xFFFF00FF;
+		dw |= (dw>>16) & 0xFF00;
+	}
+	return dw;
+}
+
+TARGET_SSSE3
+static void decompress_422_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize, out_linesize)/2;
+	uint32_t y;
+
+	__m128i shuf_lo = load_shuf(leading_lum ?
+			shuf_422_lum : shuf_422_chr);
+	__m128i shuf_hi = _mm_add_epi8(shuf_lo, _mm_set1_epi8(8));
+
+	for (y = start_y; y < end_y; y++) {
+		const uint32_t *input32 =
+			(const uint32_t*)(input + y*in_linesize);
+		uint32_t *output32 = (uint32_t*)(output + y*out_linesize);
+		uint32_t x;
+
+		for (x = 0; x + 4 <= width_d2; x += 4) {
+			__m128i in = _mm_loadu_si128(
+					(const __m128i*)(input32 + x));
+
+			_mm_storeu_si128((__m128i*)(output32 + x*2),
+					_mm_shuffle_epi8(in, shuf_lo));
+			_mm_storeu_si128((__m128i*)(output32 + x*2 + 4),
+					_mm_shuffle_epi8(in, shuf_hi));
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t dw = input32[x];
+			output32[x*2]   = dw;
+			output32[x*2+1] = expand_422_pair(dw, leading_lum);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2 */
+
+#define load_shuf256(table) \
+	_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(table)))
+
+/* moves dword 0 of each 128bit lane into the low 64 bits */
+#define compact_lanes(val, idx) \
+	_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(val, idx))
+
+#define store_u64(dst, val) _mm_storel_epi64((__m128i*)(dst), val)
+
+#define avg_chroma256(line1, line2, uv_mask, out)                             \
+do {                                                                          \
+	__m256i sum = _mm256_add_epi16(                                       \
+			_mm256_and_si256(line1, uv_mask),                     \
+			_mm256_and_si256(line2, uv_mask));                    \
+	sum = _mm256_add_epi16(sum,                                           \
+			_mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));  \
+	out = _mm256_srli_epi16(sum, 2);                                      \
+} while (false)
+
+TARGET_AVX2
+static void compress_uyvx_to_i420_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane   = output[0];
+	uint8_t  *u_plane     = output[1];
+	uint8_t  *v_plane     = output[2];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m256i lum_shuf = load_shuf256(shuf_uyvx_lum);
+	__m256i uv_shuf  = load_shuf256(shuf_avg_2plane);
+	__m256i uv_mask  = _mm256_set1_epi16(0x00FF);
+	__m256i compact  = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m128i split_uv = _mm_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7,
+			-1, -1, -1, -1, -1, -1, -1, -1);
+
+	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
+	__m128i uv_mask128 = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos        = y      * in_linesize;
+		uint32_t chroma_y_pos = (y>>1) * out_linesize[1];
+		uint32_t lum_y_pos    = y      * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x*4;
+			uint32_t lum_pos0  = lum_y_pos + x;
+			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
+			uint32_t chroma_pos = chroma_y_pos + (x>>1);
+			__m256i avg;
+			__m128i uv;
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i*)img);
+			__m256i line2 = _mm256_loadu_si256(
+					(const __m256i*)(img + in_linesize));
+
+			store_u64(lum_plane + lum_pos0, compact_lanes(
+					_mm256_shuffle_epi8(line1, lum_shuf),
+					compact));
+			store_u64(lum_plane + lum_pos1, compact_lanes(
+					_mm256_shuffle_epi8(line2, lum_shuf),
+					compact));
+
+			avg_chroma256(line1, line2, uv_mask, avg);
+			uv = compact_lanes(_mm256_shuffle_epi8(avg, uv_shuf),
+					compact);
+			uv = _mm_shuffle_epi8(uv, split_uv);
+
+			store_u32(u_plane + chroma_pos, uv);
+			store_u32(v_plane + chroma_pos, _mm_srli_si128(uv, 4));
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x*4;
+			uint32_t lum_pos0  = lum_y_pos + x;
+			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_load_si128((const __m128i*)img);
+			__m128i line2 = _mm_load_si128(
+					(const __m128i*)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1,
+					line1, line2, lum_mask, 1);
+			pack_ch_2plane(u_plane, v_plane,
+					chroma_y_pos + (x>>1),
+					line1, line2, uv_mask128);
+		}
+	}
+}
+
+TARGET_AVX2
+static void compress_uyvx_to_nv12_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane    = output[0];
+	uint8_t *chroma_plane = output[1];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m256i lum_shuf = load_shuf256(shuf_uyvx_lum);
+	__m256i uv_shuf  = load_shuf256(shuf_avg_1plane);
+	__m256i uv_mask  = _mm256_set1_epi16(0x00FF);
+	__m256i compact  = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m128i lum_mask = _mm_set1_epi32(0x0000FF00);
+	__m128i uv_mask128 = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos        = y      * in_linesize;
+		uint32_t chroma_y_pos = (y>>1) * out_linesize[1];
+		uint32_t lum_y_pos    = y      * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x*4;
+			uint32_t lum_pos0  = lum_y_pos + x;
+			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
+			__m256i avg;
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i*)img);
+			__m256i line2 = _mm256_loadu_si256(
+					(const __m256i*)(img + in_linesize));
+
+			store_u64(lum_plane + lum_pos0, compact_lanes(
+					_mm256_shuffle_epi8(line1, lum_shuf),
+					compact));
+			store_u64(lum_plane + lum_pos1, compact_lanes(
+					_mm256_shuffle_epi8(line2, lum_shuf),
+					compact));
+
+			avg_chroma256(line1, line2, uv_mask, avg);
+			store_u64(chroma_plane + chroma_y_pos + x, compact_lanes(
+					_mm256_shuffle_epi8(avg, uv_shuf),
+					compact));
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x*4;
+			uint32_t lum_pos0  = lum_y_pos + x;
+			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_load_si128((const __m128i*)img);
+			__m128i line2 = _mm_load_si128(
+					(const __m128i*)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1,
+					line1, line2, lum_mask, 1);
+			pack_ch_1plane(chroma_plane, chroma_y_pos + x,
+					line1, line2, uv_mask128);
+		}
+	}
+}
+
+TARGET_AVX2
+static void convert_uyvx_to_i444_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t  *lum_plane   = output[0];
+	uint8_t  *u_plane     = output[1];
+	uint8_t  *v_plane     = output[2];
+	uint32_t width        = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m256i lum_shuf = load_shuf256(shuf_uyvx_lum);
+	__m256i u_shuf   = load_shuf256(shuf_uyvx_u);
+	__m256i v_shuf   = load_shuf256(shuf_uyvx_v);
+	__m256i compact  = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m128i lum_shuf128 = load_shuf(shuf_uyvx_lum);
+	__m128i u_shuf128   = load_shuf(shuf_uyvx_u);
+	__m128i v_shuf128   = load_shuf(shuf_uyvx_v);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint8_t *img_line = input + y * in_linesize;
+		uint32_t lum_y_pos      = y * out_linesize[0];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i line = _mm256_loadu_si256(
+					(const __m256i*)(img_line + x*4));
+
+			store_u64(lum_plane + lum_y_pos + x, compact_lanes(
+					_mm256_shuffle_epi8(line, lum_shuf),
+					compact));
+			store_u64(u_plane + lum_y_pos + x, compact_lanes(
+					_mm256_shuffle_epi8(line, u_shuf),
+					compact));
+			store_u64(v_plane + lum_y_pos + x, compact_lanes(
+					_mm256_shuffle_epi8(line, v_shuf),
+					compact));
+		}
+
+		for (; x < width; x += 4) {
+			__m128i line = _mm_load_si128(
+					(const __m128i*)(img_line + x*4));
+
+			store_u32(lum_plane + lum_y_pos + x,
+					_mm_shuffle_epi8(line, lum_shuf128));
+			store_u32(u_plane + lum_y_pos + x,
+					_mm_shuffle_epi8(line, u_shuf128));
+			store_u32(v_plane + lum_y_pos + x,
+					_mm_shuffle_epi8(line, v_shuf128));
+		}
+	}
+}
+
+TARGET_AVX2
+static void decompress_420_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y/2;
+	uint32_t width_d2   = in_linesize[0]/2;
+	uint32_t height_d2  = end_y/2;
+	uint32_t y;
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0, *lum1;
+		uint32_t *output0, *output1;
+		uint32_t x;
+
+		lum0 = input[0] + y * 2 * in_linesize[0];
+		lum1 = lum0 + in_linesize[0];
+		output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
+
+		for (x = 0; x + 8 <= width_d2; x += 8) {
+			__m128i u  = _mm_loadl_epi64(
+					(const __m128i*)(chroma0 + x));
+			__m128i v  = _mm_loadl_epi64(
+					(const __m128i*)(chroma1 + x));
+			__m128i vu = _mm_unpacklo_epi8(v, u);
+			__m128i l0 = _mm_loadu_si128(
+					(const __m128i*)(lum0 + x*2));
+			__m128i l1 = _mm_loadu_si128(
+					(const __m128i*)(lum1 + x*2));
+
+			__m256i c_lo = _mm256_cvtepu16_epi32(
+					_mm_unpacklo_epi16(vu, vu));
+			__m256i c_hi = _mm256_cvtepu16_epi32(
+					_mm_unpackhi_epi16(vu, vu));
+
+			__m256i *out0 = (__m256i*)(output0 + x*2);
+			__m256i *out1 = (__m256i*)(output1 + x*2);
+
+			_mm256_storeu_si256(out0, _mm256_or_si256(c_lo,
+					_mm256_slli_epi32(
+					_mm256_cvtepu8_epi32(l0), 16)));
+			_mm256_storeu_si256(out0 + 1, _mm256_or_si256(c_hi,
+					_mm256_slli_epi32(_mm256_cvtepu8_epi32(
+					_mm_srli_si128(l0, 8)), 16)));
+			_mm256_storeu_si256(out1, _mm256_or_si256(c_lo,
+					_mm256_slli_epi32(
+					_mm256_cvtepu8_epi32(l1), 16)));
+			_mm256_storeu_si256(out1 + 1, _mm256_or_si256(c_hi,
+					_mm256_slli_epi32(_mm256_cvtepu8_epi32(
+					_mm_srli_si128(l1, 8)), 16)));
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = (chroma0[x] << 8) | chroma1[x];
+
+			output0[x*2]   = (lum0[x*2]   << 16) | out;
+			output0[x*2+1] = (lum0[x*2+1] << 16) | out;
+			output1[x*2]   = (lum1[x*2]   << 16) | out;
+			output1[x*2+1] = (lum1[x*2+1] << 16) | out;
+		}
+	}
+}
+
+TARGET_AVX2
+static void decompress_nv12_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y/2;
+	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2  = end_y/2;
+	uint32_t y;
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint16_t *chroma;
+		const uint8_t *lum0, *lum1;
+		uint32_t *output0, *output1;
+		uint32_t x;
+
+		chroma = (const uint16_t*)(input[1] + y * in_linesize[1]);
+		lum0 = input[0] + y * 2 * in_linesize[0];
+		lum1 = lum0 + in_linesize[0];
+		output0 = (uint32_t*)(output + y * 2 * out_linesize);
+		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
+
+		for (x = 0; x + 8 <= width_d2; x += 8) {
+			__m128i uv = _mm_loadu_si128(
+					(const __m128i*)(chroma + x));
+			__m128i l0 = _mm_loadu_si128(
+					(const __m128i*)(lum0 + x*2));
+			__m128i l1 = _mm_loadu_si128(
+					(const __m128i*)(lum1 + x*2));
+
+			__m256i c_lo = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+					_mm_unpacklo_epi16(uv, uv)), 8);
+			__m256i c_hi = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+					_mm_unpackhi_epi16(uv, uv)), 8);
+
+			__m256i *out0 = (__m256i*)(output0 + x*2);
+			__m256i *out1 = (__m256i*)(output1 + x*2);
+
+			_mm256_storeu_si256(out0, _mm256_or_si256(c_lo,
+					_mm256_cvtepu8_epi32(l0)));
+			_mm256_storeu_si256(out0 + 1, _mm256_or_si256(c_hi,
+					_mm256_cvtepu8_epi32(
+					_mm_srli_si128(l0, 8))));
+			_mm256_storeu_si256(out1, _mm256_or_si256(c_lo,
+					_mm256_cvtepu8_epi32(l1)));
+			_mm256_storeu_si256(out1 + 1, _mm256_or_si256(c_hi,
+					_mm256_cvtepu8_epi32(
+					_mm_srli_si128(l1, 8))));
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = chroma[x] << 8;
+
+			output0[x*2]   = lum0[x*2]   | out;
+			output0[x*2+1] = lum0[x*2+1] | out;
+			output1[x*2]   = lum1[x*2]   | out;
+			output1[x*2+1] = lum1[x*2+1] | out;
+		}
+	}
+}
+
+TARGET_AVX2
+static void decompress_422_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize, out_linesize)/2;
+	uint32_t y;
+
+	__m256i shuf = load_shuf256(leading_lum ?
+			shuf_422_lum : shuf_422_chr);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint32_t *input32 =
+			(const uint32_t*)(input + y*in_linesize);
+		uint32_t *output32 = (uint32_t*)(output + y*out_linesize);
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width_d2; x += 8) {
+			__m256i in = _mm256_loadu_si256(
+					(const __m256i*)(input32 + x));
+			__m256i lo = _mm256_permute4x64_epi64(in,
+					_MM_SHUFFLE(1, 1, 0, 0));
+			__m256i hi = _mm256_permute4x64_epi64(in,
+					_MM_SHUFFLE(3, 3, 2, 2));
+
+			_mm256_storeu_si256((__m256i*)(output32 + x*2),
+					_mm256_shuffle_epi8(lo, shuf));
+			_mm256_storeu_si256((__m256i*)(output32 + x*2 + 8),
+					_mm256_shuffle_epi8(hi, shuf));
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t dw = input32[x];
+			output32[x*2]   = dw;
+			output32[x*2+1] = expand_422_pair(dw, leading_lum);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* Runtime dispatch */
+
+typedef void (*compress_func_t)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+
+typedef void (*decompress_planar_func_t)(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize);
+
+typedef void (*decompress_packed_func_t)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum);
+
+struct format_conversion_funcs {
+	const char               *name;
+	compress_func_t          compress_i420;
+	compress_func_t          compress_nv12;
+	compress_func_t          convert_i444;
+	decompress_planar_func_t decompress_420;
+	decompress_planar_func_t decompress_nv12;
+	decompress_packed_func_t decompress_422;
+};
+
+static const struct format_conversion_funcs funcs_sse2 = {
+	"SSE2",
+	compress_uyvx_to_i420_sse2,
+	compress_uyvx_to_nv12_sse2,
+	convert_uyvx_to_i444_sse2,
+	decompress_420_c,
+	decompress_nv12_c,
+	decompress_422_c
+};
+
+static const struct format_conversion_funcs funcs_ssse3 = {
+	"SSSE3",
+	compress_uyvx_to_i420_ssse3,
+	compress_uyvx_to_nv12_ssse3,
+	convert_uyvx_to_i444_ssse3,
+	decompress_420_ssse3,
+	decompress_nv12_ssse3,
+	decompress_422_ssse3
+};
+
+static const struct format_conversion_funcs funcs_avx2 = {
+	"AVX2",
+	compress_uyvx_to_i420_avx2,
+	compress_uyvx_to_nv12_avx2,
+	convert_uyvx_to_i444_avx2,
+	decompress_420_avx2,
+	decompress_nv12_avx2,
+	decompress_422_avx2
+};
+
+static const struct format_conversion_funcs *funcs = &funcs_sse2;
+
+const char *format_conversion_select(uint32_t features)
+{
+	features &= os_get_cpu_features();
+
+	if (features & OS_CPU_AVX2)
+		funcs = &funcs_avx2;
+	else if (features & OS_CPU_SSSE3)
+		funcs = &funcs_ssse3;
+	else
+		funcs = &funcs_sse2;
+
+	return funcs->name;
+}
+
+void format_conversion_init(void)
+{
+	const char *name = format_conversion_select(os_get_cpu_features());
+
+	blog(LOG_INFO, "Format conversion: using %s routines", name);
+}
+
+void compress_uyvx_to_i420(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	funcs->compress_i420(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void compress_uyvx_to_nv12(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	funcs->compress_nv12(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void convert_uyvx_to_i444(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	funcs->convert_i444(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void decompress_420(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	funcs->decompress_420(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void decompress_nv12(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	funcs->decompress_nv12(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void decompress_422(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	funcs->decompress_422(input, in_linesize, start_y, end_y,
+			output, out_linesize, leading_lum);
+}
@@ -27,6 +27,19 @@ extern "C" {
  * Functions for converting to and from packed 444 YUV
  */
 
+/**
+ * Selects the fastest conversion routines supported by the CPU.  Called once
+ * by obs_startup; until then the baseline SSE2/C routines are used.
+ */
+EXPORT void format_conversion_init(void);
+
+/**
+ * Selects the fastest conversion routines that only use the given OS_CPU_*
+ * features (and that the CPU supports), and returns their name.  0 selects
+ * the baseline routines.  Used to test the routines against each other.
+ */
+EXPORT const char *format_conversion_select(uint32_t features);
+
 EXPORT void compress_uyvx_to_i420(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/circlebuf.h"
 
 #include "format-conversion.h"
 #include "video-io.h"
@@ -32,29 +33,80 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
+#define MAX_INPUT_QUEUE 2
 
 struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+
+	/* references held by threaded inputs */
+	volatile long refs;
+};
+
+struct queued_frame {
+	struct video_data         frame;
+	struct cached_frame_info  *cfi;
+	uint64_t                  queued_time;
+};
+
+/* a scaled frame, shared by every input using the same conversion */
+struct convert_buffer {
+	struct video_frame        frame;
+	uint64_t                  timestamp;
+	bool                      valid;
+
+	/* set while an input scales into the frame outside of the conversion
+	 * mutex, inputs that need the same frame wait for the event */
+	bool                      scaling;
+	os_event_t                *scaled;
+
+	/* inputs currently using the frame, locked by the conversion mutex */
+	long                      refs;
+};
+
+/* one per distinct scale info, shared by every input that asks for it.  a
+ * frame is scaled by the first input that needs it, the others reuse it */
+struct video_conversion {
+	struct video_scale_info   info;
+	struct video_scale_info   from;
+
+	/* scalers not in use, inputs scaling different frames at the same
+	 * time each take their own */
+	DARRAY(video_scaler_t*)   scalers;
+
+	/* when cascaded, the larger rendition this one is scaled from */
+	struct video_conversion   *parent;
+
+	/* inputs and child conversions, locked by the output's input mutex */
+	long                      refs;
+
+	pthread_mutex_t           mutex;
+	DARRAY(struct convert_buffer*) buffers;
+	uint32_t                  scaled_frames;
+	uint32_t                  shared_frames;
 };
 
 struct video_input {
+	struct video_output       *video;
 	struct video_scale_info   conversion;
-	video_scaler_t            *scaler;
-	struct video_frame        frame[MAX_CONVERT_BUFFERS];
-	int                       cur_frame;
+	struct video_conversion   *converter;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
-};
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
+	/* threaded delivery */
+	bool                      threaded;
+	bool                      thread_created;
+	bool                      detached;
+	volatile bool             stop;
+	pthread_t                 thread;
+	pthread_mutex_t           queue_mutex;
+	os_sem_t                  *queue_sem;
+	struct circlebuf          queue;
+	struct video_input_stats  stats;
+	const char                *profile_name;
+};
 
 struct video_output {
 	struct video_output_info   info;
@@ -71,45 +123,490 @@ struct video_output {
 	bool                       initialized;
 
 	pthread_mutex_t            input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input*) inputs;
+	DARRAY(pthread_t)          detached_threads;
+	DARRAY(struct video_conversion*) conversions;
+	bool                       threaded_inputs;
+	bool                       cascaded_scaling;
 
 	size_t                     available_frames;
 	size_t                     first_added;
 	size_t                     last_added;
 	struct cached_frame_info   cache[MAX_CACHE_SIZE];
+
+	/* frames that have been delivered but are still referenced by
+	 * threaded inputs, starting at first_pending */
+	size_t                     pending_frames;
+	size_t                     first_pending;
 };
 
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input,
+/* must be called with data_mutex held */
+static void release_delivered_frames(struct video_output *video)
+{
+	while (video->pending_frames) {
+		struct cached_frame_info *cfi =
+			&video->cache[video->first_pending];
+
+		if (os_atomic_load_long(&cfi->refs) > 0)
+			break;
+
+		if (++video->first_pending == video->info.cache_size)
+			video->first_pending = 0;
+		video->pending_frames--;
+
+		if (++video->available_frames == video->info.cache_size)
+			video->last_added = video->first_added;
+	}
+}
+
+static void release_queued_frame(struct video_output *video,
+		struct cached_frame_info *cfi)
+{
+	if (os_atomic_dec_long(&cfi->refs) == 0) {
+		pthread_mutex_lock(&video->data_mutex);
+		release_delivered_frames(video);
+		pthread_mutex_unlock(&video->data_mutex);
+	}
+}
+
+static bool same_scale_info(const struct video_scale_info *a,
+		const struct video_scale_info *b)
+{
+	return a->format == b->format &&
+	       a->width == b->width &&
+	       a->height == b->height &&
+	       a->range == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+/* must be called with input_mutex held */
+static void video_conversion_release(struct video_output *video,
+		struct video_conversion *conv)
+{
+	if (!conv || --conv->refs > 0)
+		return;
+
+	blog(LOG_DEBUG, "video-io: %"PRIu32"x%"PRIu32" conversion scaled "
+			"%"PRIu32" frames, shared %"PRIu32,
+			conv->info.width, conv->info.height,
+			conv->scaled_frames, conv->shared_frames);
+
+	da_erase_item(video->conversions, &conv);
+	video_conversion_release(video, conv->parent);
+
+	for (size_t i = 0; i < conv->buffers.num; i++) {
+		struct convert_buffer *buf = conv->buffers.array[i];
+		video_frame_free(&buf->frame);
+		os_event_destroy(buf->scaled);
+		bfree(buf);
+	}
+
+	for (size_t i = 0; i < conv->scalers.num; i++)
+		video_scaler_destroy(conv->scalers.array[i]);
+
+	da_free(conv->buffers);
+	da_free(conv->scalers);
+	pthread_mutex_destroy(&conv->mutex);
+	bfree(conv);
+}
+
+static struct convert_buffer *convert_buffer_create(
+		struct video_conversion *conv)
+{
+	struct convert_buffer *buf = bzalloc(sizeof(*buf));
+
+	if (os_event_init(&buf->scaled, OS_EVENT_TYPE_MANUAL) != 0) {
+		bfree(buf);
+		return NULL;
+	}
+
+	video_frame_init(&buf->frame, conv->info.format,
+			conv->info.width, conv->info.height);
+	da_push_back(conv->buffers, &buf);
+	return buf;
+}
+
+/* the nearest larger rendition of the same format and colors, to scale a
+ * ladder of renditions down step by step rather than all from the full size
+ * frame */
+static struct video_conversion *find_parent_conversion(
+		struct video_output *video,
+		const struct video_scale_info *info)
+{
+	struct video_conversion *parent = NULL;
+	uint64_t area = (uint64_t)info->width * info->height;
+	uint64_t full_area = (uint64_t)video->info.width * video->info.height;
+
+	for (size_t i = 0; i < video->conversions.num; i++) {
+		struct video_conversion *conv = video->conversions.array[i];
+		uint64_t conv_area =
+			(uint64_t)conv->info.width * conv->info.height;
+
+		if (conv->info.format     != info->format ||
+		    conv->info.range      != info->range ||
+		    conv->info.colorspace != info->colorspace)
+			continue;
+		if (conv->info.width < info->width ||
+		    conv->info.height < info->height)
+			continue;
+		if (conv_area <= area || conv_area >= full_area)
+			continue;
+
+		if (!parent || conv_area <
+				(uint64_t)parent->info.width *
+				parent->info.height)
+			parent = conv;
+	}
+
+	return parent;
+}
+
+/* must be called with input_mutex held */
+static struct video_conversion *video_conversion_get(
+		struct video_output *video,
+		const struct video_scale_info *info)
+{
+	struct video_conversion *conv;
+	struct video_scale_info from = {
+		.format = video->info.format,
+		.width  = video->info.width,
+		.height = video->info.height,
+		.range = video->info.range,
+		.colorspace = video->info.colorspace
+	};
+	video_scaler_t *scaler;
+	int ret;
+
+	for (size_t i = 0; i < video->conversions.num; i++) {
+		conv = video->conversions.array[i];
+		if (same_scale_info(&conv->info, info)) {
+			conv->refs++;
+			return conv;
+		}
+	}
+
+	conv = bzalloc(sizeof(*conv));
+	conv->info = *info;
+	conv->refs = 1;
+
+	if (video->cascaded_scaling)
+		conv->parent = find_parent_conversion(video, info);
+	if (conv->parent)
+		from = conv->parent->info;
+
+	conv->from = from;
+
+	ret = video_scaler_create(&scaler, info, &from,
+			VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+			                "scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+			                "create scaler");
+
+		bfree(conv);
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&conv->mutex, NULL) != 0) {
+		video_scaler_destroy(scaler);
+		bfree(conv);
+		return NULL;
+	}
+
+	da_push_back(conv->scalers, &scaler);
+
+	if (conv->parent) {
+		conv->parent->refs++;
+		blog(LOG_DEBUG, "video-io: scaling %"PRIu32"x%"PRIu32" from "
+				"%"PRIu32"x%"PRIu32,
+				info->width, info->height,
+				from.width, from.height);
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		convert_buffer_create(conv);
+
+	da_push_back(video->conversions, &conv);
+	return conv;
+}
+
+static void convert_buffer_release(struct video_conversion *conv,
+		struct convert_buffer *buf)
+{
+	pthread_mutex_lock(&conv->mutex);
+	buf->refs--;
+	pthread_mutex_unlock(&conv->mutex);
+}
+
+/* waits for another input to finish scaling a frame, the caller holds a
+ * reference so it can't be reused in the meantime */
+static struct convert_buffer *convert_buffer_wait(
+		struct video_conversion *conv, struct convert_buffer *buf)
+{
+	bool valid;
+
+	os_event_wait(buf->scaled);
+
+	pthread_mutex_lock(&conv->mutex);
+	valid = buf->valid;
+	if (!valid)
+		buf->refs--;
+	pthread_mutex_unlock(&conv->mutex);
+
+	return valid ? buf : NULL;
+}
+
+/* gets the frame scaled for this conversion, scaling it only if no other
+ * input has already.  a frame is claimed with the mutex locked but scaled
+ * outside of it, so an input only ever waits for another one that is
+ * scaling the very frame it needs */
+static struct convert_buffer *convert_buffer_get(
+		struct video_conversion *conv, const struct video_data *src)
+{
+	struct convert_buffer *parent_buf = NULL;
+	struct convert_buffer *buf = NULL;
+	const uint8_t *const *data = (const uint8_t *const*)src->data;
+	const uint32_t *linesize = src->linesize;
+	video_scaler_t *scaler = NULL;
+	bool success = false;
+
+	pthread_mutex_lock(&conv->mutex);
+
+	for (size_t i = 0; i < conv->buffers.num; i++) {
+		struct convert_buffer *cur = conv->buffers.array[i];
+
+		if ((cur->valid || cur->scaling) &&
+		    cur->timestamp == src->timestamp) {
+			cur->refs++;
+			conv->shared_frames++;
+			pthread_mutex_unlock(&conv->mutex);
+
+			return cur->scaling ? convert_buffer_wait(conv, cur) :
+				cur;
+		}
+
+		/* reuse an unused frame, or else the oldest frame no input
+		 * is using */
+		if (!cur->refs && (!buf || (buf->valid && (!cur->valid ||
+				cur->timestamp < buf->timestamp))))
+			buf = cur;
+	}
+
+	if (!buf)
+		buf = convert_buffer_create(conv);
+	if (!buf) {
+		pthread_mutex_unlock(&conv->mutex);
+		return NULL;
+	}
+
+	buf->valid = false;
+	buf->scaling = true;
+	buf->timestamp = src->timestamp;
+	buf->refs++;
+	os_event_reset(buf->scaled);
+
+	if (conv->scalers.num) {
+		scaler = conv->scalers.array[conv->scalers.num - 1];
+		da_pop_back(conv->scalers);
+	}
+
+	pthread_mutex_unlock(&conv->mutex);
+
+	/* -------------------------------- */
+
+	if (!scaler && video_scaler_create(&scaler, &conv->info, &conv->from,
+			VIDEO_SCALE_FAST_BILINEAR) != VIDEO_SCALER_SUCCESS)
+		scaler = NULL;
+
+	if (conv->parent) {
+		parent_buf = convert_buffer_get(conv->parent, src);
+		if (parent_buf) {
+			data = (const uint8_t *const*)parent_buf->frame.data;
+			linesize = parent_buf->frame.linesize;
+		}
+	}
+
+	if (scaler && (!conv->parent || parent_buf))
+		success = video_scaler_scale(scaler,
+				buf->frame.data, buf->frame.linesize,
+				data, linesize);
+
+	if (parent_buf)
+		convert_buffer_release(conv->parent, parent_buf);
+
+	/* -------------------------------- */
+
+	pthread_mutex_lock(&conv->mutex);
+
+	if (scaler)
+		da_push_back(conv->scalers, &scaler);
+
+	buf->scaling = false;
+	buf->valid = success;
+	if (success)
+		conv->scaled_frames++;
+	else
+		buf->refs--;
+
+	/* signalled with the mutex locked, so that the frame can't be
+	 * claimed and the event reset again before */
+	os_event_signal(buf->scaled);
+
+	pthread_mutex_unlock(&conv->mutex);
+
+	if (!success) {
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+		return NULL;
+	}
+
+	return buf;
+}
+
+static void video_input_destroy(struct video_input *input)
+{
+	while (input->queue.size) {
+		struct queued_frame qf;
+		circlebuf_pop_front(&input->queue, &qf, sizeof(qf));
+		release_queued_frame(input->video, qf.cfi);
+	}
+
+	if (input->threaded) {
+		if (input->stats.dropped_frames)
+			blog(LOG_INFO, "video-io: input %p dropped "
+					"%"PRIu32"/%"PRIu32" frames, "
+					"max lag %"PRIu64" ms",
+					input->param,
+					input->stats.dropped_frames,
+					input->stats.delivered_frames +
+					input->stats.dropped_frames,
+					input->stats.max_lag_ns / 1000000);
+
+		circlebuf_free(&input->queue);
+		os_sem_destroy(input->queue_sem);
+		pthread_mutex_destroy(&input->queue_mutex);
+	}
+
+	pthread_mutex_lock(&input->video->input_mutex);
+	video_conversion_release(input->video, input->converter);
+	pthread_mutex_unlock(&input->video->input_mutex);
+	bfree(input);
+}
+
+static inline void video_input_free(struct video_input *input)
+{
+	if (input->thread_created) {
+		input->stop = true;
+
+		/* disconnected from within its own callback (e.g. an encoder
+		 * failing), the thread cleans up after the callback returns.
+		 * it still uses the output until then, so the output joins it
+		 * when it is closed */
+		if (pthread_equal(pthread_self(), input->thread)) {
+			input->detached = true;
+			da_push_back(input->video->detached_threads,
+					&input->thread);
+			return;
+		}
+
+		os_sem_post(input->queue_sem);
+		pthread_join(input->thread, NULL);
+	}
+
+	video_input_destroy(input);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void deliver_video_output(struct video_input *input,
 		struct video_data *data)
 {
-	bool success = true;
+	struct convert_buffer *buf;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	if (!input->converter) {
+		input->callback(input->param, data);
+		return;
+	}
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	buf = convert_buffer_get(input->converter, data);
+	if (!buf)
+		return;
 
-		frame = &input->frame[input->cur_frame];
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i]     = buf->frame.data[i];
+		data->linesize[i] = buf->frame.linesize[i];
+	}
 
-		success = video_scaler_scale(input->scaler,
-				frame->data, frame->linesize,
-				(const uint8_t * const*)data->data,
-				data->linesize);
+	input->callback(input->param, data);
+	convert_buffer_release(input->converter, buf);
+}
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i]     = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
+
+	os_set_thread_name("video-io: input thread");
+
+	while (os_sem_wait(input->queue_sem) == 0) {
+		struct queued_frame qf;
+		uint64_t lag;
+
+		if (input->stop)
+			break;
+
+		pthread_mutex_lock(&input->queue_mutex);
+		circlebuf_pop_front(&input->queue, &qf, sizeof(qf));
+		pthread_mutex_unlock(&input->queue_mutex);
+
+		profile_start(input->profile_name);
+		deliver_video_output(input, &qf.frame);
+		profile_end(input->profile_name);
+
+		release_queued_frame(input->video, qf.cfi);
+
+		lag = os_gettime_ns() - qf.queued_time;
+		input->stats.last_lag_ns = lag;
+		if (lag > input->stats.max_lag_ns)
+			input->stats.max_lag_ns = lag;
+		input->stats.delivered_frames++;
+
+		if (input->detached) {
+			video_input_destroy(input);
+			break;
 		}
+
+		profile_reenable_thread();
 	}
 
-	return success;
+	return NULL;
+}
+
+static void queue_input_frame(struct video_input *input,
+		struct cached_frame_info *cfi)
+{
+	struct queued_frame qf;
+	bool queued = false;
+
+	qf.frame = cfi->frame;
+	qf.cfi = cfi;
+	qf.queued_time = os_gettime_ns();
+
+	pthread_mutex_lock(&input->queue_mutex);
+	if (input->queue.size < MAX_INPUT_QUEUE * sizeof(qf)) {
+		os_atomic_inc_long(&cfi->refs);
+		circlebuf_push_back(&input->queue, &qf, sizeof(qf));
+		queued = true;
+	}
+	pthread_mutex_unlock(&input->queue_mutex);
+
+	if (queued)
+		os_sem_post(input->queue_sem);
+	else
+		input->stats.dropped_frames++;
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
@@ -131,11 +628,13 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
+		struct video_input *input = video->inputs.array[i];
 		struct video_data frame = frame_info->frame;
 
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+		if (input->threaded)
+			queue_input_frame(input, frame_info);
+		else
+			deliver_video_output(input, &frame);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -152,8 +651,10 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
+		/* the slot is only reusable once threaded inputs are done
+		 * with it; slots are released in order */
+		video->pending_frames++;
+		release_delivered_frames(video);
 	} else if (skipped) {
 		--frame_info->skipped;
 		++video->skipped_frames;
@@ -267,9 +768,14 @@ void video_output_close(video_t *video)
 	video_output_stop(video);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_free(video->inputs.array[i]);
 	da_free(video->inputs);
 
+	for (size_t i = 0; i < video->detached_threads.num; i++)
+		pthread_join(video->detached_threads.array[i], NULL);
+	da_free(video->detached_threads);
+	da_free(video->conversions);
+
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame*)&video->cache[i]);
 
@@ -284,7 +790,7 @@ static size_t video_get_input_idx(const video_t *video,
 		void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -292,39 +798,46 @@ static size_t video_get_input_idx(const video_t *video,
 	return DARRAY_INVALID;
 }
 
+static bool video_input_start_thread(struct video_input *input)
+{
+	input->threaded = true;
+
+	if (pthread_mutex_init(&input->queue_mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_sem_init(&input->queue_sem, 0) != 0)
+		goto fail_sem;
+
+	input->profile_name = profile_store_name(obs_get_profiler_name_store(),
+			"video_input_thread(%s:%p)", input->video->info.name,
+			input->param);
+
+	if (pthread_create(&input->thread, NULL, video_input_thread,
+				input) != 0) {
+		blog(LOG_ERROR, "video_input_init: Failed to create input "
+		                "thread");
+		return false;
+	}
+
+	input->thread_created = true;
+	return true;
+
+fail_sem:
+	pthread_mutex_destroy(&input->queue_mutex);
+fail_mutex:
+	input->threaded = false;
+	return false;
+}
+
 static inline bool video_input_init(struct video_input *input,
 		struct video_output *video)
 {
 	if (input->conversion.width  != video->info.width ||
 	    input->conversion.height != video->info.height ||
 	    input->conversion.format != video->info.format) {
-		struct video_scale_info from = {
-			.format = video->info.format,
-			.width  = video->info.width,
-			.height = video->info.height,
-			.range = video->info.range,
-			.colorspace = video->info.colorspace
-		};
-
-		int ret = video_scaler_create(&input->scaler,
-				&input->conversion, &from,
-				VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-				                "scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-				                "create scaler");
-
+		input->converter = video_conversion_get(video,
+				&input->conversion);
+		if (!input->converter)
 			return false;
-		}
-
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					input->conversion.format,
-					input->conversion.width,
-					input->conversion.height);
 	}
 
 	return true;
@@ -348,28 +861,33 @@ bool video_output_connect(video_t *video,
 	}
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param    = param;
+		input->video    = video;
+		input->callback = callback;
+		input->param    = param;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format    = video->info.format;
-			input.conversion.width     = video->info.width;
-			input.conversion.height    = video->info.height;
+			input->conversion.format    = video->info.format;
+			input->conversion.width     = video->info.width;
+			input->conversion.height    = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		success = video_input_init(input, video);
+		if (success && video->threaded_inputs)
+			success = video_input_start_thread(input);
 
-		success = video_input_init(&input, video);
 		if (success)
 			da_push_back(video->inputs, &input);
+		else
+			video_input_free(input);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -388,7 +906,7 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array+idx);
+		video_input_free(video->inputs.array[idx]);
 		da_erase(video->inputs, idx);
 	}
 
@@ -431,8 +949,17 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 	pthread_mutex_lock(&video->data_mutex);
 
 	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
+		cfi = &video->cache[video->last_added];
+
+		/* if every slot has already been delivered and is only
+		 * waiting on threaded inputs, there's nothing to duplicate */
+		if (cfi->count == 0) {
+			video->skipped_frames += count;
+			video->total_frames += count;
+		} else {
+			cfi->count += count;
+			cfi->skipped += count;
+		}
 		locked = false;
 
 	} else {
@@ -528,3 +1055,43 @@ uint32_t video_output_get_total_frames(const video_t *video)
 {
 	return video->total_frames;
 }
+
+void video_output_set_cascaded_scaling(video_t *video, bool cascaded)
+{
+	if (!video)
+		return;
+
+	pthread_mutex_lock(&video->input_mutex);
+	video->cascaded_scaling = cascaded;
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+void video_output_set_threaded_inputs(video_t *video, bool threaded)
+{
+	if (!video)
+		return;
+
+	pthread_mutex_lock(&video->input_mutex);
+	video->threaded_inputs = threaded;
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+bool video_output_get_input_stats(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param, struct video_input_stats *stats)
+{
+	size_t idx;
+
+	if (!video || !stats)
+		return false;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID)
+		*stats = video->inputs.array[idx]->stats;
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return idx != DARRAY_INVALID;
+}
@@ -202,6 +202,31 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+struct video_input_stats {
+	uint32_t              delivered_frames;
+	uint32_t              dropped_frames;
+	uint64_t              last_lag_ns;
+	uint64_t              max_lag_ns;
+};
+
+/**
+ * When enabled, inputs connected afterwards get their own delivery thread
+ * and a small queue of references to the cached frames, so a slow input
+ * drops its own frames instead of stalling every other input.
+ */
+EXPORT void video_output_set_threaded_inputs(video_t *video, bool threaded);
+
+/**
+ * When enabled, conversions created afterwards are scaled from the nearest
+ * larger conversion of the same format instead of from the full size frame,
+ * e.g. 480p from 720p rather than from 1080p.  Cheaper, at a small cost in
+ * quality.  Inputs with identical conversions always share scaled frames.
+ */
+EXPORT void video_output_set_cascaded_scaling(video_t *video, bool cascaded);
+EXPORT bool video_output_get_input_stats(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param, struct video_input_stats *stats);
+
 
 #ifdef __cplusplus
 }
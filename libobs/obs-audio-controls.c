@@ -70,10 +70,11 @@ struct obs_volmeter {
 	pthread_mutex_t        callback_mutex;
 	DARRAY(struct meter_cb)callbacks;
 
-	unsigned int           update_ms;
+	signal_handler_t       *signals;
+	signal_handle_t        *levels_signal;
 
-	float                  vol_magnitude[MAX_AUDIO_CHANNELS];
-	float                  vol_peak[MAX_AUDIO_CHANNELS];
+	unsigned int           update_ms;
+	enum obs_peak_meter_type peak_meter_type;
 };
 
 static float cubic_def_to_db(const float def)
@@ -205,6 +206,22 @@ static void signal_levels_updated(struct obs_volmeter *volmeter,
 		cb.callback(cb.param, magnitude, peak, input_peak);
 	}
 	pthread_mutex_unlock(&volmeter->callback_mutex);
+
+	if (signal_handle_has_callbacks(volmeter->levels_signal)) {
+		uint8_t stack[512];
+		calldata_t data;
+
+		calldata_init_fixed(&data, stack, sizeof(stack));
+		calldata_set_ptr(&data, "volmeter", volmeter);
+		calldata_set_data(&data, "magnitude", magnitude,
+				sizeof(float) * MAX_AUDIO_CHANNELS);
+		calldata_set_data(&data, "peak", peak,
+				sizeof(float) * MAX_AUDIO_CHANNELS);
+		calldata_set_data(&data, "input_peak", input_peak,
+				sizeof(float) * MAX_AUDIO_CHANNELS);
+
+		signal_handle_emit(volmeter->levels_signal, &data);
+	}
 }
 
 static void fader_source_volume_changed(void *vptr, calldata_t *calldata)
@@ -256,18 +273,102 @@ static void volmeter_source_destroyed(void *vptr, calldata_t *calldata)
 	obs_volmeter_detach_source(volmeter);
 }
 
-static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
-		const struct audio_data *data)
+static void volmeter_levels_received(void *vptr,
+		const struct audio_meter_levels *levels)
 {
-	int nr_samples = data->frames;
-	int channel_nr = 0;
+	struct obs_volmeter *volmeter = (struct obs_volmeter *) vptr;
+	const float *vol_peak;
+	float mul;
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+
+	pthread_mutex_lock(&volmeter->mutex);
+
+	vol_peak = volmeter->peak_meter_type == TRUE_PEAK_METER ?
+		levels->true_peak : levels->peak;
+
+	// Adjust magnitude/peak based on the volume level set by the user.
+	// And convert to dB.
+	mul = levels->muted ? 0.0f : db_to_mul(volmeter->cur_db);
+	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
+		channel_nr++) {
+		magnitude[channel_nr] = mul_to_db(
+			levels->magnitude[channel_nr] * mul);
+		peak[channel_nr] = mul_to_db(vol_peak[channel_nr] * mul);
+		input_peak[channel_nr] = mul_to_db(vol_peak[channel_nr]);
+	}
+
+	// The input-peak is NOT adjusted with volume, so that the user
+	// can check the input-gain.
+
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	signal_levels_updated(volmeter, magnitude, peak, input_peak);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Shared metering
+ *
+ *   Levels are computed once per audio packet of a source, no matter how many
+ * volume meters are attached to it, and only while at least one is.  True
+ * peak is only computed while a meter that uses it is attached. */
+
+void obs_source_add_meter_callback(obs_source_t *source,
+		audio_meter_updated_t callback, void *param, bool true_peak)
+{
+	struct audio_meter_cb cb = {callback, param, true_peak};
+
+	pthread_mutex_lock(&source->meter_mutex);
+
+	if (true_peak && source->meter_true_peak_users++ == 0)
+		memset(source->meter_history, 0,
+				sizeof(source->meter_history));
+
+	da_push_back(source->meter_cb_list, &cb);
+
+	pthread_mutex_unlock(&source->meter_mutex);
+}
+
+void obs_source_remove_meter_callback(obs_source_t *source,
+		audio_meter_updated_t callback, void *param)
+{
+	pthread_mutex_lock(&source->meter_mutex);
+
+	for (size_t i = 0; i < source->meter_cb_list.num; i++) {
+		struct audio_meter_cb *cb = source->meter_cb_list.array + i;
+
+		if (cb->callback == callback && cb->param == param) {
+			if (cb->true_peak)
+				source->meter_true_peak_users--;
+			da_erase(source->meter_cb_list, i);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&source->meter_mutex);
+}
+
+static void compute_levels(obs_source_t *source,
+		const struct audio_data *data,
+		struct audio_meter_levels *levels)
+{
+	bool true_peak = source->meter_true_peak_users > 0;
+	size_t channel_nr = 0;
+
+	memset(levels, 0, sizeof(*levels));
 
 	for (size_t plane_nr = 0; plane_nr < MAX_AV_PLANES; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
+		const float *samples = (const float *)data->data[plane_nr];
+		float sum_of_squares;
+		float peak;
+
 		if (!samples) {
 			// This plane does not contain data.
 			continue;
 		}
+		if (channel_nr == MAX_AUDIO_CHANNELS)
+			break;
 
 		// For each plane calculate:
 		// * peak = the maximum-absolute of the sample values.
@@ -276,64 +377,49 @@ static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
 		//	be handled by the ballistics of the meter itself,
 		//	reality. Which makes this calculation independent of
 		//	sample rate or update rate.
-		float peak = 0.0;
-		float sum_of_squares = 0.0;
-		for (int sample_nr = 0; sample_nr < nr_samples; sample_nr++) {
-			float sample = samples[sample_nr];
+		audio_get_peak_and_power(samples, data->frames,
+				&peak, &sum_of_squares);
 
-			peak = fmaxf(peak, fabsf(sample));
-			sum_of_squares += (sample * sample);
-		}
+		levels->magnitude[channel_nr] = sqrtf(sum_of_squares /
+			data->frames);
+		levels->peak[channel_nr] = peak;
 
-		volmeter->vol_magnitude[channel_nr] = sqrtf(sum_of_squares /
-			nr_samples);
-		volmeter->vol_peak[channel_nr] = peak;
-		channel_nr++;
-	}
+		if (true_peak)
+			levels->true_peak[channel_nr] = fmaxf(peak,
+				audio_get_true_peak(
+					source->meter_history[channel_nr],
+					samples, data->frames));
 
-	// Clear audio channels that are not in use.
-	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		volmeter->vol_magnitude[channel_nr] = 0.0;
-		volmeter->vol_peak[channel_nr] = 0.0;
+		channel_nr++;
 	}
 }
 
-static void volmeter_source_data_received(void *vptr, obs_source_t *source,
+void obs_source_update_meters(obs_source_t *source,
 		const struct audio_data *data, bool muted)
 {
-	struct obs_volmeter *volmeter = (struct obs_volmeter *) vptr;
-	float mul;
-	float magnitude[MAX_AUDIO_CHANNELS];
-	float peak[MAX_AUDIO_CHANNELS];
-	float input_peak[MAX_AUDIO_CHANNELS];
+	struct audio_meter_levels levels;
 
-	pthread_mutex_lock(&volmeter->mutex);
-
-	volmeter_process_audio_data(volmeter, data);
-
-	// Adjust magnitude/peak based on the volume level set by the user.
-	// And convert to dB.
-	mul = muted ? 0.0f : db_to_mul(volmeter->cur_db);
-	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
-		channel_nr++) {
-		magnitude[channel_nr] = mul_to_db(
-			volmeter->vol_magnitude[channel_nr] * mul);
-		peak[channel_nr] = mul_to_db(
-			volmeter->vol_peak[channel_nr] * mul);
-		input_peak[channel_nr] = mul_to_db(
-			volmeter->vol_peak[channel_nr]);
-	}
+	if (!data->frames)
+		return;
 
-	// The input-peak is NOT adjusted with volume, so that the user
-	// can check the input-gain.
+	pthread_mutex_lock(&source->meter_mutex);
 
-	pthread_mutex_unlock(&volmeter->mutex);
+	if (source->meter_cb_list.num) {
+		compute_levels(source, data, &levels);
+		levels.muted = muted;
 
-	signal_levels_updated(volmeter, magnitude, peak, input_peak);
+		for (size_t i = source->meter_cb_list.num; i > 0; i--) {
+			struct audio_meter_cb cb =
+				source->meter_cb_list.array[i - 1];
+			cb.callback(cb.param, &levels);
+		}
+	}
 
-	UNUSED_PARAMETER(source);
+	pthread_mutex_unlock(&source->meter_mutex);
 }
 
+/* ------------------------------------------------------------------------- */
+
 obs_fader_t *obs_fader_create(enum obs_fader_type type)
 {
 	struct obs_fader *fader = bzalloc(sizeof(struct obs_fader));
@@ -551,6 +637,10 @@ void obs_fader_remove_callback(obs_fader_t *fader, obs_fader_changed_t callback,
 	pthread_mutex_unlock(&fader->callback_mutex);
 }
 
+static const char *volmeter_signal =
+	"void levels_updated(ptr volmeter, data magnitude, data peak, "
+	"data input_peak)";
+
 obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 {
 	struct obs_volmeter *volmeter = bzalloc(sizeof(struct obs_volmeter));
@@ -564,6 +654,14 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 	if (pthread_mutex_init(&volmeter->callback_mutex, NULL) != 0)
 		goto fail;
 
+	volmeter->signals = signal_handler_create();
+	if (!volmeter->signals)
+		goto fail;
+	if (!signal_handler_add(volmeter->signals, volmeter_signal))
+		goto fail;
+
+	volmeter->levels_signal = signal_handler_get_handle(volmeter->signals,
+			"levels_updated");
 	volmeter->type = type;
 
 	obs_volmeter_set_update_interval(volmeter, 50);
@@ -580,6 +678,7 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 		return;
 
 	obs_volmeter_detach_source(volmeter);
+	signal_handler_destroy(volmeter->signals);
 	da_free(volmeter->callbacks);
 	pthread_mutex_destroy(&volmeter->callback_mutex);
 	pthread_mutex_destroy(&volmeter->mutex);
@@ -590,6 +689,7 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 {
 	signal_handler_t *sh;
+	bool true_peak;
 	float vol;
 
 	if (!volmeter || !source)
@@ -602,17 +702,21 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 			volmeter_source_volume_changed, volmeter);
 	signal_handler_connect(sh, "destroy",
 			volmeter_source_destroyed, volmeter);
-	obs_source_add_audio_capture_callback(source,
-			volmeter_source_data_received, volmeter);
 	vol = obs_source_get_volume(source);
 
 	pthread_mutex_lock(&volmeter->mutex);
 
 	volmeter->source = source;
 	volmeter->cur_db = mul_to_db(vol);
+	true_peak = volmeter->peak_meter_type == TRUE_PEAK_METER;
 
 	pthread_mutex_unlock(&volmeter->mutex);
 
+	/* the source calls back with its meter mutex locked, so never
+	 * subscribe with the volmeter mutex locked */
+	obs_source_add_meter_callback(source, volmeter_levels_received,
+			volmeter, true_peak);
+
 	return true;
 }
 
@@ -637,8 +741,8 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 			volmeter_source_volume_changed, volmeter);
 	signal_handler_disconnect(sh, "destroy",
 			volmeter_source_destroyed, volmeter);
-	obs_source_remove_audio_capture_callback(source,
-			volmeter_source_data_received, volmeter);
+	obs_source_remove_meter_callback(source, volmeter_levels_received,
+			volmeter);
 }
 
 void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter,
@@ -652,6 +756,46 @@ void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter,
 	pthread_mutex_unlock(&volmeter->mutex);
 }
 
+void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter,
+		enum obs_peak_meter_type peak_meter_type)
+{
+	obs_source_t *source = NULL;
+	bool detached;
+
+	if (!volmeter)
+		return;
+
+	/* the source can't be used once the mutex is unlocked unless it's
+	 * referenced, it could be destroyed and detached in the meantime */
+	pthread_mutex_lock(&volmeter->mutex);
+	if (volmeter->peak_meter_type != peak_meter_type) {
+		volmeter->peak_meter_type = peak_meter_type;
+		source = obs_source_get_ref(volmeter->source);
+	}
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	if (!source)
+		return;
+
+	/* resubscribe so the source knows whether to compute true peak */
+	obs_source_remove_meter_callback(source, volmeter_levels_received,
+			volmeter);
+	obs_source_add_meter_callback(source, volmeter_levels_received,
+			volmeter, peak_meter_type == TRUE_PEAK_METER);
+
+	/* don't leave the callback behind if the source was detached while
+	 * resubscribing */
+	pthread_mutex_lock(&volmeter->mutex);
+	detached = volmeter->source != source;
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	if (detached)
+		obs_source_remove_meter_callback(source,
+				volmeter_levels_received, volmeter);
+
+	obs_source_release(source);
+}
+
 unsigned int obs_volmeter_get_update_interval(obs_volmeter_t *volmeter)
 {
 	if (!volmeter)
@@ -712,3 +856,7 @@ void obs_volmeter_remove_callback(obs_volmeter_t *volmeter,
 	pthread_mutex_unlock(&volmeter->callback_mutex);
 }
 
+signal_handler_t *obs_volmeter_get_signal_handler(obs_volmeter_t *volmeter)
+{
+	return volmeter ? volmeter->signals : NULL;
+}
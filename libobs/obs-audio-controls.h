@@ -68,6 +68,21 @@ enum obs_fader_type {
 	OBS_FADER_LOG
 };
 
+/**
+ * @brief Peak meter types
+ */
+enum obs_peak_meter_type {
+	/**
+	 * @brief The largest absolute sample value
+	 */
+	SAMPLE_PEAK_METER,
+	/**
+	 * @brief The largest absolute value of the 4x oversampled signal,
+	 * as described in ITU-R BS.1770
+	 */
+	TRUE_PEAK_METER
+};
+
 /**
  * @brief Create a fader
  * @param type the type of the fader
@@ -221,6 +236,18 @@ EXPORT void obs_volmeter_detach_source(obs_volmeter_t *volmeter);
 EXPORT void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter,
 		const unsigned int ms);
 
+/**
+ * @brief Set the peak meter type for the volume meter
+ * @param volmeter pointer to the volume meter object
+ * @param peak_meter_type sample peak (default) or true peak
+ *
+ * True peak estimates the peak between samples by oversampling the audio 4x,
+ * which catches overs that sample peak misses.  It costs more to compute,
+ * and is only computed for sources that have a true peak meter attached.
+ */
+EXPORT void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter,
+		enum obs_peak_meter_type peak_meter_type);
+
 /**
  * @brief Get the update interval currently used for the volume meter
  * @param volmeter pointer to the volume meter object
@@ -244,6 +271,23 @@ EXPORT void obs_volmeter_add_callback(obs_volmeter_t *volmeter,
 EXPORT void obs_volmeter_remove_callback(obs_volmeter_t *volmeter,
 		obs_volmeter_updated_t callback, void *param);
 
+/**
+ * @brief Get the signal handler of the volume meter
+ * @param volmeter pointer to the volume meter object
+ *
+ * Signals:
+ *   void levels_updated(ptr volmeter, data magnitude, data peak,
+ *                       data input_peak)
+ *
+ * "magnitude", "peak" and "input_peak" are arrays of MAX_AUDIO_CHANNELS
+ * floats in dB, stored by value; read them with calldata_get_data.  The
+ * signal is raised from the audio thread, so UI code should connect with
+ * SIGNAL_DEFERRED | SIGNAL_COALESCE rather than using
+ * obs_volmeter_add_callback.
+ */
+EXPORT signal_handler_t *obs_volmeter_get_signal_handler(
+		obs_volmeter_t *volmeter);
+
 #ifdef __cplusplus
 }
 #endif
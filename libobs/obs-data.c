@@ -32,6 +32,9 @@ struct obs_data_item {
 	volatile long        ref;
 	struct obs_data      *parent;
 	struct obs_data_item *next;
+	struct obs_data_item *prev;
+	struct obs_data_item *hash_next;
+	uint32_t             hash;
 	enum obs_data_type   type;
 	size_t               name_len;
 	size_t               data_len;
@@ -46,6 +49,12 @@ struct obs_data {
 	volatile long        ref;
 	char                 *json;
 	struct obs_data_item *first_item;
+	struct obs_data_item *last_item;
+	size_t               num_items;
+
+	/* name index, only built once the object has enough items */
+	struct obs_data_item **buckets;
+	size_t               num_buckets;
 };
 
 struct obs_data_array {
@@ -83,6 +92,19 @@ static inline size_t get_name_align_size(const char *name)
 	return total_size - sizeof(struct obs_data_item);
 }
 
+/* FNV-1a */
+static inline uint32_t get_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 static inline char *get_item_name(struct obs_data_item *item)
 {
 	return (char*)item + sizeof(struct obs_data_item);
@@ -279,6 +301,7 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 	item->capacity = total_size;
 	item->type     = type;
 	item->name_len = name_size;
+	item->hash     = get_name_hash(name);
 	item->ref      = 1;
 
 	if (default_data) {
@@ -300,45 +323,153 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 	return item;
 }
 
-static struct obs_data_item **get_item_prev_next(struct obs_data *data,
-		struct obs_data_item *current)
+/* ------------------------------------------------------------------------- */
+/* Item list and name index
+ *
+ * Items are kept in a list sorted by name (which is also the order they are
+ * saved in), and once an object has more than a handful of items they are
+ * also indexed by a hash of their name so lookups don't have to walk the
+ * whole list. */
+
+#define OBS_DATA_INDEX_MIN_ITEMS 8
+
+static inline struct obs_data_item **get_bucket(struct obs_data *data,
+		uint32_t hash)
+{
+	return &data->buckets[hash & (data->num_buckets - 1)];
+}
+
+static void index_insert(struct obs_data *data, struct obs_data_item *item)
 {
-	if (!current || !data)
-		return NULL;
+	struct obs_data_item **bucket = get_bucket(data, item->hash);
+
+	item->hash_next = *bucket;
+	*bucket = item;
+}
+
+static void index_rebuild(struct obs_data *data, size_t num_buckets)
+{
+	struct obs_data_item *item = data->first_item;
 
-	struct obs_data_item **prev_next = &data->first_item;
-	struct obs_data_item *item       = data->first_item;
+	bfree(data->buckets);
+	data->buckets = bzalloc(num_buckets * sizeof(struct obs_data_item*));
+	data->num_buckets = num_buckets;
 
 	while (item) {
-		if (item == current)
-			return prev_next;
+		index_insert(data, item);
+		item = item->next;
+	}
+}
+
+static inline void index_add(struct obs_data *data, struct obs_data_item *item)
+{
+	if (data->buckets && data->num_items <= data->num_buckets)
+		index_insert(data, item);
+	else if (data->buckets)
+		index_rebuild(data, data->num_buckets * 2);
+	else if (data->num_items >= OBS_DATA_INDEX_MIN_ITEMS)
+		index_rebuild(data, OBS_DATA_INDEX_MIN_ITEMS * 2);
+}
+
+/* replaces old_ptr with new_ptr in its bucket, removes it if new_ptr is NULL.
+ * old_ptr may already have been freed by a realloc, it's only compared. */
+static void index_replace(struct obs_data *data, struct obs_data_item *old_ptr,
+		struct obs_data_item *new_ptr, uint32_t hash)
+{
+	struct obs_data_item **prev_next;
 
-		prev_next = &item->next;
-		item      = item->next;
+	if (!data->buckets)
+		return;
+
+	prev_next = get_bucket(data, hash);
+	while (*prev_next) {
+		if (*prev_next == old_ptr) {
+			*prev_next = new_ptr ? new_ptr : old_ptr->hash_next;
+			return;
+		}
+
+		prev_next = &(*prev_next)->hash_next;
 	}
+}
 
-	return NULL;
+static void obs_data_item_attach(struct obs_data *data,
+		struct obs_data_item *item)
+{
+	const char *name = get_item_name(item);
+	struct obs_data_item *next = NULL;
+
+	/* items usually arrive in order (loading saved data, applying one
+	 * object to another), so check the end of the list first */
+	if (data->last_item &&
+	    strcmp(get_item_name(data->last_item), name) > 0) {
+		next = data->first_item;
+		while (strcmp(get_item_name(next), name) < 0)
+			next = next->next;
+	}
+
+	item->parent = data;
+	item->next   = next;
+	item->prev   = next ? next->prev : data->last_item;
+
+	if (item->prev)
+		item->prev->next = item;
+	else
+		data->first_item = item;
+
+	if (next)
+		next->prev = item;
+	else
+		data->last_item = item;
+
+	data->num_items++;
+	index_add(data, item);
 }
 
 static inline void obs_data_item_detach(struct obs_data_item *item)
 {
-	struct obs_data_item **prev_next = get_item_prev_next(item->parent,
-			item);
+	struct obs_data *data = item->parent;
 
-	if (prev_next) {
-		*prev_next = item->next;
-		item->next = NULL;
-	}
+	if (!data)
+		return;
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		data->first_item = item->next;
+
+	if (item->next)
+		item->next->prev = item->prev;
+	else
+		data->last_item = item->prev;
+
+	index_replace(data, item, NULL, item->hash);
+	data->num_items--;
+
+	item->parent    = NULL;
+	item->next      = NULL;
+	item->prev      = NULL;
+	item->hash_next = NULL;
 }
 
 static inline void obs_data_item_reattach(struct obs_data_item *old_ptr,
 		struct obs_data_item *new_ptr)
 {
-	struct obs_data_item **prev_next = get_item_prev_next(new_ptr->parent,
-			old_ptr);
+	struct obs_data *data = new_ptr->parent;
 
-	if (prev_next)
-		*prev_next = new_ptr;
+	if (!data)
+		return;
+
+	if (new_ptr->prev)
+		new_ptr->prev->next = new_ptr;
+	else
+		data->first_item = new_ptr;
+
+	if (new_ptr->next)
+		new_ptr->next->prev = new_ptr;
+	else
+		data->last_item = new_ptr;
+
+	index_replace(data, old_ptr, new_ptr, new_ptr->hash);
 }
 
 static struct obs_data_item *obs_data_item_ensure_capacity(
@@ -705,12 +836,20 @@ static inline void obs_data_destroy(struct obs_data *data)
 
 	while (item) {
 		struct obs_data_item *next = item->next;
+
+		/* items can outlive the object if something still holds a
+		 * reference to them */
+		item->parent    = NULL;
+		item->next      = NULL;
+		item->prev      = NULL;
+		item->hash_next = NULL;
 		obs_data_item_release(&item);
 		item = next;
 	}
 
 	/* NOTE: don't use bfree for json text, allocated by json */
 	free(data->json);
+	bfree(data->buckets);
 	bfree(data);
 }
 
@@ -766,7 +905,24 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 {
 	if (!data) return NULL;
 
-	struct obs_data_item *item = data->first_item;
+	struct obs_data_item *item;
+
+	if (data->buckets) {
+		uint32_t hash = get_name_hash(name);
+
+		item = *get_bucket(data, hash);
+		while (item) {
+			if (item->hash == hash &&
+			    strcmp(get_item_name(item), name) == 0)
+				return item;
+
+			item = item->hash_next;
+		}
+
+		return NULL;
+	}
+
+	item = data->first_item;
 
 	while (item) {
 		if (strcmp(get_item_name(item), name) == 0)
@@ -788,31 +944,8 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 	if ((!item || (item && !*item)) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type,
 				default_data, autoselect_data);
-
-		obs_data_item_t *prev = obs_data_first(data);
-		obs_data_item_t *next = obs_data_first(data);
-		obs_data_item_next(&next);
-		for (; prev && next; obs_data_item_next(&prev),
-				obs_data_item_next(&next)) {
-			if (strcmp(get_item_name(next), name) > 0)
-				break;
-		}
-
-		new_item->parent = data;
-		if (prev && strcmp(get_item_name(prev), name) < 0) {
-			prev->next     = new_item;
-			new_item->next = next;
-
-		} else {
-			data->first_item = new_item;
-			new_item->next   = prev;
-		}
-
-		if (!prev)
-			data->first_item = new_item;
-
-		obs_data_item_release(&prev);
-		obs_data_item_release(&next);
+		if (new_item)
+			obs_data_item_attach(data, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
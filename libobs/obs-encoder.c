@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
+
 #include "obs.h"
 #include "obs-internal.h"
 
@@ -106,7 +108,8 @@ static struct obs_encoder *create_encoder(const char *id,
 
 	obs_context_data_insert(&encoder->context,
 			&obs->data.encoders_mutex,
-			&obs->data.first_encoder);
+			&obs->data.first_encoder,
+			&obs->data.encoder_index);
 
 	blog(LOG_DEBUG, "encoder '%s' (%s) created", name, id);
 	return encoder;
@@ -415,10 +418,38 @@ bool obs_encoder_initialize(obs_encoder_t *encoder)
 	return success;
 }
 
+static void log_packet_copy_stats(struct obs_encoder *encoder)
+{
+	uint64_t elapsed;
+	double seconds;
+
+	if (!encoder->packet_copy_start_time)
+		return;
+
+	elapsed = os_gettime_ns() - encoder->packet_copy_start_time;
+	seconds = (double)elapsed / 1000000000.0;
+
+	blog(LOG_INFO, "encoder '%s': copied %"PRIu64" bytes of packet data "
+			"(%.0f bytes/sec), outputs referenced %"PRIu64" "
+			"bytes they used to copy (%.0f bytes/sec)",
+			encoder->context.name, encoder->packet_bytes_copied,
+			seconds > 0.0 ?
+			(double)encoder->packet_bytes_copied / seconds : 0.0,
+			encoder->packet_bytes_shared,
+			seconds > 0.0 ?
+			(double)encoder->packet_bytes_shared / seconds : 0.0);
+
+	encoder->packet_bytes_copied = 0;
+	encoder->packet_bytes_shared = 0;
+	encoder->packet_copy_start_time = 0;
+}
+
 void obs_encoder_shutdown(obs_encoder_t *encoder)
 {
 	pthread_mutex_lock(&encoder->init_mutex);
 	if (encoder->context.data) {
+		log_packet_copy_stats(encoder);
+
 		encoder->info.destroy(encoder->context.data);
 		encoder->context.data    = NULL;
 		encoder->paired_encoder  = NULL;
@@ -715,11 +746,35 @@ static inline bool get_sei(const struct obs_encoder *encoder,
 	return false;
 }
 
+static inline void count_packet_copy(struct obs_encoder *encoder,
+		size_t size)
+{
+	if (!encoder->packet_copy_start_time)
+		encoder->packet_copy_start_time = os_gettime_ns();
+	encoder->packet_bytes_copied += size;
+}
+
+static void create_packet_instance(struct encoder_packet *dst,
+		const struct encoder_packet *src,
+		const uint8_t *prefix, size_t prefix_size)
+{
+	long *p_refs;
+
+	*dst = *src;
+	p_refs = bmalloc(prefix_size + src->size + sizeof(long));
+	dst->data = (void*)(p_refs + 1);
+	dst->size = prefix_size + src->size;
+	*p_refs = 1;
+
+	if (prefix_size)
+		memcpy(dst->data, prefix, prefix_size);
+	memcpy(dst->data + prefix_size, src->data, src->size);
+}
+
 static void send_first_video_packet(struct obs_encoder *encoder,
 		struct encoder_callback *cb, struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
-	DARRAY(uint8_t)       data;
 	uint8_t               *sei;
 	size_t                size;
 
@@ -727,25 +782,19 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	if (!packet->keyframe)
 		return;
 
-	da_init(data);
-
 	if (!get_sei(encoder, &sei, &size) || !sei || !size) {
 		cb->new_packet(cb->param, packet);
 		cb->sent_first_packet = true;
 		return;
 	}
 
-	da_push_back_array(data, sei, size);
-	da_push_back_array(data, packet->data, packet->size);
-
-	first_packet      = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	create_packet_instance(&first_packet, packet, sei, size);
+	count_packet_copy(encoder, first_packet.size);
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
@@ -779,6 +828,7 @@ static inline void do_encode(struct obs_encoder *encoder,
 					"encode(%s)", encoder->context.name);
 
 	struct encoder_packet pkt = {0};
+	struct encoder_packet shared_pkt;
 	bool received = false;
 	bool success;
 
@@ -809,15 +859,22 @@ static inline void do_encode(struct obs_encoder *encoder,
 			packet_dts_usec(&pkt) - encoder->offset_usec;
 		pkt.sys_dts_usec = pkt.dts_usec;
 
+		/* the encoder owns pkt.data, so copy it once into a shared
+		 * refcounted buffer, outputs only take references to it */
+		create_packet_instance(&shared_pkt, &pkt, NULL, 0);
+		count_packet_copy(encoder, pkt.size);
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array+(i-1);
-			send_packet(encoder, cb, &pkt);
+			send_packet(encoder, cb, &shared_pkt);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+		obs_encoder_packet_release(&shared_pkt);
 	}
 
 error:
@@ -1034,13 +1091,7 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 		const struct encoder_packet *src)
 {
-	long *p_refs;
-
-	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void*)(p_refs + 1);
-	*p_refs = 1;
-	memcpy(dst->data, src->data, src->size);
+	create_packet_instance(dst, src, NULL, 0);
 }
 
 void obs_duplicate_encoder_packet(struct encoder_packet *dst,
@@ -1082,6 +1133,42 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 	memset(pkt, 0, sizeof(struct encoder_packet));
 }
 
+uint64_t obs_encoder_get_packet_bytes_copied(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_packet_bytes_copied")
+		? encoder->packet_bytes_copied : 0;
+}
+
+uint64_t obs_encoder_get_packet_bytes_shared(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_packet_bytes_shared")
+		? encoder->packet_bytes_shared : 0;
+}
+
+bool obs_encoder_get_video_input_stats(const obs_encoder_t *encoder,
+		struct video_input_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_video_input_stats"))
+		return false;
+	if (encoder->info.type != OBS_ENCODER_VIDEO)
+		return false;
+
+	return video_output_get_input_stats(encoder->media, receive_video,
+			(void*)encoder, stats);
+}
+
+void obs_encoder_count_shared_packet(const struct encoder_packet *packet)
+{
+	struct obs_encoder *encoder = packet->encoder;
+
+	if (!encoder)
+		return;
+
+	if (!encoder->packet_copy_start_time)
+		encoder->packet_copy_start_time = os_gettime_ns();
+	encoder->packet_bytes_shared += packet->size;
+}
+
 void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder,
 		enum video_format format)
 {
@@ -33,6 +33,7 @@
 #include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-math.h"
 
 #include "obs.h"
 
@@ -225,6 +226,17 @@ struct obs_vframe_info {
 	int count;
 };
 
+struct video_convert_pool;
+
+struct scene_render_cache_entry {
+	obs_weak_source_t               *source;
+	gs_texrender_t                  *texrender;
+	uint64_t                        rendered_pass;
+	uint64_t                        used_pass;
+	uint64_t                        version;
+	bool                            cacheable;
+};
+
 struct obs_core_video {
 	graphics_t                      *graphics;
 	gs_stagesurf_t                  *copy_surfaces[NUM_TEXTURES];
@@ -266,6 +278,19 @@ struct obs_core_video {
 	uint32_t                        plane_sizes[3];
 	uint32_t                        plane_linewidth[3];
 
+	volatile long                   convert_workers;
+	struct video_convert_pool       *convert_pool;
+	bool                            threaded_delivery;
+	bool                            cascaded_scaling;
+
+	/* renders of sources shared by all displays, graphics thread only */
+	DARRAY(struct scene_render_cache_entry) scene_render_cache;
+	uint64_t                        display_pass;
+	uint32_t                        scene_renders;
+	uint32_t                        scene_renders_saved;
+	uint32_t                        last_scene_renders;
+	uint32_t                        last_scene_renders_saved;
+
 	uint32_t                        output_width;
 	uint32_t                        output_height;
 	uint32_t                        base_width;
@@ -302,6 +327,15 @@ struct obs_core_audio {
 
 	float                           user_volume;
 
+	bool                            precise_timing;
+	bool                            monitoring_clock;
+
+	/* the monitor whose device clock the audio thread follows, and how
+	 * far that clock was from the system clock when it last played */
+	struct audio_monitor *volatile  clock_monitor;
+	volatile int64_t                clock_monitor_offset;
+	volatile bool                   clock_monitor_valid;
+
 	pthread_mutex_t                 monitoring_mutex;
 	DARRAY(struct audio_monitor*)   monitors;
 	char                            *monitoring_device_name;
@@ -309,6 +343,19 @@ struct obs_core_audio {
 };
 
 /* user sources, output channels, and displays */
+/* hash index of the names of the public contexts of a context list, which
+ * is protected by the mutex of that list */
+struct obs_context_index {
+	struct obs_context_data         **buckets;
+	size_t                          num_buckets;
+	size_t                          num;
+
+	/* insertion order of the next context, and a count of the changes to
+	 * the index, which lets lookups made outside the lock be verified */
+	uint64_t                        next_order;
+	volatile long                   generation;
+};
+
 struct obs_core_data {
 	struct obs_source               *first_source;
 	struct obs_source               *first_audio_source;
@@ -323,6 +370,12 @@ struct obs_core_data {
 	pthread_mutex_t                 encoders_mutex;
 	pthread_mutex_t                 services_mutex;
 	pthread_mutex_t                 audio_sources_mutex;
+
+	struct obs_context_index        source_index;
+	struct obs_context_index        output_index;
+	struct obs_context_index        encoder_index;
+	struct obs_context_index        service_index;
+
 	pthread_mutex_t                 draw_callbacks_mutex;
 	DARRAY(struct draw_callback)    draw_callbacks;
 	DARRAY(struct tick_callback)    tick_callbacks;
@@ -385,6 +438,7 @@ struct obs_core {
 
 	signal_handler_t                *signals;
 	proc_handler_t                  *procs;
+	signal_handle_t                 *source_volume_signal;
 
 	char                            *locale;
 	char                            *module_config_path;
@@ -402,6 +456,9 @@ struct obs_core {
 extern struct obs_core *obs;
 
 extern void *obs_graphics_thread(void *param);
+extern void obs_free_scene_render_cache(struct obs_core_video *video);
+extern void obs_scene_render_cache_begin(struct obs_core_video *video);
+extern void obs_scene_render_cache_end(struct obs_core_video *video);
 
 extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
@@ -439,6 +496,12 @@ struct obs_context_data {
 	struct obs_context_data         *next;
 	struct obs_context_data         **prev_next;
 
+	struct obs_context_index        *index;
+	struct obs_context_data         *hash_next;
+	uint32_t                        name_hash;
+	uint64_t                        index_order;
+	bool                            indexed;
+
 	bool                            private;
 };
 
@@ -452,12 +515,20 @@ extern bool obs_context_data_init(
 extern void obs_context_data_free(struct obs_context_data *context);
 
 extern void obs_context_data_insert(struct obs_context_data *context,
-		pthread_mutex_t *mutex, void *first);
+		pthread_mutex_t *mutex, void *first,
+		struct obs_context_index *index);
 extern void obs_context_data_remove(struct obs_context_data *context);
 
 extern void obs_context_data_setname(struct obs_context_data *context,
 		const char *name);
 
+/* gets up to max_sources public sources with the given name without adding
+ * references, newest first, and returns the total number of matching sources.
+ * generation is set to the generation of the source index the sources were
+ * found in */
+extern size_t obs_find_sources_by_name(const char *name,
+		obs_source_t **sources, size_t max_sources, long *generation);
+
 
 /* ------------------------------------------------------------------------- */
 /* ref-counting  */
@@ -487,6 +558,11 @@ static inline bool obs_weak_ref_release(struct obs_weak_ref *ref)
 	return os_atomic_dec_long(&ref->weak_refs) == -1;
 }
 
+static inline bool obs_weak_ref_expired(struct obs_weak_ref *ref)
+{
+	return os_atomic_load_long(&ref->refs) < 0;
+}
+
 static inline bool obs_weak_ref_get_ref(struct obs_weak_ref *ref)
 {
 	long owners = ref->refs;
@@ -510,6 +586,14 @@ struct async_frame {
 	bool used;
 };
 
+/* frame whose data is owned by the source (obs_source_output_video_nocopy) */
+struct async_external_frame {
+	struct obs_source_frame *frame;
+	obs_source_frame_release_t release;
+	void *param;
+	bool queued;
+};
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -536,6 +620,24 @@ struct audio_cb_info {
 	void *param;
 };
 
+/* levels of a source's audio, computed once per audio packet for everything
+ * metering the source */
+struct audio_meter_levels {
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float true_peak[MAX_AUDIO_CHANNELS];
+	bool  muted;
+};
+
+typedef void (*audio_meter_updated_t)(void *param,
+		const struct audio_meter_levels *levels);
+
+struct audio_meter_cb {
+	audio_meter_updated_t callback;
+	void *param;
+	bool true_peak;
+};
+
 struct obs_source {
 	struct obs_context_data         context;
 	struct obs_source_info          info;
@@ -568,6 +670,10 @@ struct obs_source {
 	/* used to temporarily disable sources if needed */
 	bool                            enabled;
 
+	/* set by synchronous sources that are known to fill every pixel they
+	 * draw with full opacity */
+	volatile bool                   video_opaque;
+
 	/* timing (if video is present, is based upon video) */
 	volatile bool                   timing_set;
 	volatile uint64_t               timing_adjust;
@@ -599,11 +705,18 @@ struct obs_source {
 	pthread_mutex_t                 audio_mutex;
 	pthread_mutex_t                 audio_cb_mutex;
 	DARRAY(struct audio_cb_info)    audio_cb_list;
+	pthread_mutex_t                 meter_mutex;
+	DARRAY(struct audio_meter_cb)   meter_cb_list;
+	size_t                          meter_true_peak_users;
+	float                           meter_history[MAX_AUDIO_CHANNELS]
+	                                             [AUDIO_TRUE_PEAK_HISTORY];
 	struct obs_audio_data           audio_data;
 	size_t                          audio_storage_size;
 	uint32_t                        audio_mixers;
+	uint32_t                        audio_written_mixes;
 	float                           user_volume;
 	float                           volume;
+	signal_handle_t                 *volume_signal;
 	int64_t                         sync_offset;
 	int64_t                         last_sync_offset;
 
@@ -626,7 +739,11 @@ struct obs_source {
 	bool                            async_unbuffered;
 	bool                            async_decoupled;
 	struct obs_source_frame         *async_preload_frame;
+	/* incremented whenever static video changes */
+	volatile long                   content_version;
+
 	DARRAY(struct async_frame)      async_cache;
+	DARRAY(struct async_external_frame) async_external;
 	DARRAY(struct obs_source_frame*)async_frames;
 	pthread_mutex_t                 async_mutex;
 	uint32_t                        async_width;
@@ -718,9 +835,20 @@ extern void obs_transition_load(obs_source_t *source, obs_data_t *data);
 struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
 extern void audio_monitor_destroy(struct audio_monitor *monitor);
+extern void audio_monitor_publish_clock(struct audio_monitor *monitor,
+		uint64_t device_ts);
+extern void audio_monitor_release_clock(struct audio_monitor *monitor);
 
 extern void obs_source_destroy(struct obs_source *source);
 
+/* shared metering, see obs-audio-controls.c */
+extern void obs_source_add_meter_callback(obs_source_t *source,
+		audio_meter_updated_t callback, void *param, bool true_peak);
+extern void obs_source_remove_meter_callback(obs_source_t *source,
+		audio_meter_updated_t callback, void *param);
+extern void obs_source_update_meters(obs_source_t *source,
+		const struct audio_data *data, bool muted);
+
 enum view_type {
 	MAIN_VIEW,
 	AUX_VIEW
@@ -784,6 +912,27 @@ extern bool set_async_texture_size(struct obs_source *source,
 extern void remove_async_frame(obs_source_t *source,
 		struct obs_source_frame *frame);
 
+static inline uint64_t mix_content_version(uint64_t hash, uint64_t val)
+{
+	return hash ^ (val + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+/* returns false if the video of the source can change at any time,
+ * otherwise version changes whenever the rendered video of the source would
+ * change */
+extern bool obs_source_get_content_version(obs_source_t *source,
+		uint64_t *version);
+extern bool obs_scene_get_content_version(obs_scene_t *scene,
+		uint64_t *version);
+
+/* returns true if the source is known to draw only fully opaque pixels */
+extern bool obs_source_video_opaque(obs_source_t *source);
+
+/* keeps the source and its children consuming async frames while their
+ * rendering is being skipped */
+extern void obs_source_video_skip_render(obs_source_t *source);
+extern void obs_scene_video_skip_render(obs_scene_t *scene);
+
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source,
 		uint64_t sys_time);
@@ -820,6 +969,15 @@ struct caption_text {
 	struct caption_text *next;
 };
 
+/* interleaved packets are queued per track: video first, then one queue per
+ * audio track */
+#define INTERLEAVE_TRACKS (MAX_AUDIO_MIXES + 1)
+
+struct interleaved_packet {
+	struct encoder_packet           packet;
+	uint64_t                        seq;
+};
+
 struct obs_output {
 	struct obs_context_data         context;
 	struct obs_output_info          info;
@@ -839,7 +997,8 @@ struct obs_output {
 	pthread_t                       end_data_capture_thread;
 	os_event_t                      *stopping_event;
 	pthread_mutex_t                 interleaved_mutex;
-	DARRAY(struct encoder_packet)   interleaved_packets;
+	struct circlebuf                interleaved_tracks[INTERLEAVE_TRACKS];
+	uint64_t                        interleaved_seq;
 	int                             stop_code;
 
 	int                             reconnect_retry_sec;
@@ -990,6 +1149,13 @@ struct obs_encoder {
 	pthread_mutex_t                 callbacks_mutex;
 	DARRAY(struct encoder_callback) callbacks;
 
+	/* packet data copy statistics, only updated from the encoder
+	 * thread.  shared counts the bytes outputs reference, which each
+	 * output used to copy */
+	uint64_t                        packet_bytes_copied;
+	uint64_t                        packet_bytes_shared;
+	uint64_t                        packet_copy_start_time;
+
 	const char                      *profile_encoder_encode_name;
 };
 
@@ -998,6 +1164,11 @@ extern struct obs_encoder_info *find_encoder(const char *id);
 extern bool obs_encoder_initialize(obs_encoder_t *encoder);
 extern void obs_encoder_shutdown(obs_encoder_t *encoder);
 
+/* called by outputs where they take a reference to a packet instead of
+ * copying it */
+extern void obs_encoder_count_shared_packet(
+		const struct encoder_packet *packet);
+
 extern void obs_encoder_start(obs_encoder_t *encoder,
 		void (*new_packet)(void *param, struct encoder_packet *packet),
 		void *param);
@@ -146,7 +146,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 
 	obs_context_data_insert(&output->context,
 			&obs->data.outputs_mutex,
-			&obs->data.first_output);
+			&obs->data.first_output,
+			&obs->data.output_index);
 
 	if (info)
 		output->context.data = info->create(output->context.settings,
@@ -164,9 +165,19 @@ fail:
 
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array+i);
-	da_free(output->interleaved_packets);
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *track = &output->interleaved_tracks[i];
+
+		while (track->size) {
+			struct interleaved_packet packet;
+			circlebuf_pop_front(track, &packet, sizeof(packet));
+			obs_encoder_packet_release(&packet.packet);
+		}
+
+		circlebuf_free(track);
+	}
+
+	output->interleaved_seq = 0;
 }
 
 void obs_output_destroy(obs_output_t *output)
@@ -279,6 +290,24 @@ static inline bool data_active(struct obs_output *output)
 	return os_atomic_load_bool(&output->data_active);
 }
 
+static void log_video_input_stats(struct obs_output *output)
+{
+	struct video_input_stats stats;
+	uint32_t total;
+
+	if (!obs_output_get_video_input_stats(output, &stats))
+		return;
+
+	total = stats.delivered_frames + stats.dropped_frames;
+	if (!total)
+		return;
+
+	blog(LOG_INFO, "Output '%s': Video input thread delivered "
+			"%"PRIu32"/%"PRIu32" frames, max queue lag %"PRIu64
+			" ms", output->context.name, stats.delivered_frames,
+			total, stats.max_lag_ns / 1000000);
+}
+
 static void log_frame_info(struct obs_output *output)
 {
 	struct obs_core_video *video = &obs->video;
@@ -325,6 +354,8 @@ static void log_frame_info(struct obs_output *output)
 				"%d (%0.1f%%)",
 				output->context.name,
 				dropped, percentage_dropped);
+
+	log_video_input_stats(output);
 }
 
 static inline void signal_stop(struct obs_output *output);
@@ -709,6 +740,24 @@ int obs_output_get_total_frames(const obs_output_t *output)
 		output->total_frames : 0;
 }
 
+static void default_raw_video_callback(void *param, struct video_data *frame);
+
+bool obs_output_get_video_input_stats(const obs_output_t *output,
+		struct video_input_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_video_input_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_output_get_video_input_stats"))
+		return false;
+
+	if ((output->info.flags & OBS_OUTPUT_ENCODED) != 0)
+		return obs_encoder_get_video_input_stats(output->video_encoder,
+				stats);
+
+	return video_output_get_input_stats(output->video,
+			default_raw_video_callback, (void*)output, stats);
+}
+
 void obs_output_set_preferred_size(obs_output_t *output, uint32_t width,
 		uint32_t height)
 {
@@ -963,6 +1012,99 @@ static inline void apply_interleaved_packet_offset(struct obs_output *output,
 	out->dts_usec = packet_dts_usec(out);
 }
 
+/* ------------------------------------------------------------------------- */
+/* interleave queue.  packets are queued per track and merged on the way out,
+ * in dts_usec order, video first on equal timestamps, and otherwise in the
+ * order they were received. */
+
+static inline struct circlebuf *get_interleave_track(
+		struct obs_output *output, enum obs_encoder_type type,
+		size_t audio_idx)
+{
+	size_t idx = type == OBS_ENCODER_VIDEO ? 0 : audio_idx + 1;
+	return &output->interleaved_tracks[idx];
+}
+
+static inline size_t track_packet_count(const struct circlebuf *track)
+{
+	return track->size / sizeof(struct interleaved_packet);
+}
+
+static inline struct interleaved_packet *get_track_packet(
+		struct circlebuf *track, size_t idx)
+{
+	return circlebuf_data(track, idx * sizeof(struct interleaved_packet));
+}
+
+static inline struct interleaved_packet *first_track_packet(
+		struct circlebuf *track)
+{
+	return track->size ? get_track_packet(track, 0) : NULL;
+}
+
+static inline struct interleaved_packet *last_track_packet(
+		struct circlebuf *track)
+{
+	size_t count = track_packet_count(track);
+	return count ? get_track_packet(track, count - 1) : NULL;
+}
+
+static inline bool interleaved_packet_before(
+		const struct interleaved_packet *a,
+		const struct interleaved_packet *b)
+{
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+	if (a->packet.type != b->packet.type)
+		return a->packet.type == OBS_ENCODER_VIDEO;
+	return a->seq < b->seq;
+}
+
+/* returns the track that holds the next packet in interleaved order */
+static struct circlebuf *next_interleaved_track(struct obs_output *output)
+{
+	struct circlebuf *next_track = NULL;
+	struct interleaved_packet *next = NULL;
+
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *track = &output->interleaved_tracks[i];
+		struct interleaved_packet *packet = first_track_packet(track);
+
+		if (packet && (!next || interleaved_packet_before(packet, next))) {
+			next_track = track;
+			next = packet;
+		}
+	}
+
+	return next_track;
+}
+
+static inline void pop_interleaved_packet(struct circlebuf *track)
+{
+	struct interleaved_packet packet;
+	circlebuf_pop_front(track, &packet, sizeof(packet));
+	obs_encoder_packet_release(&packet.packet);
+}
+
+/* discards packets in interleaved order until the stop packet is reached */
+static void discard_interleaved_packets(struct obs_output *output,
+		struct interleaved_packet stop, bool include_stop)
+{
+	struct circlebuf *track;
+
+	while ((track = next_interleaved_track(output)) != NULL) {
+		struct interleaved_packet *packet = first_track_packet(track);
+		bool is_stop = packet->seq == stop.seq;
+
+		if (is_stop && !include_stop)
+			break;
+		if (!is_stop && !interleaved_packet_before(packet, &stop))
+			break;
+
+		pop_interleaved_packet(track);
+	}
+}
+
 static inline bool has_higher_opposing_ts(struct obs_output *output,
 		struct encoder_packet *packet)
 {
@@ -1024,7 +1166,13 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct circlebuf *track = next_interleaved_track(output);
+	struct encoder_packet out;
+
+	if (!track)
+		return;
+
+	out = first_track_packet(track)->packet;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
@@ -1032,7 +1180,7 @@ static inline void send_interleaved(struct obs_output *output)
 	if (!has_higher_opposing_ts(output, &out))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	circlebuf_pop_front(track, NULL, sizeof(struct interleaved_packet));
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1079,184 +1227,148 @@ static inline void set_higher_ts(struct obs_output *output,
 
 static inline struct encoder_packet *find_first_packet_type(
 		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx);
+		size_t audio_idx)
+{
+	struct interleaved_packet *packet = first_track_packet(
+			get_interleave_track(output, type, audio_idx));
+	return packet ? &packet->packet : NULL;
+}
+
+static inline struct encoder_packet *find_last_packet_type(
+		struct obs_output *output, enum obs_encoder_type type,
+		size_t audio_idx)
+{
+	struct interleaved_packet *packet = last_track_packet(
+			get_interleave_track(output, type, audio_idx));
+	return packet ? &packet->packet : NULL;
+}
 
 /* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
+static bool get_interleaved_start(struct obs_output *output,
+		struct interleaved_packet *start)
 {
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
-	struct encoder_packet *first_video = find_first_packet_type(output,
-			OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
-
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
-
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
-
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+	struct interleaved_packet *first_video = first_track_packet(
+			get_interleave_track(output, OBS_ENCODER_VIDEO, 0));
+	struct interleaved_packet *closest = NULL;
+
+	for (size_t i = 1; i < INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *track = &output->interleaved_tracks[i];
+		size_t count = track_packet_count(track);
+
+		for (size_t j = 0; j < count; j++) {
+			struct interleaved_packet *packet =
+				get_track_packet(track, j);
+			int64_t diff = llabs(packet->packet.dts_usec -
+					first_video->packet.dts_usec);
+
+			if (diff < closest_diff || (closest &&
+			    diff == closest_diff &&
+			    interleaved_packet_before(packet, closest))) {
+				closest_diff = diff;
+				closest = packet;
+			}
 		}
 	}
 
-	return video_idx < idx ? video_idx : idx;
+	if (!closest)
+		return false;
+
+	*start = interleaved_packet_before(first_video, closest) ?
+		*first_video : *closest;
+	return true;
 }
 
-static int prune_premature_packets(struct obs_output *output)
+static int prune_premature_packets(struct obs_output *output,
+		struct interleaved_packet *prune_to)
 {
 	size_t audio_mixes = num_audio_mixes(output);
-	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
+	struct interleaved_packet *video;
+	struct interleaved_packet *last;
 	int64_t duration_usec;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1) {
+	video = first_track_packet(
+			get_interleave_track(output, OBS_ENCODER_VIDEO, 0));
+	if (!video) {
 		output->received_video = false;
 		return -1;
 	}
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
-	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
+	last = video;
+	duration_usec = video->packet.timebase_num * 1000000LL /
+		video->packet.timebase_den;
 
 	for (size_t i = 0; i < audio_mixes; i++) {
-		struct encoder_packet *audio;
-		int audio_idx;
+		struct interleaved_packet *audio;
 
-		audio_idx = find_first_packet_type_idx(output,
-				OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		audio = first_track_packet(
+				get_interleave_track(output,
+					OBS_ENCODER_AUDIO, i));
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
+		if (interleaved_packet_before(last, audio))
+			last = audio;
 
-		diff = audio->dts_usec - video->dts_usec;
+		diff = audio->packet.dts_usec - video->packet.dts_usec;
 		if (diff > max_diff)
 			max_diff = diff;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
-}
-
-static void discard_to_idx(struct obs_output *output, size_t idx)
-{
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_encoder_packet_release(packet);
-	}
+	if (diff <= duration_usec)
+		return 0;
 
-	da_erase_range(output->interleaved_packets, 0, idx);
+	*prune_to = *last;
+	return 1;
 }
 
 #define DEBUG_STARTING_PACKETS 0
 
+#if DEBUG_STARTING_PACKETS == 1
+static void debug_starting_packets(struct obs_output *output)
+{
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *track = &output->interleaved_tracks[i];
+		size_t count = track_packet_count(track);
+
+		for (size_t j = 0; j < count; j++) {
+			struct encoder_packet *packet =
+				&get_track_packet(track, j)->packet;
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld",
+					packet->type == OBS_ENCODER_AUDIO ?
+					"audio" : "video",
+					(int)packet->track_idx,
+					packet->dts_usec);
+		}
+	}
+}
+#endif
+
 static bool prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
+	struct interleaved_packet start;
+	int prune = prune_premature_packets(output, &start);
 
 #if DEBUG_STARTING_PACKETS == 1
-	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-				packet->type == OBS_ENCODER_AUDIO ?
-				"audio" : "video", (int)packet->track_idx,
-				packet->dts_usec,
-				(int)i < prune_start ? "true" : "false");
-	}
+	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune);
+	debug_starting_packets(output);
 #endif
 
 	/* prunes the first video packet if it's too far away from audio */
-	if (prune_start == -1)
+	if (prune == -1)
 		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
-	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
+	else if (prune != 0)
+		discard_interleaved_packets(output, start, true);
+	else if (get_interleaved_start(output, &start))
+		discard_interleaved_packets(output, start, false);
 
 	return true;
 }
 
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)i;
-		}
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)(i - 1);
-		}
-	}
-
-	return -1;
-}
-
-static inline struct encoder_packet *find_first_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *find_last_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
 static bool get_audio_and_video_packets(struct obs_output *output,
 		struct encoder_packet **video,
 		struct encoder_packet **audio, size_t audio_mixes)
@@ -1280,13 +1392,48 @@ static bool get_audio_and_video_packets(struct obs_output *output,
 	return true;
 }
 
+/* renumbers packets in their current interleaved order, so that packets with
+ * equal timestamps keep that order once new offsets have been applied */
+static void renumber_interleaved_packets(struct obs_output *output)
+{
+	size_t pos[INTERLEAVE_TRACKS] = {0};
+	uint64_t seq = 0;
+
+	for (;;) {
+		struct interleaved_packet *next = NULL;
+		size_t next_track = 0;
+
+		for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+			struct circlebuf *track = &output->interleaved_tracks[i];
+			struct interleaved_packet *packet;
+
+			if (pos[i] == track_packet_count(track))
+				continue;
+
+			packet = get_track_packet(track, pos[i]);
+			if (!next || interleaved_packet_before(packet, next)) {
+				next = packet;
+				next_track = i;
+			}
+		}
+
+		if (!next)
+			break;
+
+		next->seq = seq++;
+		pos[next_track]++;
+	}
+
+	output->interleaved_seq = seq;
+}
+
 static bool initialize_interleaved_packets(struct obs_output *output)
 {
 	struct encoder_packet *video;
 	struct encoder_packet *audio[MAX_AUDIO_MIXES];
 	struct encoder_packet *last_audio[MAX_AUDIO_MIXES];
+	struct interleaved_packet start;
 	size_t audio_mixes = num_audio_mixes(output);
-	size_t start_idx;
 
 	if (!get_audio_and_video_packets(output, &video, audio, audio_mixes))
 		return false;
@@ -1304,9 +1451,8 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	}
 
 	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
+	if (get_interleaved_start(output, &start)) {
+		discard_interleaved_packets(output, start, false);
 		if (!get_audio_and_video_packets(output, &video, audio,
 					audio_mixes))
 			return false;
@@ -1331,11 +1477,16 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_audio_ts -= audio[0]->dts_usec;
 	output->highest_video_ts -= video->dts_usec;
 
+	renumber_interleaved_packets(output);
+
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *track = &output->interleaved_tracks[i];
+		size_t count = track_packet_count(track);
+
+		for (size_t j = 0; j < count; j++)
+			apply_interleaved_packet_offset(output,
+					&get_track_packet(track, j)->packet);
 	}
 
 	return true;
@@ -1344,51 +1495,42 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 static inline void insert_interleaved_packet(struct obs_output *output,
 		struct encoder_packet *out)
 {
+	struct circlebuf *track = get_interleave_track(output, out->type,
+			out->track_idx);
+	struct interleaved_packet packet = {*out, output->interleaved_seq++};
 	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
-}
 
-static void resort_interleaved_packets(struct obs_output *output)
-{
-	DARRAY(struct encoder_packet) old_array;
+	circlebuf_push_back(track, &packet, sizeof(packet));
 
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-			sizeof(output->interleaved_packets));
+	/* packets of a track normally arrive in order, anything else is
+	 * moved back into place */
+	idx = track_packet_count(track) - 1;
+	while (idx > 0) {
+		struct interleaved_packet *prev = get_track_packet(track,
+				idx - 1);
+		struct interleaved_packet *cur = get_track_packet(track, idx);
 
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
+		if (!interleaved_packet_before(cur, prev))
+			break;
 
-	da_free(old_array);
+		packet = *prev;
+		*prev = *cur;
+		*cur = packet;
+		idx--;
+	}
 }
 
 static void discard_unused_audio_packets(struct obs_output *output,
 		int64_t dts_usec)
 {
-	size_t idx = 0;
+	struct circlebuf *track;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
+	while ((track = next_interleaved_track(output)) != NULL) {
+		if (first_track_packet(track)->packet.dts_usec >= dts_usec)
 			break;
-	}
 
-	if (idx)
-		discard_to_idx(output, idx);
+		pop_interleaved_packet(track);
+	}
 }
 
 static void interleave_packets(void *data, struct encoder_packet *packet)
@@ -1419,10 +1561,12 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 
 	was_started = output->received_audio && output->received_video;
 
-	if (output->active_delay_ns)
+	if (output->active_delay_ns) {
 		out = *packet;
-	else
-		obs_encoder_packet_create_instance(&out, packet);
+	} else {
+		obs_encoder_packet_ref(&out, packet);
+		obs_encoder_count_shared_packet(packet);
+	}
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
@@ -1437,10 +1581,8 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->received_audio && output->received_video) {
 		if (!was_started) {
 			if (prune_interleaved_packets(output)) {
-				if (initialize_interleaved_packets(output)) {
-					resort_interleaved_packets(output);
+				if (initialize_interleaved_packets(output))
 					send_interleaved(output);
-				}
 			}
 		} else {
 			send_interleaved(output);
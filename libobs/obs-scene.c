@@ -17,6 +17,7 @@
 ******************************************************************************/
 
 #include "util/threading.h"
+#include "util/profiler.h"
 #include "graphics/math-defs.h"
 #include "obs-scene.h"
 
@@ -64,7 +65,7 @@ static const char *scene_getname(void *unused)
 static void *scene_create(obs_data_t *settings, struct obs_source *source)
 {
 	pthread_mutexattr_t attr;
-	struct obs_scene *scene = bmalloc(sizeof(struct obs_scene));
+	struct obs_scene *scene = bzalloc(sizeof(struct obs_scene));
 	scene->source     = source;
 	scene->first_item = NULL;
 
@@ -117,11 +118,107 @@ static inline void full_unlock(struct obs_scene *scene)
 static void set_visibility(struct obs_scene_item *item, bool vis);
 static inline void detach_sceneitem(struct obs_scene_item *item);
 
+#define SCENE_INDEX_MIN_BUCKETS 16
+
+static inline size_t hash_bucket(uint64_t val, size_t num_buckets)
+{
+	return (size_t)((val * 0x9E3779B97F4A7C15ULL) >> 32) &
+		(num_buckets - 1);
+}
+
+static inline size_t id_bucket(const struct obs_scene *scene, int64_t id)
+{
+	return hash_bucket((uint64_t)id, scene->num_buckets);
+}
+
+static inline size_t source_bucket(const struct obs_scene *scene,
+		const obs_source_t *source)
+{
+	return hash_bucket((uint64_t)(uintptr_t)source, scene->num_buckets);
+}
+
+static inline void link_item_index(struct obs_scene *scene,
+		struct obs_scene_item *item)
+{
+	size_t id_idx = id_bucket(scene, item->id);
+	size_t source_idx = source_bucket(scene, item->source);
+
+	item->id_hash_next = scene->id_buckets[id_idx];
+	scene->id_buckets[id_idx] = item;
+
+	item->source_hash_next = scene->source_buckets[source_idx];
+	scene->source_buckets[source_idx] = item;
+}
+
+static void resize_item_index(struct obs_scene *scene, size_t num_buckets)
+{
+	struct obs_scene_item **old_buckets = scene->id_buckets;
+	size_t old_num_buckets = scene->num_buckets;
+
+	bfree(scene->source_buckets);
+	scene->id_buckets = bzalloc(num_buckets * sizeof(*old_buckets));
+	scene->source_buckets = bzalloc(num_buckets * sizeof(*old_buckets));
+	scene->num_buckets = num_buckets;
+
+	for (size_t i = 0; i < old_num_buckets; i++) {
+		struct obs_scene_item *item = old_buckets[i];
+
+		while (item) {
+			struct obs_scene_item *next = item->id_hash_next;
+			link_item_index(scene, item);
+			item = next;
+		}
+	}
+
+	bfree(old_buckets);
+}
+
+/* must be called with full_lock held */
+static void index_sceneitem(struct obs_scene *scene,
+		struct obs_scene_item *item)
+{
+	if (!scene->num_buckets)
+		resize_item_index(scene, SCENE_INDEX_MIN_BUCKETS);
+	else if (scene->num_items >= scene->num_buckets)
+		resize_item_index(scene, scene->num_buckets * 2);
+
+	link_item_index(scene, item);
+
+	if (item->source->context.private)
+		scene->num_private_items++;
+	scene->num_items++;
+}
+
+/* must be called with full_lock held */
+static void unindex_sceneitem(struct obs_scene *scene,
+		struct obs_scene_item *item)
+{
+	struct obs_scene_item **next;
+
+	next = &scene->id_buckets[id_bucket(scene, item->id)];
+	while (*next != item)
+		next = &(*next)->id_hash_next;
+	*next = item->id_hash_next;
+
+	next = &scene->source_buckets[source_bucket(scene, item->source)];
+	while (*next != item)
+		next = &(*next)->source_hash_next;
+	*next = item->source_hash_next;
+
+	item->id_hash_next = NULL;
+	item->source_hash_next = NULL;
+
+	if (item->source->context.private)
+		scene->num_private_items--;
+	scene->num_items--;
+}
+
 static inline void remove_without_release(struct obs_scene_item *item)
 {
 	item->removed = true;
 	set_visibility(item, false);
 	signal_item_remove(item);
+	unindex_sceneitem(item->parent, item);
 	detach_sceneitem(item);
 }
 
@@ -157,6 +254,8 @@ static void scene_destroy(void *data)
 
 	remove_all_items(scene);
 
+	bfree(scene->id_buckets);
+	bfree(scene->source_buckets);
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
 	bfree(scene);
@@ -462,6 +561,17 @@ static void render_item_texture(struct obs_scene_item *item)
 		obs_source_draw(tex, 0, 0, 0, 0, 0);
 }
 
+static inline bool crop_equal(const struct obs_sceneitem_crop *crop1,
+		const struct obs_sceneitem_crop *crop2)
+{
+	return crop1->left   == crop2->left  &&
+	       crop1->right  == crop2->right &&
+	       crop1->top    == crop2->top   &&
+	       crop1->bottom == crop2->bottom;
+}
+
+static const char *scene_item_cache_hit_name = "scene_item_cache_hit";
+
 static inline void render_item(struct obs_scene_item *item)
 {
 	if (item->item_render) {
@@ -469,6 +579,23 @@ static inline void render_item(struct obs_scene_item *item)
 		uint32_t height = obs_source_get_height(item->source);
 		uint32_t cx = calc_cx(item, width);
 		uint32_t cy = calc_cy(item, height);
+		bool cache_hit = false;
+		uint64_t version = 0;
+		bool cacheable = obs_source_get_content_version(item->source,
+				&version);
+
+		/* the cache is only checked once per tick so that an item
+		 * drawn multiple times per frame is still only rendered once */
+		if (item->render_check_cache) {
+			item->render_check_cache = false;
+
+			if (!cacheable || version != item->render_version ||
+			    cx != item->render_cx || cy != item->render_cy ||
+			    !crop_equal(&item->crop, &item->render_crop))
+				gs_texrender_reset(item->item_render);
+			else
+				cache_hit = true;
+		}
 
 		if (cx && cy && gs_texrender_begin(item->item_render, cx, cy)) {
 			float cx_scale = (float)width  / (float)cx;
@@ -491,6 +618,18 @@ static inline void render_item(struct obs_scene_item *item)
 			obs_source_video_render(item->source);
 			gs_blend_state_pop();
 			gs_texrender_end(item->item_render);
+
+			item->render_cached = cacheable;
+			item->render_version = version;
+			item->render_cx = cx;
+			item->render_cy = cy;
+			item->render_crop = item->crop;
+			cache_hit = false;
+		}
+
+		if (cache_hit) {
+			profile_start(scene_item_cache_hit_name);
+			profile_end(scene_item_cache_hit_name);
 		}
 	}
 
@@ -512,8 +651,12 @@ static void scene_video_tick(void *data, float seconds)
 	video_lock(scene);
 	item = scene->first_item;
 	while (item) {
-		if (item->item_render)
-			gs_texrender_reset(item->item_render);
+		if (item->item_render) {
+			if (item->render_cached)
+				item->render_check_cache = true;
+			else
+				gs_texrender_reset(item->item_render);
+		}
 		item = item->next;
 	}
 	video_unlock(scene);
@@ -521,19 +664,161 @@ static void scene_video_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 }
 
+static inline uint64_t mix_content_floats(uint64_t hash, const float *vals,
+		size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		uint32_t bits;
+		memcpy(&bits, &vals[i], sizeof(bits));
+		hash = mix_content_version(hash, bits);
+	}
+
+	return hash;
+}
+
+bool obs_scene_get_content_version(obs_scene_t *scene, uint64_t *version)
+{
+	struct obs_scene_item *item;
+	uint64_t ver = 0;
+	bool cacheable = true;
+
+	video_lock(scene);
+	item = scene->first_item;
+
+	while (item) {
+		uint64_t item_ver;
+
+		if (!item->user_visible) {
+			item = item->next;
+			continue;
+		}
+
+		if (obs_source_removed(item->source) ||
+		    !obs_source_get_content_version(item->source, &item_ver)) {
+			cacheable = false;
+			break;
+		}
+
+		ver = mix_content_version(ver, (uint64_t)item->id);
+		ver = mix_content_version(ver, item_ver);
+		ver = mix_content_floats(ver, item->draw_transform.x.ptr, 4);
+		ver = mix_content_floats(ver, item->draw_transform.y.ptr, 4);
+		ver = mix_content_floats(ver, item->draw_transform.z.ptr, 4);
+		ver = mix_content_floats(ver, item->draw_transform.t.ptr, 4);
+		ver = mix_content_version(ver, item->crop.left);
+		ver = mix_content_version(ver, item->crop.top);
+		ver = mix_content_version(ver, item->crop.right);
+		ver = mix_content_version(ver, item->crop.bottom);
+		ver = mix_content_version(ver, item->scale_filter);
+		ver = mix_content_version(ver, item->item_render != NULL);
+
+		item = item->next;
+	}
+
+	video_unlock(scene);
+
+	*version = ver;
+	return cacheable;
+}
+
+/* gets the bounding box of the area an item draws to on the canvas */
+static void get_item_draw_bounds(const struct obs_scene_item *item,
+		struct vec2 *min, struct vec2 *max)
+{
+	uint32_t width  = obs_source_get_width(item->source);
+	uint32_t height = obs_source_get_height(item->source);
+	float cx = (float)calc_cx(item, width);
+	float cy = (float)calc_cy(item, height);
+	struct vec3 corners[4];
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], cx,   0.0f, 0.0f);
+	vec3_set(&corners[2], 0.0f, cy,   0.0f);
+	vec3_set(&corners[3], cx,   cy,   0.0f);
+
+	vec2_set(min, M_INFINITE, M_INFINITE);
+	vec2_set(max, -M_INFINITE, -M_INFINITE);
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 pos;
+		vec3_transform(&pos, &corners[i], &item->draw_transform);
+
+		min->x = fminf(min->x, pos.x);
+		min->y = fminf(min->y, pos.y);
+		max->x = fmaxf(max->x, pos.x);
+		max->y = fmaxf(max->y, pos.y);
+	}
+}
+
+static inline bool item_axis_aligned(const struct obs_scene_item *item)
+{
+	const struct matrix4 *m = &item->draw_transform;
+
+	return (close_float(m->x.y, 0.0f, EPSILON) &&
+	        close_float(m->y.x, 0.0f, EPSILON)) ||
+	       (close_float(m->x.x, 0.0f, EPSILON) &&
+	        close_float(m->y.y, 0.0f, EPSILON));
+}
+
+static inline bool item_off_canvas(const struct obs_scene_item *item,
+		float canvas_cx, float canvas_cy)
+{
+	struct vec2 min, max;
+	get_item_draw_bounds(item, &min, &max);
+
+	return max.x <= 0.0f || max.y <= 0.0f ||
+		min.x >= canvas_cx || min.y >= canvas_cy;
+}
+
+/* an item occludes everything below it if it's opaque and its drawn
+ * rectangle covers the whole canvas */
+static inline bool item_covers_canvas(const struct obs_scene_item *item,
+		float canvas_cx, float canvas_cy)
+{
+	struct vec2 min, max;
+
+	if (!item->user_visible || !item_axis_aligned(item) ||
+	    !obs_source_video_opaque(item->source))
+		return false;
+
+	get_item_draw_bounds(item, &min, &max);
+
+	return min.x <= 0.0f && min.y <= 0.0f &&
+		max.x >= canvas_cx && max.y >= canvas_cy;
+}
+
+static const char *scene_item_culled_name = "scene_item_culled";
+
+void obs_scene_video_skip_render(obs_scene_t *scene)
+{
+	struct obs_scene_item *item;
+
+	video_lock(scene);
+	item = scene->first_item;
+
+	while (item) {
+		if (item->user_visible)
+			obs_source_video_skip_render(item->source);
+		item = item->next;
+	}
+
+	video_unlock(scene);
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	DARRAY(struct obs_scene_item*) remove_items;
 	struct obs_scene *scene = data;
 	struct obs_scene_item *item;
+	struct obs_scene_item *occluder;
+	float canvas_cx = (float)obs_source_get_width(scene->source);
+	float canvas_cy = (float)obs_source_get_height(scene->source);
 
 	da_init(remove_items);
 
 	video_lock(scene);
 	item = scene->first_item;
-
-	gs_blend_state_push();
-	gs_reset_blend_state();
+	occluder = NULL;
 
 	while (item) {
 		if (obs_source_removed(item->source)) {
@@ -548,8 +833,33 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		if (source_size_changed(item))
 			update_item_transform(item);
 
-		if (item->user_visible)
-			render_item(item);
+		if (item_covers_canvas(item, canvas_cx, canvas_cy))
+			occluder = item;
+
+		item = item->next;
+	}
+
+	gs_blend_state_push();
+	gs_reset_blend_state();
+
+	/* items below the topmost item that covers the canvas, or entirely
+	 * outside of the canvas, can't contribute any pixels.  they still
+	 * need to consume their async frames so they don't fall behind */
+	item = scene->first_item;
+	while (item) {
+		if (item == occluder)
+			occluder = NULL;
+
+		if (item->user_visible) {
+			if (occluder ||
+			    item_off_canvas(item, canvas_cx, canvas_cy)) {
+				profile_start(scene_item_culled_name);
+				obs_source_video_skip_render(item->source);
+				profile_end(scene_item_culled_name);
+			} else {
+				render_item(item);
+			}
+		}
 
 		item = item->next;
 	}
@@ -614,8 +924,13 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
 	obs_data_set_default_int(item_data, "align",
 			OBS_ALIGN_TOP | OBS_ALIGN_LEFT);
 
-	if (obs_data_has_user_value(item_data, "id"))
+	if (obs_data_has_user_value(item_data, "id")) {
+		full_lock(scene);
+		unindex_sceneitem(scene, item);
 		item->id = obs_data_get_int(item_data, "id");
+		index_sceneitem(scene, item);
+		full_unlock(scene);
+	}
 
 	item->rot     = (float)obs_data_get_double(item_data, "rot");
 	item->align   = (uint32_t)obs_data_get_int(item_data, "align");
@@ -934,6 +1249,7 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 	item = scene->first_item;
 	while (item) {
 		uint64_t source_ts;
+		uint32_t child_mixes;
 		size_t pos, count;
 		bool apply_buf;
 
@@ -960,9 +1276,15 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 			continue;
 		}
 
+		child_mixes = mixers & item->source->audio_written_mixes;
+		if (!child_mixes) {
+			item = item->next;
+			continue;
+		}
+
 		obs_source_get_audio_mix(item->source, &child_audio);
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
+			if ((child_mixes & (1 << mix)) == 0)
 				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
@@ -1182,43 +1504,97 @@ obs_scene_t *obs_scene_from_source(const obs_source_t *source)
 	return source->context.data;
 }
 
+static struct obs_scene_item *find_item_by_name_slow(struct obs_scene *scene,
+		const char *name)
+{
+	struct obs_scene_item *item = scene->first_item;
+
+	while (item) {
+		if (strcmp(item->source->context.name, name) == 0)
+			break;
+
+		item = item->next;
+	}
+
+	return item;
+}
+
+#define MAX_NAME_CANDIDATES 4
+
 obs_sceneitem_t *obs_scene_find_source(obs_scene_t *scene, const char *name)
 {
+	obs_source_t *sources[MAX_NAME_CANDIDATES];
+	struct obs_scene_item *found = NULL;
 	struct obs_scene_item *item;
+	size_t num_found = 0;
+	long generation;
+	size_t count;
 
 	if (!scene)
 		return NULL;
 
+	/* candidate sources are found before locking the scene to avoid
+	 * locking the sources mutex within the scene mutexes.  they are
+	 * only compared by pointer, and matches are verified by name */
+	count = obs_find_sources_by_name(name, sources, MAX_NAME_CANDIDATES,
+			&generation);
+
 	full_lock(scene);
 
-	item = scene->first_item;
-	while (item) {
-		if (strcmp(item->source->context.name, name) == 0)
-			break;
+	/* if a source was created, renamed or removed since the candidates
+	 * were found, a source that now has the name may be missing from
+	 * them.  private sources aren't indexed by name, so scenes that
+	 * contain them fall back to checking every item as well */
+	if (os_atomic_load_long(&obs->data.source_index.generation) !=
+			generation ||
+	    count > MAX_NAME_CANDIDATES || scene->num_private_items ||
+	    !scene->num_buckets) {
+		found = find_item_by_name_slow(scene, name);
+		goto unlock;
+	}
 
-		item = item->next;
+	for (size_t i = 0; i < count; i++) {
+		item = scene->source_buckets[source_bucket(scene, sources[i])];
+
+		while (item) {
+			if (item->source == sources[i] &&
+			    strcmp(item->source->context.name, name) == 0) {
+				num_found++;
+				found = item;
+			}
+
+			item = item->source_hash_next;
+		}
 	}
 
+	/* the bottom-most matching item is returned, so if the name is
+	 * used by multiple items, get it by their order */
+	if (num_found > 1)
+		found = find_item_by_name_slow(scene, name);
+
+unlock:
 	full_unlock(scene);
 
-	return item;
+	return found;
 }
 
 obs_sceneitem_t *obs_scene_find_sceneitem_by_id(obs_scene_t *scene, int64_t id)
 {
-	struct obs_scene_item *item;
+	struct obs_scene_item *item = NULL;
 
 	if (!scene)
 		return NULL;
 
 	full_lock(scene);
 
-	item = scene->first_item;
-	while (item) {
-		if (item->id == id)
-			break;
+	if (scene->num_buckets) {
+		item = scene->id_buckets[id_bucket(scene, id)];
+		while (item) {
+			if (item->id == id)
+				break;
 
-		item = item->next;
+			item = item->id_hash_next;
+		}
 	}
 
 	full_unlock(scene);
@@ -1414,6 +1790,8 @@ obs_sceneitem_t *obs_scene_add(obs_scene_t *scene, obs_source_t *source)
 		item->prev = last;
 	}
 
+	index_sceneitem(scene, item);
+
 	full_unlock(scene);
 
 	if (!scene->source->context.private)
@@ -1486,6 +1864,7 @@ void obs_sceneitem_remove(obs_sceneitem_t *item)
 	set_visibility(item, false);
 
 	signal_item_remove(item);
+	unindex_sceneitem(scene, item);
 	detach_sceneitem(item);
 
 	full_unlock(scene);
@@ -1908,15 +2287,6 @@ void obs_scene_atomic_update(obs_scene_t *scene,
 	obs_scene_release(scene);
 }
 
-static inline bool crop_equal(const struct obs_sceneitem_crop *crop1,
-		const struct obs_sceneitem_crop *crop2)
-{
-	return crop1->left   == crop2->left  &&
-	       crop1->right  == crop2->right &&
-	       crop1->top    == crop2->top   &&
-	       crop1->bottom == crop2->bottom;
-}
-
 void obs_sceneitem_set_crop(obs_sceneitem_t *item,
 		const struct obs_sceneitem_crop *crop)
 {
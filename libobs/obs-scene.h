@@ -46,6 +46,15 @@ struct obs_scene_item {
 	gs_texrender_t        *item_render;
 	struct obs_sceneitem_crop crop;
 
+	/* state of the last item_render contents, used to skip rendering
+	 * static sources again when nothing has changed */
+	bool                  render_cached;
+	bool                  render_check_cache;
+	uint64_t              render_version;
+	uint32_t              render_cx;
+	uint32_t              render_cy;
+	struct obs_sceneitem_crop render_crop;
+
 	struct vec2           pos;
 	struct vec2           scale;
 	float                 rot;
@@ -76,6 +85,10 @@ struct obs_scene_item {
 	/* would do **prev_next, but not really great for reordering */
 	struct obs_scene_item *prev;
 	struct obs_scene_item *next;
+
+	/* hash chains of the scene's item indexes */
+	struct obs_scene_item *id_hash_next;
+	struct obs_scene_item *source_hash_next;
 };
 
 struct obs_scene {
@@ -86,4 +99,11 @@ struct obs_scene {
 	pthread_mutex_t       video_mutex;
 	pthread_mutex_t       audio_mutex;
 	struct obs_scene_item *first_item;
+
+	/* indexes of the items by id and by source, protected by full_lock */
+	struct obs_scene_item **id_buckets;
+	struct obs_scene_item **source_buckets;
+	size_t                num_buckets;
+	size_t                num_items;
+	size_t                num_private_items;
 };
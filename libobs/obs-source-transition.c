@@ -944,6 +944,8 @@ bool obs_transition_audio_render(obs_source_t *transition,
 			memcpy(audio->output[0].data[0],
 					state.s[0]->audio_output_buf[0][0],
 					TOTAL_AUDIO_SIZE);
+			transition->audio_written_mixes |=
+				state.s[0]->audio_written_mixes;
 		}
 
 		obs_source_release(state.s[0]);
@@ -20,6 +20,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-math.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "callback/calldata.h"
@@ -88,8 +89,13 @@ bool obs_source_init_context(struct obs_source *source,
 				settings, name, hotkey_data, private))
 		return false;
 
-	return signal_handler_add_array(source->context.signals,
-			source_signals);
+	if (!signal_handler_add_array(source->context.signals,
+				source_signals))
+		return false;
+
+	source->volume_signal = signal_handler_get_handle(
+			source->context.signals, "volume");
+	return true;
 }
 
 const char *obs_source_get_display_name(const char *id)
@@ -145,6 +151,7 @@ bool obs_source_init(struct obs_source *source)
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
+	pthread_mutex_init_value(&source->meter_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -158,6 +165,8 @@ bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->audio_cb_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->meter_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->audio_mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
@@ -194,7 +203,8 @@ bool obs_source_init(struct obs_source *source)
 
 	obs_context_data_insert(&source->context,
 			&obs->data.sources_mutex,
-			&obs->data.first_source);
+			&obs->data.first_source,
+			&obs->data.source_index);
 	return true;
 }
 
@@ -501,10 +511,57 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
-static inline void obs_source_frame_decref(struct obs_source_frame *frame)
+static struct async_external_frame *find_external_frame(
+		obs_source_t *source, struct obs_source_frame *frame)
 {
-	if (os_atomic_dec_long(&frame->refs) == 0)
+	for (size_t i = 0; i < source->async_external.num; i++) {
+		struct async_external_frame *ef =
+			&source->async_external.array[i];
+		if (ef->frame == frame)
+			return ef;
+	}
+
+	return NULL;
+}
+
+/* frames that wrap source-owned data are handed back to the source instead
+ * of being freed */
+static void destroy_async_frame(obs_source_t *source,
+		struct obs_source_frame *frame)
+{
+	struct async_external_frame *ef = find_external_frame(source, frame);
+
+	if (ef) {
+		ef->release(ef->param);
+		da_erase(source->async_external,
+				ef - source->async_external.array);
+		bfree(frame);
+	} else {
 		obs_source_frame_destroy(frame);
+	}
+}
+
+static inline void obs_source_frame_decref(obs_source_t *source,
+		struct obs_source_frame *frame)
+{
+	if (os_atomic_dec_long(&frame->refs) == 0)
+		destroy_async_frame(source, frame);
+}
+
+/* drops the reference libobs itself holds on external frames, frames that
+ * are still being used (for example by the graphics thread) are returned to
+ * the source once they're released */
+static void release_external_frames(obs_source_t *source)
+{
+	for (size_t i = source->async_external.num; i > 0; i--) {
+		struct async_external_frame *ef =
+			&source->async_external.array[i - 1];
+
+		if (ef->queued) {
+			ef->queued = false;
+			obs_source_frame_decref(source, ef->frame);
+		}
+	}
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -555,7 +612,9 @@ void obs_source_destroy(struct obs_source *source)
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
 	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+		obs_source_frame_decref(source,
+				source->async_cache.array[i].frame);
+	release_external_frames(source);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
@@ -584,13 +643,16 @@ void obs_source_destroy(struct obs_source *source)
 
 	da_free(source->audio_actions);
 	da_free(source->audio_cb_list);
+	da_free(source->meter_cb_list);
 	da_free(source->async_cache);
+	da_free(source->async_external);
 	da_free(source->async_frames);
 	da_free(source->filters);
 	pthread_mutex_destroy(&source->filter_mutex);
 	pthread_mutex_destroy(&source->audio_actions_mutex);
 	pthread_mutex_destroy(&source->audio_buf_mutex);
 	pthread_mutex_destroy(&source->audio_cb_mutex);
+	pthread_mutex_destroy(&source->meter_mutex);
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
 	obs_data_release(source->private_settings);
@@ -790,6 +852,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 		source->info.update(source->context.data,
 				source->context.settings);
 
+	os_atomic_inc_long(&source->content_version);
 	source->defer_update = false;
 }
 
@@ -806,9 +869,66 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				source->context.settings);
+		os_atomic_inc_long(&source->content_version);
 	}
 }
 
+void obs_source_content_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_content_changed"))
+		return;
+
+	os_atomic_inc_long(&source->content_version);
+}
+
+bool obs_source_get_content_version(obs_source_t *source, uint64_t *version)
+{
+	uint32_t flags = source->info.output_flags;
+	bool cacheable = true;
+	uint64_t ver;
+
+	if (!source->context.data || !source->enabled)
+		return false;
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE) {
+		if (!obs_scene_get_content_version(source->context.data, &ver))
+			return false;
+
+	} else {
+		if ((flags & OBS_SOURCE_ASYNC) != 0 ||
+		    (flags & OBS_SOURCE_STATIC_VIDEO) == 0 ||
+		    source->defer_update)
+			return false;
+
+		ver = (uint64_t)os_atomic_load_long(&source->content_version);
+	}
+
+	ver = mix_content_version(ver, obs_source_get_width(source));
+	ver = mix_content_version(ver, obs_source_get_height(source));
+
+	pthread_mutex_lock(&source->filter_mutex);
+
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		uint64_t filter_ver;
+
+		if (!filter->enabled)
+			continue;
+
+		if (!obs_source_get_content_version(filter, &filter_ver)) {
+			cacheable = false;
+			break;
+		}
+
+		ver = mix_content_version(ver, filter_ver);
+	}
+
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	*version = ver;
+	return cacheable;
+}
+
 void obs_source_update_properties(obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_update_properties"))
@@ -1131,6 +1251,8 @@ static void source_signal_audio_data(obs_source_t *source,
 	}
 
 	pthread_mutex_unlock(&source->audio_cb_mutex);
+
+	obs_source_update_meters(source, in, muted);
 }
 
 static inline uint64_t uint64_diff(uint64_t ts1, uint64_t ts2)
@@ -1772,6 +1894,20 @@ static inline void obs_source_main_render(obs_source_t *source)
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time);
 
+static inline bool is_async_video_input(const obs_source_t *source)
+{
+	return source->info.type == OBS_SOURCE_TYPE_INPUT &&
+		(source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) ==
+		OBS_SOURCE_ASYNC_VIDEO;
+}
+
+static inline void update_async_video(obs_source_t *source)
+{
+	if (deinterlacing_enabled(source))
+		deinterlace_update_async_video(source);
+	obs_source_update_async_video(source);
+}
+
 static inline void render_video(obs_source_t *source)
 {
 	if (source->info.type != OBS_SOURCE_TYPE_FILTER &&
@@ -1781,13 +1917,8 @@ static inline void render_video(obs_source_t *source)
 		return;
 	}
 
-	if (source->info.type == OBS_SOURCE_TYPE_INPUT &&
-	    (source->info.output_flags & OBS_SOURCE_ASYNC) != 0 &&
-	    !source->rendering_filter) {
-		if (deinterlacing_enabled(source))
-			deinterlace_update_async_video(source);
-		obs_source_update_async_video(source);
-	}
+	if (is_async_video_input(source) && !source->rendering_filter)
+		update_async_video(source);
 
 	if (!source->context.data || !source->enabled) {
 		if (source->filter_parent)
@@ -1821,6 +1952,68 @@ void obs_source_video_render(obs_source_t *source)
 	obs_source_release(source);
 }
 
+void obs_source_video_skip_render(obs_source_t *source)
+{
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE) {
+		obs_scene_video_skip_render(source->context.data);
+
+	} else if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
+		pthread_mutex_lock(&source->transition_mutex);
+		for (size_t i = 0; i < 2; i++) {
+			obs_source_t *child = source->transition_sources[i];
+			if (child)
+				obs_source_video_skip_render(child);
+		}
+		pthread_mutex_unlock(&source->transition_mutex);
+
+	} else if (is_async_video_input(source)) {
+		update_async_video(source);
+	}
+}
+
+static inline bool async_format_opaque(enum video_format format)
+{
+	return format_is_yuv(format) || format == VIDEO_FORMAT_BGRX ||
+		format == VIDEO_FORMAT_Y800;
+}
+
+bool obs_source_video_opaque(obs_source_t *source)
+{
+	bool opaque;
+
+	if (!source->context.data || !source->enabled)
+		return false;
+
+	if (is_async_video_input(source))
+		opaque = source->async_active && source->async_texture &&
+			async_format_opaque(source->async_format);
+	else
+		opaque = os_atomic_load_bool(&source->video_opaque);
+
+	if (!opaque)
+		return false;
+
+	/* filters can change the size or transparency of the output */
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		if (source->filters.array[i]->enabled) {
+			opaque = false;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return opaque;
+}
+
+void obs_source_set_video_opaque(obs_source_t *source, bool opaque)
+{
+	if (!obs_source_valid(source, "obs_source_set_video_opaque"))
+		return;
+
+	os_atomic_set_bool(&source->video_opaque, opaque);
+}
+
 static uint32_t get_base_width(const obs_source_t *source)
 {
 	bool is_filter = !!source->filter_parent;
@@ -2299,7 +2492,9 @@ static inline bool async_texture_changed(struct obs_source *source,
 static inline void free_async_cache(struct obs_source *source)
 {
 	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+		obs_source_frame_decref(source,
+				source->async_cache.array[i].frame);
+	release_external_frames(source);
 
 	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
@@ -2414,6 +2609,89 @@ void obs_source_output_video(obs_source_t *source,
 	}
 }
 
+/* returns any queued frames that wrap source-owned data, so the source can
+ * safely free that data after deactivating its output */
+static void flush_external_frames(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->async_mutex);
+
+	for (size_t i = source->async_frames.num; i > 0; i--) {
+		if (find_external_frame(source,
+					source->async_frames.array[i - 1]))
+			da_erase(source->async_frames, i - 1);
+	}
+
+	if (source->cur_async_frame &&
+	    find_external_frame(source, source->cur_async_frame))
+		source->cur_async_frame = NULL;
+	if (source->prev_async_frame &&
+	    find_external_frame(source, source->prev_async_frame))
+		source->prev_async_frame = NULL;
+
+	release_external_frames(source);
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+void obs_source_output_video_nocopy(obs_source_t *source,
+		const struct obs_source_frame *frame,
+		obs_source_frame_release_t release, void *param)
+{
+	struct async_external_frame ef;
+
+	if (!obs_source_valid(source, "obs_source_output_video_nocopy")) {
+		if (frame && release)
+			release(param);
+		return;
+	}
+
+	if (!frame) {
+		flush_external_frames(source);
+		source->async_active = false;
+		return;
+	}
+
+	/* Y800 is converted to BGRX while copying */
+	if (!release || frame->format == VIDEO_FORMAT_Y800) {
+		obs_source_output_video(source, frame);
+		if (release)
+			release(param);
+		return;
+	}
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		free_async_cache(source);
+		source->last_frame_ts = 0;
+		pthread_mutex_unlock(&source->async_mutex);
+		release(param);
+		return;
+	}
+
+	if (async_texture_changed(source, frame)) {
+		free_async_cache(source);
+		source->async_cache_width  = frame->width;
+		source->async_cache_height = frame->height;
+		source->async_cache_format = frame->format;
+	}
+
+	ef.frame = bmalloc(sizeof(*ef.frame));
+	ef.release = release;
+	ef.param = param;
+	ef.queued = true;
+
+	*ef.frame = *frame;
+	ef.frame->refs = 1;
+	ef.frame->prev_frame = false;
+
+	da_push_back(source->async_external, &ef);
+	da_push_back(source->async_frames, &ef.frame);
+
+	pthread_mutex_unlock(&source->async_mutex);
+	source->async_active = true;
+}
+
 static inline bool preload_frame_changed(obs_source_t *source,
 		const struct obs_source_frame *in)
 {
@@ -2551,25 +2829,12 @@ static void copy_audio_data(obs_source_t *source,
 		source->audio_storage_size = size;
 }
 
-/* TODO: SSE optimization */
 static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
 {
 	size_t channels = audio_output_get_channels(obs->audio.audio);
-	const float channels_i = 1.0f / (float)channels;
 	float **data = (float**)source->audio_data.data;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
-
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
-
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
-	}
+	audio_downmix_to_mono_planar(data, channels, frames);
 }
 
 /* resamples/remixes new audio to the designated main audio output format */
@@ -2643,6 +2908,8 @@ void obs_source_output_audio(obs_source_t *source,
 
 void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 {
+	struct async_external_frame *ef;
+
 	if (frame)
 		frame->prev_frame = false;
 
@@ -2651,9 +2918,16 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 
 		if (f->frame == frame) {
 			f->used = false;
-			break;
+			return;
 		}
 	}
+
+	/* external frames can't be reused, so return them to the source */
+	ef = frame ? find_external_frame(source, frame) : NULL;
+	if (ef && ef->queued) {
+		ef->queued = false;
+		obs_source_frame_decref(source, frame);
+	}
 }
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
@@ -2805,7 +3079,7 @@ void obs_source_release_frame(obs_source_t *source,
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			destroy_async_frame(source, frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -3074,18 +3348,20 @@ void obs_source_set_volume(obs_source_t *source, float volume)
 		};
 
 		struct calldata data;
-		uint8_t stack[128];
+		double new_volume = volume;
 
-		calldata_init_fixed(&data, stack, sizeof(stack));
-		calldata_set_ptr(&data, "source", source);
-		calldata_set_float(&data, "volume", volume);
+		/* "volume" and "source_volume" have the same parameters */
+		signal_handle_init_calldata(source->volume_signal, &data);
+		calldata_set_indexed_ptr(&data, 0, source);
+		calldata_set_indexed_float(&data, 1, volume);
 
-		signal_handler_signal(source->context.signals, "volume", &data);
+		signal_handle_emit(source->volume_signal, &data);
 		if (!source->context.private)
-			signal_handler_signal(obs->signals, "source_volume",
-					&data);
+			signal_handle_emit(obs->source_volume_signal, &data);
 
-		volume = (float)calldata_float(&data, "volume");
+		calldata_get_indexed_float(&data, 1, &new_volume);
+		calldata_free(&data);
+		volume = (float)new_volume;
 
 		pthread_mutex_lock(&source->audio_actions_mutex);
 		da_push_back(source->audio_actions, &action);
@@ -3769,24 +4045,36 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 		size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	audio_mul_floats(source->audio_output_buf[mix][0], vol,
+			AUDIO_OUTPUT_FRAMES * channels);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 		size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_mul_floats_varying(source->audio_output_buf[mix][ch],
+				vol_data, AUDIO_OUTPUT_FRAMES);
+}
+
+#define ALL_AUDIO_MIXES ((1 << MAX_AUDIO_MIXES) - 1)
+
+/* only clears the mixes that have actually been written to since they were
+ * last cleared, mixes that are never rendered stay zeroed without touching
+ * them every tick */
+static inline void clear_audio_output_mixes(obs_source_t *source,
+		uint32_t mixes, size_t channels)
+{
+	uint32_t dirty = source->audio_written_mixes & mixes;
 
-		while (out < end)
-			*(out++) *= *(vol++);
+	for (size_t mix = 0; dirty != 0 && mix < MAX_AUDIO_MIXES; mix++) {
+		if ((dirty & (1 << mix)) != 0)
+			memset(source->audio_output_buf[mix][0], 0,
+					sizeof(float) * AUDIO_OUTPUT_FRAMES *
+					channels);
 	}
+
+	source->audio_written_mixes &= ~mixes;
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -3804,8 +4092,8 @@ static inline void apply_audio_action(obs_source_t *source,
 	}
 }
 
-static void apply_audio_actions(obs_source_t *source, size_t channels,
-		size_t sample_rate)
+static void apply_audio_actions(obs_source_t *source, uint32_t mixers,
+		size_t channels, size_t sample_rate)
 {
 	float *vol_data = malloc(sizeof(float) * AUDIO_OUTPUT_FRAMES);
 	float cur_vol = get_source_volume(source, source->audio_ts);
@@ -3845,7 +4133,7 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((source->audio_mixers & mixers & (1 << mix)) != 0)
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 
@@ -3872,7 +4160,8 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 				AUDIO_OUTPUT_FRAMES);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
-			apply_audio_actions(source, channels, sample_rate);
+			apply_audio_actions(source, mixers, channels,
+					sample_rate);
 			return;
 		}
 	}
@@ -3882,9 +4171,7 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 		return;
 
 	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-				AUDIO_OUTPUT_FRAMES * sizeof(float) *
-				MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+		clear_audio_output_mixes(source, ALL_AUDIO_MIXES, channels);
 		return;
 	}
 
@@ -3900,6 +4187,7 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 		size_t channels, size_t sample_rate)
 {
 	struct obs_source_audio_mix audio_data;
+	uint32_t render_mixes = source->audio_mixers & mixers;
 	bool success;
 	uint64_t ts;
 
@@ -3908,42 +4196,51 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 			audio_data.output[mix].data[ch] =
 				source->audio_output_buf[mix][ch];
 		}
-
-		if ((source->audio_mixers & mixers & (1 << mix)) != 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-					sizeof(float) * AUDIO_OUTPUT_FRAMES *
-					channels);
-		}
 	}
 
+	clear_audio_output_mixes(source, render_mixes, channels);
+
 	success = source->info.audio_render(source->context.data, &ts,
 			&audio_data, mixers, channels, sample_rate);
 	source->audio_ts = success ? ts : 0;
 	source->audio_pending = !success;
 
+	/* the source is free to mix into any of the requested mixes */
+	source->audio_written_mixes |= mixers;
+
 	if (!success || !source->audio_ts || !mixers)
 		return;
 
-	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_bit = 1 << mix;
+	clear_audio_output_mixes(source, ALL_AUDIO_MIXES & ~render_mixes,
+			channels);
+	apply_audio_volume(source, mixers, channels, sample_rate);
+}
 
-		if ((mixers & mix_bit) == 0)
-			continue;
+static bool audio_source_silent(obs_source_t *source, size_t sample_rate)
+{
+	uint64_t duration = conv_frames_to_time(sample_rate,
+			AUDIO_OUTPUT_FRAMES);
+	bool actions_pending;
 
-		if ((source->audio_mixers & mix_bit) == 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-					sizeof(float) * AUDIO_OUTPUT_FRAMES *
-					channels);
-		}
-	}
+	pthread_mutex_lock(&source->audio_actions_mutex);
+	actions_pending = source->audio_actions.num > 0 &&
+		source->audio_actions.array[0].timestamp <
+		(source->audio_ts + duration);
+	pthread_mutex_unlock(&source->audio_actions_mutex);
 
-	apply_audio_volume(source, mixers, channels, sample_rate);
+	return !actions_pending &&
+		get_source_volume(source, source->audio_ts) == 0.0f;
 }
 
 static inline void process_audio_source_tick(obs_source_t *source,
 		uint32_t mixers, size_t channels, size_t sample_rate,
 		size_t size)
 {
+	uint32_t render_mixes = source->audio_mixers & mixers;
+
+	if (render_mixes && audio_source_silent(source, sample_rate))
+		render_mixes = 0;
+
 	pthread_mutex_lock(&source->audio_buf_mutex);
 
 	if (source->audio_input_buf[0].size < size) {
@@ -3952,6 +4249,16 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		return;
 	}
 
+	/* nothing would be audible in any mix, so skip copying and volume
+	 * processing entirely and just make sure the output stays zeroed */
+	if (!render_mixes) {
+		pthread_mutex_unlock(&source->audio_buf_mutex);
+
+		clear_audio_output_mixes(source, ALL_AUDIO_MIXES, channels);
+		source->audio_pending = false;
+		return;
+	}
+
 	for (size_t ch = 0; ch < channels; ch++)
 		circlebuf_peek_front(&source->audio_input_buf[ch],
 				source->audio_output_buf[0][ch],
@@ -3960,23 +4267,17 @@ static inline void process_audio_source_tick(obs_source_t *source,
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
 	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_and_val = (1 << mix);
-
-		if ((source->audio_mixers & mix_and_val) == 0 ||
-		    (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0],
-					0, size * channels);
+		if ((render_mixes & (1 << mix)) == 0)
 			continue;
-		}
 
 		for (size_t ch = 0; ch < channels; ch++)
 			memcpy(source->audio_output_buf[mix][ch],
 					source->audio_output_buf[0][ch], size);
 	}
 
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0,
-				size * channels);
+	source->audio_written_mixes |= render_mixes | 1;
+	clear_audio_output_mixes(source, ALL_AUDIO_MIXES & ~render_mixes,
+			channels);
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
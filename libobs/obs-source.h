@@ -135,6 +135,15 @@ enum obs_source_type {
  */
 #define OBS_SOURCE_CAP_DISABLED (1<<10)
 
+/**
+ * Source video only changes when its settings are updated or when it calls
+ * obs_source_content_changed.
+ *
+ * This allows scenes to keep cached renders of the source (for example when
+ * it's cropped) instead of rendering it again every frame.
+ */
+#define OBS_SOURCE_STATIC_VIDEO (1<<11)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -67,6 +67,170 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	return cur_time;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Scene render cache
+ *
+ *   Multiview, projectors and the preview often show the same scenes.  With
+ * obs_source_video_render_cached, each source is rendered once per pass over
+ * the displays into a texture at its own size, and every display draws that
+ * texture.  If the content version of the source didn't change since, the
+ * texture from an earlier pass is used without rendering at all. */
+
+/* passes a cached render is kept for after it was last drawn */
+#define SCENE_RENDER_CACHE_EXPIRE 60
+
+static inline void free_scene_render(struct scene_render_cache_entry *entry)
+{
+	gs_texrender_destroy(entry->texrender);
+	obs_weak_source_release(entry->source);
+}
+
+void obs_free_scene_render_cache(struct obs_core_video *video)
+{
+	for (size_t i = 0; i < video->scene_render_cache.num; i++)
+		free_scene_render(video->scene_render_cache.array + i);
+	da_free(video->scene_render_cache);
+}
+
+void obs_scene_render_cache_begin(struct obs_core_video *video)
+{
+	video->display_pass++;
+	video->scene_renders = 0;
+	video->scene_renders_saved = 0;
+}
+
+void obs_scene_render_cache_end(struct obs_core_video *video)
+{
+	video->last_scene_renders = video->scene_renders;
+	video->last_scene_renders_saved = video->scene_renders_saved;
+
+	for (size_t i = video->scene_render_cache.num; i > 0; i--) {
+		struct scene_render_cache_entry *entry =
+			video->scene_render_cache.array + (i - 1);
+
+		if (obs_weak_ref_expired(&entry->source->ref) ||
+		    video->display_pass - entry->used_pass >
+				SCENE_RENDER_CACHE_EXPIRE) {
+			free_scene_render(entry);
+			da_erase(video->scene_render_cache, i - 1);
+		}
+	}
+}
+
+static struct scene_render_cache_entry *get_scene_render(
+		struct obs_core_video *video, obs_source_t *source)
+{
+	struct scene_render_cache_entry *entry;
+	gs_texrender_t *texrender;
+
+	for (size_t i = 0; i < video->scene_render_cache.num; i++) {
+		entry = video->scene_render_cache.array + i;
+
+		/* the caller holds a reference, so an expired entry for the
+		 * same address belongs to an older source */
+		if (entry->source->source == source &&
+		    !obs_weak_ref_expired(&entry->source->ref))
+			return entry;
+	}
+
+	texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	if (!texrender)
+		return NULL;
+
+	entry = da_push_back_new(video->scene_render_cache);
+	entry->source    = obs_source_get_weak_source(source);
+	entry->texrender = texrender;
+	return entry;
+}
+
+static inline bool scene_render_current(
+		const struct scene_render_cache_entry *entry,
+		bool cacheable, uint64_t version, uint32_t cx, uint32_t cy)
+{
+	gs_texture_t *tex;
+
+	if (!entry->rendered_pass || !entry->cacheable || !cacheable ||
+	    entry->version != version)
+		return false;
+
+	tex = gs_texrender_get_texture(entry->texrender);
+	return tex && gs_texture_get_width(tex) == cx &&
+		gs_texture_get_height(tex) == cy;
+}
+
+static const char *render_scene_cached_name = "obs_source_video_render_cached";
+void obs_source_video_render_cached(obs_source_t *source)
+{
+	struct obs_core_video *video = &obs->video;
+	struct scene_render_cache_entry *entry;
+	gs_texture_t *tex;
+	gs_effect_t *effect;
+	uint32_t cx, cy;
+
+	if (!obs_source_valid(source, "obs_source_video_render_cached"))
+		return;
+
+	cx = obs_source_get_width(source);
+	cy = obs_source_get_height(source);
+	if (!cx || !cy)
+		return;
+
+	entry = get_scene_render(video, source);
+	if (!entry) {
+		obs_source_video_render(source);
+		return;
+	}
+
+	entry->used_pass = video->display_pass;
+
+	if (entry->rendered_pass == video->display_pass) {
+		video->scene_renders_saved++;
+
+	} else {
+		uint64_t version = 0;
+		bool cacheable = obs_source_get_content_version(source,
+				&version);
+
+		if (scene_render_current(entry, cacheable, version, cx, cy)) {
+			video->scene_renders_saved++;
+
+		} else {
+			profile_start(render_scene_cached_name);
+
+			gs_texrender_reset(entry->texrender);
+			if (gs_texrender_begin(entry->texrender, cx, cy)) {
+				struct vec4 clear_color;
+
+				vec4_zero(&clear_color);
+				gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+				gs_ortho(0.0f, (float)cx, 0.0f, (float)cy,
+						-100.0f, 100.0f);
+
+				obs_source_video_render(source);
+				gs_texrender_end(entry->texrender);
+			}
+
+			entry->cacheable = cacheable;
+			entry->version = version;
+			video->scene_renders++;
+
+			profile_end(render_scene_cached_name);
+		}
+
+		entry->rendered_pass = video->display_pass;
+	}
+
+	tex = gs_texrender_get_texture(entry->texrender);
+	if (!tex)
+		return;
+
+	effect = obs->video.default_effect;
+	while (gs_effect_loop(effect, "Draw"))
+		obs_source_draw(tex, 0, 0, 0, 0, false);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* in obs-display.c */
 extern void render_display(struct obs_display *display);
 
@@ -79,6 +243,8 @@ static inline void render_displays(void)
 
 	gs_enter_context(obs->video.graphics);
 
+	obs_scene_render_cache_begin(&obs->video);
+
 	/* render extra displays/swaps */
 	pthread_mutex_lock(&obs->data.displays_mutex);
 
@@ -90,6 +256,8 @@ static inline void render_displays(void)
 
 	pthread_mutex_unlock(&obs->data.displays_mutex);
 
+	obs_scene_render_cache_end(&obs->video);
+
 	gs_leave_context();
 }
 
@@ -455,24 +623,25 @@ static void set_gpu_converted_data(struct obs_core_video *video,
 
 static void convert_frame(
 		struct video_frame *output, const struct video_data *input,
-		const struct video_output_info *info)
+		const struct video_output_info *info,
+		uint32_t start_y, uint32_t end_y)
 {
 	if (info->format == VIDEO_FORMAT_I420) {
 		compress_uyvx_to_i420(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_NV12) {
 		compress_uyvx_to_nv12(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_I444) {
 		convert_uyvx_to_i444(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else {
@@ -482,16 +651,18 @@ static void convert_frame(
 
 static inline void copy_rgbx_frame(
 		struct video_frame *output, const struct video_data *input,
-		const struct video_output_info *info)
+		const struct video_output_info *info,
+		uint32_t start_y, uint32_t end_y)
 {
-	uint8_t *in_ptr = input->data[0];
-	uint8_t *out_ptr = output->data[0];
+	uint8_t *in_ptr = input->data[0] + start_y * input->linesize[0];
+	uint8_t *out_ptr = output->data[0] + start_y * output->linesize[0];
 
 	/* if the line sizes match, do a single copy */
 	if (input->linesize[0] == output->linesize[0]) {
-		memcpy(out_ptr, in_ptr, input->linesize[0] * info->height);
+		memcpy(out_ptr, in_ptr,
+				input->linesize[0] * (end_y - start_y));
 	} else {
-		for (size_t y = 0; y < info->height; y++) {
+		for (uint32_t y = start_y; y < end_y; y++) {
 			memcpy(out_ptr, in_ptr, info->width * 4);
 			in_ptr += input->linesize[0];
 			out_ptr += output->linesize[0];
@@ -499,6 +670,179 @@ static inline void copy_rgbx_frame(
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* CPU conversion worker pool */
+
+struct video_convert_worker {
+	struct video_convert_pool       *pool;
+	pthread_t                       thread;
+	os_sem_t                        *start_sem;
+	size_t                          band;
+	const char                      *profile_name;
+	bool                            thread_created;
+};
+
+struct video_convert_pool {
+	struct video_convert_worker     *workers;
+	size_t                          num_workers;
+	os_sem_t                        *done_sem;
+	uint64_t                        frame_time;
+	volatile bool                   stop;
+
+	/* current job, only valid between start/done */
+	struct video_frame              *output;
+	const struct video_data         *input;
+	const struct video_output_info  *info;
+	uint32_t                        band_height;
+};
+
+static void convert_band(struct video_convert_pool *pool, size_t band)
+{
+	const struct video_output_info *info = pool->info;
+	uint32_t start_y = (uint32_t)band * pool->band_height;
+	uint32_t end_y   = start_y + pool->band_height;
+
+	if (end_y > info->height)
+		end_y = info->height;
+	if (start_y >= end_y)
+		return;
+
+	if (format_is_yuv(info->format))
+		convert_frame(pool->output, pool->input, info, start_y, end_y);
+	else
+		copy_rgbx_frame(pool->output, pool->input, info,
+				start_y, end_y);
+}
+
+static void *convert_worker_thread(void *param)
+{
+	struct video_convert_worker *worker = param;
+	struct video_convert_pool *pool = worker->pool;
+
+	os_set_thread_name("libobs: video conversion worker");
+	profile_register_root(worker->profile_name, pool->frame_time);
+
+	for (;;) {
+		os_sem_wait(worker->start_sem);
+		if (pool->stop)
+			break;
+
+		profile_start(worker->profile_name);
+		convert_band(pool, worker->band);
+		profile_end(worker->profile_name);
+
+		profile_reenable_thread();
+		os_sem_post(pool->done_sem);
+	}
+
+	return NULL;
+}
+
+static void convert_pool_destroy(struct video_convert_pool *pool)
+{
+	if (!pool)
+		return;
+
+	pool->stop = true;
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct video_convert_worker *worker = &pool->workers[i];
+		if (worker->thread_created) {
+			os_sem_post(worker->start_sem);
+			pthread_join(worker->thread, NULL);
+		}
+		os_sem_destroy(worker->start_sem);
+	}
+
+	os_sem_destroy(pool->done_sem);
+	bfree(pool->workers);
+	bfree(pool);
+}
+
+static struct video_convert_pool *convert_pool_create(size_t num_workers)
+{
+	struct video_convert_pool *pool = bzalloc(sizeof(*pool));
+	pool->workers = bzalloc(sizeof(*pool->workers) * num_workers);
+	pool->num_workers = num_workers;
+	pool->frame_time = video_output_get_frame_time(obs->video.video);
+
+	if (os_sem_init(&pool->done_sem, 0) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < num_workers; i++) {
+		struct video_convert_worker *worker = &pool->workers[i];
+
+		worker->pool = pool;
+		worker->band = i;
+		worker->profile_name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"video_convert_worker(%d)", (int)i);
+
+		if (os_sem_init(&worker->start_sem, 0) != 0)
+			goto fail;
+		if (pthread_create(&worker->thread, NULL,
+					convert_worker_thread, worker) != 0)
+			goto fail;
+
+		worker->thread_created = true;
+	}
+
+	blog(LOG_INFO, "Started %d video conversion worker(s)",
+			(int)num_workers);
+	return pool;
+
+fail:
+	blog(LOG_WARNING, "Failed to create video conversion workers");
+	convert_pool_destroy(pool);
+	return NULL;
+}
+
+static void update_convert_pool(struct obs_core_video *video)
+{
+	size_t workers = (size_t)os_atomic_load_long(&video->convert_workers);
+	size_t cur = video->convert_pool ? video->convert_pool->num_workers : 0;
+
+	if (workers == cur)
+		return;
+
+	convert_pool_destroy(video->convert_pool);
+	video->convert_pool = workers ? convert_pool_create(workers) : NULL;
+}
+
+static const char *convert_band_name = "convert_band";
+static void convert_frame_parallel(struct video_convert_pool *pool,
+		struct video_frame *output, const struct video_data *input,
+		const struct video_output_info *info)
+{
+	size_t bands = pool->num_workers + 1;
+	uint32_t band_height = (info->height + (uint32_t)bands - 1) /
+		(uint32_t)bands;
+
+	/* keep bands on even lines so 4:2:0 chroma rows aren't split */
+	pool->band_height = (band_height + 1) & ~1;
+	pool->output      = output;
+	pool->input       = input;
+	pool->info        = info;
+
+	for (size_t i = 0; i < pool->num_workers; i++)
+		os_sem_post(pool->workers[i].start_sem);
+
+	profile_start(convert_band_name);
+	convert_band(pool, pool->num_workers);
+	profile_end(convert_band_name);
+
+	for (size_t i = 0; i < pool->num_workers; i++)
+		os_sem_wait(pool->done_sem);
+}
+
+static void free_convert_pool(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	convert_pool_destroy(video->convert_pool);
+	video->convert_pool = NULL;
+}
+
 static inline void output_video_data(struct obs_core_video *video,
 		struct video_data *input_frame, int count)
 {
@@ -515,10 +859,19 @@ static inline void output_video_data(struct obs_core_video *video,
 			set_gpu_converted_data(video, &output_frame,
 					input_frame, info);
 
-		} else if (format_is_yuv(info->format)) {
-			convert_frame(&output_frame, input_frame, info);
 		} else {
-			copy_rgbx_frame(&output_frame, input_frame, info);
+			update_convert_pool(video);
+
+			if (video->convert_pool)
+				convert_frame_parallel(video->convert_pool,
+						&output_frame, input_frame,
+						info);
+			else if (format_is_yuv(info->format))
+				convert_frame(&output_frame, input_frame,
+						info, 0, info->height);
+			else
+				copy_rgbx_frame(&output_frame, input_frame,
+						info, 0, info->height);
 		}
 
 		video_output_unlock_frame(video->video);
@@ -685,6 +1038,8 @@ void *obs_graphics_thread(void *param)
 		}
 	}
 
+	free_convert_pool();
+
 	UNUSED_PARAMETER(param);
 	return NULL;
 }
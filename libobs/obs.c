@@ -19,6 +19,8 @@
 
 #include "graphics/matrix4.h"
 #include "callback/calldata.h"
+#include "media-io/format-conversion.h"
+#include "media-io/audio-math.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -375,6 +377,11 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 	}
 
+	video_output_set_threaded_inputs(video->video,
+			video->threaded_delivery);
+	video_output_set_cascaded_scaling(video->video,
+			video->cascaded_scaling);
+
 	gs_enter_context(video->graphics);
 
 	if (ovi->gpu_conversion && !obs_init_gpu_conversion(ovi))
@@ -439,6 +446,8 @@ static void obs_free_video(void)
 			video->output_textures[i]  = NULL;
 		}
 
+		obs_free_scene_render_cache(video);
+
 		gs_leave_context();
 
 		circlebuf_free(&video->vframe_info_buffer);
@@ -484,6 +493,60 @@ static void obs_free_graphics(void)
 	}
 }
 
+/* called from the monitors' own playback callbacks.  the first monitor to
+ * get here drives the clock until it's released, and only publishes the
+ * offset of its device clock from the system clock, so the audio thread can
+ * read it without locking the monitors or their devices. */
+void audio_monitor_publish_clock(struct audio_monitor *monitor,
+		uint64_t device_ts)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	void *owner = os_atomic_load_ptr((void*volatile*)&audio->clock_monitor);
+
+	if (owner != monitor) {
+		if (owner || !os_atomic_compare_swap_ptr(
+					(void*volatile*)&audio->clock_monitor,
+					NULL, monitor))
+			return;
+	}
+
+	os_atomic_set_int64(&audio->clock_monitor_offset,
+			(int64_t)(device_ts - os_gettime_ns()));
+	os_atomic_set_bool(&audio->clock_monitor_valid, true);
+}
+
+/* called once a monitor's device has stopped calling back, otherwise it could
+ * claim the clock again.  another monitor takes over the next time it plays */
+void audio_monitor_release_clock(struct audio_monitor *monitor)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	if (os_atomic_compare_swap_ptr((void*volatile*)&audio->clock_monitor,
+				monitor, NULL))
+		os_atomic_set_bool(&audio->clock_monitor_valid, false);
+}
+
+static bool monitoring_clock(void *param, uint64_t *ts)
+{
+	struct obs_core_audio *audio = param;
+
+	if (!os_atomic_load_bool(&audio->clock_monitor_valid))
+		return false;
+
+	*ts = os_gettime_ns() +
+		os_atomic_load_int64(&audio->clock_monitor_offset);
+	return true;
+}
+
+static inline void update_audio_clock(struct obs_core_audio *audio)
+{
+	audio_output_set_precise_timing(audio->audio,
+			audio->precise_timing || audio->monitoring_clock);
+	audio_output_set_clock(audio->audio,
+			audio->monitoring_clock ? monitoring_clock : NULL,
+			audio);
+}
+
 static bool obs_init_audio(struct audio_output_info *ai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -506,9 +569,10 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	audio->monitoring_device_id = bstrdup("default");
 
 	errorcode = audio_output_open(&audio->audio, ai);
-	if (errorcode == AUDIO_OUTPUT_SUCCESS)
+	if (errorcode == AUDIO_OUTPUT_SUCCESS) {
+		update_audio_clock(audio);
 		return true;
-	else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
+	} else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
 		blog(LOG_ERROR, "Invalid audio parameters specified");
 	else
 		blog(LOG_ERROR, "Could not open audio output");
@@ -519,6 +583,9 @@ static bool obs_init_audio(struct audio_output_info *ai)
 static void obs_free_audio(void)
 {
 	struct obs_core_audio *audio = &obs->audio;
+	bool precise_timing = audio->precise_timing;
+	bool monitoring_clock = audio->monitoring_clock;
+
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
@@ -532,6 +599,10 @@ static void obs_free_audio(void)
 	pthread_mutex_destroy(&audio->monitoring_mutex);
 
 	memset(audio, 0, sizeof(struct obs_core_audio));
+
+	/* timing settings persist across audio resets */
+	audio->precise_timing = precise_timing;
+	audio->monitoring_clock = monitoring_clock;
 }
 
 static bool obs_init_data(void)
@@ -620,6 +691,11 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
 	da_free(data->draw_callbacks);
 	da_free(data->tick_callbacks);
+
+	bfree(data->source_index.buckets);
+	bfree(data->output_index.buckets);
+	bfree(data->encoder_index.buckets);
+	bfree(data->service_index.buckets);
 }
 
 static const char *obs_signals[] = {
@@ -661,7 +737,12 @@ static inline bool obs_init_handlers(void)
 	if (!obs->procs)
 		return false;
 
-	return signal_handler_add_array(obs->signals, obs_signals);
+	if (!signal_handler_add_array(obs->signals, obs_signals))
+		return false;
+
+	obs->source_volume_signal = signal_handler_get_handle(obs->signals,
+			"source_volume");
+	return true;
 }
 
 static pthread_once_t obs_pthread_once_init_token = PTHREAD_ONCE_INIT;
@@ -759,6 +840,8 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	}
 
 	log_system_info();
+	format_conversion_init();
+	audio_math_init();
 
 	if (!obs_init_data())
 		return false;
@@ -1315,27 +1398,80 @@ void obs_enum_services(bool (*enum_proc)(void*, obs_service_t*), void *param)
 			enum_proc, param);
 }
 
-static inline void *get_context_by_name(void *vfirst, const char *name,
-		pthread_mutex_t *mutex, void *(*addref)(void*))
+/* FNV-1a */
+static inline uint32_t get_context_name_hash(const char *name)
 {
-	struct obs_context_data **first = vfirst;
-	struct obs_context_data *context;
+	uint32_t hash = 2166136261U;
 
-	pthread_mutex_lock(mutex);
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static inline struct obs_context_data *find_indexed_context(
+		struct obs_context_index *index, const char *name,
+		uint32_t hash, struct obs_context_data *context)
+{
+	if (!context) {
+		if (!index->num)
+			return NULL;
+		context = index->buckets[hash & (index->num_buckets - 1)];
+	} else {
+		context = context->hash_next;
+	}
 
-	context = *first;
 	while (context) {
-		if (!context->private && strcmp(context->name, name) == 0) {
-			context = addref(context);
+		if (context->name_hash == hash &&
+		    strcmp(context->name, name) == 0)
 			break;
-		}
-		context = context->next;
+		context = context->hash_next;
 	}
 
+	return context;
+}
+
+static inline void *get_context_by_name(const char *name,
+		pthread_mutex_t *mutex, struct obs_context_index *index,
+		void *(*addref)(void*))
+{
+	struct obs_context_data *context;
+	uint32_t hash = get_context_name_hash(name);
+
+	pthread_mutex_lock(mutex);
+
+	context = find_indexed_context(index, name, hash, NULL);
+	if (context)
+		context = addref(context);
+
 	pthread_mutex_unlock(mutex);
 	return context;
 }
 
+size_t obs_find_sources_by_name(const char *name, obs_source_t **sources,
+		size_t max_sources, long *generation)
+{
+	struct obs_context_index *index = &obs->data.source_index;
+	struct obs_context_data *context = NULL;
+	uint32_t hash = get_context_name_hash(name);
+	size_t count = 0;
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+
+	while ((context = find_indexed_context(index, name, hash, context))) {
+		if (count < max_sources)
+			sources[count] = (obs_source_t*)context;
+		count++;
+	}
+
+	*generation = os_atomic_load_long(&index->generation);
+
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+	return count;
+}
+
 static inline void *obs_source_addref_safe_(void *ref)
 {
 	return obs_source_get_ref(ref);
@@ -1364,29 +1500,29 @@ static inline void *obs_id_(void *data)
 obs_source_t *obs_get_source_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_source, name,
-			&obs->data.sources_mutex, obs_source_addref_safe_);
+	return get_context_by_name(name, &obs->data.sources_mutex,
+			&obs->data.source_index, obs_source_addref_safe_);
 }
 
 obs_output_t *obs_get_output_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_output, name,
-			&obs->data.outputs_mutex, obs_output_addref_safe_);
+	return get_context_by_name(name, &obs->data.outputs_mutex,
+			&obs->data.output_index, obs_output_addref_safe_);
 }
 
 obs_encoder_t *obs_get_encoder_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_encoder, name,
-			&obs->data.encoders_mutex, obs_encoder_addref_safe_);
+	return get_context_by_name(name, &obs->data.encoders_mutex,
+			&obs->data.encoder_index, obs_encoder_addref_safe_);
 }
 
 obs_service_t *obs_get_service_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_service, name,
-			&obs->data.services_mutex, obs_service_addref_safe_);
+	return get_context_by_name(name, &obs->data.services_mutex,
+			&obs->data.service_index, obs_service_addref_safe_);
 }
 
 gs_effect_t *obs_get_base_effect(enum obs_base_effect effect)
@@ -1859,8 +1995,90 @@ void obs_context_data_free(struct obs_context_data *context)
 	memset(context, 0, sizeof(*context));
 }
 
+#define CONTEXT_INDEX_MIN_BUCKETS 64
+
+/* buckets are kept newest first, so like the context lists, the first context
+ * found with a name is the newest one, whatever the renames and resizes */
+static void bucket_insert(struct obs_context_data **bucket,
+		struct obs_context_data *context)
+{
+	while (*bucket && (*bucket)->index_order > context->index_order)
+		bucket = &(*bucket)->hash_next;
+
+	context->hash_next = *bucket;
+	*bucket = context;
+}
+
+static void resize_context_index(struct obs_context_index *index,
+		size_t num_buckets)
+{
+	struct obs_context_data **buckets;
+
+	buckets = bzalloc(num_buckets * sizeof(*buckets));
+
+	for (size_t i = 0; i < index->num_buckets; i++) {
+		struct obs_context_data *context = index->buckets[i];
+
+		while (context) {
+			struct obs_context_data *next = context->hash_next;
+			size_t idx = context->name_hash & (num_buckets - 1);
+
+			bucket_insert(&buckets[idx], context);
+			context = next;
+		}
+	}
+
+	bfree(index->buckets);
+	index->buckets = buckets;
+	index->num_buckets = num_buckets;
+}
+
+/* the index is only needed for lookups by name, so private contexts (which
+ * can't be looked up by name) are never added to it */
+static void index_context(struct obs_context_data *context)
+{
+	struct obs_context_index *index = context->index;
+	size_t idx;
+
+	if (!index || context->private || !context->name)
+		return;
+
+	if (!index->num_buckets)
+		resize_context_index(index, CONTEXT_INDEX_MIN_BUCKETS);
+	else if (index->num >= index->num_buckets)
+		resize_context_index(index, index->num_buckets * 2);
+
+	context->name_hash = get_context_name_hash(context->name);
+
+	idx = context->name_hash & (index->num_buckets - 1);
+	bucket_insert(&index->buckets[idx], context);
+	context->indexed = true;
+	index->num++;
+	os_atomic_inc_long(&index->generation);
+}
+
+static void unindex_context(struct obs_context_data *context)
+{
+	struct obs_context_index *index = context->index;
+	struct obs_context_data **next;
+
+	if (!context->indexed)
+		return;
+
+	next = &index->buckets[context->name_hash & (index->num_buckets - 1)];
+	while (*next != context)
+		next = &(*next)->hash_next;
+
+	*next = context->hash_next;
+	context->hash_next = NULL;
+	context->indexed = false;
+	index->num--;
+	os_atomic_inc_long(&index->generation);
+}
+
 void obs_context_data_insert(struct obs_context_data *context,
-		pthread_mutex_t *mutex, void *pfirst)
+		pthread_mutex_t *mutex, void *pfirst,
+		struct obs_context_index *index)
 {
 	struct obs_context_data **first = pfirst;
 
@@ -1869,13 +2087,17 @@ void obs_context_data_insert(struct obs_context_data *context,
 	assert(first);
 
 	context->mutex = mutex;
+	context->index = index;
 
 	pthread_mutex_lock(mutex);
+	if (index)
+		context->index_order = index->next_order++;
 	context->prev_next  = first;
 	context->next       = *first;
 	*first              = context;
 	if (context->next)
 		context->next->prev_next = &context->next;
+	index_context(context);
 	pthread_mutex_unlock(mutex);
 }
 
@@ -1887,6 +2109,7 @@ void obs_context_data_remove(struct obs_context_data *context)
 			*context->prev_next = context->next;
 		if (context->next)
 			context->next->prev_next = context->prev_next;
+		unindex_context(context);
 		pthread_mutex_unlock(context->mutex);
 
 		context->mutex = NULL;
@@ -1896,13 +2119,24 @@ void obs_context_data_remove(struct obs_context_data *context)
 void obs_context_data_setname(struct obs_context_data *context,
 		const char *name)
 {
+	pthread_mutex_t *mutex = context->mutex;
+
+	if (mutex)
+		pthread_mutex_lock(mutex);
 	pthread_mutex_lock(&context->rename_cache_mutex);
 
+	unindex_context(context);
+
 	if (context->name)
 		da_push_back(context->rename_cache, &context->name);
 	context->name = dup_name(name, context->private);
 
+	if (mutex)
+		index_context(context);
+
 	pthread_mutex_unlock(&context->rename_cache_mutex);
+	if (mutex)
+		pthread_mutex_unlock(mutex);
 }
 
 profiler_name_store_t *obs_get_profiler_name_store(void)
@@ -1928,6 +2162,81 @@ uint64_t obs_get_average_frame_time_ns(void)
 	return obs ? obs->video.video_avg_frame_time_ns : 0;
 }
 
+#define MAX_CONVERT_WORKERS 16
+
+void obs_set_video_conversion_workers(uint32_t workers)
+{
+	if (!obs)
+		return;
+
+	if (workers > MAX_CONVERT_WORKERS)
+		workers = MAX_CONVERT_WORKERS;
+
+	os_atomic_set_long(&obs->video.convert_workers, (long)workers);
+}
+
+uint32_t obs_get_video_conversion_workers(void)
+{
+	return obs ? (uint32_t)os_atomic_load_long(&obs->video.convert_workers)
+		: 0;
+}
+
+void obs_set_threaded_video_delivery(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->video.threaded_delivery = enable;
+	video_output_set_threaded_inputs(obs->video.video, enable);
+}
+
+bool obs_threaded_video_delivery_enabled(void)
+{
+	return obs ? obs->video.threaded_delivery : false;
+}
+
+void obs_set_cascaded_video_scaling(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->video.cascaded_scaling = enable;
+	video_output_set_cascaded_scaling(obs->video.video, enable);
+}
+
+bool obs_cascaded_video_scaling_enabled(void)
+{
+	return obs ? obs->video.cascaded_scaling : false;
+}
+
+void obs_set_precise_audio_timing(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->audio.precise_timing = enable;
+	update_audio_clock(&obs->audio);
+}
+
+bool obs_precise_audio_timing_enabled(void)
+{
+	return obs ? obs->audio.precise_timing : false;
+}
+
+void obs_set_audio_monitoring_clock(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->audio.monitoring_clock = enable;
+	update_audio_clock(&obs->audio);
+}
+
+bool obs_audio_monitoring_clock_enabled(void)
+{
+	return obs ? obs->audio.monitoring_clock : false;
+}
+
 enum obs_obj_type obs_obj_get_type(void *obj)
 {
 	struct obs_context_data *context = obj;
@@ -2070,6 +2379,12 @@ uint32_t obs_get_lagged_frames(void)
 	return obs ? obs->video.lagged_frames : 0;
 }
 
+void obs_get_scene_render_stats(uint32_t *renders, uint32_t *saved)
+{
+	*renders = obs ? obs->video.last_scene_renders : 0;
+	*saved   = obs ? obs->video.last_scene_renders_saved : 0;
+}
+
 void start_raw_video(video_t *v, const struct video_scale_info *conversion,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
@@ -574,6 +574,15 @@ EXPORT void obs_render_main_texture(void);
  * is unavailable. */
 EXPORT gs_texture_t *obs_get_main_texture(void);
 
+/**
+ * Renders a source (usually a scene) through a texture shared by all
+ * displays: the first call for the source while displays are rendered
+ * renders it at its own size, later calls just draw the texture.  If the
+ * source's content hasn't changed, the texture from an earlier frame is
+ * drawn without rendering at all.  Only call from display draw callbacks.
+ */
+EXPORT void obs_source_video_render_cached(obs_source_t *source);
+
 /** Sets the master user volume */
 EXPORT void obs_set_master_volume(float volume);
 
@@ -676,6 +685,54 @@ EXPORT uint64_t obs_get_average_frame_time_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/**
+ * Gets how many sources obs_source_video_render_cached rendered, and how
+ * many renders it saved by drawing an already rendered texture, while the
+ * displays were last rendered.
+ */
+EXPORT void obs_get_scene_render_stats(uint32_t *renders, uint32_t *saved);
+
+/**
+ * Sets the number of worker threads used to help the graphics thread with
+ * CPU-side conversion of raw output frames (only used when GPU conversion is
+ * disabled).  Each frame is split into horizontal bands shared between the
+ * workers and the graphics thread.  0 (the default) disables the workers.
+ */
+EXPORT void obs_set_video_conversion_workers(uint32_t workers);
+EXPORT uint32_t obs_get_video_conversion_workers(void);
+
+/**
+ * Delivers raw video to each encoder/output from its own thread, so that a
+ * slow consumer drops its own frames rather than delaying the others.
+ * Applies to consumers that connect after this is changed.
+ */
+EXPORT void obs_set_threaded_video_delivery(bool enable);
+EXPORT bool obs_threaded_video_delivery_enabled(void);
+
+/**
+ * Scales raw video for a consumer from the nearest larger rendition another
+ * consumer already uses (e.g. 480p from 720p) rather than from the full size
+ * frame.  Consumers that use identical conversions always share the scaled
+ * frames.  Applies to consumers that connect after this is changed.
+ */
+EXPORT void obs_set_cascaded_video_scaling(bool enable);
+EXPORT bool obs_cascaded_video_scaling_enabled(void);
+
+/**
+ * Paces the audio thread with absolute tick deadlines instead of polling.
+ * Tick jitter is recorded by the profiler as the time between calls of the
+ * audio thread.
+ */
+EXPORT void obs_set_precise_audio_timing(bool enable);
+EXPORT bool obs_precise_audio_timing_enabled(void);
+
+/**
+ * Slaves the audio tick to the clock of the audio monitoring device while
+ * any source is being monitored (implies precise audio timing).
+ */
+EXPORT void obs_set_audio_monitoring_clock(bool enable);
+EXPORT bool obs_audio_monitoring_clock_enabled(void);
+
 
 /* ------------------------------------------------------------------------- */
 /* Display context */
@@ -1034,10 +1091,34 @@ EXPORT void obs_source_draw_set_color_matrix(
 EXPORT void obs_source_draw(gs_texture_t *image, int x, int y,
 		uint32_t cx, uint32_t cy, bool flip);
 
+/**
+ * Marks whether every pixel drawn by a synchronous source is fully opaque.
+ * Scenes use this to skip rendering items that are completely covered.
+ */
+EXPORT void obs_source_set_video_opaque(obs_source_t *source, bool opaque);
+
+/**
+ * Signals that the video of a source with the OBS_SOURCE_STATIC_VIDEO flag
+ * has changed for reasons other than a settings update.
+ */
+EXPORT void obs_source_content_changed(obs_source_t *source);
+
 /** Outputs asynchronous video data.  Set to NULL to deactivate the texture */
 EXPORT void obs_source_output_video(obs_source_t *source,
 		const struct obs_source_frame *frame);
 
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The frame data must
+ * stay valid until libobs calls the release callback, which can happen on
+ * any thread (including before this function returns) and with internal
+ * locks held, so it must not call back into the source.
+ */
+EXPORT void obs_source_output_video_nocopy(obs_source_t *source,
+		const struct obs_source_frame *frame,
+		obs_source_frame_release_t release, void *param);
+
 /** Preloads asynchronous video data to allow instantaneous playback */
 EXPORT void obs_source_preload_video(obs_source_t *source,
 		const struct obs_source_frame *frame);
@@ -1562,6 +1643,14 @@ EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
 
+/**
+ * Gets the delivery statistics of the raw video the output (or its video
+ * encoder) receives, only kept while threaded video delivery is enabled.
+ * Returns false if the output is not receiving video.
+ */
+EXPORT bool obs_output_get_video_input_stats(const obs_output_t *output,
+		struct video_input_stats *stats);
+
 /**
  * Sets the preferred scaled resolution for this output.  Set width and height
  * to 0 to disable scaling.
@@ -1805,6 +1894,25 @@ EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst,
 		struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+/** Returns the bytes of packet data copied since the encoder was started */
+EXPORT uint64_t obs_encoder_get_packet_bytes_copied(
+		const obs_encoder_t *encoder);
+
+/**
+ * Returns the bytes of packet data outputs referenced since the encoder was
+ * started, which each of them used to copy
+ */
+EXPORT uint64_t obs_encoder_get_packet_bytes_shared(
+		const obs_encoder_t *encoder);
+
+/**
+ * Gets the delivery statistics of the raw video a video encoder receives,
+ * only kept while threaded video delivery is enabled.  Returns false if the
+ * encoder is not receiving video.
+ */
+EXPORT bool obs_encoder_get_video_input_stats(const obs_encoder_t *encoder,
+		struct video_input_stats *stats);
+
 
 /* ------------------------------------------------------------------------- */
 /* Stream Services */
@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2026 by the OBS Studio contributors
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+#include "file-watcher.h"
+#include "threading.h"
+#include "platform.h"
+#include "bmem.h"
+#include "base.h"
+
+#define POLL_INTERVAL_MS 1000
+
+#ifdef __linux__
+#define INOTIFY_MASK (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | \
+		IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+struct os_file_watch {
+	char                 *path;
+	os_file_changed_t    callback;
+	void                 *param;
+	uint32_t             pending;
+
+	/* inotify watch descriptor of the directory containing the file (or
+	 * of the directory itself), or -1 if the path is polled instead */
+	int                  wd;
+	const char           *name;
+
+	bool                 exists;
+	bool                 is_dir;
+	time_t               mtime;
+	off_t                size;
+
+	struct os_file_watch *next;
+};
+
+struct os_file_watcher {
+	pthread_mutex_t      mutex;
+	pthread_t            thread;
+	bool                 thread_initialized;
+	volatile bool        stop;
+
+	struct os_file_watch *first_watch;
+
+	/* watch whose callback is currently being called, it's freed by the
+	 * thread after the callback if it's removed during the callback */
+	struct os_file_watch *cur_watch;
+	bool                 cur_watch_removed;
+
+#ifdef __linux__
+	int                  inotify_fd;
+	int                  wake_fds[2];
+#else
+	os_event_t           *stop_event;
+#endif
+};
+
+static void free_watch(struct os_file_watch *watch)
+{
+	bfree(watch->path);
+	bfree(watch);
+}
+
+static void update_stat(struct os_file_watch *watch)
+{
+	struct stat st;
+
+	watch->exists = os_stat(watch->path, &st) == 0;
+	watch->is_dir = watch->exists && S_ISDIR(st.st_mode);
+	watch->mtime = watch->exists ? st.st_mtime : 0;
+	watch->size = watch->exists ? st.st_size : 0;
+}
+
+static void poll_watch(struct os_file_watch *watch)
+{
+	bool   exists = watch->exists;
+	time_t mtime = watch->mtime;
+	off_t  size = watch->size;
+
+	update_stat(watch);
+
+	/* the mtime of a directory only tells that its entries changed, not
+	 * how */
+	if (!exists && watch->exists)
+		watch->pending |= OS_FILE_CREATED;
+	else if (exists && !watch->exists)
+		watch->pending |= OS_FILE_DELETED;
+	else if (mtime != watch->mtime || size != watch->size)
+		watch->pending |= watch->is_dir ?
+			OS_FILE_CHANGE_ALL : OS_FILE_MODIFIED;
+}
+
+static void check_polled_watches(struct os_file_watcher *fw)
+{
+	struct os_file_watch *watch = fw->first_watch;
+
+	while (watch) {
+		if (watch->wd == -1)
+			poll_watch(watch);
+		watch = watch->next;
+	}
+}
+
+static void dispatch_changes(struct os_file_watcher *fw)
+{
+	struct os_file_watch *watch;
+	uint32_t changes;
+
+	for (;;) {
+		watch = fw->first_watch;
+		while (watch && !watch->pending)
+			watch = watch->next;
+		if (!watch)
+			break;
+
+		changes = watch->pending;
+		watch->pending = 0;
+
+		fw->cur_watch = watch;
+		fw->cur_watch_removed = false;
+		watch->callback(watch->param, watch->path, changes);
+		fw->cur_watch = NULL;
+
+		if (fw->cur_watch_removed)
+			free_watch(watch);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef __linux__
+
+static inline void wake_thread(struct os_file_watcher *fw)
+{
+	char c = 0;
+	if (write(fw->wake_fds[1], &c, 1) != 1)
+		blog(LOG_DEBUG, "os_file_watcher: Failed to wake thread");
+}
+
+static void add_inotify_watch(struct os_file_watcher *fw,
+		struct os_file_watch *watch)
+{
+	struct stat st;
+	char *dir;
+
+	watch->wd = -1;
+	watch->name = NULL;
+
+	if (fw->inotify_fd == -1)
+		return;
+
+	if (os_stat(watch->path, &st) == 0 && S_ISDIR(st.st_mode)) {
+		watch->wd = inotify_add_watch(fw->inotify_fd, watch->path,
+				INOTIFY_MASK);
+		return;
+	}
+
+	/* files are watched through their directory so that files being
+	 * created or replaced with a rename are noticed */
+	watch->name = strrchr(watch->path, '/');
+	if (!watch->name) {
+		watch->name = watch->path;
+		watch->wd = inotify_add_watch(fw->inotify_fd, ".",
+				INOTIFY_MASK);
+		return;
+	}
+
+	dir = bstrdup_n(watch->path, watch->name - watch->path);
+	watch->name++;
+	watch->wd = inotify_add_watch(fw->inotify_fd, *dir ? dir : "/",
+			INOTIFY_MASK);
+	bfree(dir);
+}
+
+static void remove_inotify_watch(struct os_file_watcher *fw,
+		struct os_file_watch *watch)
+{
+	struct os_file_watch *other = fw->first_watch;
+
+	if (watch->wd == -1)
+		return;
+
+	/* watches of files in the same directory share a descriptor */
+	while (other) {
+		if (other->wd == watch->wd)
+			return;
+		other = other->next;
+	}
+
+	inotify_rm_watch(fw->inotify_fd, watch->wd);
+}
+
+static uint32_t inotify_changes(uint32_t mask)
+{
+	uint32_t changes = 0;
+
+	if (mask & (IN_CLOSE_WRITE | IN_MODIFY))
+		changes |= OS_FILE_MODIFIED;
+	if (mask & IN_CREATE)
+		changes |= OS_FILE_CREATED;
+	if (mask & (IN_DELETE | IN_DELETE_SELF | IN_IGNORED))
+		changes |= OS_FILE_DELETED;
+	if (mask & (IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF))
+		changes |= OS_FILE_MOVED;
+
+	return changes;
+}
+
+static void mark_inotify_event(struct os_file_watcher *fw,
+		const struct inotify_event *event)
+{
+	struct os_file_watch *watch = fw->first_watch;
+
+	while (watch) {
+		if (event->mask & IN_Q_OVERFLOW) {
+			watch->pending |= OS_FILE_CHANGE_ALL;
+
+		} else if (watch->wd == event->wd) {
+			if (!watch->name || (event->len &&
+			    strcmp(watch->name, event->name) == 0))
+				watch->pending |= inotify_changes(event->mask);
+
+			/* the directory is gone, poll the path until the
+			 * directory is created again (see
+			 * retry_inotify_watches) */
+			if (event->mask & IN_IGNORED) {
+				watch->wd = -1;
+				update_stat(watch);
+			}
+		}
+
+		watch = watch->next;
+	}
+}
+
+static void read_inotify_events(struct os_file_watcher *fw)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	while ((len = read(fw->inotify_fd, buf, sizeof(buf))) > 0) {
+		const struct inotify_event *event;
+
+		pthread_mutex_lock(&fw->mutex);
+
+		for (char *ptr = buf; ptr < buf + len;
+				ptr += sizeof(*event) + event->len) {
+			event = (const struct inotify_event*)ptr;
+			mark_inotify_event(fw, event);
+		}
+
+		pthread_mutex_unlock(&fw->mutex);
+	}
+}
+
+/* polled watches go back to inotify once the directory to watch exists (again),
+ * which is also when a directory that was removed is created again */
+static void retry_inotify_watches(struct os_file_watcher *fw)
+{
+	struct os_file_watch *watch = fw->first_watch;
+
+	if (fw->inotify_fd == -1)
+		return;
+
+	while (watch) {
+		if (watch->wd == -1) {
+			add_inotify_watch(fw, watch);
+
+			/* catches changes from the last poll up to adding
+			 * the watch */
+			if (watch->wd != -1)
+				poll_watch(watch);
+		}
+
+		watch = watch->next;
+	}
+}
+
+static bool has_polled_watches(struct os_file_watcher *fw)
+{
+	struct os_file_watch *watch;
+	bool polled = false;
+
+	pthread_mutex_lock(&fw->mutex);
+
+	watch = fw->first_watch;
+	while (watch) {
+		if (watch->wd == -1) {
+			polled = true;
+			break;
+		}
+		watch = watch->next;
+	}
+
+	pthread_mutex_unlock(&fw->mutex);
+	return polled;
+}
+
+static void *file_watcher_thread(void *data)
+{
+	struct os_file_watcher *fw = data;
+	uint64_t last_poll = os_gettime_ns();
+
+	os_set_thread_name("file watcher");
+
+	while (!os_atomic_load_bool(&fw->stop)) {
+		struct pollfd fds[2] = {
+			{fw->wake_fds[0],  POLLIN, 0},
+			{fw->inotify_fd, POLLIN, 0}
+		};
+		int timeout = has_polled_watches(fw) ? POLL_INTERVAL_MS : -1;
+		nfds_t nfds = fw->inotify_fd != -1 ? 2 : 1;
+		uint64_t now;
+
+		if (poll(fds, nfds, timeout) < 0 && errno != EINTR)
+			break;
+
+		if (fds[0].revents & POLLIN) {
+			char buf[64];
+			while (read(fw->wake_fds[0], buf, sizeof(buf)) > 0);
+		}
+
+		if (nfds == 2 && (fds[1].revents & POLLIN))
+			read_inotify_events(fw);
+
+		pthread_mutex_lock(&fw->mutex);
+
+		now = os_gettime_ns();
+		if (now - last_poll >= POLL_INTERVAL_MS * 1000000ULL) {
+			check_polled_watches(fw);
+			retry_inotify_watches(fw);
+			last_poll = now;
+		}
+
+		dispatch_changes(fw);
+
+		pthread_mutex_unlock(&fw->mutex);
+	}
+
+	return NULL;
+}
+
+static bool file_watcher_init_platform(struct os_file_watcher *fw)
+{
+	fw->wake_fds[0] = -1;
+	fw->wake_fds[1] = -1;
+
+	fw->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fw->inotify_fd == -1)
+		blog(LOG_WARNING, "os_file_watcher: Failed to initialize "
+				"inotify, falling back to polling");
+
+	if (pipe(fw->wake_fds) != 0)
+		return false;
+
+	fcntl(fw->wake_fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(fw->wake_fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fw->wake_fds[1], F_SETFD, FD_CLOEXEC);
+	return true;
+}
+
+static void file_watcher_free_platform(struct os_file_watcher *fw)
+{
+	if (fw->inotify_fd != -1)
+		close(fw->inotify_fd);
+	if (fw->wake_fds[0] != -1)
+		close(fw->wake_fds[0]);
+	if (fw->wake_fds[1] != -1)
+		close(fw->wake_fds[1]);
+}
+
+#else
+
+static inline void wake_thread(struct os_file_watcher *fw)
+{
+	UNUSED_PARAMETER(fw);
+}
+
+static inline void add_inotify_watch(struct os_file_watcher *fw,
+		struct os_file_watch *watch)
+{
+	watch->wd = -1;
+	UNUSED_PARAMETER(fw);
+}
+
+static inline void remove_inotify_watch(struct os_file_watcher *fw,
+		struct os_file_watch *watch)
+{
+	UNUSED_PARAMETER(fw);
+	UNUSED_PARAMETER(watch);
+}
+
+static void *file_watcher_thread(void *data)
+{
+	struct os_file_watcher *fw = data;
+
+	os_set_thread_name("file watcher");
+
+	while (os_event_timedwait(fw->stop_event, POLL_INTERVAL_MS) ==
+			ETIMEDOUT) {
+		pthread_mutex_lock(&fw->mutex);
+		check_polled_watches(fw);
+		dispatch_changes(fw);
+		pthread_mutex_unlock(&fw->mutex);
+	}
+
+	return NULL;
+}
+
+static bool file_watcher_init_platform(struct os_file_watcher *fw)
+{
+	return os_event_init(&fw->stop_event, OS_EVENT_TYPE_MANUAL) == 0;
+}
+
+static void file_watcher_free_platform(struct os_file_watcher *fw)
+{
+	os_event_destroy(fw->stop_event);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+os_file_watcher_t *os_file_watcher_create(void)
+{
+	struct os_file_watcher *fw = bzalloc(sizeof(*fw));
+	pthread_mutexattr_t attr;
+
+	pthread_mutex_init_value(&fw->mutex);
+
+	if (!file_watcher_init_platform(fw))
+		goto fail;
+
+	/* recursive so watches can be removed from within callbacks */
+	if (pthread_mutexattr_init(&attr) != 0)
+		goto fail;
+	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+		goto fail;
+	if (pthread_mutex_init(&fw->mutex, &attr) != 0)
+		goto fail;
+	if (pthread_create(&fw->thread, NULL, file_watcher_thread, fw) != 0)
+		goto fail;
+
+	fw->thread_initialized = true;
+	return fw;
+
+fail:
+	blog(LOG_ERROR, "os_file_watcher_create: Failed to create file "
+			"watcher");
+	os_file_watcher_destroy(fw);
+	return NULL;
+}
+
+void os_file_watcher_destroy(os_file_watcher_t *fw)
+{
+	struct os_file_watch *watch;
+
+	if (!fw)
+		return;
+
+	if (fw->thread_initialized) {
+		os_atomic_set_bool(&fw->stop, true);
+#ifdef __linux__
+		wake_thread(fw);
+#else
+		os_event_signal(fw->stop_event);
+#endif
+		pthread_join(fw->thread, NULL);
+	}
+
+	watch = fw->first_watch;
+	while (watch) {
+		struct os_file_watch *next = watch->next;
+		free_watch(watch);
+		watch = next;
+	}
+
+	file_watcher_free_platform(fw);
+	pthread_mutex_destroy(&fw->mutex);
+	bfree(fw);
+}
+
+os_file_watch_t *os_file_watcher_add(os_file_watcher_t *fw, const char *path,
+		os_file_changed_t callback, void *param)
+{
+	struct os_file_watch *watch;
+
+	if (!fw || !path || !*path || !callback)
+		return NULL;
+
+	watch = bzalloc(sizeof(*watch));
+	watch->path = bstrdup(path);
+	watch->callback = callback;
+	watch->param = param;
+
+	pthread_mutex_lock(&fw->mutex);
+
+	add_inotify_watch(fw, watch);
+	update_stat(watch);
+
+	watch->next = fw->first_watch;
+	fw->first_watch = watch;
+
+	pthread_mutex_unlock(&fw->mutex);
+
+	/* the thread might need to start polling */
+	if (watch->wd == -1)
+		wake_thread(fw);
+
+	return watch;
+}
+
+void os_file_watcher_remove(os_file_watcher_t *fw, os_file_watch_t *watch)
+{
+	struct os_file_watch **prev_next;
+
+	if (!fw || !watch)
+		return;
+
+	pthread_mutex_lock(&fw->mutex);
+
+	prev_next = &fw->first_watch;
+	while (*prev_next && *prev_next != watch)
+		prev_next = &(*prev_next)->next;
+
+	if (*prev_next) {
+		*prev_next = watch->next;
+		remove_inotify_watch(fw, watch);
+
+		if (watch == fw->cur_watch)
+			fw->cur_watch_removed = true;
+		else
+			free_watch(watch);
+	}
+
+	pthread_mutex_unlock(&fw->mutex);
+}
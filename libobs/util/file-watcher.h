@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 by the OBS Studio contributors
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * File watcher
+ *
+ *   Watches files and directories for changes, and calls back from the
+ * watcher's thread when they change.  Uses inotify on Linux, and falls back
+ * to checking the modification time of each watched path once a second
+ * elsewhere (or when inotify can't be used for a path).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct os_file_watcher;
+struct os_file_watch;
+typedef struct os_file_watcher os_file_watcher_t;
+typedef struct os_file_watch   os_file_watch_t;
+
+enum os_file_change {
+	OS_FILE_MODIFIED = 1 << 0,
+	OS_FILE_CREATED  = 1 << 1,
+	OS_FILE_DELETED  = 1 << 2,
+	OS_FILE_MOVED    = 1 << 3,
+};
+
+#define OS_FILE_CHANGE_ALL \
+	(OS_FILE_MODIFIED | OS_FILE_CREATED | OS_FILE_DELETED | OS_FILE_MOVED)
+
+/**
+ * Called from the watcher thread when a watched file is written, created,
+ * deleted or replaced, or when the entries of a watched directory change.
+ * Multiple changes may be reported with a single call, changes is the
+ * combination of their os_file_change flags.  For a directory, the flags
+ * describe what happened to its entries.  All flags are set when the kind of
+ * change is not known, such as when a polled directory changes.
+ */
+typedef void (*os_file_changed_t)(void *param, const char *path,
+		uint32_t changes);
+
+EXPORT os_file_watcher_t *os_file_watcher_create(void);
+EXPORT void os_file_watcher_destroy(os_file_watcher_t *fw);
+
+/**
+ * Starts watching a file or directory.  The path does not need to exist
+ * yet, the callback is called once it's created.
+ */
+EXPORT os_file_watch_t *os_file_watcher_add(os_file_watcher_t *fw,
+		const char *path, os_file_changed_t callback, void *param);
+
+/**
+ * Stops watching.  Once this returns, the callback of the watch is not
+ * being called and will not be called again.  Can be called from within a
+ * callback.
+ */
+EXPORT void os_file_watcher_remove(os_file_watcher_t *fw,
+		os_file_watch_t *watch);
+
+#ifdef __cplusplus
+}
+#endif
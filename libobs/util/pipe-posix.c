@@ -85,3 +85,15 @@ size_t os_process_pipe_write(os_process_pipe_t *pp, const uint8_t *data,
 
 	return fwrite(data, 1, len, pp->file);
 }
+
+bool os_process_pipe_flush(os_process_pipe_t *pp)
+{
+	if (!pp) {
+		return false;
+	}
+	if (pp->read_pipe) {
+		return false;
+	}
+
+	return fflush(pp->file) == 0;
+}
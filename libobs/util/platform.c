@@ -26,6 +26,12 @@
 #include "utf8.h"
 #include "dstr.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
 FILE *os_wfopen(const wchar_t *path, const char *mode)
 {
 	FILE *file = NULL;
@@ -774,3 +780,84 @@ char *os_generate_formatted_filename(const char *extension, bool space,
 
 	return sf.array;
 }
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || \
+	defined(__x86_64__)
+static inline void get_cpuid(uint32_t leaf, uint32_t sub, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+	__cpuidex((int*)regs, (int)leaf, (int)sub);
+#else
+	__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static inline uint64_t get_xcr0(void)
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile(".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+			: "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static uint32_t detect_cpu_features(void)
+{
+	uint32_t regs[4];
+	uint32_t max_leaf;
+	uint32_t features = 0;
+	bool os_avx = false;
+
+	get_cpuid(0, 0, regs);
+	max_leaf = regs[0];
+	if (max_leaf < 1)
+		return 0;
+
+	get_cpuid(1, 0, regs);
+	if (regs[3] & (1 << 26))
+		features |= OS_CPU_SSE2;
+	if (regs[2] & (1 << 9))
+		features |= OS_CPU_SSSE3;
+	if (regs[2] & (1 << 19))
+		features |= OS_CPU_SSE41;
+
+	/* AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1-2) */
+	if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28)))
+		os_avx = (get_xcr0() & 0x6) == 0x6;
+
+	if (os_avx) {
+		features |= OS_CPU_AVX;
+		if (regs[2] & (1 << 12))
+			features |= OS_CPU_FMA;
+
+		if (max_leaf >= 7) {
+			get_cpuid(7, 0, regs);
+			if (regs[1] & (1 << 5))
+				features |= OS_CPU_AVX2;
+		}
+	}
+
+	return features;
+}
+#else
+static uint32_t detect_cpu_features(void)
+{
+	return 0;
+}
+#endif
+
+uint32_t os_get_cpu_features(void)
+{
+	static volatile bool detected = false;
+	static volatile uint32_t features = 0;
+
+	if (!detected) {
+		features = detect_cpu_features();
+		detected = true;
+	}
+
+	return features;
+}
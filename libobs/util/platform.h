@@ -181,6 +181,16 @@ EXPORT void os_breakpoint(void);
 EXPORT int os_get_physical_cores(void);
 EXPORT int os_get_logical_cores(void);
 
+#define OS_CPU_SSE2     (1 << 0)
+#define OS_CPU_SSSE3    (1 << 1)
+#define OS_CPU_SSE41    (1 << 2)
+#define OS_CPU_AVX      (1 << 3)
+#define OS_CPU_AVX2     (1 << 4)
+#define OS_CPU_FMA      (1 << 5)
+
+/** Returns a mask of OS_CPU_* flags supported by both the CPU and the OS */
+EXPORT uint32_t os_get_cpu_features(void);
+
 EXPORT uint64_t os_get_sys_free_size(void);
 
 struct os_proc_memory_usage {
@@ -53,3 +53,38 @@ static inline bool os_atomic_load_bool(const volatile bool *ptr)
 {
 	return !!_InterlockedOr8((volatile char*)ptr, 0);
 }
+
+static inline void *os_atomic_set_ptr(void *volatile *ptr, void *val)
+{
+	return _InterlockedExchangePointer(ptr, val);
+}
+
+static inline void *os_atomic_load_ptr(void *const volatile *ptr)
+{
+	return _InterlockedCompareExchangePointer((void *volatile*)ptr,
+			NULL, NULL);
+}
+
+static inline bool os_atomic_compare_swap_ptr(void *volatile *ptr,
+		void *old_val, void *new_val)
+{
+	return _InterlockedCompareExchangePointer(ptr, new_val, old_val) ==
+		old_val;
+}
+
+/* _InterlockedExchange64 isn't available on 32-bit x86 */
+static inline int64_t os_atomic_set_int64(volatile int64_t *ptr, int64_t val)
+{
+	int64_t old_val;
+
+	do {
+		old_val = *ptr;
+	} while (_InterlockedCompareExchange64(ptr, val, old_val) != old_val);
+
+	return old_val;
+}
+
+static inline int64_t os_atomic_load_int64(const volatile int64_t *ptr)
+{
+	return _InterlockedCompareExchange64((volatile int64_t*)ptr, 0, 0);
+}
@@ -1,8 +1,10 @@
 #include <obs-module.h>
 #include <graphics/image-file.h>
+#include <util/file-watcher.h>
+#include <util/threading.h>
 #include <util/platform.h>
+#include <util/darray.h>
 #include <util/dstr.h>
-#include <sys/stat.h>
 
 #define blog(log_level, format, ...) \
 	blog(log_level, "[image_source: '%s'] " format, \
@@ -15,62 +17,220 @@
 #define warn(format, ...) \
 	blog(LOG_WARNING, format, ##__VA_ARGS__)
 
+/* images are decoded by a shared pool of threads, and the decoded image is
+ * swapped in by the video tick once it's ready */
+#define DECODE_THREADS 2
+
+struct image_decode {
+	volatile long   refs;
+	volatile bool   cancelled;
+	volatile bool   done;
+
+	char            *file;
+	gs_image_file_t image;
+};
+
 struct image_source {
 	obs_source_t *source;
 
 	char         *file;
 	bool         persistent;
-	time_t       file_timestamp;
-	float        update_time_elapsed;
 	uint64_t     last_time;
 	bool         active;
 
+	os_file_watch_t *file_watch;
+	volatile bool   file_changed;
+
+	struct image_decode *decode;
 	gs_image_file_t image;
 };
 
+/* shared with the slideshow */
+os_file_watcher_t *image_file_watcher = NULL;
 
-static time_t get_modified_timestamp(const char *filename)
+static struct {
+	pthread_mutex_t              mutex;
+	os_sem_t                     *sem;
+	pthread_t                    threads[DECODE_THREADS];
+	bool                         threads_initialized[DECODE_THREADS];
+	volatile bool                stop;
+	DARRAY(struct image_decode*) queue;
+} decoder;
+
+static void image_decode_release(struct image_decode *decode)
 {
-	struct stat stats;
-	if (os_stat(filename, &stats) != 0)
-		return -1;
-	return stats.st_mtime;
+	if (!decode)
+		return;
+
+	if (os_atomic_dec_long(&decode->refs) == 0) {
+		if (decode->image.loaded) {
+			obs_enter_graphics();
+			gs_image_file_free(&decode->image);
+			obs_leave_graphics();
+		}
+
+		bfree(decode->file);
+		bfree(decode);
+	}
+}
+
+static void *decode_thread(void *unused)
+{
+	os_set_thread_name("image-source: decode thread");
+
+	while (os_sem_wait(decoder.sem) == 0) {
+		struct image_decode *decode = NULL;
+
+		if (os_atomic_load_bool(&decoder.stop))
+			break;
+
+		pthread_mutex_lock(&decoder.mutex);
+		if (decoder.queue.num) {
+			decode = decoder.queue.array[0];
+			da_erase(decoder.queue, 0);
+		}
+		pthread_mutex_unlock(&decoder.mutex);
+
+		if (!decode)
+			continue;
+
+		if (!os_atomic_load_bool(&decode->cancelled))
+			gs_image_file_init(&decode->image, decode->file);
+
+		os_atomic_set_bool(&decode->done, true);
+		image_decode_release(decode);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static bool decoder_init(void)
+{
+	pthread_mutex_init_value(&decoder.mutex);
+	if (pthread_mutex_init(&decoder.mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&decoder.sem, 0) != 0)
+		return false;
+
+	for (size_t i = 0; i < DECODE_THREADS; i++) {
+		if (pthread_create(&decoder.threads[i], NULL, decode_thread,
+					NULL) != 0)
+			return false;
+		decoder.threads_initialized[i] = true;
+	}
+
+	return true;
+}
+
+static void decoder_free(void)
+{
+	os_atomic_set_bool(&decoder.stop, true);
+
+	for (size_t i = 0; i < DECODE_THREADS; i++) {
+		if (decoder.threads_initialized[i])
+			os_sem_post(decoder.sem);
+	}
+	for (size_t i = 0; i < DECODE_THREADS; i++) {
+		if (decoder.threads_initialized[i])
+			pthread_join(decoder.threads[i], NULL);
+	}
+
+	for (size_t i = 0; i < decoder.queue.num; i++)
+		image_decode_release(decoder.queue.array[i]);
+	da_free(decoder.queue);
+
+	os_sem_destroy(decoder.sem);
+	pthread_mutex_destroy(&decoder.mutex);
+	memset(&decoder, 0, sizeof(decoder));
 }
 
+static struct image_decode *decoder_queue(const char *file)
+{
+	struct image_decode *decode = bzalloc(sizeof(*decode));
+	decode->file = bstrdup(file);
+	decode->refs = 2;
+
+	pthread_mutex_lock(&decoder.mutex);
+	da_push_back(decoder.queue, &decode);
+	pthread_mutex_unlock(&decoder.mutex);
+
+	os_sem_post(decoder.sem);
+	return decode;
+}
+
+
 static const char *image_source_get_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
 	return obs_module_text("ImageInput");
 }
 
-static void image_source_load(struct image_source *context)
+static void image_source_cancel_decode(struct image_source *context)
 {
-	char *file = context->file;
+	if (context->decode) {
+		os_atomic_set_bool(&context->decode->cancelled, true);
+		image_decode_release(context->decode);
+		context->decode = NULL;
+	}
+}
+
+static void image_source_unload(struct image_source *context)
+{
+	image_source_cancel_decode(context);
 
 	obs_enter_graphics();
 	gs_image_file_free(&context->image);
 	obs_leave_graphics();
 
-	if (file && *file) {
-		debug("loading texture '%s'", file);
-		context->file_timestamp = get_modified_timestamp(file);
-		gs_image_file_init(&context->image, file);
-		context->update_time_elapsed = 0;
+	obs_source_content_changed(context->source);
+}
 
-		obs_enter_graphics();
-		gs_image_file_init_texture(&context->image);
-		obs_leave_graphics();
+/* the current image is kept until the new one has been decoded */
+static void image_source_load(struct image_source *context)
+{
+	char *file = context->file;
 
-		if (!context->image.loaded)
-			warn("failed to load texture '%s'", file);
+	if (!file || !*file) {
+		image_source_unload(context);
+		return;
 	}
+
+	image_source_cancel_decode(context);
+
+	debug("loading texture '%s'", file);
+	context->decode = decoder_queue(file);
 }
 
-static void image_source_unload(struct image_source *context)
+static void image_source_swap_decoded(struct image_source *context)
 {
+	struct image_decode *decode = context->decode;
+
 	obs_enter_graphics();
 	gs_image_file_free(&context->image);
+	context->image = decode->image;
+	memset(&decode->image, 0, sizeof(decode->image));
+	gs_image_file_init_texture(&context->image);
 	obs_leave_graphics();
+
+	if (!context->image.loaded)
+		warn("failed to load texture '%s'", decode->file);
+
+	image_decode_release(decode);
+	context->decode = NULL;
+	context->last_time = 0;
+
+	obs_source_content_changed(context->source);
+}
+
+static void image_source_file_changed(void *param, const char *path,
+		uint32_t changes)
+{
+	struct image_source *context = param;
+	os_atomic_set_bool(&context->file_changed, true);
+
+	UNUSED_PARAMETER(path);
+	UNUSED_PARAMETER(changes);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -79,6 +239,10 @@ static void image_source_update(void *data, obs_data_t *settings)
 	const char *file = obs_data_get_string(settings, "file");
 	const bool unload = obs_data_get_bool(settings, "unload");
 
+	os_file_watcher_remove(image_file_watcher, context->file_watch);
+	context->file_watch = os_file_watcher_add(image_file_watcher, file,
+			image_source_file_changed, context);
+
 	if (context->file)
 		bfree(context->file);
 	context->file = bstrdup(file);
@@ -125,6 +289,7 @@ static void image_source_destroy(void *data)
 {
 	struct image_source *context = data;
 
+	os_file_watcher_remove(image_file_watcher, context->file_watch);
 	image_source_unload(context);
 
 	if (context->file)
@@ -162,15 +327,12 @@ static void image_source_tick(void *data, float seconds)
 	struct image_source *context = data;
 	uint64_t frame_time = obs_get_video_frame_time();
 
-	context->update_time_elapsed += seconds;
-
-	if (context->update_time_elapsed >= 1.0f) {
-		time_t t = get_modified_timestamp(context->file);
-		context->update_time_elapsed = 0.0f;
+	if (context->decode && os_atomic_load_bool(&context->decode->done))
+		image_source_swap_decoded(context);
 
-		if (context->file_timestamp != t) {
+	if (os_atomic_set_bool(&context->file_changed, false)) {
+		if (context->persistent || obs_source_showing(context->source))
 			image_source_load(context);
-		}
 	}
 
 	if (obs_source_active(context->source)) {
@@ -190,6 +352,7 @@ static void image_source_tick(void *data, float seconds)
 				obs_enter_graphics();
 				gs_image_file_update_texture(&context->image);
 				obs_leave_graphics();
+				obs_source_content_changed(context->source);
 			}
 
 			context->active = false;
@@ -206,10 +369,13 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file_update_texture(&context->image);
 			obs_leave_graphics();
+			obs_source_content_changed(context->source);
 		}
 	}
 
 	context->last_time = frame_time;
+
+	UNUSED_PARAMETER(seconds);
 }
 
 
@@ -251,7 +417,7 @@ static obs_properties_t *image_source_properties(void *data)
 static struct obs_source_info image_source_info = {
 	.id             = "image_source",
 	.type           = OBS_SOURCE_TYPE_INPUT,
-	.output_flags   = OBS_SOURCE_VIDEO,
+	.output_flags   = OBS_SOURCE_VIDEO | OBS_SOURCE_STATIC_VIDEO,
 	.get_name       = image_source_get_name,
 	.create         = image_source_create,
 	.destroy        = image_source_destroy,
@@ -274,8 +440,22 @@ extern struct obs_source_info color_source_info;
 
 bool obs_module_load(void)
 {
+	if (!decoder_init()) {
+		decoder_free();
+		return false;
+	}
+
+	image_file_watcher = os_file_watcher_create();
+
 	obs_register_source(&image_source_info);
 	obs_register_source(&color_source_info);
 	obs_register_source(&slideshow_info);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	os_file_watcher_destroy(image_file_watcher);
+	image_file_watcher = NULL;
+	decoder_free();
+}
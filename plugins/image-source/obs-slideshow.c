@@ -1,4 +1,5 @@
 #include <obs-module.h>
+#include <util/file-watcher.h>
 #include <util/threading.h>
 #include <util/platform.h>
 #include <util/darray.h>
@@ -57,9 +58,17 @@
 
 /* ------------------------------------------------------------------------- */
 
+/* number of slides before and after the current slide that are kept
+ * loaded, slides outside of this window have their sources released */
+#define PREFETCH_SLIDES 2
+
 struct image_file_data {
 	char *path;
 	obs_source_t *source;
+
+	/* last known size of the image, kept when the source is released */
+	uint32_t cx;
+	uint32_t cy;
 };
 
 enum behavior {
@@ -88,13 +97,22 @@ struct slideshow {
 
 	float elapsed;
 	size_t cur_item;
+	size_t next_random;
 
 	uint32_t cx;
 	uint32_t cy;
 
+	bool use_auto;
+	bool aspect_only;
+	int cx_in;
+	int cy_in;
+
 	pthread_mutex_t mutex;
 	DARRAY(struct image_file_data) files;
 
+	DARRAY(os_file_watch_t*) dir_watches;
+	volatile bool dirs_changed;
+
 	enum behavior behavior;
 
 	obs_hotkey_id play_pause_hotkey;
@@ -104,6 +122,8 @@ struct slideshow {
 	obs_hotkey_id prev_hotkey;
 };
 
+extern os_file_watcher_t *image_file_watcher;
+
 static obs_source_t *get_transition(struct slideshow *ss)
 {
 	obs_source_t *tr;
@@ -116,24 +136,19 @@ static obs_source_t *get_transition(struct slideshow *ss)
 	return tr;
 }
 
-static obs_source_t *get_source(struct darray *array, const char *path)
+static struct image_file_data *find_file(struct darray *array,
+		const char *path)
 {
 	DARRAY(struct image_file_data) files;
-	obs_source_t *source = NULL;
 
 	files.da = *array;
 
 	for (size_t i = 0; i < files.num; i++) {
-		const char *cur_path = files.array[i].path;
-
-		if (strcmp(path, cur_path) == 0) {
-			source = files.array[i].source;
-			obs_source_addref(source);
-			break;
-		}
+		if (strcmp(path, files.array[i].path) == 0)
+			return &files.array[i];
 	}
 
-	return source;
+	return NULL;
 }
 
 static obs_source_t *create_source_from_file(const char *file)
@@ -175,37 +190,138 @@ static const char *ss_getname(void *unused)
 	return obs_module_text("SlideShow");
 }
 
+/* sources are not created here, only the slides near the current slide
+ * are loaded by update_prefetch */
 static void add_file(struct slideshow *ss, struct darray *array,
-		const char *path, uint32_t *cx, uint32_t *cy)
+		const char *path)
 {
 	DARRAY(struct image_file_data) new_files;
-	struct image_file_data data;
-	obs_source_t *new_source;
+	struct image_file_data data = {0};
+	struct image_file_data *existing;
 
 	new_files.da = *array;
 
 	pthread_mutex_lock(&ss->mutex);
-	new_source = get_source(&ss->files.da, path);
+	existing = find_file(&ss->files.da, path);
+	if (existing) {
+		data = *existing;
+		obs_source_addref(data.source);
+	}
+	pthread_mutex_unlock(&ss->mutex);
+
+	data.path = bstrdup(path);
+	da_push_back(new_files, &data);
+
+	*array = new_files.da;
+}
+
+static inline bool in_prefetch_window(struct slideshow *ss, size_t idx)
+{
+	size_t num = ss->files.num;
+	size_t ahead = (idx + num - ss->cur_item) % num;
+	size_t behind = (ss->cur_item + num - idx) % num;
+
+	if (ss->randomize)
+		return idx == ss->cur_item || idx == ss->next_random;
+
+	return ahead <= PREFETCH_SLIDES || behind <= PREFETCH_SLIDES;
+}
+
+static void update_prefetch(struct slideshow *ss)
+{
+	DARRAY(obs_source_t*) old_sources;
+
+	da_init(old_sources);
+
+	pthread_mutex_lock(&ss->mutex);
+
+	for (size_t i = 0; i < ss->files.num; i++) {
+		struct image_file_data *file = &ss->files.array[i];
+		bool keep = in_prefetch_window(ss, i);
+
+		if (keep && !file->source) {
+			file->source = create_source_from_file(file->path);
+
+		} else if (!keep && file->source) {
+			da_push_back(old_sources, &file->source);
+			file->source = NULL;
+		}
+	}
+
 	pthread_mutex_unlock(&ss->mutex);
 
-	if (!new_source)
-		new_source = get_source(&new_files.da, path);
-	if (!new_source)
-		new_source = create_source_from_file(path);
+	for (size_t i = 0; i < old_sources.num; i++)
+		obs_source_release(old_sources.array[i]);
+	da_free(old_sources);
+}
 
-	if (new_source) {
-		uint32_t new_cx = obs_source_get_width(new_source);
-		uint32_t new_cy = obs_source_get_height(new_source);
+static void update_size(struct slideshow *ss, uint32_t cx, uint32_t cy)
+{
+	if (!ss->use_auto) {
+		double cx_f = (double)cx;
+		double cy_f = (double)cy;
 
-		data.path = bstrdup(path);
-		data.source = new_source;
-		da_push_back(new_files, &data);
+		double old_aspect = cx_f / cy_f;
+		double new_aspect = (double)ss->cx_in / (double)ss->cy_in;
 
-		if (new_cx > *cx) *cx = new_cx;
-		if (new_cy > *cy) *cy = new_cy;
+		if (ss->aspect_only) {
+			if (fabs(old_aspect - new_aspect) > EPSILON) {
+				if (new_aspect > old_aspect)
+					cx = (uint32_t)(cy_f * new_aspect);
+				else
+					cy = (uint32_t)(cx_f / new_aspect);
+			}
+		} else {
+			cx = (uint32_t)ss->cx_in;
+			cy = (uint32_t)ss->cy_in;
+		}
 	}
 
-	*array = new_files.da;
+	ss->cx = cx;
+	ss->cy = cy;
+	obs_transition_set_size(ss->transition, cx, cy);
+}
+
+/* image sizes are only known once the images have been decoded, so the
+ * size of the slideshow is updated as slides finish loading */
+static void check_file_sizes(struct slideshow *ss)
+{
+	uint32_t cx = 0;
+	uint32_t cy = 0;
+	bool changed = false;
+
+	for (size_t i = 0; i < ss->files.num; i++) {
+		struct image_file_data *file = &ss->files.array[i];
+
+		if (file->source) {
+			uint32_t new_cx = obs_source_get_width(file->source);
+			uint32_t new_cy = obs_source_get_height(file->source);
+
+			if (new_cx > file->cx || new_cy > file->cy) {
+				if (new_cx > file->cx) file->cx = new_cx;
+				if (new_cy > file->cy) file->cy = new_cy;
+				changed = true;
+			}
+		}
+
+		if (file->cx > cx) cx = file->cx;
+		if (file->cy > cy) cy = file->cy;
+	}
+
+	if (changed)
+		update_size(ss, cx, cy);
+}
+
+static size_t random_next_file(struct slideshow *ss)
+{
+	size_t next = ss->cur_item;
+
+	if (ss->files.num > 1) {
+		while (next == ss->cur_item)
+			next = random_file(ss);
+	}
+
+	return next;
 }
 
 static bool valid_extension(const char *ext)
@@ -230,6 +346,9 @@ static void do_transition(void *data, bool to_null)
 	struct slideshow *ss = data;
 	bool valid = item_valid(ss);
 
+	if (valid)
+		update_prefetch(ss);
+
 	if (valid && ss->use_cut)
 		obs_transition_set(ss->transition,
 				ss->files.array[ss->cur_item].source);
@@ -247,6 +366,123 @@ static void do_transition(void *data, bool to_null)
 				NULL);
 }
 
+static void dir_changed(void *data, const char *path, uint32_t changes)
+{
+	struct slideshow *ss = data;
+
+	/* files being written don't change the file list */
+	if (changes & (OS_FILE_CREATED | OS_FILE_DELETED | OS_FILE_MOVED))
+		os_atomic_set_bool(&ss->dirs_changed, true);
+
+	UNUSED_PARAMETER(path);
+}
+
+static void remove_dir_watches(struct slideshow *ss)
+{
+	for (size_t i = 0; i < ss->dir_watches.num; i++)
+		os_file_watcher_remove(image_file_watcher,
+				ss->dir_watches.array[i]);
+	da_resize(ss->dir_watches, 0);
+}
+
+/* builds the list of files from the files setting, and if add_watches is
+ * set, watches its directories for added or removed files */
+static void build_file_list(struct slideshow *ss, obs_data_array_t *array,
+		struct darray *new_files, bool add_watches)
+{
+	size_t count = obs_data_array_count(array);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		const char *path = obs_data_get_string(item, "value");
+		os_dir_t *dir = os_opendir(path);
+
+		if (dir) {
+			struct dstr dir_path = {0};
+			struct os_dirent *ent;
+
+			if (add_watches) {
+				os_file_watch_t *watch = os_file_watcher_add(
+						image_file_watcher, path,
+						dir_changed, ss);
+				if (watch)
+					da_push_back(ss->dir_watches, &watch);
+			}
+
+			for (;;) {
+				const char *ext;
+
+				ent = os_readdir(dir);
+				if (!ent)
+					break;
+				if (ent->directory)
+					continue;
+
+				ext = os_get_path_extension(ent->d_name);
+				if (!valid_extension(ext))
+					continue;
+
+				dstr_copy(&dir_path, path);
+				dstr_cat_ch(&dir_path, '/');
+				dstr_cat(&dir_path, ent->d_name);
+				add_file(ss, new_files, dir_path.array);
+			}
+
+			dstr_free(&dir_path);
+			os_closedir(dir);
+		} else {
+			add_file(ss, new_files, path);
+		}
+
+		obs_data_release(item);
+	}
+}
+
+/* rebuilds the file list when files are added to or removed from the
+ * directories of the slideshow, staying on the current slide if possible */
+static void rescan_dirs(struct slideshow *ss)
+{
+	DARRAY(struct image_file_data) new_files;
+	DARRAY(struct image_file_data) old_files;
+	obs_data_t *settings = obs_source_get_settings(ss->source);
+	obs_data_array_t *array = obs_data_get_array(settings, S_FILES);
+	char *cur_path = NULL;
+	size_t old_count = ss->files.num;
+
+	da_init(new_files);
+	build_file_list(ss, array, &new_files.da, false);
+
+	if (item_valid(ss))
+		cur_path = bstrdup(ss->files.array[ss->cur_item].path);
+
+	pthread_mutex_lock(&ss->mutex);
+	old_files.da = ss->files.da;
+	ss->files.da = new_files.da;
+	pthread_mutex_unlock(&ss->mutex);
+
+	free_files(&old_files.da);
+
+	ss->cur_item = 0;
+	for (size_t i = 0; cur_path && i < ss->files.num; i++) {
+		if (strcmp(ss->files.array[i].path, cur_path) == 0) {
+			ss->cur_item = i;
+			break;
+		}
+	}
+
+	if (ss->randomize && ss->files.num)
+		ss->next_random = random_next_file(ss);
+
+	if (ss->files.num)
+		update_prefetch(ss);
+	if (!old_count && ss->files.num)
+		do_transition(ss, false);
+
+	bfree(cur_path);
+	obs_data_array_release(array);
+	obs_data_release(settings);
+}
+
 static void ss_update(void *data, obs_data_t *settings)
 {
 	DARRAY(struct image_file_data) new_files;
@@ -260,7 +496,6 @@ static void ss_update(void *data, obs_data_t *settings)
 	uint32_t new_speed;
 	uint32_t cx = 0;
 	uint32_t cy = 0;
-	size_t count;
 	const char *behavior;
 	const char *mode;
 
@@ -303,48 +538,13 @@ static void ss_update(void *data, obs_data_t *settings)
 	new_speed = (uint32_t)obs_data_get_int(settings, S_TR_SPEED);
 
 	array = obs_data_get_array(settings, S_FILES);
-	count = obs_data_array_count(array);
 
 	/* ------------------------------------- */
-	/* create new list of sources */
+	/* create new list of files */
 
-	for (size_t i = 0; i < count; i++) {
-		obs_data_t *item = obs_data_array_item(array, i);
-		const char *path = obs_data_get_string(item, "value");
-		os_dir_t *dir = os_opendir(path);
-
-		if (dir) {
-			struct dstr dir_path = {0};
-			struct os_dirent *ent;
-
-			for (;;) {
-				const char *ext;
-
-				ent = os_readdir(dir);
-				if (!ent)
-					break;
-				if (ent->directory)
-					continue;
-
-				ext = os_get_path_extension(ent->d_name);
-				if (!valid_extension(ext))
-					continue;
-
-				dstr_copy(&dir_path, path);
-				dstr_cat_ch(&dir_path, '/');
-				dstr_cat(&dir_path, ent->d_name);
-				add_file(ss, &new_files.da, dir_path.array,
-						&cx, &cy);
-			}
-
-			dstr_free(&dir_path);
-			os_closedir(dir);
-		} else {
-			add_file(ss, &new_files.da, path, &cx, &cy);
-		}
-
-		obs_data_release(item);
-	}
+	remove_dir_watches(ss);
+	os_atomic_set_bool(&ss->dirs_changed, false);
+	build_file_list(ss, array, &new_files.da, true);
 
 	/* ------------------------------------- */
 	/* update settings data */
@@ -396,39 +596,30 @@ static void ss_update(void *data, obs_data_t *settings)
 		}
 	}
 
-	if (!use_auto) {
-		double cx_f = (double)cx;
-		double cy_f = (double)cy;
+	ss->use_auto = use_auto;
+	ss->aspect_only = aspect_only;
+	ss->cx_in = cx_in;
+	ss->cy_in = cy_in;
 
-		double old_aspect = cx_f / cy_f;
-		double new_aspect = (double)cx_in / (double)cy_in;
-
-		if (aspect_only) {
-			if (fabs(old_aspect - new_aspect) > EPSILON) {
-				if (new_aspect > old_aspect)
-					cx = (uint32_t)(cy_f * new_aspect);
-				else
-					cy = (uint32_t)(cx_f / new_aspect);
-			}
-		} else {
-			cx = (uint32_t)cx_in;
-			cy = (uint32_t)cy_in;
-		}
+	for (size_t i = 0; i < ss->files.num; i++) {
+		struct image_file_data *file = &ss->files.array[i];
+		if (file->cx > cx) cx = file->cx;
+		if (file->cy > cy) cy = file->cy;
 	}
 
 	/* ------------------------- */
 
-	ss->cx = cx;
-	ss->cy = cy;
 	ss->cur_item = 0;
 	ss->elapsed = 0.0f;
-	obs_transition_set_size(ss->transition, cx, cy);
+	update_size(ss, cx, cy);
 	obs_transition_set_alignment(ss->transition, OBS_ALIGN_CENTER);
 	obs_transition_set_scale_type(ss->transition,
 			OBS_TRANSITION_SCALE_ASPECT);
 
-	if (ss->randomize && ss->files.num)
+	if (ss->randomize && ss->files.num) {
 		ss->cur_item = random_file(ss);
+		ss->next_random = random_next_file(ss);
+	}
 	if (new_tr)
 		obs_source_add_active_child(ss->source, new_tr);
 	if (ss->files.num)
@@ -452,6 +643,10 @@ static void ss_restart(void *data)
 	ss->elapsed = 0.0f;
 	ss->cur_item = 0;
 
+	if (!ss->files.num)
+		return;
+
+	update_prefetch(ss);
 	obs_transition_set(ss->transition,
 			ss->files.array[ss->cur_item].source);
 
@@ -569,6 +764,9 @@ static void ss_destroy(void *data)
 {
 	struct slideshow *ss = data;
 
+	remove_dir_watches(ss);
+	da_free(ss->dir_watches);
+
 	obs_source_release(ss->transition);
 	free_files(&ss->files.da);
 	pthread_mutex_destroy(&ss->mutex);
@@ -644,6 +842,11 @@ static void ss_video_tick(void *data, float seconds)
 	if (!ss->transition || !ss->slide_time)
 		return;
 
+	if (os_atomic_set_bool(&ss->dirs_changed, false))
+		rescan_dirs(ss);
+
+	check_file_sizes(ss);
+
 	if (ss->restart_on_activate && !ss->randomize && ss->use_cut) {
 		ss->elapsed = 0.0f;
 		ss->cur_item = 0;
@@ -686,12 +889,8 @@ static void ss_video_tick(void *data, float seconds)
 		}
 
 		if (ss->randomize) {
-			size_t next = ss->cur_item;
-			if (ss->files.num > 1) {
-				while (next == ss->cur_item)
-					next = random_file(ss);
-			}
-			ss->cur_item = next;
+			ss->cur_item = ss->next_random;
+			ss->next_random = random_next_file(ss);
 
 		} else if (++ss->cur_item >= ss->files.num) {
 			ss->cur_item = 0;
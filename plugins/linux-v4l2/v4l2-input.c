@@ -63,6 +63,37 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+struct v4l2_mapping;
+
+/**
+ * A dequeued buffer that was handed to obs without copying
+ */
+struct v4l2_frame_ref {
+	struct v4l2_mapping *map;
+	struct v4l2_buffer buf;
+};
+
+/**
+ * Mapped buffers of one capture session
+ *
+ * Every buffer obs holds keeps a reference to the mapping, so it is only
+ * unmapped once obs released the last of them, which can be after the
+ * capture was stopped and the device closed.
+ */
+struct v4l2_mapping {
+	volatile long refs;
+
+	/* buffers are only requeued while capturing, the device handle is
+	 * closed once that stopped */
+	pthread_mutex_t mutex;
+	int_fast32_t dev;
+	bool capturing;
+
+	struct v4l2_buffer_data buffers;
+	struct v4l2_frame_ref *frame_refs;
+	volatile long held_buffers;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -85,7 +116,7 @@ struct v4l2_data {
 	int width;
 	int height;
 	int linesize;
-	struct v4l2_buffer_data buffers;
+	struct v4l2_mapping *map;
 };
 
 /* forward declarations */
@@ -142,12 +173,96 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+static void v4l2_mapping_release(struct v4l2_mapping *map)
+{
+	if (!map || os_atomic_dec_long(&map->refs) != 0)
+		return;
+
+	v4l2_destroy_mmap(&map->buffers);
+	pthread_mutex_destroy(&map->mutex);
+	bfree(map->frame_refs);
+	bfree(map);
+}
+
+/**
+ * Map the buffers of the device
+ *
+ * @return the mapping with one reference held by the caller, or NULL
+ */
+static struct v4l2_mapping *v4l2_mapping_create(int_fast32_t dev)
+{
+	struct v4l2_mapping *map = bzalloc(sizeof(struct v4l2_mapping));
+
+	if (pthread_mutex_init(&map->mutex, NULL) != 0) {
+		bfree(map);
+		return NULL;
+	}
+
+	map->refs = 1;
+	map->dev = dev;
+
+	if (v4l2_create_mmap(dev, &map->buffers) < 0) {
+		v4l2_mapping_release(map);
+		return NULL;
+	}
+
+	map->frame_refs = bzalloc(map->buffers.count *
+			sizeof(struct v4l2_frame_ref));
+	for (uint_fast32_t i = 0; i < map->buffers.count; ++i)
+		map->frame_refs[i].map = map;
+
+	return map;
+}
+
+static void v4l2_mapping_set_capturing(struct v4l2_mapping *map,
+		bool capturing)
+{
+	pthread_mutex_lock(&map->mutex);
+	map->capturing = capturing;
+	pthread_mutex_unlock(&map->mutex);
+}
+
+/**
+ * Requeue a buffer once obs is done with it
+ *
+ * This may be called from any thread. After the capture was stopped the
+ * buffer is only returned, and the last buffer returned unmaps them all.
+ */
+static void v4l2_release_buffer(void *vptr)
+{
+	struct v4l2_frame_ref *ref = vptr;
+	struct v4l2_mapping *map = ref->map;
+
+	pthread_mutex_lock(&map->mutex);
+	if (map->capturing &&
+	    v4l2_ioctl(map->dev, VIDIOC_QBUF, &ref->buf) < 0)
+		blog(LOG_DEBUG, "failed to enqueue buffer");
+	pthread_mutex_unlock(&map->mutex);
+
+	os_atomic_dec_long(&map->held_buffers);
+	v4l2_mapping_release(map);
+}
+
+/**
+ * Check if a dequeued buffer can be handed to obs without copying
+ *
+ * At least one buffer is always left with the driver, if obs holds on to
+ * more frames than that (for example while the source isn't shown) the data
+ * is copied and the buffer requeued right away.
+ */
+static inline bool v4l2_can_hold_buffer(struct v4l2_mapping *map)
+{
+	return os_atomic_load_long(&map->held_buffers) + 1 <
+		(long)map->buffers.count;
+}
+
 /*
  * Worker thread to get video data
  */
 static void *v4l2_thread(void *vptr)
 {
 	V4L2_DATA(vptr);
+	struct v4l2_mapping *map = data->map;
 	int r;
 	fd_set fds;
 	uint8_t *start;
@@ -158,8 +273,9 @@ static void *v4l2_thread(void *vptr)
 	struct obs_source_frame out;
 	size_t plane_offsets[MAX_AV_PLANES];
 
-	if (v4l2_start_capture(data->dev, &data->buffers) < 0)
+	if (v4l2_start_capture(data->dev, &map->buffers) < 0)
 		goto exit;
+	v4l2_mapping_set_capturing(map, true);
 
 	frames   = 0;
 	first_ts = 0;
@@ -197,9 +313,23 @@ static void *v4l2_thread(void *vptr)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
-		start = (uint8_t *) data->buffers.info[buf.index].start;
+		start = (uint8_t *) map->buffers.info[buf.index].start;
 		for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 			out.data[i] = start + plane_offsets[i];
+
+		if (v4l2_can_hold_buffer(map)) {
+			struct v4l2_frame_ref *ref =
+				&map->frame_refs[buf.index];
+
+			ref->buf = buf;
+			os_atomic_inc_long(&map->refs);
+			os_atomic_inc_long(&map->held_buffers);
+			obs_source_output_video_nocopy(data->source, &out,
+					v4l2_release_buffer, ref);
+			frames++;
+			continue;
+		}
+
 		obs_source_output_video(data->source, &out);
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
@@ -213,6 +343,7 @@ static void *v4l2_thread(void *vptr)
 	blog(LOG_INFO, "Stopped capture after %"PRIu64" frames", frames);
 
 exit:
+	v4l2_mapping_set_capturing(map, false);
 	v4l2_stop_capture(data->dev);
 	return NULL;
 }
@@ -784,7 +915,10 @@ static void v4l2_terminate(struct v4l2_data *data)
 		data->thread = 0;
 	}
 
-	v4l2_destroy_mmap(&data->buffers);
+	/* buffers obs still holds stay mapped until it releases them, so the
+	 * last frame stays up while the source restarts */
+	v4l2_mapping_release(data->map);
+	data->map = NULL;
 
 	if (data->dev != -1) {
 		v4l2_close(data->dev);
@@ -892,7 +1026,8 @@ static void v4l2_init(struct v4l2_data *data)
 	blog(LOG_INFO, "Framerate: %.2f fps", (float) fps_denom / fps_num);
 
 	/* map buffers */
-	if (v4l2_create_mmap(data->dev, &data->buffers) < 0) {
+	data->map = v4l2_mapping_create(data->dev);
+	if (!data->map) {
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
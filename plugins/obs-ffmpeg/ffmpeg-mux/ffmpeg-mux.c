@@ -20,6 +20,11 @@
 #include <windows.h>
 #define inline __inline
 
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <stdbool.h>
@@ -81,6 +86,7 @@ struct main_params {
 	int fps_den;
 	char *acodec;
 	char *muxer_settings;
+	char *shm_name;
 };
 
 struct audio_params {
@@ -97,6 +103,7 @@ struct header {
 
 struct ffmpeg_mux {
 	AVFormatContext        *output;
+	char                   *file_from_pipe;
 	AVStream               *video_stream;
 	AVStream               **audio_streams;
 	struct main_params     params;
@@ -106,6 +113,14 @@ struct ffmpeg_mux {
 	int                    num_audio_streams;
 	bool                   initialized;
 	char error[4096];
+
+	struct ffm_shm_header  *shm;
+	size_t                 shm_map_size;
+	uint64_t               shm_read_pos;
+	bool                   shm_eof;
+#ifdef _WIN32
+	HANDLE                 shm_handle;
+#endif
 };
 
 static void header_free(struct header *header)
@@ -154,6 +169,20 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 		free(ffm->audio);
 	}
 
+	free(ffm->file_from_pipe);
+
+	if (ffm->shm) {
+#ifdef _WIN32
+		UnmapViewOfFile(ffm->shm);
+#else
+		munmap(ffm->shm, ffm->shm_map_size);
+#endif
+	}
+#ifdef _WIN32
+	if (ffm->shm_handle)
+		CloseHandle(ffm->shm_handle);
+#endif
+
 	memset(ffm, 0, sizeof(*ffm));
 }
 
@@ -258,6 +287,9 @@ static bool init_params(int *argc, char ***argv, struct main_params *params,
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+	if (*argc)
+		get_opt_str(argc, argv, &params->shm_name, "shared memory name");
+
 	return true;
 }
 
@@ -401,11 +433,111 @@ static void ffmpeg_mux_header(struct ffmpeg_mux *ffm, uint8_t *data,
 	}
 }
 
-static size_t safe_read(void *vdata, size_t size)
+static bool ffmpeg_mux_open_shm(struct ffmpeg_mux *ffm)
+{
+	const char *name = ffm->params.shm_name;
+
+#ifdef _WIN32
+	ffm->shm_handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, false, name);
+	if (!ffm->shm_handle) {
+		printf("Couldn't open shared memory '%s'\n", name);
+		return false;
+	}
+
+	ffm->shm = MapViewOfFile(ffm->shm_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+#else
+	struct stat st;
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd == -1) {
+		printf("Couldn't open shared memory '%s'\n", name);
+		return false;
+	}
+
+	/* the name is no longer needed once both sides have it open */
+	shm_unlink(name);
+
+	if (fstat(fd, &st) == 0) {
+		void *data = mmap(NULL, (size_t)st.st_size,
+				PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (data != MAP_FAILED) {
+			ffm->shm = data;
+			ffm->shm_map_size = (size_t)st.st_size;
+		}
+	}
+
+	close(fd);
+#endif
+
+	if (!ffm->shm || ffm->shm->magic != FFM_SHM_MAGIC) {
+		printf("Invalid shared memory '%s'\n", name);
+		return false;
+	}
+
+	ffm->shm_read_pos = ffm_atomic_load(&ffm->shm->read_pos);
+	return true;
+}
+
+/* blocks until the writer rings the doorbell, returns false once stdin has
+ * been closed */
+static bool shm_wait(struct ffmpeg_mux *ffm)
+{
+	struct ffm_shm_header *shm = ffm->shm;
+	uint8_t doorbell;
+
+	if (ffm->shm_eof)
+		return false;
+
+	ffm_atomic_exchange_long(&shm->waiting, 1);
+
+	if (ffm_atomic_load(&shm->write_pos) == ffm->shm_read_pos) {
+		if (fread(&doorbell, 1, 1, stdin) != 1)
+			ffm->shm_eof = true;
+	}
+
+	ffm_atomic_exchange_long(&shm->waiting, 0);
+	return true;
+}
+
+static size_t shm_read(struct ffmpeg_mux *ffm, uint8_t *data, size_t size)
+{
+	struct ffm_shm_header *shm = ffm->shm;
+	size_t total = size;
+
+	while (size > 0) {
+		uint64_t avail = ffm_atomic_load(&shm->write_pos) -
+			ffm->shm_read_pos;
+		size_t chunk;
+
+		if (!avail) {
+			/* hand the space back before waiting, the writer may
+			 * be waiting for it */
+			ffm_atomic_store(&shm->read_pos, ffm->shm_read_pos);
+
+			if (!shm_wait(ffm))
+				return 0;
+			continue;
+		}
+
+		chunk = avail < (uint64_t)size ? (size_t)avail : size;
+		ffm_shm_copy_out(shm, ffm->shm_read_pos, data, chunk);
+
+		ffm->shm_read_pos += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+
+	ffm_atomic_store(&shm->read_pos, ffm->shm_read_pos);
+	return total;
+}
+
+static size_t safe_read(struct ffmpeg_mux *ffm, void *vdata, size_t size)
 {
 	uint8_t *data = vdata;
 	size_t  total = size;
 
+	if (ffm->shm)
+		return shm_read(ffm, data, size);
+
 	while (size > 0) {
 		size_t in_size = fread(data, 1, size, stdin);
 		if (in_size == 0)
@@ -422,11 +554,11 @@ static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
 
-	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
+	bool success = safe_read(ffm, &info, sizeof(info)) == sizeof(info);
 	if (success) {
 		uint8_t *data = malloc(info.size);
 
-		if (safe_read(data, info.size) == info.size) {
+		if (safe_read(ffm, data, info.size) == info.size) {
 			ffmpeg_mux_header(ffm, data, &info);
 		} else {
 			success = false;
@@ -438,6 +570,31 @@ static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 	return success;
 }
 
+static bool ffmpeg_mux_get_file(struct ffmpeg_mux *ffm)
+{
+	struct ffm_packet_info info = {0};
+
+	if (safe_read(ffm, &info, sizeof(info)) != sizeof(info))
+		return false;
+	if (info.type != FFM_PACKET_FILE) {
+		puts("Expected file name packet");
+		return false;
+	}
+
+	ffm->file_from_pipe = malloc((size_t)info.size + 1);
+	if (!ffm->file_from_pipe) {
+		puts("Couldn't allocate file name");
+		return false;
+	}
+
+	if (safe_read(ffm, ffm->file_from_pipe, info.size) != info.size)
+		return false;
+
+	ffm->file_from_pipe[info.size] = 0;
+	ffm->params.file = ffm->file_from_pipe;
+	return true;
+}
+
 static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
 {
 	if (ffm->params.has_video) {
@@ -565,6 +722,14 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 
 	av_register_all();
 
+	if (ffm->params.shm_name && !ffmpeg_mux_open_shm(ffm))
+		return FFM_ERROR;
+
+	if (strcmp(ffm->params.file, FFM_FILE_FROM_PIPE) == 0) {
+		if (!ffmpeg_mux_get_file(ffm))
+			return FFM_ERROR;
+	}
+
 	if (!ffmpeg_mux_get_extra_data(ffm))
 		return FFM_ERROR;
 
@@ -682,10 +847,10 @@ int main(int argc, char *argv[])
 		return ret;
 	}
 
-	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
+	while (!fail && safe_read(&ffm, &info, sizeof(info)) == sizeof(info)) {
 		resize_buf_resize(&rb, info.size);
 
-		if (safe_read(rb.buf, info.size) == info.size) {
+		if (safe_read(&ffm, rb.buf, info.size) == info.size) {
 			ffmpeg_mux_packet(&ffm, rb.buf, &info);
 		} else {
 			fail = true;
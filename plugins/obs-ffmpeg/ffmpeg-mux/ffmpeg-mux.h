@@ -17,12 +17,23 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 enum ffm_packet_type {
 	FFM_PACKET_VIDEO,
-	FFM_PACKET_AUDIO
+	FFM_PACKET_AUDIO,
+	FFM_PACKET_FILE
 };
 
+/* when used as the file name, the muxer is started ahead of time and waits
+ * for a FFM_PACKET_FILE packet containing the UTF-8 path of the file before
+ * the headers */
+#define FFM_FILE_FROM_PIPE "--file-from-pipe"
+
 #define FFM_SUCCESS      0
 #define FFM_ERROR       -1
 #define FFM_UNSUPPORTED -2
@@ -35,3 +46,95 @@ struct ffm_packet_info {
 	enum ffm_packet_type type;
 	bool                 keyframe;
 };
+
+/* ------------------------------------------------------------------------- */
+/* shared memory transport */
+
+/*
+ * When a shared memory name is given after the muxer settings, the stream
+ * normally written to stdin is written to a ring buffer in shared memory
+ * instead.  stdin is then only used as a doorbell: the muxer sets 'waiting'
+ * before blocking on a read of stdin, and the writer sends a byte if it sees
+ * it set after making data available.  Closing stdin still ends the file.
+ */
+
+#define FFM_SHM_MAGIC       0x4d4d4646
+#define FFM_SHM_HEADER_SIZE 64
+#define FFM_SHM_SIZE        (32 * 1024 * 1024)
+
+struct ffm_shm_header {
+	uint32_t          magic;
+	uint32_t          header_size;
+	uint64_t          size;
+	volatile uint64_t write_pos;
+	volatile uint64_t read_pos;
+	volatile long     waiting;
+};
+
+#ifdef _MSC_VER
+static inline uint64_t ffm_atomic_load(volatile uint64_t *ptr)
+{
+	return (uint64_t)_InterlockedCompareExchange64(
+			(volatile __int64*)ptr, 0, 0);
+}
+
+static inline void ffm_atomic_store(volatile uint64_t *ptr, uint64_t val)
+{
+	__int64 old;
+	do {
+		old = *(volatile __int64*)ptr;
+	} while (_InterlockedCompareExchange64((volatile __int64*)ptr,
+				(__int64)val, old) != old);
+}
+
+static inline long ffm_atomic_exchange_long(volatile long *ptr, long val)
+{
+	return _InterlockedExchange(ptr, val);
+}
+#else
+static inline uint64_t ffm_atomic_load(volatile uint64_t *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void ffm_atomic_store(volatile uint64_t *ptr, uint64_t val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline long ffm_atomic_exchange_long(volatile long *ptr, long val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+#endif
+
+static inline uint8_t *ffm_shm_ring(struct ffm_shm_header *shm)
+{
+	return (uint8_t*)shm + shm->header_size;
+}
+
+static inline void ffm_shm_copy_in(struct ffm_shm_header *shm, uint64_t pos,
+		const uint8_t *data, size_t size)
+{
+	size_t offset = (size_t)(pos % shm->size);
+	size_t first = (size_t)shm->size - offset;
+
+	if (first > size)
+		first = size;
+
+	memcpy(ffm_shm_ring(shm) + offset, data, first);
+	memcpy(ffm_shm_ring(shm), data + first, size - first);
+}
+
+static inline void ffm_shm_copy_out(struct ffm_shm_header *shm, uint64_t pos,
+		uint8_t *data, size_t size)
+{
+	size_t offset = (size_t)(pos % shm->size);
+	size_t first = (size_t)shm->size - offset;
+
+	if (first > size)
+		first = size;
+
+	memcpy(data, ffm_shm_ring(shm) + offset, first);
+	memcpy(data + first, ffm_shm_ring(shm), size - first);
+}
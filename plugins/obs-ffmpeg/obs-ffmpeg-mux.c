@@ -25,9 +25,19 @@
 #include <util/circlebuf.h>
 #include <util/threading.h>
 #include "ffmpeg-mux/ffmpeg-mux.h"
+#include "replay-disk.h"
 
 #include <libavformat/avformat.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define do_log(level, format, ...) \
 	blog(level, "[ffmpeg muxer: '%s'] " format, \
 			obs_output_get_name(stream->output), ##__VA_ARGS__)
@@ -46,6 +56,19 @@ struct ffmpeg_muxer {
 	volatile bool     stopping;
 	volatile bool     capturing;
 
+	/* shared memory transport */
+	struct ffm_shm_header *shm;
+	struct dstr       shm_name;
+	uint64_t          shm_write_pos;
+	uint64_t          shm_peak;
+	uint64_t          shm_stalls;
+	uint64_t          shm_stall_ns;
+	uint64_t          shm_doorbells;
+	volatile long     shm_used;
+#ifdef _WIN32
+	HANDLE            shm_handle;
+#endif
+
 	/* replay buffer */
 	struct circlebuf  packets;
 	int64_t           cur_size;
@@ -53,13 +76,25 @@ struct ffmpeg_muxer {
 	int64_t           max_size;
 	int64_t           max_time;
 	int64_t           save_ts;
+	int64_t           save_duration;
 	int               keyframes;
 	obs_hotkey_id     hotkey;
-
-	DARRAY(struct encoder_packet) mux_packets;
-	pthread_t                     mux_thread;
-	bool                          mux_thread_joinable;
-	volatile bool                 muxing;
+	struct dstr       mux_cmd;
+
+	/* disk-backed replay buffer */
+	struct replay_disk *disk;
+
+	/* replays are saved in order on the save thread, which keeps a muxer
+	 * helper process started ahead of the next save */
+	DARRAY(struct replay_job*)    save_jobs;
+	pthread_mutex_t               save_mutex;
+	os_sem_t                      *save_sem;
+	pthread_t                     save_thread;
+	bool                          save_thread_active;
+	volatile bool                 save_thread_exit;
+	struct dstr                   helper_cmd;
+	DARRAY(uint8_t)               save_batch;
+	struct dstr                   last_replay;
 };
 
 static const char *ffmpeg_mux_getname(void *type)
@@ -77,6 +112,8 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	}
 
 	circlebuf_free(&stream->packets);
+	replay_disk_release(stream->disk);
+	stream->disk = NULL;
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -85,16 +122,38 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	stream->keyframes = 0;
 }
 
+#define SHM_MAP_SIZE (FFM_SHM_HEADER_SIZE + FFM_SHM_SIZE)
+
+static void destroy_shm(struct ffmpeg_muxer *stream)
+{
+#ifdef _WIN32
+	if (stream->shm)
+		UnmapViewOfFile(stream->shm);
+	if (stream->shm_handle)
+		CloseHandle(stream->shm_handle);
+	stream->shm_handle = NULL;
+#else
+	if (stream->shm)
+		munmap(stream->shm, SHM_MAP_SIZE);
+
+	/* normally already unlinked by the muxer once it opened it */
+	if (stream->shm_name.array)
+		shm_unlink(stream->shm_name.array);
+#endif
+
+	stream->shm = NULL;
+	dstr_free(&stream->shm_name);
+	os_atomic_set_long(&stream->shm_used, 0);
+}
+
 static void ffmpeg_mux_destroy(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
 
 	replay_buffer_clear(stream);
-	if (stream->mux_thread_joinable)
-		pthread_join(stream->mux_thread, NULL);
-	da_free(stream->mux_packets);
 
 	os_process_pipe_destroy(stream->pipe);
+	destroy_shm(stream);
 	dstr_free(&stream->path);
 	bfree(stream);
 }
@@ -259,6 +318,79 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 	}
 
 	add_muxer_params(cmd, stream);
+
+	if (stream->shm)
+		dstr_catf(cmd, "\"%s\" ", stream->shm_name.array);
+}
+
+static volatile long shm_count = 0;
+
+/* while the ring buffer is full, the muxer is checked for having exited this
+ * often, and the stall is logged this often */
+#define SHM_PROBE_INTERVAL_NS 1000000000ULL
+#define SHM_WARN_INTERVAL_NS  5000000000ULL
+
+/* creates the ring buffer the packets are sent through instead of the pipe,
+ * the pipe is used as is if it can't be created */
+static bool create_shm(struct ffmpeg_muxer *stream)
+{
+	long id = os_atomic_inc_long(&shm_count);
+	void *data = NULL;
+
+#ifdef _WIN32
+	dstr_printf(&stream->shm_name, "Local\\obs-ffmpeg-mux-%lu-%ld",
+			GetCurrentProcessId(), id);
+
+	stream->shm_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+			PAGE_READWRITE, 0, SHM_MAP_SIZE,
+			stream->shm_name.array);
+	if (stream->shm_handle)
+		data = MapViewOfFile(stream->shm_handle, FILE_MAP_ALL_ACCESS,
+				0, 0, SHM_MAP_SIZE);
+#else
+	int fd;
+
+	dstr_printf(&stream->shm_name, "/obsmux-%ld-%ld", (long)getpid(), id);
+
+	fd = shm_open(stream->shm_name.array, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd != -1) {
+		if (ftruncate(fd, SHM_MAP_SIZE) == 0) {
+			data = mmap(NULL, SHM_MAP_SIZE, PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0);
+			if (data == MAP_FAILED)
+				data = NULL;
+		}
+
+		close(fd);
+	}
+#endif
+
+	if (!data) {
+		warn("Failed to create shared memory, using the pipe instead");
+		destroy_shm(stream);
+		return false;
+	}
+
+	stream->shm = data;
+	stream->shm->magic = FFM_SHM_MAGIC;
+	stream->shm->header_size = FFM_SHM_HEADER_SIZE;
+	stream->shm->size = FFM_SHM_SIZE;
+	stream->shm_write_pos = 0;
+	stream->shm_peak = 0;
+	stream->shm_stalls = 0;
+	stream->shm_stall_ns = 0;
+	stream->shm_doorbells = 0;
+	return true;
+}
+
+static void log_shm_stats(struct ffmpeg_muxer *stream)
+{
+	info("Shared memory transport: peak usage %d%%, %llu stalls "
+	     "(%llu ms), %llu wakeups",
+			(int)(stream->shm_peak * 100 / FFM_SHM_SIZE),
+			(unsigned long long)stream->shm_stalls,
+			(unsigned long long)(stream->shm_stall_ns / 1000000),
+			(unsigned long long)stream->shm_doorbells);
 }
 
 static inline void start_pipe(struct ffmpeg_muxer *stream, const char *path)
@@ -301,10 +433,12 @@ static bool ffmpeg_mux_start(void *data)
 	fclose(test_file);
 	os_unlink(path);
 
+	create_shm(stream);
 	start_pipe(stream, path);
 	obs_data_release(settings);
 
 	if (!stream->pipe) {
+		destroy_shm(stream);
 		obs_output_set_last_error(stream->output,
 			obs_module_text("HelperProcessFailed"));
 		warn("Failed to create process pipe");
@@ -329,6 +463,11 @@ static int deactivate(struct ffmpeg_muxer *stream)
 		ret = os_process_pipe_destroy(stream->pipe);
 		stream->pipe = NULL;
 
+		if (stream->shm) {
+			log_shm_stats(stream);
+			destroy_shm(stream);
+		}
+
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
 
@@ -367,20 +506,149 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->capturing, false);
 }
 
-static bool write_packet(struct ffmpeg_muxer *stream,
+static inline void get_packet_info(struct ffm_packet_info *info,
 		struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
+
+	info->pts = packet->pts;
+	info->dts = packet->dts;
+	info->size = (uint32_t)packet->size;
+	info->index = (int)packet->track_idx;
+	info->type = is_video ? FFM_PACKET_VIDEO : FFM_PACKET_AUDIO;
+	info->keyframe = packet->keyframe;
+}
+
+/* makes the written data available to the muxer, and wakes it up if it's
+ * waiting for data */
+static bool shm_publish(struct ffmpeg_muxer *stream)
+{
+	struct ffm_shm_header *shm = stream->shm;
+	uint64_t used;
+
+	ffm_atomic_store(&shm->write_pos, stream->shm_write_pos);
+
+	used = stream->shm_write_pos - ffm_atomic_load(&shm->read_pos);
+	if (used > stream->shm_peak)
+		stream->shm_peak = used;
+	os_atomic_set_long(&stream->shm_used, (long)used);
+
+	if (ffm_atomic_exchange_long(&shm->waiting, 0)) {
+		uint8_t doorbell = 0;
+
+		stream->shm_doorbells++;
+
+		if (os_process_pipe_write(stream->pipe, &doorbell, 1) != 1 ||
+		    !os_process_pipe_flush(stream->pipe)) {
+			warn("Failed to wake up the muxer");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* an extra doorbell is harmless to the muxer, but writing it fails once the
+ * muxer has exited */
+static bool shm_probe(struct ffmpeg_muxer *stream)
+{
+	uint8_t doorbell = 0;
+
+	if (os_process_pipe_write(stream->pipe, &doorbell, 1) != 1 ||
+	    !os_process_pipe_flush(stream->pipe)) {
+		warn("The muxer exited while the shared memory was full");
+		return false;
+	}
+
+	return true;
+}
+
+static bool shm_write(struct ffmpeg_muxer *stream, const uint8_t *data,
+		size_t size)
+{
+	struct ffm_shm_header *shm = stream->shm;
+	uint64_t wait_start = 0;
+	uint64_t last_probe = 0;
+	uint64_t last_warn = 0;
+
+	while (size > 0) {
+		uint64_t used = stream->shm_write_pos -
+			ffm_atomic_load(&shm->read_pos);
+		uint64_t space = FFM_SHM_SIZE - used;
+		size_t chunk;
+
+		if (!space) {
+			/* the muxer is behind, hand it what has been written
+			 * so far and wait for it to make room.  like the pipe,
+			 * this keeps waiting through slow disks, and only
+			 * stops if the muxer is gone */
+			uint64_t now = os_gettime_ns();
+
+			if (!wait_start) {
+				wait_start = last_probe = last_warn = now;
+				stream->shm_stalls++;
+
+				if (!shm_publish(stream))
+					return false;
+
+			} else if (now - last_probe >= SHM_PROBE_INTERVAL_NS) {
+				last_probe = now;
+				if (!shm_probe(stream))
+					return false;
+			}
+
+			if (now - last_warn >= SHM_WARN_INTERVAL_NS) {
+				last_warn = now;
+				warn("The muxer has not read any data for "
+				     "%d seconds",
+				     (int)((now - wait_start) / 1000000000ULL));
+			}
+
+			os_sleep_ms(1);
+			continue;
+		}
+
+		if (wait_start) {
+			stream->shm_stall_ns += os_gettime_ns() - wait_start;
+			wait_start = 0;
+		}
+
+		chunk = space < (uint64_t)size ? (size_t)space : size;
+		ffm_shm_copy_in(shm, stream->shm_write_pos, data, chunk);
+
+		stream->shm_write_pos += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+
+	return true;
+}
+
+static bool shm_write_packet(struct ffmpeg_muxer *stream,
+		struct ffm_packet_info *info, const uint8_t *data)
+{
+	return shm_write(stream, (const uint8_t*)info, sizeof(*info)) &&
+	       shm_write(stream, data, info->size) &&
+	       shm_publish(stream);
+}
+
+static bool write_packet(struct ffmpeg_muxer *stream,
+		struct encoder_packet *packet)
+{
+	struct ffm_packet_info info = {0};
 	size_t ret;
 
-	struct ffm_packet_info info = {
-		.pts = packet->pts,
-		.dts = packet->dts,
-		.size = (uint32_t)packet->size,
-		.index = (int)packet->track_idx,
-		.type = is_video ? FFM_PACKET_VIDEO : FFM_PACKET_AUDIO,
-		.keyframe = packet->keyframe
-	};
+	get_packet_info(&info, packet);
+
+	if (stream->shm) {
+		if (!shm_write_packet(stream, &info, packet->data)) {
+			signal_failure(stream);
+			return false;
+		}
+
+		stream->total_bytes += packet->size;
+		return true;
+	}
 
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t*)&info,
 			sizeof(info));
@@ -401,8 +669,11 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 	return true;
 }
 
+typedef bool (*write_packet_t)(struct ffmpeg_muxer *stream,
+		struct encoder_packet *packet);
+
 static bool send_audio_headers(struct ffmpeg_muxer *stream,
-		obs_encoder_t *aencoder, size_t idx)
+		write_packet_t write, obs_encoder_t *aencoder, size_t idx)
 {
 	struct encoder_packet packet = {
 		.type         = OBS_ENCODER_AUDIO,
@@ -411,10 +682,11 @@ static bool send_audio_headers(struct ffmpeg_muxer *stream,
 	};
 
 	obs_encoder_get_extra_data(aencoder, &packet.data, &packet.size);
-	return write_packet(stream, &packet);
+	return write(stream, &packet);
 }
 
-static bool send_video_headers(struct ffmpeg_muxer *stream)
+static bool send_video_headers(struct ffmpeg_muxer *stream,
+		write_packet_t write)
 {
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
 
@@ -424,21 +696,22 @@ static bool send_video_headers(struct ffmpeg_muxer *stream)
 	};
 
 	obs_encoder_get_extra_data(vencoder, &packet.data, &packet.size);
-	return write_packet(stream, &packet);
+	return write(stream, &packet);
 }
 
-static bool send_headers(struct ffmpeg_muxer *stream)
+static bool send_headers(struct ffmpeg_muxer *stream, write_packet_t write)
 {
 	obs_encoder_t *aencoder;
 	size_t idx = 0;
 
-	if (!send_video_headers(stream))
+	if (!send_video_headers(stream, write))
 		return false;
 
 	do {
 		aencoder = obs_output_get_audio_encoder(stream->output, idx);
 		if (aencoder) {
-			if (!send_audio_headers(stream, aencoder, idx)) {
+			if (!send_audio_headers(stream, write, aencoder,
+						idx)) {
 				return false;
 			}
 			idx++;
@@ -456,7 +729,7 @@ static void ffmpeg_mux_data(void *data, struct encoder_packet *packet)
 		return;
 
 	if (!stream->sent_headers) {
-		if (!send_headers(stream))
+		if (!send_headers(stream, write_packet))
 			return;
 
 		stream->sent_headers = true;
@@ -490,6 +763,15 @@ static uint64_t ffmpeg_mux_total_bytes(void *data)
 	return stream->total_bytes;
 }
 
+/* how full the shared memory ring was when last written to, i.e. how far
+ * the muxer is behind */
+static float ffmpeg_mux_congestion(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	long used = os_atomic_load_long(&stream->shm_used);
+	return (float)used / (float)FFM_SHM_SIZE;
+}
+
 struct obs_output_info ffmpeg_muxer = {
 	.id             = "ffmpeg_muxer",
 	.flags          = OBS_OUTPUT_AV |
@@ -502,17 +784,49 @@ struct obs_output_info ffmpeg_muxer = {
 	.stop           = ffmpeg_mux_stop,
 	.encoded_packet = ffmpeg_mux_data,
 	.get_total_bytes= ffmpeg_mux_total_bytes,
+	.get_congestion = ffmpeg_mux_congestion,
 	.get_properties = ffmpeg_mux_properties
 };
 
 /* ------------------------------------------------------------------------ */
 
+enum replay_job_type {
+	REPLAY_JOB_OPEN,
+	REPLAY_JOB_SAVE,
+	REPLAY_JOB_CLOSE
+};
+
+struct replay_job {
+	enum replay_job_type          type;
+	char                          *cmd;
+	char                          *path;
+
+	/* memory replay buffer */
+	DARRAY(struct encoder_packet) packets;
+
+	/* disk-backed replay buffer */
+	struct replay_disk            *disk;
+	struct replay_disk_pos        start;
+	struct replay_disk_pos        end;
+};
+
+/* packets are sent to the muxer in batches of about this size */
+#define SAVE_BATCH_SIZE (1024 * 1024)
+
 static const char *replay_buffer_getname(void *type)
 {
 	UNUSED_PARAMETER(type);
 	return obs_module_text("ReplayBuffer");
 }
 
+static inline void request_save(struct ffmpeg_muxer *stream, int64_t duration)
+{
+	if (os_atomic_load_bool(&stream->active)) {
+		stream->save_duration = duration;
+		stream->save_ts = os_gettime_ns() / 1000LL;
+	}
+}
+
 static void replay_buffer_hotkey(void *data, obs_hotkey_id id,
 		obs_hotkey_t *hotkey, bool pressed)
 {
@@ -520,9 +834,7 @@ static void replay_buffer_hotkey(void *data, obs_hotkey_id id,
 	UNUSED_PARAMETER(hotkey);
 	UNUSED_PARAMETER(pressed);
 
-	struct ffmpeg_muxer *stream = data;
-	if (os_atomic_load_bool(&stream->active))
-		stream->save_ts = os_gettime_ns() / 1000LL;
+	request_save(data, 0);
 }
 
 static void save_replay_proc(void *data, calldata_t *cd)
@@ -531,11 +843,398 @@ static void save_replay_proc(void *data, calldata_t *cd)
 	UNUSED_PARAMETER(cd);
 }
 
+static void save_last_replay_proc(void *data, calldata_t *cd)
+{
+	long long seconds = calldata_int(cd, "seconds");
+	if (seconds > 0)
+		request_save(data, seconds * 1000000LL);
+}
+
 static void get_last_replay(void *data, calldata_t *cd)
 {
 	struct ffmpeg_muxer *stream = data;
-	if (!os_atomic_load_bool(&stream->muxing))
-		calldata_set_string(cd, "path", stream->path.array);
+
+	pthread_mutex_lock(&stream->save_mutex);
+	if (stream->last_replay.array)
+		calldata_set_string(cd, "path", stream->last_replay.array);
+	pthread_mutex_unlock(&stream->save_mutex);
+}
+
+/* ------------------------------------------------------------------------ */
+/* save thread */
+
+static void free_job(struct replay_job *job)
+{
+	for (size_t i = 0; i < job->packets.num; i++)
+		obs_encoder_packet_release(&job->packets.array[i]);
+	da_free(job->packets);
+
+	replay_disk_release(job->disk);
+	bfree(job->cmd);
+	bfree(job->path);
+	bfree(job);
+}
+
+static void queue_job(struct ffmpeg_muxer *stream, enum replay_job_type type,
+		struct replay_job *job)
+{
+	if (!job)
+		job = bzalloc(sizeof(*job));
+
+	job->type = type;
+	if (!job->cmd && stream->mux_cmd.array)
+		job->cmd = bstrdup(stream->mux_cmd.array);
+
+	pthread_mutex_lock(&stream->save_mutex);
+	da_push_back(stream->save_jobs, &job);
+	pthread_mutex_unlock(&stream->save_mutex);
+
+	os_sem_post(stream->save_sem);
+}
+
+static void close_helper(struct ffmpeg_muxer *stream)
+{
+	os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+	dstr_free(&stream->helper_cmd);
+}
+
+static bool open_helper(struct ffmpeg_muxer *stream, const char *cmd)
+{
+	if (!cmd)
+		return false;
+	if (stream->pipe && dstr_cmp(&stream->helper_cmd, cmd) == 0)
+		return true;
+
+	close_helper(stream);
+
+	stream->pipe = os_process_pipe_create(cmd, "w");
+	if (!stream->pipe) {
+		warn("Failed to create process pipe");
+		return false;
+	}
+
+	dstr_copy(&stream->helper_cmd, cmd);
+	return true;
+}
+
+static bool flush_batch(struct ffmpeg_muxer *stream)
+{
+	size_t size = stream->save_batch.num;
+	size_t ret;
+
+	if (!size)
+		return true;
+
+	da_resize(stream->save_batch, 0);
+
+	ret = os_process_pipe_write(stream->pipe, stream->save_batch.array,
+			size);
+	if (ret != size) {
+		warn("os_process_pipe_write for replay data failed");
+		return false;
+	}
+
+	return true;
+}
+
+static bool batch_write(struct ffmpeg_muxer *stream,
+		struct ffm_packet_info *info, const uint8_t *data)
+{
+	da_push_back_array(stream->save_batch, (uint8_t*)info, sizeof(*info));
+	da_push_back_array(stream->save_batch, data, info->size);
+
+	if (stream->save_batch.num >= SAVE_BATCH_SIZE)
+		return flush_batch(stream);
+	return true;
+}
+
+static bool batch_write_packet(struct ffmpeg_muxer *stream,
+		struct encoder_packet *packet)
+{
+	struct ffm_packet_info info = {0};
+	get_packet_info(&info, packet);
+	return batch_write(stream, &info, packet->data);
+}
+
+static bool send_file_name(struct ffmpeg_muxer *stream, const char *path)
+{
+	struct ffm_packet_info info = {
+		.type = FFM_PACKET_FILE,
+		.size = (uint32_t)strlen(path)
+	};
+
+	return batch_write(stream, &info, (const uint8_t*)path);
+}
+
+static void insert_packet(struct darray *array, struct encoder_packet *packet,
+		int64_t video_offset, int64_t *audio_offsets,
+		int64_t video_dts_offset, int64_t *audio_dts_offsets)
+{
+	struct encoder_packet pkt = *packet;
+	DARRAY(struct encoder_packet) packets;
+	packets.da = *array;
+	size_t idx;
+
+	if (pkt.type == OBS_ENCODER_VIDEO) {
+		pkt.dts_usec -= video_offset;
+		pkt.dts -= video_dts_offset;
+		pkt.pts -= video_dts_offset;
+	} else {
+		pkt.dts_usec -= audio_offsets[pkt.track_idx];
+		pkt.dts -= audio_dts_offsets[pkt.track_idx];
+		pkt.pts -= audio_dts_offsets[pkt.track_idx];
+	}
+
+	for (idx = packets.num; idx > 0; idx--) {
+		struct encoder_packet *p = packets.array + (idx - 1);
+		if (p->dts_usec < pkt.dts_usec)
+			break;
+	}
+
+	da_insert(packets, idx, &pkt);
+	*array = packets.da;
+}
+
+/* reorders the packets of the job, taking over their references */
+static void reorder_packets(struct replay_job *job)
+{
+	DARRAY(struct encoder_packet) sorted;
+
+	bool found_video = false;
+	bool found_audio[MAX_AUDIO_MIXES] = {0};
+	int64_t video_offset = 0;
+	int64_t video_dts_offset = 0;
+	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
+	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+
+	da_init(sorted);
+	da_reserve(sorted, job->packets.num);
+
+	for (size_t i = 0; i < job->packets.num; i++) {
+		struct encoder_packet *pkt = &job->packets.array[i];
+
+		if (pkt->type == OBS_ENCODER_VIDEO) {
+			if (!found_video) {
+				video_offset = pkt->dts_usec;
+				video_dts_offset = pkt->dts;
+				found_video = true;
+			}
+		} else {
+			if (!found_audio[pkt->track_idx]) {
+				found_audio[pkt->track_idx] = true;
+				audio_offsets[pkt->track_idx] = pkt->dts_usec;
+				audio_dts_offsets[pkt->track_idx] = pkt->dts;
+			}
+		}
+
+		insert_packet(&sorted.da, pkt,
+				video_offset, audio_offsets,
+				video_dts_offset, audio_dts_offsets);
+	}
+
+	da_free(job->packets);
+	job->packets.da = sorted.da;
+}
+
+static bool write_memory_packets(struct ffmpeg_muxer *stream,
+		struct replay_job *job)
+{
+	reorder_packets(job);
+
+	for (size_t i = 0; i < job->packets.num; i++) {
+		struct encoder_packet *pkt = &job->packets.array[i];
+		bool success = batch_write_packet(stream, pkt);
+
+		obs_encoder_packet_release(pkt);
+		if (!success) {
+			da_erase_range(job->packets, 0, i + 1);
+			return false;
+		}
+	}
+
+	da_resize(job->packets, 0);
+	return true;
+}
+
+/* streams the saved range straight from the disk segments.  packets are
+ * written in the order they were received, like a regular recording */
+static bool write_disk_packets(struct ffmpeg_muxer *stream,
+		struct replay_job *job)
+{
+	DARRAY(uint8_t) buf;
+	struct replay_disk_pos pos = job->start;
+	enum replay_read_result ret;
+	struct encoder_packet pkt;
+	bool success = true;
+
+	bool found_video = false;
+	bool found_audio[MAX_AUDIO_MIXES] = {0};
+	int64_t video_dts_offset = 0;
+	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+
+	da_init(buf);
+
+	for (;;) {
+		ret = replay_disk_read(job->disk, &pos, &job->end, &pkt,
+				&buf.da);
+		if (ret != REPLAY_READ_OK)
+			break;
+
+		if (pkt.type == OBS_ENCODER_VIDEO) {
+			if (!found_video) {
+				video_dts_offset = pkt.dts;
+				found_video = true;
+			}
+
+			pkt.dts -= video_dts_offset;
+			pkt.pts -= video_dts_offset;
+		} else {
+			if (!found_audio[pkt.track_idx]) {
+				found_audio[pkt.track_idx] = true;
+				audio_dts_offsets[pkt.track_idx] = pkt.dts;
+			}
+
+			pkt.dts -= audio_dts_offsets[pkt.track_idx];
+			pkt.pts -= audio_dts_offsets[pkt.track_idx];
+		}
+
+		if (!batch_write_packet(stream, &pkt)) {
+			success = false;
+			break;
+		}
+	}
+
+	if (ret == REPLAY_READ_OVERWRITTEN)
+		warn("Replay buffer was overwritten while saving, the replay "
+		     "'%s' is incomplete", job->path);
+
+	da_free(buf);
+	return success;
+}
+
+static void save_replay(struct ffmpeg_muxer *stream, struct replay_job *job)
+{
+	bool success;
+
+	da_resize(stream->save_batch, 0);
+
+	success = open_helper(stream, job->cmd) &&
+		send_file_name(stream, job->path) &&
+		send_headers(stream, batch_write_packet);
+
+	if (success) {
+		if (job->disk)
+			success = write_disk_packets(stream, job);
+		else
+			success = write_memory_packets(stream, job);
+	}
+
+	if (success)
+		success = flush_batch(stream);
+
+	/* the helper finishes the file and exits once its input is closed */
+	if (stream->pipe) {
+		int ret = os_process_pipe_destroy(stream->pipe);
+		stream->pipe = NULL;
+		dstr_free(&stream->helper_cmd);
+
+		if (ret != 0)
+			success = false;
+	}
+
+	if (success) {
+		info("Wrote replay buffer to '%s'", job->path);
+
+		pthread_mutex_lock(&stream->save_mutex);
+		dstr_copy(&stream->last_replay, job->path);
+		pthread_mutex_unlock(&stream->save_mutex);
+	} else {
+		warn("Failed to write replay buffer to '%s'", job->path);
+	}
+}
+
+static struct replay_job *pop_job(struct ffmpeg_muxer *stream)
+{
+	struct replay_job *job = NULL;
+
+	pthread_mutex_lock(&stream->save_mutex);
+	if (stream->save_jobs.num) {
+		job = stream->save_jobs.array[0];
+		da_erase(stream->save_jobs, 0);
+	}
+	pthread_mutex_unlock(&stream->save_mutex);
+
+	return job;
+}
+
+static void *replay_buffer_save_thread(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	os_set_thread_name("replay-buffer-save");
+
+	while (os_sem_wait(stream->save_sem) == 0) {
+		struct replay_job *job = pop_job(stream);
+
+		if (!job) {
+			if (os_atomic_load_bool(&stream->save_thread_exit))
+				break;
+			continue;
+		}
+
+		switch (job->type) {
+		case REPLAY_JOB_OPEN:
+			open_helper(stream, job->cmd);
+			break;
+
+		case REPLAY_JOB_SAVE:
+			save_replay(stream, job);
+
+			/* start the helper for the next save right away, so
+			 * saving doesn't have to wait for it */
+			open_helper(stream, job->cmd);
+			break;
+
+		case REPLAY_JOB_CLOSE:
+			close_helper(stream);
+			break;
+		}
+
+		free_job(job);
+	}
+
+	close_helper(stream);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------ */
+
+static void replay_buffer_destroy(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	if (stream->hotkey)
+		obs_hotkey_unregister(stream->hotkey);
+
+	/* finishes any replays still being saved */
+	if (stream->save_thread_active) {
+		os_atomic_set_bool(&stream->save_thread_exit, true);
+		os_sem_post(stream->save_sem);
+		pthread_join(stream->save_thread, NULL);
+	}
+
+	for (size_t i = 0; i < stream->save_jobs.num; i++)
+		free_job(stream->save_jobs.array[i]);
+	da_free(stream->save_jobs);
+	da_free(stream->save_batch);
+
+	os_sem_destroy(stream->save_sem);
+	pthread_mutex_destroy(&stream->save_mutex);
+	dstr_free(&stream->mux_cmd);
+	dstr_free(&stream->helper_cmd);
+	dstr_free(&stream->last_replay);
+
+	ffmpeg_mux_destroy(data);
 }
 
 static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
@@ -544,6 +1243,18 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
 
+	if (pthread_mutex_init(&stream->save_mutex, NULL) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+	if (os_sem_init(&stream->save_sem, 0) != 0)
+		goto fail;
+
+	stream->save_thread_active = pthread_create(&stream->save_thread,
+			NULL, replay_buffer_save_thread, stream) == 0;
+	if (!stream->save_thread_active)
+		goto fail;
+
 	stream->hotkey = obs_hotkey_register_output(output,
 			"ReplayBuffer.Save",
 			obs_module_text("ReplayBuffer.Save"),
@@ -551,18 +1262,43 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void save()", save_replay_proc, stream);
+	proc_handler_add(ph, "void save_last(int seconds)",
+			save_last_replay_proc, stream);
 	proc_handler_add(ph, "void get_last_replay(out string path)",
 			get_last_replay, stream);
 
 	return stream;
+
+fail:
+	replay_buffer_destroy(stream);
+	return NULL;
 }
 
-static void replay_buffer_destroy(void *data)
+#define DEFAULT_DISK_SIZE (1024LL * 1024 * 1024)
+
+static bool create_replay_disk(struct ffmpeg_muxer *stream, obs_data_t *s)
 {
-	struct ffmpeg_muxer *stream = data;
-	if (stream->hotkey)
-		obs_hotkey_unregister(stream->hotkey);
-	ffmpeg_mux_destroy(data);
+	const char *dir = obs_data_get_string(s, "disk_cache_dir");
+	int64_t size = stream->max_size ? stream->max_size : DEFAULT_DISK_SIZE;
+
+	if (!dir || !*dir)
+		dir = obs_data_get_string(s, "directory");
+
+	stream->disk = replay_disk_create(dir, (size_t)size);
+	if (!stream->disk) {
+		struct dstr error_message;
+		dstr_init_copy(&error_message,
+			obs_module_text("UnableToWritePath"));
+		dstr_replace(&error_message, "%1", dir);
+		obs_output_set_last_error(stream->output,
+			error_message.array);
+		dstr_free(&error_message);
+		return false;
+	}
+
+	info("Using disk-backed replay buffer in '%s' (%lld MB)", dir,
+			(long long)(size / (1024 * 1024)));
+	return true;
 }
 
 static bool replay_buffer_start(void *data)
@@ -577,8 +1313,20 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+
+	if (obs_data_get_bool(s, "use_disk") && !create_replay_disk(stream, s)) {
+		obs_data_release(s);
+		return false;
+	}
+
 	obs_data_release(s);
 
+	/* the muxer is started now and waits for the file name of the first
+	 * save, so saving doesn't have to wait for it to start */
+	dstr_free(&stream->mux_cmd);
+	build_command_line(stream, &stream->mux_cmd, FFM_FILE_FROM_PIPE);
+	queue_job(stream, REPLAY_JOB_OPEN, NULL);
+
 	os_atomic_set_bool(&stream->active, true);
 	os_atomic_set_bool(&stream->capturing, true);
 	stream->total_bytes = 0;
@@ -648,135 +1396,102 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 		purge(stream);
 }
 
-static void insert_packet(struct darray *array, struct encoder_packet *packet,
-		int64_t video_offset, int64_t *audio_offsets,
-		int64_t video_dts_offset, int64_t *audio_dts_offsets)
+/* references the packets to save, starting from the first keyframe within
+ * 'duration' of the newest packet, or from the first keyframe if 0.  the
+ * packets are reordered on the save thread */
+static bool copy_packets(struct ffmpeg_muxer *stream, int64_t duration,
+		struct replay_job *job)
 {
-	struct encoder_packet pkt;
-	DARRAY(struct encoder_packet) packets;
-	packets.da = *array;
-	size_t idx;
-
-	obs_encoder_packet_ref(&pkt, packet);
-
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_dts_offset;
-		pkt.pts -= video_dts_offset;
-	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
-	}
-
-	for (idx = packets.num; idx > 0; idx--) {
-		struct encoder_packet *p = packets.array + (idx - 1);
-		if (p->dts_usec < pkt.dts_usec)
-			break;
-	}
-
-	da_insert(packets, idx, &pkt);
-	*array = packets.da;
-}
+	const size_t size = sizeof(struct encoder_packet);
+	size_t num_packets = stream->packets.size / size;
+	size_t start = num_packets;
+	struct encoder_packet *last;
+	int64_t cutoff;
 
-static void *replay_buffer_mux_thread(void *data)
-{
-	struct ffmpeg_muxer *stream = data;
+	if (!num_packets)
+		return false;
 
-	start_pipe(stream, stream->path.array);
+	last = circlebuf_data(&stream->packets, (num_packets - 1) * size);
+	cutoff = last->dts_usec - duration;
 
-	if (!stream->pipe) {
-		warn("Failed to create process pipe");
-		goto error;
-	}
+	for (size_t i = 0; i < num_packets; i++) {
+		struct encoder_packet *pkt;
+		pkt = circlebuf_data(&stream->packets, i * size);
 
-	if (!send_headers(stream)) {
-		warn("Could not write headers for file '%s'",
-				stream->path.array);
-		goto error;
-	}
+		if (pkt->type != OBS_ENCODER_VIDEO || !pkt->keyframe)
+			continue;
 
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		write_packet(stream, pkt);
-		obs_encoder_packet_release(pkt);
+		start = i;
+		if (!duration || pkt->dts_usec >= cutoff)
+			break;
 	}
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
-
-error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	da_free(stream->mux_packets);
-	os_atomic_set_bool(&stream->muxing, false);
-	return NULL;
-}
-
-static void replay_buffer_save(struct ffmpeg_muxer *stream)
-{
-	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
-
-	da_reserve(stream->mux_packets, num_packets);
-
-	/* ---------------------------- */
-	/* reorder packets */
+	if (start == num_packets)
+		return false;
 
-	bool found_video = false;
-	bool found_audio[MAX_AUDIO_MIXES] = {0};
-	int64_t video_offset = 0;
-	int64_t video_dts_offset = 0;
-	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
-	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+	da_reserve(job->packets, num_packets - start);
 
-	for (size_t i = 0; i < num_packets; i++) {
+	for (size_t i = start; i < num_packets; i++) {
 		struct encoder_packet *pkt;
 		pkt = circlebuf_data(&stream->packets, i * size);
-
-		if (pkt->type == OBS_ENCODER_VIDEO) {
-			if (!found_video) {
-				video_offset = pkt->dts_usec;
-				video_dts_offset = pkt->dts;
-				found_video = true;
-			}
-		} else {
-			if (!found_audio[pkt->track_idx]) {
-				found_audio[pkt->track_idx] = true;
-				audio_offsets[pkt->track_idx] = pkt->dts_usec;
-				audio_dts_offsets[pkt->track_idx] = pkt->dts;
-			}
-		}
-
-		insert_packet(&stream->mux_packets.da, pkt,
-				video_offset, audio_offsets,
-				video_dts_offset, audio_dts_offsets);
+		obs_encoder_packet_ref(da_push_back_new(job->packets), pkt);
 	}
 
-	/* ---------------------------- */
-	/* generate filename */
+	return true;
+}
 
+static char *generate_replay_path(struct ffmpeg_muxer *stream)
+{
 	obs_data_t *settings = obs_output_get_settings(stream->output);
 	const char *dir = obs_data_get_string(settings, "directory");
 	const char *fmt = obs_data_get_string(settings, "format");
 	const char *ext = obs_data_get_string(settings, "extension");
 	bool space = obs_data_get_bool(settings, "allow_spaces");
+	struct dstr path = {0};
 
 	char *filename = os_generate_formatted_filename(ext, space, fmt);
 
-	dstr_copy(&stream->path, dir);
-	dstr_replace(&stream->path, "\\", "/");
-	if (dstr_end(&stream->path) != '/')
-		dstr_cat_ch(&stream->path, '/');
-	dstr_cat(&stream->path, filename);
+	dstr_copy(&path, dir);
+	dstr_replace(&path, "\\", "/");
+	if (dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, filename);
 
 	bfree(filename);
 	obs_data_release(settings);
+	return path.array;
+}
 
-	/* ---------------------------- */
+/* only references the packets to save, the replay is written on the save
+ * thread so saves never wait for a previous one to finish */
+static void replay_buffer_save(struct ffmpeg_muxer *stream)
+{
+	struct replay_job *job = bzalloc(sizeof(*job));
+	int64_t duration = stream->save_duration;
+
+	if (stream->disk) {
+		if (!duration || (stream->max_time &&
+		                  stream->max_time < duration))
+			duration = stream->max_time;
+
+		if (!replay_disk_get_range(stream->disk, duration,
+					&job->start, &job->end)) {
+			warn("No keyframe in the replay buffer, not saving");
+			bfree(job);
+			return;
+		}
+
+		replay_disk_addref(stream->disk);
+		job->disk = stream->disk;
+
+	} else if (!copy_packets(stream, duration, job)) {
+		warn("No keyframe in the replay buffer, not saving");
+		free_job(job);
+		return;
+	}
 
-	os_atomic_set_bool(&stream->muxing, true);
-	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL,
-			replay_buffer_mux_thread, stream) == 0;
+	job->path = generate_replay_path(stream);
+	queue_job(stream, REPLAY_JOB_SAVE, job);
 }
 
 static void deactivate_replay_buffer(struct ffmpeg_muxer *stream)
@@ -788,6 +1503,7 @@ static void deactivate_replay_buffer(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->sent_headers, false);
 	os_atomic_set_bool(&stream->stopping, false);
 	replay_buffer_clear(stream);
+	queue_job(stream, REPLAY_JOB_CLOSE, NULL);
 }
 
 static void replay_buffer_data(void *data, struct encoder_packet *packet)
@@ -805,27 +1521,26 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	if (stream->disk) {
+		if (!replay_disk_push(stream->disk, packet))
+			warn("Packet of %d bytes is too large for the replay "
+			     "buffer, dropping it", (int)packet->size);
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+		replay_buffer_purge(stream, &pkt);
 
-	if (!stream->packets.size)
-		stream->cur_time = pkt.dts_usec;
-	stream->cur_size += pkt.size;
+		if (!stream->packets.size)
+			stream->cur_time = pkt.dts_usec;
+		stream->cur_size += pkt.size;
 
-	circlebuf_push_back(&stream->packets, packet, sizeof(*packet));
+		circlebuf_push_back(&stream->packets, packet,
+				sizeof(*packet));
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+		if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
+			stream->keyframes++;
+	}
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
-		if (os_atomic_load_bool(&stream->muxing))
-			return;
-
-		if (stream->mux_thread_joinable) {
-			pthread_join(stream->mux_thread, NULL);
-			stream->mux_thread_joinable = false;
-		}
-
 		stream->save_ts = 0;
 		replay_buffer_save(stream);
 	}
@@ -838,6 +1553,7 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "use_disk", false);
 }
 
 struct obs_output_info replay_buffer = {
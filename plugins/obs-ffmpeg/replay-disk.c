@@ -0,0 +1,392 @@
+/******************************************************************************
+    Copyright (C) 2026 by the OBS Studio contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "replay-disk.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+/* the ring is split in RING_SEGMENTS segments covering the requested size,
+ * plus SPARE_SEGMENTS that are never saved from.  the spare segments give a
+ * save that is still reading the oldest part of the ring time to get ahead
+ * before the writer recycles it */
+#define RING_SEGMENTS     16
+#define SPARE_SEGMENTS    2
+#define NUM_SEGMENTS      (RING_SEGMENTS + SPARE_SEGMENTS)
+#define MIN_SEGMENT_SIZE  (4 * 1024 * 1024)
+
+struct replay_record {
+	int64_t  pts;
+	int64_t  dts;
+	int64_t  dts_usec;
+	uint32_t size;
+	uint16_t track_idx;
+	uint8_t  type;
+	uint8_t  keyframe;
+};
+
+struct replay_keyframe {
+	uint64_t seq;
+	size_t   offset;
+	int64_t  dts_usec;
+};
+
+struct replay_segment {
+	uint8_t  *data;
+	uint64_t seq;
+	size_t   used;
+#ifdef _WIN32
+	HANDLE   file;
+	HANDLE   mapping;
+#endif
+};
+
+struct replay_disk {
+	volatile long          refs;
+
+	/* locked when a segment is recycled, and by readers while copying */
+	pthread_mutex_t        mutex;
+
+	struct replay_segment  segments[NUM_SEGMENTS];
+	size_t                 segment_size;
+	uint64_t               cur_seq;
+	int64_t                last_dts_usec;
+
+	DARRAY(struct replay_keyframe) keyframes;
+};
+
+static inline size_t record_size(size_t data_size)
+{
+	size_t size = sizeof(struct replay_record) + data_size;
+	return (size + 7) & ~(size_t)7;
+}
+
+static inline struct replay_segment *get_segment(struct replay_disk *rd,
+		uint64_t seq)
+{
+	return &rd->segments[seq % NUM_SEGMENTS];
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+static bool map_segment(struct replay_segment *seg, const char *path,
+		size_t size)
+{
+	ULARGE_INTEGER li;
+	wchar_t *wpath;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+
+	/* the file is deleted by the system once the last handle is closed,
+	 * even if the program crashes */
+	seg->file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+			CREATE_ALWAYS, FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	bfree(wpath);
+
+	if (seg->file == INVALID_HANDLE_VALUE) {
+		seg->file = NULL;
+		return false;
+	}
+
+	li.QuadPart = size;
+	seg->mapping = CreateFileMappingW(seg->file, NULL, PAGE_READWRITE,
+			li.HighPart, li.LowPart, NULL);
+	if (!seg->mapping)
+		return false;
+
+	seg->data = MapViewOfFile(seg->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+			size);
+	return seg->data != NULL;
+}
+
+static void unmap_segment(struct replay_segment *seg, size_t size)
+{
+	if (seg->data)
+		UnmapViewOfFile(seg->data);
+	if (seg->mapping)
+		CloseHandle(seg->mapping);
+	if (seg->file)
+		CloseHandle(seg->file);
+
+	UNUSED_PARAMETER(size);
+}
+
+#else
+static bool map_segment(struct replay_segment *seg, const char *path,
+		size_t size)
+{
+	bool success = false;
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1)
+		return false;
+
+	/* the mapping keeps the file alive, so it can be unlinked right away
+	 * and never outlives the program */
+	unlink(path);
+
+	if (ftruncate(fd, (off_t)size) != 0)
+		goto fail;
+
+#ifdef __linux__
+	/* reserve the disk space up front so running out of space is an error
+	 * when starting rather than a crash when writing */
+	int ret = posix_fallocate(fd, 0, (off_t)size);
+	if (ret != 0 && ret != EINVAL && ret != EOPNOTSUPP)
+		goto fail;
+#endif
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data != MAP_FAILED) {
+		seg->data = data;
+		success = true;
+	}
+
+fail:
+	close(fd);
+	return success;
+}
+
+static void unmap_segment(struct replay_segment *seg, size_t size)
+{
+	if (seg->data)
+		munmap(seg->data, size);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static void replay_disk_destroy(struct replay_disk *rd)
+{
+	for (size_t i = 0; i < NUM_SEGMENTS; i++)
+		unmap_segment(&rd->segments[i], rd->segment_size);
+
+	da_free(rd->keyframes);
+	pthread_mutex_destroy(&rd->mutex);
+	bfree(rd);
+}
+
+struct replay_disk *replay_disk_create(const char *dir, size_t size)
+{
+	struct replay_disk *rd = bzalloc(sizeof(*rd));
+	struct dstr path = {0};
+	size_t segment_size;
+
+	segment_size = (size / RING_SEGMENTS + 0xFFFF) & ~(size_t)0xFFFF;
+	if (segment_size < MIN_SEGMENT_SIZE)
+		segment_size = MIN_SEGMENT_SIZE;
+
+	rd->refs = 1;
+	rd->segment_size = segment_size;
+
+	if (pthread_mutex_init(&rd->mutex, NULL) != 0) {
+		bfree(rd);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < NUM_SEGMENTS; i++) {
+		struct replay_segment *seg = &rd->segments[i];
+
+		dstr_printf(&path, "%s/obs-replay-%p-%d.tmp", dir, rd, (int)i);
+
+		if (!map_segment(seg, path.array, segment_size)) {
+			blog(LOG_WARNING, "replay_disk_create: Failed to "
+					"create segment '%s'", path.array);
+			dstr_free(&path);
+			replay_disk_destroy(rd);
+			return NULL;
+		}
+
+		seg->seq = i;
+	}
+
+	dstr_free(&path);
+	return rd;
+}
+
+void replay_disk_addref(struct replay_disk *rd)
+{
+	os_atomic_inc_long(&rd->refs);
+}
+
+void replay_disk_release(struct replay_disk *rd)
+{
+	if (rd && os_atomic_dec_long(&rd->refs) == 0)
+		replay_disk_destroy(rd);
+}
+
+static void next_segment(struct replay_disk *rd)
+{
+	struct replay_segment *seg;
+	uint64_t first_seq;
+	size_t count = 0;
+
+	rd->cur_seq++;
+	seg = get_segment(rd, rd->cur_seq);
+
+	pthread_mutex_lock(&rd->mutex);
+	seg->seq = rd->cur_seq;
+	seg->used = 0;
+	pthread_mutex_unlock(&rd->mutex);
+
+	if (rd->cur_seq < NUM_SEGMENTS)
+		return;
+
+	/* drop the keyframes of the recycled segment */
+	first_seq = rd->cur_seq - NUM_SEGMENTS + 1;
+	while (count < rd->keyframes.num &&
+	       rd->keyframes.array[count].seq < first_seq)
+		count++;
+
+	if (count)
+		da_erase_range(rd->keyframes, 0, count);
+}
+
+bool replay_disk_push(struct replay_disk *rd, struct encoder_packet *packet)
+{
+	size_t size = record_size(packet->size);
+	struct replay_segment *seg = get_segment(rd, rd->cur_seq);
+	struct replay_record *record;
+
+	if (size > rd->segment_size)
+		return false;
+
+	if (seg->used + size > rd->segment_size) {
+		next_segment(rd);
+		seg = get_segment(rd, rd->cur_seq);
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
+		struct replay_keyframe *kf = da_push_back_new(rd->keyframes);
+		kf->seq = rd->cur_seq;
+		kf->offset = seg->used;
+		kf->dts_usec = packet->dts_usec;
+	}
+
+	record = (struct replay_record*)(seg->data + seg->used);
+	record->pts = packet->pts;
+	record->dts = packet->dts;
+	record->dts_usec = packet->dts_usec;
+	record->size = (uint32_t)packet->size;
+	record->track_idx = (uint16_t)packet->track_idx;
+	record->type = (uint8_t)packet->type;
+	record->keyframe = packet->keyframe;
+	memcpy(record + 1, packet->data, packet->size);
+
+	seg->used += size;
+	rd->last_dts_usec = packet->dts_usec;
+	return true;
+}
+
+bool replay_disk_get_range(struct replay_disk *rd, int64_t max_time_usec,
+		struct replay_disk_pos *start, struct replay_disk_pos *end)
+{
+	struct replay_keyframe *found = NULL;
+	int64_t cutoff = rd->last_dts_usec - max_time_usec;
+	uint64_t min_seq = 0;
+
+	if (rd->cur_seq >= RING_SEGMENTS)
+		min_seq = rd->cur_seq - RING_SEGMENTS + 1;
+
+	for (size_t i = 0; i < rd->keyframes.num; i++) {
+		struct replay_keyframe *kf = &rd->keyframes.array[i];
+		if (kf->seq < min_seq)
+			continue;
+
+		found = kf;
+		if (!max_time_usec || kf->dts_usec >= cutoff)
+			break;
+	}
+
+	if (!found)
+		return false;
+
+	start->seq = found->seq;
+	start->offset = found->offset;
+	end->seq = rd->cur_seq;
+	end->offset = get_segment(rd, rd->cur_seq)->used;
+	return true;
+}
+
+enum replay_read_result replay_disk_read(struct replay_disk *rd,
+		struct replay_disk_pos *pos, const struct replay_disk_pos *end,
+		struct encoder_packet *packet, struct darray *buf)
+{
+	DARRAY(uint8_t) data;
+	struct replay_segment *seg;
+	struct replay_record record;
+	size_t used;
+
+	data.da = *buf;
+
+	for (;;) {
+		if (pos->seq > end->seq ||
+		    (pos->seq == end->seq && pos->offset >= end->offset))
+			return REPLAY_READ_END;
+
+		seg = get_segment(rd, pos->seq);
+
+		pthread_mutex_lock(&rd->mutex);
+		if (seg->seq != pos->seq) {
+			pthread_mutex_unlock(&rd->mutex);
+			return REPLAY_READ_OVERWRITTEN;
+		}
+
+		used = pos->seq == end->seq ? end->offset : seg->used;
+		if (pos->offset < used)
+			break;
+
+		pthread_mutex_unlock(&rd->mutex);
+		pos->seq++;
+		pos->offset = 0;
+	}
+
+	memcpy(&record, seg->data + pos->offset, sizeof(record));
+	da_resize(data, record.size);
+	memcpy(data.array, seg->data + pos->offset + sizeof(record),
+			record.size);
+	pthread_mutex_unlock(&rd->mutex);
+
+	pos->offset += record_size(record.size);
+
+	memset(packet, 0, sizeof(*packet));
+	packet->data = data.array;
+	packet->size = record.size;
+	packet->pts = record.pts;
+	packet->dts = record.dts;
+	packet->dts_usec = record.dts_usec;
+	packet->track_idx = record.track_idx;
+	packet->type = (enum obs_encoder_type)record.type;
+	packet->keyframe = record.keyframe != 0;
+
+	*buf = data.da;
+	return REPLAY_READ_OK;
+}
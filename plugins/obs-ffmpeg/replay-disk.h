@@ -0,0 +1,68 @@
+/******************************************************************************
+    Copyright (C) 2026 by the OBS Studio contributors
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+#include <util/darray.h>
+
+/*
+ * Disk-backed replay buffer storage
+ *
+ *   Packets are written sequentially to a ring of preallocated segment files
+ * which are memory-mapped, so only the pages being written or read need to
+ * be resident.  When the ring is full the oldest segment is recycled.  Only
+ * the positions of video keyframes are kept in memory.
+ *
+ *   Packets are written from the output's data thread, and can be read from
+ * another thread while writing continues.  A reader that falls so far behind
+ * that its segment gets recycled is told so instead of reading bad data.
+ */
+
+struct replay_disk;
+
+struct replay_disk_pos {
+	uint64_t seq;
+	size_t   offset;
+};
+
+enum replay_read_result {
+	REPLAY_READ_OK,
+	REPLAY_READ_END,
+	REPLAY_READ_OVERWRITTEN
+};
+
+/* creates a ring of about 'size' bytes in 'dir', NULL on failure */
+extern struct replay_disk *replay_disk_create(const char *dir, size_t size);
+extern void replay_disk_addref(struct replay_disk *rd);
+extern void replay_disk_release(struct replay_disk *rd);
+
+/* returns false if the packet is larger than a segment */
+extern bool replay_disk_push(struct replay_disk *rd,
+		struct encoder_packet *packet);
+
+/* gets the range to save: from the first keyframe within max_time_usec of
+ * the newest packet (0 for no limit) up to the newest packet */
+extern bool replay_disk_get_range(struct replay_disk *rd,
+		int64_t max_time_usec,
+		struct replay_disk_pos *start, struct replay_disk_pos *end);
+
+/* reads the packet at 'pos' and advances it.  packet data is copied to
+ * 'buf' and is valid until the next read with the same buffer */
+extern enum replay_read_result replay_disk_read(struct replay_disk *rd,
+		struct replay_disk_pos *pos, const struct replay_disk_pos *end,
+		struct encoder_packet *packet, struct darray *buf);
@@ -192,8 +192,8 @@ static int32_t last_time = 0;
 static void flv_video(struct serializer *s, int32_t dts_offset,
 		struct encoder_packet *packet, bool is_header)
 {
-	int64_t offset  = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
+	uint8_t body_header[FLV_BODY_HEADER_MAX_SIZE];
 
 	if (!packet->data || !packet->size)
 		return;
@@ -215,9 +215,8 @@ static void flv_video(struct serializer *s, int32_t dts_offset,
 	s_wb24(s, 0);
 
 	/* these are the 5 extra bytes mentioned above */
-	s_w8(s, packet->keyframe ? 0x17 : 0x27);
-	s_w8(s, is_header ? 0 : 1);
-	s_wb24(s, get_ms_time(packet, offset));
+	s_write(s, body_header, flv_packet_body_header(packet, dts_offset,
+				body_header, NULL, is_header));
 	s_write(s, packet->data, packet->size);
 
 	/* write tag size (starting byte doesn't count) */
@@ -228,6 +227,7 @@ static void flv_audio(struct serializer *s, int32_t dts_offset,
 		struct encoder_packet *packet, bool is_header)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
+	uint8_t body_header[FLV_BODY_HEADER_MAX_SIZE];
 
 	if (!packet->data || !packet->size)
 		return;
@@ -249,14 +249,41 @@ static void flv_audio(struct serializer *s, int32_t dts_offset,
 	s_wb24(s, 0);
 
 	/* these are the two extra bytes mentioned above */
-	s_w8(s, 0xaf);
-	s_w8(s, is_header ? 0 : 1);
+	s_write(s, body_header, flv_packet_body_header(packet, dts_offset,
+				body_header, NULL, is_header));
 	s_write(s, packet->data, packet->size);
 
 	/* write tag size (starting byte doesn't count) */
 	s_wb32(s, (uint32_t)serializer_get_pos(s) - 1);
 }
 
+size_t flv_packet_body_header(struct encoder_packet *packet,
+		int32_t dts_offset, uint8_t *header, uint32_t *timestamp,
+		bool is_header)
+{
+	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
+
+	/* same 31 bits that end up in the FLV tag timestamp fields */
+	if (timestamp)
+		*timestamp = (uint32_t)time_ms & 0x7FFFFFFF;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		int32_t offset_ms = get_ms_time(packet,
+				packet->pts - packet->dts);
+
+		header[0] = packet->keyframe ? 0x17 : 0x27;
+		header[1] = is_header ? 0 : 1;
+		header[2] = (uint8_t)(offset_ms >> 16);
+		header[3] = (uint8_t)(offset_ms >> 8);
+		header[4] = (uint8_t)offset_ms;
+		return 5;
+	}
+
+	header[0] = 0xaf;
+	header[1] = is_header ? 0 : 1;
+	return 2;
+}
+
 void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 		uint8_t **output, size_t *size, bool is_header)
 {
@@ -32,3 +32,11 @@ extern bool flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 		bool write_header, size_t audio_idx);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 		uint8_t **output, size_t *size, bool is_header);
+
+#define FLV_BODY_HEADER_MAX_SIZE 5
+
+/* writes the audio/video tag body header that precedes the packet data and
+ * returns its size, so muxers can send the packet data without copying it */
+extern size_t flv_packet_body_header(struct encoder_packet *packet,
+		int32_t dts_offset, uint8_t *header, uint32_t *timestamp,
+		bool is_header);
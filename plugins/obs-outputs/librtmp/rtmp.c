@@ -1486,6 +1486,99 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+#define RTMP_MAX_WRITEV 64
+
+static int
+SockBufSendV(RTMPSockBuf *sb, const RTMPBuf *bufs, int nbufs)
+{
+#ifdef _WIN32
+    WSABUF wsabufs[RTMP_MAX_WRITEV];
+    DWORD sent = 0;
+#else
+    struct iovec iov[RTMP_MAX_WRITEV];
+    struct msghdr msg;
+#endif
+    int i;
+
+    for (i = 0; i < nbufs; i++)
+    {
+#if defined(RTMP_NETSTACK_DUMP)
+        fwrite(bufs[i].buf, 1, bufs[i].len, netstackdump);
+#endif
+#ifdef _WIN32
+        wsabufs[i].buf = (char *)bufs[i].buf;
+        wsabufs[i].len = bufs[i].len;
+#else
+        iov[i].iov_base = (void *)bufs[i].buf;
+        iov[i].iov_len = bufs[i].len;
+#endif
+    }
+
+#ifdef _WIN32
+    if (WSASend(sb->sb_socket, wsabufs, nbufs, &sent, 0, NULL, NULL) != 0)
+        return -1;
+    return (int)sent;
+#else
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = nbufs;
+    return (int)sendmsg(sb->sb_socket, &msg, 0);
+#endif
+}
+
+/* Like WriteN, but gathers the data from several buffers.  Only used for
+ * plain connections; bufs is advanced in place on partial writes. */
+static int
+WriteV(RTMP *r, RTMPBuf *bufs, int nbufs)
+{
+    while (nbufs > 0)
+    {
+        int nBytes;
+
+        if (r->m_bCustomSend && r->m_customSendFunc)
+            nBytes = r->m_customSendFunc(&r->m_sb, bufs->buf, bufs->len, r->m_customSendParam);
+        else
+            nBytes = SockBufSendV(&r->m_sb, bufs, nbufs);
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d buffers)", __FUNCTION__,
+                     sockerr, nbufs);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            r->last_error_code = sockerr;
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+        {
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send returned 0 (%d buffers)", __FUNCTION__,
+                     nbufs);
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        while (nbufs > 0 && nBytes >= bufs->len)
+        {
+            nBytes -= bufs->len;
+            bufs++;
+            nbufs--;
+        }
+        if (nBytes)
+        {
+            bufs->buf += nBytes;
+            bufs->len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -3962,18 +4055,12 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+static int
+PrepareChannelOut(RTMP *r, RTMPPacket *packet, uint32_t *last)
 {
     const RTMPPacket *prevPacket;
-    uint32_t last = 0;
-    int nSize;
-    int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
-    uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
+
+    *last = 0;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4003,7 +4090,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         if (prevPacket->m_nTimeStamp == packet->m_nTimeStamp
                 && packet->m_headerType == RTMP_PACKET_SIZE_SMALL)
             packet->m_headerType = RTMP_PACKET_SIZE_MINIMUM;
-        last = prevPacket->m_nTimeStamp;
+        *last = prevPacket->m_nTimeStamp;
     }
 
     if (packet->m_headerType > 3)	/* sanity */
@@ -4013,57 +4100,52 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         return FALSE;
     }
 
-    nSize = packetSize[packet->m_headerType];
-    hSize = nSize;
-    cSize = 0;
-    t = packet->m_nTimeStamp - last;
+    return TRUE;
+}
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+static void
+StoreChannelOut(RTMP *r, const RTMPPacket *packet)
+{
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+}
+
+/* Encodes the first chunk header of a packet into hbuf, which must hold at
+ * least RTMP_MAX_HEADER_SIZE bytes.  Returns the header size, the size of the
+ * channel id extension in *cSize and the basic header byte in *c. */
+static int
+EncodePacketHeader(const RTMPPacket *packet, uint32_t last, char *hbuf,
+                   int *cSize, char *c)
+{
+    char *hptr = hbuf, *hend = hbuf + RTMP_MAX_HEADER_SIZE;
+    int nSize = packetSize[packet->m_headerType];
+    uint32_t t = packet->m_nTimeStamp - last;
 
+    *cSize = 0;
     if (packet->m_nChannel > 319)
-        cSize = 2;
+        *cSize = 2;
     else if (packet->m_nChannel > 63)
-        cSize = 1;
-    if (cSize)
-    {
-        header -= cSize;
-        hSize += cSize;
-    }
+        *cSize = 1;
 
-    if (nSize > 1 && t >= 0xffffff)
-    {
-        header -= 4;
-        hSize += 4;
-    }
-
-    hptr = header;
-    c = packet->m_headerType << 6;
-    switch (cSize)
+    *c = packet->m_headerType << 6;
+    switch (*cSize)
     {
     case 0:
-        c |= packet->m_nChannel;
+        *c |= packet->m_nChannel;
         break;
     case 1:
         break;
     case 2:
-        c |= 1;
+        *c |= 1;
         break;
     }
-    *hptr++ = c;
-    if (cSize)
+    *hptr++ = *c;
+    if (*cSize)
     {
         int tmp = packet->m_nChannel - 64;
         *hptr++ = tmp & 0xff;
-        if (cSize == 2)
+        if (*cSize == 2)
             *hptr++ = tmp >> 8;
     }
 
@@ -4084,6 +4166,35 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    return (int)(hptr - hbuf);
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    uint32_t last;
+    int nSize;
+    int hSize, cSize;
+    char *header, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (!PrepareChannelOut(r, packet, &last))
+        return FALSE;
+
+    hSize = EncodePacketHeader(packet, last, hbuf, &cSize, &c);
+
+    if (packet->m_body)
+    {
+        header = packet->m_body - hSize;
+        memcpy(header, hbuf, hSize);
+    }
+    else
+    {
+        header = hbuf;
+    }
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4173,9 +4284,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         }
     }
 
-    if (!r->m_vecChannelsOut[packet->m_nChannel])
-        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
-    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    StoreChannelOut(r, packet);
     return TRUE;
 }
 
@@ -5284,3 +5393,128 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* Sends a single audio or video message whose body is made up of several
+ * buffers.  The chunk headers are interleaved with the caller's buffers and
+ * the whole message is handed to the socket with vectored writes, so the
+ * body is never copied on plain connections.  HTTP tunneling, RC4 and TLS
+ * need a contiguous body, so they fall back to RTMP_SendPacket. */
+int
+RTMP_WriteV(RTMP *r, int packetType, uint32_t timestamp, const RTMPBuf *bufs,
+            int nbufs, int streamIdx)
+{
+    RTMPPacket packet;
+    RTMPBuf iov[RTMP_MAX_WRITEV];
+    char hbuf[RTMP_MAX_HEADER_SIZE], cbuf[3], c;
+    uint32_t last;
+    int hSize, cSize, nSize = 0, chunkLeft, n, i, off;
+
+    for (i = 0; i < nbufs; i++)
+        nSize += bufs[i].len;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = packetType;
+    packet.m_nTimeStamp = timestamp;
+    packet.m_nBodySize = nSize;
+    packet.m_headerType = timestamp ? RTMP_PACKET_SIZE_MEDIUM : RTMP_PACKET_SIZE_LARGE;
+
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP)
+#ifdef CRYPTO
+            || r->Link.rc4keyOut
+#ifndef NO_SSL
+            || r->m_sb.sb_ssl
+#endif
+#endif
+       )
+    {
+        char *enc;
+        int ret;
+
+        if (!RTMPPacket_Alloc(&packet, nSize))
+        {
+            RTMP_Log(RTMP_LOGDEBUG, "%s, failed to allocate packet", __FUNCTION__);
+            return FALSE;
+        }
+        enc = packet.m_body;
+        for (i = 0; i < nbufs; i++)
+        {
+            memcpy(enc, bufs[i].buf, bufs[i].len);
+            enc += bufs[i].len;
+        }
+        ret = RTMP_SendPacket(r, &packet, FALSE);
+        RTMPPacket_Free(&packet);
+        return ret;
+    }
+
+    if (!PrepareChannelOut(r, &packet, &last))
+        return FALSE;
+
+    hSize = EncodePacketHeader(&packet, last, hbuf, &cSize, &c);
+
+    /* continuation chunks all share the same basic header */
+    cbuf[0] = (0xc0 | c);
+    if (cSize)
+    {
+        int tmp = packet.m_nChannel - 64;
+        cbuf[1] = tmp & 0xff;
+        if (cSize == 2)
+            cbuf[2] = tmp >> 8;
+    }
+
+    RTMP_Log(RTMP_LOGDEBUG2, "%s: fd=%d, size=%d", __FUNCTION__, (int)r->m_sb.sb_socket,
+             nSize);
+
+    iov[0].buf = hbuf;
+    iov[0].len = hSize;
+    n = 1;
+    chunkLeft = r->m_outChunkSize;
+    i = 0;
+    off = 0;
+
+    while (nSize > 0)
+    {
+        int num;
+
+        if (n > RTMP_MAX_WRITEV - 2)
+        {
+            if (!WriteV(r, iov, n))
+                return FALSE;
+            n = 0;
+        }
+
+        if (!chunkLeft)
+        {
+            iov[n].buf = cbuf;
+            iov[n].len = cSize + 1;
+            n++;
+            chunkLeft = r->m_outChunkSize;
+        }
+
+        num = bufs[i].len - off;
+        if (num > chunkLeft)
+            num = chunkLeft;
+        if (num)
+        {
+            iov[n].buf = bufs[i].buf + off;
+            iov[n].len = num;
+            n++;
+        }
+
+        off += num;
+        chunkLeft -= num;
+        nSize -= num;
+        if (off == bufs[i].len)
+        {
+            i++;
+            off = 0;
+        }
+    }
+
+    if (n && !WriteV(r, iov, n))
+        return FALSE;
+
+    StoreChannelOut(r, &packet);
+    return TRUE;
+}
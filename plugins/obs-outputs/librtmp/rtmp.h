@@ -269,6 +269,12 @@ extern "C"
 
     typedef int (*CUSTOMSEND)(RTMPSockBuf*, const char *, int, void*);
 
+    typedef struct RTMPBuf
+    {
+        const char *buf;
+        int len;
+    } RTMPBuf;
+
     typedef struct RTMP
     {
         int m_inChunkSize;
@@ -413,6 +419,8 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_WriteV(RTMP *r, int packetType, uint32_t timestamp,
+                    const RTMPBuf *bufs, int nbufs, int streamIdx);
 
     /* hashswf.c */
     int RTMP_HashSWF(const char *url, unsigned int *size, unsigned char *hash,
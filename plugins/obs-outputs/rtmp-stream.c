@@ -327,10 +327,48 @@ retry_send:
 	return len;
 }
 
+/* sends the FLV body header and the encoded data as one RTMP message without
+ * first muxing them into a temporary FLV tag */
+static int write_packet(struct rtmp_stream *stream,
+		struct encoder_packet *packet, bool is_header, size_t idx,
+		size_t *size)
+{
+	uint8_t  body_header[FLV_BODY_HEADER_MAX_SIZE];
+	RTMPBuf  bufs[2];
+	uint32_t timestamp;
+	size_t   header_size;
+	int      type;
+
+	*size = 0;
+	if (!packet->data || !packet->size)
+		return 0;
+
+	header_size = flv_packet_body_header(packet,
+			is_header ? 0 : stream->start_dts_offset,
+			body_header, &timestamp, is_header);
+	type = packet->type == OBS_ENCODER_VIDEO ?
+		RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO;
+
+	bufs[0].buf = (const char*)body_header;
+	bufs[0].len = (int)header_size;
+	bufs[1].buf = (const char*)packet->data;
+	bufs[1].len = (int)packet->size;
+
+	/* account for the same bytes as a full FLV tag would have */
+	*size = 11 + header_size + packet->size + 4;
+
+#ifdef TEST_FRAMEDROPS
+	droptest_cap_data_rate(stream, *size);
+#endif
+
+	if (!RTMP_WriteV(&stream->rtmp, type, timestamp, bufs, 2, (int)idx))
+		return -1;
+	return (int)*size;
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
 	size_t  size;
 	int     recv_size = 0;
 	int     ret = 0;
@@ -349,15 +387,7 @@ static int send_packet(struct rtmp_stream *stream,
 		}
 	}
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
-			&data, &size, is_header);
-
-#ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
-#endif
-
-	ret = RTMP_Write(&stream->rtmp, (char*)data, (int)size, (int)idx);
-	bfree(data);
+	ret = write_packet(stream, packet, is_header, idx, &size);
 
 	if (is_header)
 		bfree(packet->data);
@@ -17,14 +17,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <sys/stat.h>
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 #include "find-font.h"
 
 FT_Library ft2_lib;
+os_file_watcher_t *ft2_file_watcher = NULL;
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("text-freetype2", "en-US")
@@ -38,7 +39,8 @@ static struct obs_source_info freetype2_source_info = {
 #ifdef _WIN32
 	                OBS_SOURCE_DEPRECATED |
 #endif
-	                OBS_SOURCE_CUSTOM_DRAW,
+	                OBS_SOURCE_CUSTOM_DRAW |
+	                OBS_SOURCE_STATIC_VIDEO,
 	.get_name = ft2_source_get_name,
 	.create = ft2_source_create,
 	.destroy = ft2_source_destroy,
@@ -78,6 +80,8 @@ bool obs_module_load()
 		bfree(config_dir);
 	}
 
+	ft2_file_watcher = os_file_watcher_create();
+
 	obs_register_source(&freetype2_source_info);
 
 	return true;
@@ -85,6 +89,8 @@ bool obs_module_load()
 
 void obs_module_unload(void)
 {
+	os_file_watcher_destroy(ft2_file_watcher);
+
 	if (plugin_initialized) {
 		free_os_font_list();
 		FT_Done_FreeType(ft2_lib);
@@ -168,6 +174,8 @@ static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
+	os_file_watcher_remove(ft2_file_watcher, srcdata->file_watch);
+
 	if (srcdata->font_face != NULL) {
 		FT_Done_Face(srcdata->font_face);
 		srcdata->font_face = NULL;
@@ -235,32 +243,50 @@ static void ft2_video_tick(void *data, float seconds)
 {
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL) return;
-	if (!srcdata->from_file || !srcdata->text_file) return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
-		time_t t = get_modified_timestamp(srcdata->text_file);
-		srcdata->last_checked = os_gettime_ns();
+	if (os_atomic_set_bool(&srcdata->file_changed, false)) {
+		srcdata->last_change = os_gettime_ns();
+		srcdata->update_file = true;
+	}
 
-		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-					srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
-		}
+	if (!srcdata->update_file) return;
+	if (!srcdata->from_file || !srcdata->text_file) return;
 
-		if (srcdata->m_timestamp != t) {
-			srcdata->m_timestamp = t;
-			srcdata->update_file = true;
-		}
-	}
+	/* wait for the file to settle, programs writing the file may
+	 * truncate it and write it in several steps */
+	if (os_gettime_ns() - srcdata->last_change < 1000000000) return;
+
+	if (srcdata->log_mode)
+		read_from_end(srcdata, srcdata->text_file);
+	else
+		load_text_from_file(srcdata, srcdata->text_file);
+	cache_glyphs(srcdata, srcdata->text);
+	set_up_vertex_buffer(srcdata);
+	obs_source_content_changed(srcdata->src);
+	srcdata->update_file = false;
 
 	UNUSED_PARAMETER(seconds);
 }
 
+static void ft2_file_changed(void *data, const char *path, uint32_t changes)
+{
+	struct ft2_source *srcdata = data;
+	os_atomic_set_bool(&srcdata->file_changed, true);
+
+	UNUSED_PARAMETER(path);
+	UNUSED_PARAMETER(changes);
+}
+
+static void update_file_watch(struct ft2_source *srcdata, const char *path)
+{
+	os_file_watcher_remove(ft2_file_watcher, srcdata->file_watch);
+	srcdata->file_watch = NULL;
+
+	if (path && *path)
+		srcdata->file_watch = os_file_watcher_add(ft2_file_watcher,
+				path, ft2_file_changed, srcdata);
+}
+
 static bool init_font(struct ft2_source *srcdata)
 {
 	FT_Long index;
@@ -406,6 +432,8 @@ skip_font_load:
 	if (from_file) {
 		const char *tmp = obs_data_get_string(settings, "text_file");
 
+		update_file_watch(srcdata, tmp);
+
 		if (!tmp || !*tmp || !os_file_exists(tmp)) {
 			const char *emptystr = " ";
 
@@ -430,11 +458,12 @@ skip_font_load:
 				read_from_end(srcdata, tmp);
 			else
 				load_text_from_file(srcdata, tmp);
-			srcdata->last_checked = os_gettime_ns();
 		}
 	}
 	else {
 		const char *tmp = obs_data_get_string(settings, "text");
+
+		update_file_watch(srcdata, NULL);
 		if (!tmp || !*tmp) goto error;
 
 		if (srcdata->text != NULL) {
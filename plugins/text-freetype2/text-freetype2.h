@@ -16,6 +16,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
 #include <obs-module.h>
+#include <util/file-watcher.h>
 #include <ft2build.h>
 
 #define num_cache_slots 65535
@@ -37,9 +38,10 @@ struct ft2_source {
 	bool from_file;
 	char *text_file;
 	wchar_t *text;
-	time_t m_timestamp;
+	os_file_watch_t *file_watch;
+	volatile bool file_changed;
 	bool update_file;
-	uint64_t last_checked;
+	uint64_t last_change;
 
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t texbuf_x, texbuf_y;
@@ -66,6 +68,7 @@ struct ft2_source {
 };
 
 extern FT_Library ft2_lib;
+extern os_file_watcher_t *ft2_file_watcher;
 
 static void *ft2_source_create(obs_data_t *settings, obs_source_t *source);
 static void ft2_source_destroy(void *data);
@@ -85,7 +88,6 @@ static const char *ft2_source_get_name(void *unused);
 
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
 
-time_t get_modified_timestamp(char *filename);
 void load_text_from_file(struct ft2_source *srcdata, const char *filename);
 void read_from_end(struct ft2_source *srcdata, const char *filename);
 
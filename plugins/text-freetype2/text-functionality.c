@@ -19,7 +19,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <util/platform.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <sys/stat.h>
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 
@@ -324,18 +323,6 @@ void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
 	}
 }
 
-time_t get_modified_timestamp(char *filename)
-{
-	struct stat stats;
-
-	// stat is apparently terrifying and horrible, but we only call it once
-	// every second at most.
-	if (os_stat(filename, &stats) != 0)
-		return -1;
-
-	return stats.st_mtime;
-}
-
 static void remove_cr(wchar_t* source)
 {
 	int j = 0;
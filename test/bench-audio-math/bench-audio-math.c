@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-math.h>
+
+/*
+ * Measures the scalar, SSE and AVX audio math routines on one channel of an
+ * audio output tick: mixing a buffer into another, and computing its peak
+ * and sum of squares for the volume meters.  The buffers are offset by one
+ * float so that the vector loops run on unaligned data like in the mixer.
+ */
+
+#define FRAMES     1024
+#define ITERATIONS 200000
+
+static const struct {
+	const char *name;
+	uint32_t   features;
+} variants[] = {
+	{"C",   0},
+	{"SSE", OS_CPU_SSE2},
+	{"AVX", OS_CPU_SSE2 | OS_CPU_AVX},
+};
+
+static float *dst;
+static float *src;
+static volatile float result;
+
+static double bench_mix(void)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < ITERATIONS; i++)
+		audio_mix_floats(dst, src, FRAMES);
+
+	result = dst[0];
+	return (double)(os_gettime_ns() - start) / ITERATIONS;
+}
+
+static double bench_peak(void)
+{
+	uint64_t start = os_gettime_ns();
+	float peak = 0.0f;
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < ITERATIONS; i++)
+		audio_get_peak_and_power(src, FRAMES, &peak, &sum);
+
+	result = peak + sum;
+	return (double)(os_gettime_ns() - start) / ITERATIONS;
+}
+
+static void fill(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = sinf((float)i * 0.01f) * 0.8f;
+}
+
+int main(void)
+{
+	float *dst_buf = bmalloc((FRAMES + 1) * sizeof(float));
+	float *src_buf = bmalloc((FRAMES + 1) * sizeof(float));
+	const char *prev = NULL;
+	double base_mix = 0.0;
+	double base_peak = 0.0;
+
+	dst = dst_buf + 1;
+	src = src_buf + 1;
+	fill(src, FRAMES);
+
+	for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+		const char *name = audio_math_select(variants[i].features);
+		double mix, peak;
+
+		if (name == prev) {
+			printf("%-3s: not supported by this CPU, skipped\n",
+					variants[i].name);
+			continue;
+		}
+
+		prev = name;
+		fill(dst, FRAMES);
+
+		mix = bench_mix();
+		peak = bench_peak();
+
+		if (i == 0) {
+			base_mix = mix;
+			base_peak = peak;
+		}
+
+		printf("%-3s: mix %7.1f ns (%4.1fx), "
+				"peak/power %7.1f ns (%4.1fx) per %d frames\n",
+				name, mix, base_mix / mix,
+				peak, base_peak / peak, FRAMES);
+	}
+
+	bfree(dst_buf);
+	bfree(src_buf);
+	return 0;
+}
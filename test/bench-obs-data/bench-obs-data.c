@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <obs-data.h>
+
+/*
+ * Builds a scene collection with 500 sources laid out like the ones the
+ * frontend saves (settings with a few dozen keys, filters, hotkeys and scenes
+ * with item lists), then measures how long parsing it from JSON takes and
+ * how long the getters take to look up the keys a collection load reads.
+ */
+
+#define SOURCES           500
+#define SCENES            50
+#define ITEMS_PER_SCENE   9
+#define PARSE_ITERATIONS  20
+#define LOOKUP_PASSES     200
+
+static const char *setting_keys[] = {
+	"text", "font", "color", "color1", "color2", "gradient",
+	"gradient_color", "gradient_dir", "opacity", "outline",
+	"outline_size", "outline_color", "drop_shadow", "custom_width",
+	"word_wrap", "from_file", "text_file", "log_mode", "log_lines",
+	"url", "is_local_file", "local_file", "width", "height", "fps",
+	"css", "shutdown", "restart_when_active", "reroute_audio",
+	"looping", "hw_decode", "close_when_inactive",
+};
+
+#define NUM_SETTING_KEYS (sizeof(setting_keys) / sizeof(setting_keys[0]))
+
+static volatile long long result;
+
+static obs_data_t *create_settings(size_t idx)
+{
+	obs_data_t *settings = obs_data_create();
+
+	for (size_t i = 0; i < NUM_SETTING_KEYS; i++) {
+		if (i % 2)
+			obs_data_set_int(settings, setting_keys[i],
+					(long long)(idx * i));
+		else
+			obs_data_set_string(settings, setting_keys[i],
+					"some setting value");
+	}
+
+	return settings;
+}
+
+static obs_data_t *create_scene_items(obs_data_t *settings, size_t scene)
+{
+	obs_data_array_t *items = obs_data_array_create();
+
+	for (size_t i = 0; i < ITEMS_PER_SCENE; i++) {
+		obs_data_t *item = obs_data_create();
+		obs_data_t *pos = obs_data_create();
+		struct dstr name = {0};
+
+		dstr_printf(&name, "Source %zu", scene * ITEMS_PER_SCENE + i);
+		obs_data_set_string(item, "name", name.array);
+		obs_data_set_int(item, "id", (long long)i + 1);
+		obs_data_set_bool(item, "visible", true);
+		obs_data_set_bool(item, "locked", false);
+		obs_data_set_int(item, "align", 5);
+		obs_data_set_double(pos, "x", (double)i * 10.0);
+		obs_data_set_double(pos, "y", (double)i * 20.0);
+		obs_data_set_obj(item, "pos", pos);
+		obs_data_set_obj(item, "scale", pos);
+
+		obs_data_array_push_back(items, item);
+		obs_data_release(pos);
+		obs_data_release(item);
+		dstr_free(&name);
+	}
+
+	obs_data_set_array(settings, "items", items);
+	obs_data_set_int(settings, "id_counter", ITEMS_PER_SCENE);
+	obs_data_array_release(items);
+	return settings;
+}
+
+static char *create_collection_json(void)
+{
+	obs_data_t *collection = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+	char *json;
+
+	for (size_t i = 0; i < SOURCES; i++) {
+		bool scene = i >= SOURCES - SCENES;
+		obs_data_t *source = obs_data_create();
+		obs_data_t *settings = scene ?
+			create_scene_items(obs_data_create(),
+					i - (SOURCES - SCENES)) :
+			create_settings(i);
+		obs_data_t *hotkeys = obs_data_create();
+		obs_data_array_t *filters = obs_data_array_create();
+		struct dstr name = {0};
+
+		dstr_printf(&name, scene ? "Scene %zu" : "Source %zu", i);
+		obs_data_set_string(source, "name", name.array);
+		obs_data_set_string(source, "id", scene ? "scene" : "text_ft2");
+		obs_data_set_obj(source, "settings", settings);
+		obs_data_set_double(source, "volume", 1.0);
+		obs_data_set_int(source, "mixers", 0xFF);
+		obs_data_set_int(source, "flags", 0);
+		obs_data_set_int(source, "sync", 0);
+		obs_data_set_bool(source, "muted", false);
+		obs_data_set_bool(source, "enabled", true);
+		obs_data_set_int(source, "deinterlace_mode", 0);
+		obs_data_set_int(source, "monitoring_type", 0);
+		obs_data_set_bool(source, "push-to-mute", false);
+		obs_data_set_obj(source, "hotkeys", hotkeys);
+		obs_data_set_array(source, "filters", filters);
+
+		obs_data_array_push_back(sources, source);
+		obs_data_array_release(filters);
+		obs_data_release(hotkeys);
+		obs_data_release(settings);
+		obs_data_release(source);
+		dstr_free(&name);
+	}
+
+	obs_data_set_string(collection, "name", "Benchmark");
+	obs_data_set_string(collection, "current_scene", "Scene 450");
+	obs_data_set_array(collection, "sources", sources);
+
+	json = bstrdup(obs_data_get_json(collection));
+
+	obs_data_array_release(sources);
+	obs_data_release(collection);
+	return json;
+}
+
+static double bench_parse(const char *json)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < PARSE_ITERATIONS; i++) {
+		obs_data_t *collection = obs_data_create_from_json(json);
+		obs_data_release(collection);
+	}
+
+	return (double)(os_gettime_ns() - start) / PARSE_ITERATIONS;
+}
+
+/* the getters a collection load calls for each source and its settings */
+static long long lookup_source(obs_data_t *source, size_t *lookups)
+{
+	obs_data_t *settings = obs_data_get_obj(source, "settings");
+	long long sum = 0;
+
+	sum += (long long)strlen(obs_data_get_string(source, "name"));
+	sum += (long long)strlen(obs_data_get_string(source, "id"));
+	sum += obs_data_get_int(source, "mixers");
+	sum += obs_data_get_int(source, "flags");
+	sum += obs_data_get_int(source, "sync");
+	sum += obs_data_get_int(source, "deinterlace_mode");
+	sum += obs_data_get_int(source, "monitoring_type");
+	sum += obs_data_get_bool(source, "muted");
+	sum += obs_data_get_bool(source, "enabled");
+	sum += (long long)obs_data_get_double(source, "volume");
+	*lookups += 11;
+
+	for (size_t i = 0; i < NUM_SETTING_KEYS; i++) {
+		if (i % 2)
+			sum += obs_data_get_int(settings, setting_keys[i]);
+		else
+			sum += (long long)strlen(obs_data_get_string(settings,
+						setting_keys[i]));
+	}
+	*lookups += NUM_SETTING_KEYS;
+
+	obs_data_release(settings);
+	return sum;
+}
+
+static double bench_lookup(obs_data_t *collection)
+{
+	obs_data_array_t *sources = obs_data_get_array(collection, "sources");
+	size_t count = obs_data_array_count(sources);
+	obs_data_t **items = bmalloc(count * sizeof(obs_data_t *));
+	size_t lookups = 0;
+	long long sum = 0;
+	uint64_t start;
+	double ns;
+
+	for (size_t i = 0; i < count; i++)
+		items[i] = obs_data_array_item(sources, i);
+
+	start = os_gettime_ns();
+	for (size_t pass = 0; pass < LOOKUP_PASSES; pass++)
+		for (size_t i = 0; i < count; i++)
+			sum += lookup_source(items[i], &lookups);
+
+	ns = (double)(os_gettime_ns() - start) / lookups;
+	result = sum;
+
+	for (size_t i = 0; i < count; i++)
+		obs_data_release(items[i]);
+	bfree(items);
+	obs_data_array_release(sources);
+	return ns;
+}
+
+int main(void)
+{
+	char *json = create_collection_json();
+	obs_data_t *collection = obs_data_create_from_json(json);
+
+	printf("collection: %d sources, %zu bytes of JSON\n", SOURCES,
+			strlen(json));
+	printf("parse:  %8.3f ms per collection\n", bench_parse(json) / 1e6);
+	printf("lookup: %8.1f ns per key\n", bench_lookup(collection));
+
+	obs_data_release(collection);
+	bfree(json);
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/platform.h>
+#include <util/threading.h>
+#include <callback/signal.h>
+
+/*
+ * Measures the cost of emitting a signal with 0, 1 and 10 callbacks, by name
+ * and with a pre-resolved handle, and again while another thread keeps
+ * connecting and disconnecting a callback to the same signal.
+ */
+
+#define ITERATIONS 2000000
+
+static const char *bench_signals[] = {
+	"void first(ptr source)",
+	"void second(ptr source)",
+	"void third(ptr source)",
+	"void volume(ptr source, in out float volume)",
+	NULL
+};
+
+static volatile long calls = 0;
+static volatile bool stop = false;
+
+static void bench_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+	os_atomic_inc_long(&calls);
+}
+
+static void *churn_thread(void *param)
+{
+	signal_handler_t *handler = param;
+
+	while (!os_atomic_load_bool(&stop)) {
+		signal_handler_connect(handler, "volume", bench_callback,
+				handler);
+		signal_handler_disconnect(handler, "volume", bench_callback,
+				handler);
+	}
+
+	return NULL;
+}
+
+static double bench_by_name(signal_handler_t *handler)
+{
+	struct calldata cd;
+	uint8_t stack[128];
+	uint64_t start;
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+	calldata_set_float(&cd, "volume", 1.0);
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < ITERATIONS; i++)
+		signal_handler_signal(handler, "volume", &cd);
+
+	return (double)(os_gettime_ns() - start) / ITERATIONS;
+}
+
+static double bench_by_handle(signal_handle_t *signal)
+{
+	struct calldata cd;
+	uint8_t stack[128];
+	uint64_t start;
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+	calldata_set_float(&cd, "volume", 1.0);
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < ITERATIONS; i++)
+		signal_handle_emit(signal, &cd);
+
+	return (double)(os_gettime_ns() - start) / ITERATIONS;
+}
+
+static void run(size_t num_callbacks, bool churn)
+{
+	signal_handler_t *handler = signal_handler_create();
+	signal_handle_t *signal;
+	pthread_t thread;
+
+	signal_handler_add_array(handler, bench_signals);
+	signal = signal_handler_get_handle(handler, "volume");
+
+	for (size_t i = 0; i < num_callbacks; i++)
+		signal_handler_connect(handler, "volume", bench_callback,
+				(void*)(uintptr_t)(i + 1));
+
+	if (churn) {
+		os_atomic_set_bool(&stop, false);
+		pthread_create(&thread, NULL, churn_thread, handler);
+	}
+
+	double by_name = bench_by_name(handler);
+	double by_handle = bench_by_handle(signal);
+
+	if (churn) {
+		os_atomic_set_bool(&stop, true);
+		pthread_join(thread, NULL);
+	}
+
+	printf("%2d callbacks%s: %7.1f ns by name, %7.1f ns by handle\n",
+			(int)num_callbacks,
+			churn ? " (connect/disconnect churn)" : "",
+			by_name, by_handle);
+
+	signal_handler_destroy(handler);
+}
+
+int main(void)
+{
+	run(0, false);
+	run(1, false);
+	run(10, false);
+	run(0, true);
+	run(1, true);
+	run(10, true);
+
+	printf("%ld callbacks called\n", os_atomic_load_long(&calls));
+
+	return 0;
+}
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+
+/*
+ * Creates 2000 sources and a scene holding all of them, then measures the
+ * lookups that scripting and remote control make all the time: a source by
+ * name, a scene item by source and by id.  Then measures renaming every
+ * source and removing and releasing them.
+ */
+
+#define SOURCES          2000
+#define LOOKUP_PASSES    50
+
+static const char *bench_source_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "bench source";
+}
+
+static void *bench_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void bench_source_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static uint32_t bench_source_get_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 64;
+}
+
+static struct obs_source_info bench_source_info = {
+	.id           = "bench_source",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name     = bench_source_get_name,
+	.create       = bench_source_create,
+	.destroy      = bench_source_destroy,
+	.get_width    = bench_source_get_size,
+	.get_height   = bench_source_get_size,
+};
+
+static obs_source_t *sources[SOURCES];
+static obs_sceneitem_t *items[SOURCES];
+static struct dstr names[SOURCES];
+static volatile size_t result;
+
+static size_t lookup_order(size_t i)
+{
+	/* visits every index once per pass, in a scattered order */
+	return (i * 7919) % SOURCES;
+}
+
+static void print_result(const char *name, uint64_t start, size_t count)
+{
+	double ns = (double)(os_gettime_ns() - start) / count;
+	printf("%-28s %10.1f ns\n", name, ns);
+}
+
+static void bench_get_by_name(void)
+{
+	uint64_t start = os_gettime_ns();
+	size_t found = 0;
+
+	for (size_t pass = 0; pass < LOOKUP_PASSES; pass++) {
+		for (size_t i = 0; i < SOURCES; i++) {
+			obs_source_t *source = obs_get_source_by_name(
+					names[lookup_order(i)].array);
+			found += source != NULL;
+			obs_source_release(source);
+		}
+	}
+
+	print_result("obs_get_source_by_name", start, LOOKUP_PASSES * SOURCES);
+	result = found;
+}
+
+static void bench_find_source(obs_scene_t *scene)
+{
+	uint64_t start = os_gettime_ns();
+	size_t found = 0;
+
+	for (size_t pass = 0; pass < LOOKUP_PASSES; pass++)
+		for (size_t i = 0; i < SOURCES; i++)
+			found += obs_scene_find_source(scene,
+					names[lookup_order(i)].array) != NULL;
+
+	print_result("obs_scene_find_source", start, LOOKUP_PASSES * SOURCES);
+	result = found;
+}
+
+static void bench_find_by_id(obs_scene_t *scene)
+{
+	int64_t ids[SOURCES];
+	uint64_t start;
+	size_t found = 0;
+
+	for (size_t i = 0; i < SOURCES; i++)
+		ids[i] = obs_sceneitem_get_id(items[i]);
+
+	start = os_gettime_ns();
+	for (size_t pass = 0; pass < LOOKUP_PASSES; pass++)
+		for (size_t i = 0; i < SOURCES; i++)
+			found += obs_scene_find_sceneitem_by_id(scene,
+					ids[lookup_order(i)]) != NULL;
+
+	print_result("obs_scene_find_sceneitem_by_id", start,
+			LOOKUP_PASSES * SOURCES);
+	result = found;
+}
+
+static void bench_rename(void)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < SOURCES; i++) {
+		dstr_printf(&names[i], "Renamed source %zu", i);
+		obs_source_set_name(sources[i], names[i].array);
+	}
+
+	print_result("obs_source_set_name", start, SOURCES);
+}
+
+static void bench_destroy(void)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < SOURCES; i++) {
+		obs_source_remove(sources[i]);
+		obs_source_release(sources[i]);
+	}
+
+	print_result("obs_source_remove + release", start, SOURCES);
+}
+
+static bool check_lookups(obs_scene_t *scene)
+{
+	for (size_t i = 0; i < SOURCES; i++) {
+		obs_source_t *source = obs_get_source_by_name(names[i].array);
+		obs_sceneitem_t *item = obs_scene_find_source(scene,
+				names[i].array);
+		bool found = source == sources[i] && item == items[i];
+
+		obs_source_release(source);
+		if (!found) {
+			printf("FAIL: \"%s\" not found\n", names[i].array);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	obs_scene_t *scene;
+	uint64_t start;
+	bool success = true;
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("FAIL: obs_startup failed\n");
+		return 1;
+	}
+
+	obs_register_source(&bench_source_info);
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < SOURCES; i++) {
+		dstr_printf(&names[i], "Source %zu", i);
+		sources[i] = obs_source_create("bench_source", names[i].array,
+				NULL, NULL);
+		if (!sources[i]) {
+			printf("FAIL: could not create \"%s\"\n",
+					names[i].array);
+			return 1;
+		}
+	}
+	print_result("obs_source_create", start, SOURCES);
+
+	scene = obs_scene_create("Bench scene");
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < SOURCES; i++)
+		items[i] = obs_scene_add(scene, sources[i]);
+	print_result("obs_scene_add", start, SOURCES);
+
+	success = check_lookups(scene);
+
+	bench_get_by_name();
+	bench_find_source(scene);
+	bench_find_by_id(scene);
+	bench_rename();
+
+	/* the indexes have to follow the renames */
+	success = success && check_lookups(scene);
+
+	bench_get_by_name();
+	bench_destroy();
+
+	obs_scene_release(scene);
+	obs_shutdown();
+
+	for (size_t i = 0; i < SOURCES; i++)
+		dstr_free(&names[i]);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <callback/decl.h>
+#include <callback/proc.h>
+#include <callback/signal.h>
+
+/*
+ * Checks calldata storage: parameters stay in the inline buffer until they
+ * outgrow it, and calldata laid out from a declaration can be read and
+ * written by index, mixed freely with access by name, including after a
+ * laid out parameter is resized by name.  Also checks that signalling and
+ * calling a procedure with calldata from their declaration allocate
+ * nothing, and measures setting three parameters and getting one by name
+ * and by index.
+ */
+
+#define ITERATIONS 1000000
+
+static int failures = 0;
+
+#define check(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL: %s:%d: %s\n", __func__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (false)
+
+static void test_inline(void)
+{
+	long base = bnum_allocs();
+	char big[400];
+	calldata_t cd;
+
+	calldata_init(&cd);
+	calldata_set_ptr(&cd, "source", &cd);
+	calldata_set_float(&cd, "volume", 1.0);
+	calldata_set_string(&cd, "name", "hello");
+	calldata_set_int(&cd, "x", 4);
+
+	check(bnum_allocs() == base);
+	check(cd.stack == cd.inline_stack);
+
+	memset(big, 'a', sizeof(big) - 1);
+	big[sizeof(big) - 1] = 0;
+	calldata_set_string(&cd, "big", big);
+
+	check(bnum_allocs() == base + 1);
+	check(cd.stack != cd.inline_stack);
+	check(calldata_ptr(&cd, "source") == &cd);
+	check(calldata_float(&cd, "volume") == 1.0);
+	check(strcmp(calldata_string(&cd, "name"), "hello") == 0);
+	check(calldata_int(&cd, "x") == 4);
+	check(strlen(calldata_string(&cd, "big")) == sizeof(big) - 1);
+
+	calldata_free(&cd);
+	check(bnum_allocs() == base);
+
+	/* zero initialized calldata is valid as well */
+	calldata_t zeroed = {0};
+	calldata_set_int(&zeroed, "a", 3);
+	check(calldata_int(&zeroed, "a") == 3);
+	calldata_free(&zeroed);
+}
+
+static void test_indexed(void)
+{
+	struct decl_info decl = {0};
+	const char *str;
+	char buf[3];
+	long long ret;
+	double val;
+	bool b;
+	calldata_t cd;
+
+	check(parse_decl_string(&decl, "int f(ptr source, string name, "
+				"in out float volume, bool b, data levels)"));
+
+	calldata_init_decl(&cd, &decl);
+	check(cd.indexed);
+	check(calldata_get_int(&cd, "return", &ret) && ret == 0);
+
+	calldata_set_indexed_ptr(&cd, 0, (void*)0x55);
+	calldata_set_indexed_float(&cd, 2, 0.5);
+	calldata_set_indexed_bool(&cd, 3, true);
+	calldata_set_indexed(&cd, 4, "lv", 3);
+
+	/* strings and data aren't laid out, and are found by name */
+	calldata_set_data(&cd, "name", "nm", 3);
+	check(calldata_get_string(&cd, "name", &str) && strcmp(str, "nm") == 0);
+	check(calldata_get_indexed(&cd, 1, buf, 3) && strcmp(buf, "nm") == 0);
+	check(calldata_get_data(&cd, "levels", buf, 3) &&
+			strcmp(buf, "lv") == 0);
+
+	check(calldata_ptr(&cd, "source") == (void*)0x55);
+	check(calldata_float(&cd, "volume") == 0.5);
+	check(calldata_bool(&cd, "b"));
+
+	calldata_set_float(&cd, "volume", 0.75);
+	check(calldata_get_indexed_float(&cd, 2, &val) && val == 0.75);
+	check(cd.indexed);
+
+	/* resizing a laid out parameter by name moves the ones after it */
+	calldata_set_data(&cd, "source", "xyzxyzxyzxyz", 13);
+	check(!cd.indexed);
+
+	calldata_set_indexed_float(&cd, 2, 0.25);
+	check(calldata_float(&cd, "volume") == 0.25);
+	check(calldata_get_indexed_float(&cd, 2, &val) && val == 0.25);
+	check(calldata_get_indexed_bool(&cd, 3, &b) && b);
+
+	calldata_clear(&cd);
+	check(!cd.decl);
+
+	calldata_free(&cd);
+	decl_info_free(&decl);
+}
+
+static double received_volume = 0.0;
+
+static void volume_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+
+	received_volume = calldata_float(cd, "volume");
+	calldata_set_float(cd, "volume", received_volume * 2.0);
+}
+
+static void add_proc(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+
+	calldata_set_int(cd, "return", calldata_int(cd, "a") +
+			calldata_int(cd, "b"));
+}
+
+static void test_no_allocations(void)
+{
+	signal_handler_t *handler = signal_handler_create();
+	proc_handler_t *procs = proc_handler_create();
+	signal_handle_t *volume;
+	long long ret;
+	double val;
+	calldata_t cd;
+	long base;
+
+	signal_handler_add(handler,
+			"void volume(ptr source, in out float volume)");
+	volume = signal_handler_get_handle(handler, "volume");
+	signal_handler_connect(handler, "volume", volume_callback, NULL);
+
+	base = bnum_allocs();
+	for (int i = 0; i < 100; i++) {
+		signal_handle_init_calldata(volume, &cd);
+		calldata_set_indexed_ptr(&cd, 0, handler);
+		calldata_set_indexed_float(&cd, 1, 3.0);
+		signal_handle_emit(volume, &cd);
+
+		check(received_volume == 3.0);
+		check(calldata_get_indexed_float(&cd, 1, &val) && val == 6.0);
+		calldata_free(&cd);
+	}
+	check(bnum_allocs() == base);
+
+	proc_handler_add(procs, "int add(int a, int b)", add_proc, NULL);
+	check(proc_handler_init_calldata(procs, "add", &cd));
+	calldata_set_indexed_int(&cd, 0, 2);
+	calldata_set_indexed_int(&cd, 1, 40);
+
+	base = bnum_allocs();
+	check(proc_handler_call(procs, "add", &cd));
+	check(bnum_allocs() == base);
+	check(calldata_get_indexed_int(&cd, 2, &ret) && ret == 42);
+	calldata_free(&cd);
+
+	check(!proc_handler_init_calldata(procs, "missing", &cd));
+	calldata_free(&cd);
+
+	proc_handler_destroy(procs);
+	signal_handler_destroy(handler);
+}
+
+static volatile double result;
+
+static void bench_access(void)
+{
+	struct decl_info decl = {0};
+	double sum = 0.0;
+	uint64_t start;
+	double by_name;
+	double by_index;
+	calldata_t cd;
+
+	calldata_init(&cd);
+	start = os_gettime_ns();
+	for (int i = 0; i < ITERATIONS; i++) {
+		calldata_clear(&cd);
+		calldata_set_ptr(&cd, "source", &cd);
+		calldata_set_float(&cd, "volume", i);
+		calldata_set_bool(&cd, "muted", false);
+		sum += calldata_float(&cd, "volume");
+	}
+	by_name = (double)(os_gettime_ns() - start) / ITERATIONS;
+	calldata_free(&cd);
+
+	parse_decl_string(&decl, "void f(ptr source, float volume, bool muted)");
+	start = os_gettime_ns();
+	for (int i = 0; i < ITERATIONS; i++) {
+		double val;
+
+		calldata_init_decl(&cd, &decl);
+		calldata_set_indexed_ptr(&cd, 0, &cd);
+		calldata_set_indexed_float(&cd, 1, i);
+		calldata_set_indexed_bool(&cd, 2, false);
+		calldata_get_indexed_float(&cd, 1, &val);
+		sum += val;
+		calldata_free(&cd);
+	}
+	by_index = (double)(os_gettime_ns() - start) / ITERATIONS;
+	decl_info_free(&decl);
+
+	result = sum;
+	printf("set 3, get 1: %6.1f ns by name, %6.1f ns by index\n",
+			by_name, by_index);
+}
+
+int main(void)
+{
+	test_inline();
+	test_indexed();
+	test_no_allocations();
+	bench_access();
+
+	if (bnum_allocs() != 0) {
+		printf("FAIL: %ld allocations leaked\n", bnum_allocs());
+		failures++;
+	}
+
+	return failures ? 1 : 0;
+}
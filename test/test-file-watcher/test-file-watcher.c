@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/file-watcher.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+/*
+ * Checks that the file watcher reports writes, creation and deletion of a
+ * watched file and changes to the entries of a watched directory, and that
+ * removing the directory of a watched file and creating it again doesn't
+ * leave the file polled forever: writes are reported right away again, even
+ * ones that keep the size and happen within the same second, which polling
+ * can't tell apart.
+ */
+
+#define TEST_DIR         "test-file-watcher.tmp"
+#define TEST_FILE        TEST_DIR "/file.txt"
+#define TEST_OTHER_FILE  TEST_DIR "/other.txt"
+#define WAIT_MS          3000
+#define FAST_MS          500
+#define REWATCH_MS       2500
+#define FAST_WRITES      5
+
+struct watched {
+	volatile long changes;
+	volatile long calls;
+};
+
+static int failures = 0;
+
+static void fail(const char *message)
+{
+	printf("FAIL: %s\n", message);
+	failures++;
+}
+
+static void changed(void *param, const char *path, uint32_t changes)
+{
+	struct watched *w = param;
+
+	UNUSED_PARAMETER(path);
+
+	os_atomic_set_long(&w->changes,
+			os_atomic_load_long(&w->changes) | (long)changes);
+	os_atomic_inc_long(&w->calls);
+}
+
+static void reset(struct watched *w)
+{
+	os_atomic_set_long(&w->changes, 0);
+	os_atomic_set_long(&w->calls, 0);
+}
+
+/* returns how long it took for the change to be reported, or -1 */
+static int wait_for(struct watched *w, uint32_t change, int timeout_ms)
+{
+	for (int ms = 0; ms < timeout_ms; ms++) {
+		if (os_atomic_load_long(&w->changes) & (long)change)
+			return ms;
+		os_sleep_ms(1);
+	}
+
+	return -1;
+}
+
+static bool write_file(const char *path, const char *text)
+{
+	FILE *f = os_fopen(path, "wb");
+	if (!f)
+		return false;
+
+	fputs(text, f);
+	fclose(f);
+	return true;
+}
+
+static void expect(struct watched *w, uint32_t change, const char *what)
+{
+	if (wait_for(w, change, WAIT_MS) < 0) {
+		printf("FAIL: %s was not reported\n", what);
+		failures++;
+	}
+	reset(w);
+}
+
+int main(void)
+{
+	struct watched file = {0};
+	struct watched dir = {0};
+	os_file_watcher_t *fw;
+	int max_ms = 0;
+
+	os_unlink(TEST_FILE);
+	os_unlink(TEST_OTHER_FILE);
+	os_rmdir(TEST_DIR);
+	if (os_mkdir(TEST_DIR) == MKDIR_ERROR) {
+		printf("FAIL: could not create " TEST_DIR "\n");
+		return 1;
+	}
+
+	fw = os_file_watcher_create();
+	if (!fw) {
+		printf("FAIL: could not create the file watcher\n");
+		return 1;
+	}
+
+	os_file_watcher_add(fw, TEST_FILE, changed, &file);
+	os_file_watcher_add(fw, TEST_DIR, changed, &dir);
+	os_sleep_ms(100);
+
+	write_file(TEST_FILE, "aaaa");
+	expect(&file, OS_FILE_CREATED | OS_FILE_MODIFIED, "creating the file");
+	reset(&dir);
+
+	write_file(TEST_FILE, "aaaaaaaa");
+	expect(&file, OS_FILE_MODIFIED, "writing the file");
+
+	write_file(TEST_OTHER_FILE, "b");
+	expect(&dir, OS_FILE_CREATED | OS_FILE_MODIFIED,
+			"creating a file in the directory");
+
+	os_unlink(TEST_OTHER_FILE);
+	expect(&dir, OS_FILE_DELETED, "deleting a file in the directory");
+
+	/* the directory goes away and comes back */
+	os_unlink(TEST_FILE);
+	expect(&file, OS_FILE_DELETED, "deleting the file");
+	os_rmdir(TEST_DIR);
+	os_sleep_ms(100);
+
+	os_mkdir(TEST_DIR);
+	write_file(TEST_FILE, "aaaa");
+	expect(&file, OS_FILE_CREATED | OS_FILE_MODIFIED,
+			"creating the file again");
+
+	os_sleep_ms(REWATCH_MS);
+	reset(&file);
+
+	for (int i = 0; i < FAST_WRITES; i++) {
+		int ms;
+
+		write_file(TEST_FILE, (i & 1) ? "aaaa" : "bbbb");
+		ms = wait_for(&file, OS_FILE_MODIFIED, WAIT_MS);
+		reset(&file);
+
+		if (ms < 0) {
+			fail("write after the directory came back was missed");
+			break;
+		}
+		if (ms > max_ms)
+			max_ms = ms;
+	}
+
+#ifdef __linux__
+	/* polled paths are only checked once a second */
+	if (max_ms > FAST_MS)
+		fail("the file is still polled after its directory came back");
+#endif
+
+	printf("writes after the directory came back: %d ms max\n", max_ms);
+
+	os_file_watcher_destroy(fw);
+
+	os_unlink(TEST_FILE);
+	os_rmdir(TEST_DIR);
+	return failures ? 1 : 0;
+}
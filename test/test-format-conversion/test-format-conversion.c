@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/format-conversion.h>
+
+/*
+ * Runs every SSSE3 and AVX2 conversion routine the CPU supports against the
+ * baseline SSE2/C routine on the same input, over odd frame sizes and over
+ * partial row ranges, and fails on any byte of difference in the output.
+ *
+ * The packed UYVX compress routines work on 4 pixels at a time, so their
+ * linesizes are padded to a multiple of 4 like a real frame's; the widths of
+ * the planar decompress routines are used as is.  Only the rows inside the
+ * frame are compared: the baseline routines work on pairs of rows and write
+ * one row past the bottom of a frame with an odd height.
+ */
+
+#define SLACK 64
+
+static const uint32_t widths[] = {
+	1, 3, 5, 7, 9, 15, 17, 31, 33, 63, 65, 99, 641, 1279
+};
+
+static const uint32_t heights[] = {
+	1, 3, 5, 7, 33, 121
+};
+
+static const struct {
+	const char *name;
+	uint32_t   features;
+} variants[] = {
+	{"SSSE3", OS_CPU_SSSE3},
+	{"AVX2",  OS_CPU_SSSE3 | OS_CPU_AVX2},
+};
+
+static const char *variant_name = NULL;
+static uint32_t   variant_features = 0;
+
+static uint32_t rand_state = 1;
+static size_t   checks = 0;
+static size_t   failures = 0;
+
+static uint8_t *alloc_random(size_t size)
+{
+	uint8_t *data = bmalloc(size);
+
+	for (size_t i = 0; i < size; i++) {
+		rand_state ^= rand_state << 13;
+		rand_state ^= rand_state >> 17;
+		rand_state ^= rand_state << 5;
+		data[i] = (uint8_t)rand_state;
+	}
+
+	return data;
+}
+
+static uint8_t *alloc_copy(const uint8_t *src, size_t size)
+{
+	uint8_t *data = bmalloc(size);
+	memcpy(data, src, size);
+	return data;
+}
+
+static void compare(const char *routine, const char *plane,
+		uint32_t width, uint32_t height, uint32_t start_y,
+		uint32_t end_y, const uint8_t *expected, const uint8_t *actual,
+		size_t size, uint32_t linesize)
+{
+	checks++;
+
+	for (size_t i = 0; i < size; i++) {
+		if (expected[i] == actual[i])
+			continue;
+
+		printf("FAIL: %s (%s) %s, %"PRIu32"x%"PRIu32", "
+				"rows %"PRIu32"-%"PRIu32": "
+				"row %zu, byte %zu: expected %02x, got %02x\n",
+				routine, variant_name, plane,
+				width, height, start_y, end_y,
+				i / linesize, i % linesize,
+				expected[i], actual[i]);
+		failures++;
+		return;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef void (*compress_func)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+
+static void test_compress(const char *routine, compress_func func,
+		uint32_t width, uint32_t height, uint32_t start_y,
+		uint32_t end_y, bool half_height_chroma,
+		const uint32_t out_linesize[3])
+{
+	/* rows are processed in pairs, so an odd height touches one more */
+	uint32_t in_linesize = ((width + 3) & ~3) * 4;
+	size_t in_size = (size_t)in_linesize * (height + 1) + SLACK;
+	uint8_t *input = alloc_random(in_size);
+	uint8_t *expected[3] = {0};
+	uint8_t *actual[3] = {0};
+	size_t sizes[3] = {0};
+	size_t frame_sizes[3] = {0};
+	static const char *plane_names[] = {"plane 0", "plane 1", "plane 2"};
+
+	for (size_t i = 0; i < 3; i++) {
+		uint32_t rows = height;
+		if (!out_linesize[i])
+			continue;
+		if (i > 0 && half_height_chroma)
+			rows = (rows + 1) / 2;
+
+		frame_sizes[i] = (size_t)out_linesize[i] * rows;
+		sizes[i]    = frame_sizes[i] + out_linesize[i] + SLACK;
+		expected[i] = alloc_random(sizes[i]);
+		actual[i]   = alloc_copy(expected[i], sizes[i]);
+	}
+
+	format_conversion_select(0);
+	func(input, in_linesize, start_y, end_y, expected, out_linesize);
+	format_conversion_select(variant_features);
+	func(input, in_linesize, start_y, end_y, actual, out_linesize);
+
+	for (size_t i = 0; i < 3; i++) {
+		if (!sizes[i])
+			continue;
+
+		compare(routine, plane_names[i], width, height, start_y, end_y,
+				expected[i], actual[i], frame_sizes[i],
+				out_linesize[i]);
+		bfree(expected[i]);
+		bfree(actual[i]);
+	}
+
+	bfree(input);
+}
+
+static void test_compress_all(uint32_t width, uint32_t height,
+		uint32_t start_y, uint32_t end_y)
+{
+	uint32_t linesize = (width + 3) & ~3;
+	uint32_t i420_linesize[3] = {linesize, linesize / 2, linesize / 2};
+	uint32_t nv12_linesize[3] = {linesize, linesize, 0};
+	uint32_t i444_linesize[3] = {linesize, linesize, linesize};
+
+	test_compress("compress_uyvx_to_i420", compress_uyvx_to_i420,
+			width, height, start_y, end_y, true, i420_linesize);
+	test_compress("compress_uyvx_to_nv12", compress_uyvx_to_nv12,
+			width, height, start_y, end_y, true, nv12_linesize);
+	test_compress("convert_uyvx_to_i444", convert_uyvx_to_i444,
+			width, height, start_y, end_y, false, i444_linesize);
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef void (*decompress_planar_func)(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize);
+
+static void test_decompress_planar(const char *routine,
+		decompress_planar_func func, uint32_t width, uint32_t height,
+		uint32_t start_y, uint32_t end_y, const uint32_t in_linesize[3])
+{
+	uint32_t out_linesize = width * 4;
+	size_t out_size = (size_t)out_linesize * height + SLACK;
+	uint8_t *input[3] = {0};
+	uint8_t *expected;
+	uint8_t *actual;
+
+	for (size_t i = 0; i < 3; i++) {
+		uint32_t rows = i == 0 ? height : (height + 1) / 2;
+		if (in_linesize[i])
+			input[i] = alloc_random(
+					(size_t)in_linesize[i] * rows + SLACK);
+	}
+
+	expected = alloc_random(out_size);
+	actual   = alloc_copy(expected, out_size);
+
+	format_conversion_select(0);
+	func((const uint8_t *const *)input, in_linesize, start_y, end_y,
+			expected, out_linesize);
+	format_conversion_select(variant_features);
+	func((const uint8_t *const *)input, in_linesize, start_y, end_y,
+			actual, out_linesize);
+
+	compare(routine, "output", width, height, start_y, end_y,
+			expected, actual, out_size - SLACK, out_linesize);
+
+	for (size_t i = 0; i < 3; i++)
+		bfree(input[i]);
+	bfree(expected);
+	bfree(actual);
+}
+
+static void test_decompress_422(uint32_t width, uint32_t height,
+		uint32_t start_y, uint32_t end_y, bool leading_lum)
+{
+	/* each row reads in_linesize / 2 dwords and writes twice that */
+	uint32_t in_linesize  = width * 2;
+	uint32_t out_linesize = width * 8;
+	size_t in_size  = (size_t)in_linesize * (height + 1) + SLACK;
+	size_t out_size = (size_t)out_linesize * height + SLACK;
+	uint8_t *input    = alloc_random(in_size);
+	uint8_t *expected = alloc_random(out_size);
+	uint8_t *actual   = alloc_copy(expected, out_size);
+
+	format_conversion_select(0);
+	decompress_422(input, in_linesize, start_y, end_y,
+			expected, out_linesize, leading_lum);
+	format_conversion_select(variant_features);
+	decompress_422(input, in_linesize, start_y, end_y,
+			actual, out_linesize, leading_lum);
+
+	compare(leading_lum ?
+			"decompress_422 (YUYV)" : "decompress_422 (UYVY)",
+			"output", width, height, start_y, end_y,
+			expected, actual, out_size - SLACK, out_linesize);
+
+	bfree(input);
+	bfree(expected);
+	bfree(actual);
+}
+
+static void test_decompress_all(uint32_t width, uint32_t height,
+		uint32_t start_y, uint32_t end_y)
+{
+	uint32_t chroma_width = (width + 1) / 2;
+	uint32_t i420_linesize[3] = {width, chroma_width, chroma_width};
+	uint32_t nv12_linesize[3] = {width, chroma_width * 2, 0};
+
+	test_decompress_planar("decompress_420", decompress_420,
+			width, height, start_y, end_y, i420_linesize);
+	test_decompress_planar("decompress_nv12", decompress_nv12,
+			width, height, start_y, end_y, nv12_linesize);
+	test_decompress_422(width, height, start_y, end_y, false);
+	test_decompress_422(width, height, start_y, end_y, true);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void test_size(uint32_t width, uint32_t height)
+{
+	/* full frame, then the top and bottom halves of a split frame */
+	uint32_t split = (height / 2) & ~1;
+
+	test_compress_all(width, height, 0, height);
+	test_decompress_all(width, height, 0, height);
+
+	if (split) {
+		test_compress_all(width, height, 0, split);
+		test_compress_all(width, height, split, height);
+		test_decompress_all(width, height, 0, split);
+		test_decompress_all(width, height, split, height);
+	}
+}
+
+int main(void)
+{
+	const char *baseline = format_conversion_select(0);
+	const char *prev = baseline;
+
+	for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+		const char *name = format_conversion_select(
+				variants[i].features);
+
+		if (name == prev) {
+			printf("%s: not supported by this CPU, skipped\n",
+					variants[i].name);
+			continue;
+		}
+
+		variant_name     = name;
+		variant_features = variants[i].features;
+		prev             = name;
+
+		for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+			for (size_t h = 0;
+			     h < sizeof(heights) / sizeof(heights[0]);
+			     h++)
+				test_size(widths[w], heights[h]);
+
+		printf("%s: tested against %s\n", name, baseline);
+	}
+
+	printf("%zu checks, %zu failures\n", checks, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,560 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <obs-internal.h>
+#include <util/darray.h>
+
+/*
+ * Feeds synthetic encoded packet streams to the interleaver of an encoded
+ * output (the callback it registers with its encoders) and checks the order
+ * the packets are sent in: by dts, video before audio on equal timestamps,
+ * and otherwise in the order they were received.  Covers several audio
+ * tracks arriving with different latencies, an audio track that starts late,
+ * and timestamps that tie between video and audio and between audio tracks.
+ *
+ * The encoders never encode anything; they only need to be started so that
+ * the output hooks its interleaver up to them.
+ */
+
+#define SAMPLE_RATE 48000
+#define AUDIO_FRAMES 1024
+
+struct packet_info {
+	enum obs_encoder_type type;
+	size_t                track;
+	int64_t               dts_usec;
+	size_t                id;
+};
+
+struct test_output {
+	obs_output_t              *output;
+	DARRAY(struct packet_info) sent;
+};
+
+struct harness {
+	obs_output_t               *output;
+	obs_encoder_t              *video_encoder;
+	obs_encoder_t              *audio_encoders[MAX_AUDIO_MIXES];
+	size_t                     num_tracks;
+
+	struct test_output         *data;
+	void (*new_packet)(void *param, struct encoder_packet *packet);
+	void                       *param;
+
+	/* indexed by packet id - 1 */
+	DARRAY(struct packet_info) fed;
+};
+
+static video_t *video = NULL;
+static audio_t *audio = NULL;
+static int failures = 0;
+
+/* ------------------------------------------------------------------------- */
+/* test output and encoders */
+
+static const char *test_output_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Interleave test output";
+}
+
+static void *test_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct test_output *data = bzalloc(sizeof(struct test_output));
+	data->output = output;
+	UNUSED_PARAMETER(settings);
+	return data;
+}
+
+static void test_output_destroy(void *data)
+{
+	struct test_output *out = data;
+	da_free(out->sent);
+	bfree(out);
+}
+
+static bool test_output_start(void *data)
+{
+	struct test_output *out = data;
+
+	if (!obs_output_initialize_encoders(out->output, 0))
+		return false;
+	return obs_output_begin_data_capture(out->output, 0);
+}
+
+static void test_output_stop(void *data, uint64_t ts)
+{
+	struct test_output *out = data;
+	obs_output_end_data_capture(out->output);
+	UNUSED_PARAMETER(ts);
+}
+
+static void test_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct test_output *out = data;
+	struct packet_info *info = da_push_back_new(out->sent);
+
+	info->type     = packet->type;
+	info->track    = packet->track_idx;
+	info->dts_usec = packet->dts_usec;
+	info->id       = packet->size;
+}
+
+static struct obs_output_info test_output_info = {
+	.id             = "interleave_test_output",
+	.flags          = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED |
+	                  OBS_OUTPUT_MULTI_TRACK,
+	.get_name       = test_output_name,
+	.create         = test_output_create,
+	.destroy        = test_output_destroy,
+	.start          = test_output_start,
+	.stop           = test_output_stop,
+	.encoded_packet = test_output_packet
+};
+
+static int encoder_data = 0;
+
+static const char *test_encoder_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Interleave test encoder";
+}
+
+static void *test_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(encoder);
+	return &encoder_data;
+}
+
+static void test_encoder_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool test_encoder_encode(void *data, struct encoder_frame *frame,
+		struct encoder_packet *packet, bool *received_packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(frame);
+	UNUSED_PARAMETER(packet);
+	*received_packet = false;
+	return true;
+}
+
+static size_t test_encoder_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return AUDIO_FRAMES;
+}
+
+static struct obs_encoder_info test_video_encoder_info = {
+	.id       = "interleave_test_video",
+	.type     = OBS_ENCODER_VIDEO,
+	.codec    = "h264",
+	.get_name = test_encoder_name,
+	.create   = test_encoder_create,
+	.destroy  = test_encoder_destroy,
+	.encode   = test_encoder_encode
+};
+
+static struct obs_encoder_info test_audio_encoder_info = {
+	.id             = "interleave_test_audio",
+	.type           = OBS_ENCODER_AUDIO,
+	.codec          = "AAC",
+	.get_name       = test_encoder_name,
+	.create         = test_encoder_create,
+	.destroy        = test_encoder_destroy,
+	.encode         = test_encoder_encode,
+	.get_frame_size = test_encoder_frame_size
+};
+
+static bool no_audio_input(void *param, uint64_t start_ts, uint64_t end_ts,
+		uint64_t *new_ts, uint32_t active_mixers,
+		struct audio_output_data *mixes)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(start_ts);
+	UNUSED_PARAMETER(end_ts);
+	UNUSED_PARAMETER(new_ts);
+	UNUSED_PARAMETER(active_mixers);
+	UNUSED_PARAMETER(mixes);
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* harness */
+
+static bool harness_start(struct harness *h, size_t num_tracks)
+{
+	struct encoder_callback *cb;
+
+	memset(h, 0, sizeof(*h));
+	h->num_tracks = num_tracks;
+
+	h->output = obs_output_create("interleave_test_output", "output",
+			NULL, NULL);
+	h->video_encoder = obs_video_encoder_create("interleave_test_video",
+			"video", NULL, NULL);
+	obs_encoder_set_video(h->video_encoder, video);
+	obs_output_set_video_encoder(h->output, h->video_encoder);
+
+	for (size_t i = 0; i < num_tracks; i++) {
+		h->audio_encoders[i] = obs_audio_encoder_create(
+				"interleave_test_audio", "audio", NULL, i,
+				NULL);
+		obs_encoder_set_audio(h->audio_encoders[i], audio);
+		obs_output_set_audio_encoder(h->output, h->audio_encoders[i],
+				i);
+	}
+
+	if (!obs_output_start(h->output)) {
+		printf("FAIL: could not start the test output\n");
+		return false;
+	}
+
+	cb = &h->video_encoder->callbacks.array[0];
+	h->data       = h->output->context.data;
+	h->new_packet = cb->new_packet;
+	h->param      = cb->param;
+	return true;
+}
+
+static void harness_stop(struct harness *h)
+{
+	obs_output_stop(h->output);
+	obs_output_release(h->output);
+	obs_encoder_release(h->video_encoder);
+
+	for (size_t i = 0; i < h->num_tracks; i++)
+		obs_encoder_release(h->audio_encoders[i]);
+
+	da_free(h->fed);
+}
+
+static void feed(struct harness *h, enum obs_encoder_type type, size_t track,
+		int64_t dts, int32_t timebase_den)
+{
+	struct encoder_packet packet = {0};
+	struct packet_info *info = da_push_back_new(h->fed);
+
+	/* no data, the size carries the id of the packet */
+	packet.size         = h->fed.num;
+	packet.pts          = dts;
+	packet.dts          = dts;
+	packet.timebase_num = 1;
+	packet.timebase_den = timebase_den;
+	packet.type         = type;
+	packet.keyframe     = true;
+	packet.dts_usec     = dts * 1000000 / timebase_den;
+	packet.sys_dts_usec = packet.dts_usec;
+	packet.encoder      = type == OBS_ENCODER_VIDEO ?
+		h->video_encoder : h->audio_encoders[track];
+
+	info->type     = type;
+	info->track    = track;
+	info->dts_usec = packet.dts_usec;
+	info->id       = packet.size;
+
+	h->new_packet(h->param, &packet);
+}
+
+static inline void feed_video(struct harness *h, int64_t frame,
+		int32_t fps)
+{
+	feed(h, OBS_ENCODER_VIDEO, 0, frame, fps);
+}
+
+static inline void feed_audio(struct harness *h, size_t track,
+		int64_t packet_idx)
+{
+	feed(h, OBS_ENCODER_AUDIO, track, packet_idx * AUDIO_FRAMES,
+			SAMPLE_RATE);
+}
+
+static void fail(const char *test, const char *msg, size_t idx,
+		const struct packet_info *packet)
+{
+	printf("FAIL: %s: %s at sent packet %zu (%s %zu, dts %"PRId64" us, "
+			"packet %zu)\n", test, msg, idx,
+			packet->type == OBS_ENCODER_VIDEO ? "video" : "audio",
+			packet->track, packet->dts_usec, packet->id);
+	failures++;
+}
+
+static inline bool is_audio(const struct packet_info *packet)
+{
+	return packet->type == OBS_ENCODER_AUDIO;
+}
+
+/* checks that the packets were sent in interleaved order and returns the
+ * number of ties that had to be broken */
+static size_t check_order(struct harness *h, const char *test)
+{
+	struct packet_info *sent = h->data->sent.array;
+	size_t num = h->data->sent.num;
+	size_t ties = 0;
+	bool *seen = bzalloc(h->fed.num + 1);
+
+	for (size_t i = 0; i < num; i++) {
+		const struct packet_info *prev = i ? &sent[i - 1] : NULL;
+		const struct packet_info *cur = &sent[i];
+
+		if (cur->id == 0 || cur->id > h->fed.num) {
+			fail(test, "unknown packet", i, cur);
+			continue;
+		}
+		if (seen[cur->id]) {
+			fail(test, "packet sent twice", i, cur);
+			continue;
+		}
+		seen[cur->id] = true;
+
+		if (!prev)
+			continue;
+
+		if (prev->dts_usec > cur->dts_usec) {
+			fail(test, "dts went backwards", i, cur);
+
+		} else if (prev->dts_usec == cur->dts_usec) {
+			ties++;
+
+			if (is_audio(prev) && !is_audio(cur))
+				fail(test, "video sent after audio with the "
+						"same dts", i, cur);
+			else if (is_audio(prev) == is_audio(cur) &&
+			         prev->id > cur->id)
+				fail(test, "equal dts sent out of arrival "
+						"order", i, cur);
+		}
+	}
+
+	bfree(seen);
+	return ties;
+}
+
+/* checks that all but the last few packets of a track were sent */
+static void check_sent(struct harness *h, const char *test,
+		enum obs_encoder_type type, size_t track, size_t max_unsent)
+{
+	size_t fed = 0;
+	size_t sent = 0;
+
+	for (size_t i = 0; i < h->fed.num; i++) {
+		struct packet_info *packet = &h->fed.array[i];
+		if (packet->type == type && packet->track == track)
+			fed++;
+	}
+
+	for (size_t i = 0; i < h->data->sent.num; i++) {
+		struct packet_info *packet = &h->data->sent.array[i];
+		if (packet->type == type && packet->track == track)
+			sent++;
+	}
+
+	if (!sent || sent + max_unsent < fed) {
+		printf("FAIL: %s: %s %zu: %zu of %zu packets sent\n", test,
+				type == OBS_ENCODER_VIDEO ? "video" : "audio",
+				track, sent, fed);
+		failures++;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* tests */
+
+/* 30 fps video and three audio tracks.  video arrives three frames late and
+ * each audio track with a different latency, and the tracks are fed in an
+ * order that differs from their index */
+static void test_multi_track(void)
+{
+	static const char *test = "multi-track";
+	static const size_t track_order[] = {2, 0, 1};
+	static const int64_t audio_delay_us[] = {5000, 25000, 12000};
+	const int64_t video_delay_us = 3 * 1000000 / 30;
+	int64_t next_video = 0;
+	int64_t next_audio[3] = {0};
+	struct harness h;
+
+	if (!harness_start(&h, 3))
+		goto fail;
+
+	for (int64_t now = 0; now <= 2000000; now += 1000) {
+		for (size_t i = 0; i < 3; i++) {
+			size_t track = track_order[i];
+
+			while (next_audio[track] * AUDIO_FRAMES * 1000000 /
+					SAMPLE_RATE + audio_delay_us[track]
+					<= now)
+				feed_audio(&h, track, next_audio[track]++);
+		}
+
+		while (next_video * 1000000 / 30 + video_delay_us <= now)
+			feed_video(&h, next_video++, 30);
+	}
+
+	check_order(&h, test);
+	check_sent(&h, test, OBS_ENCODER_VIDEO, 0, 8);
+	for (size_t i = 0; i < 3; i++)
+		check_sent(&h, test, OBS_ENCODER_AUDIO, i, 8);
+
+	printf("%s: %zu of %zu packets sent\n", test, h.data->sent.num,
+			h.fed.num);
+
+fail:
+	harness_stop(&h);
+}
+
+/* two audio tracks, the second of which only starts after half a second.
+ * nothing may be sent until every track has packets, and then sending starts
+ * where the late track starts */
+static void test_missing_track(void)
+{
+	static const char *test = "missing track";
+	const int64_t late_start_us = 500000;
+	int64_t late_first_packet = late_start_us * SAMPLE_RATE /
+		AUDIO_FRAMES / 1000000;
+	int64_t next_video = 0;
+	int64_t next_audio[2] = {0, late_first_packet};
+	int64_t late_first_dts;
+	struct harness h;
+
+	late_first_dts = late_first_packet * AUDIO_FRAMES * 1000000 /
+		SAMPLE_RATE;
+
+	if (!harness_start(&h, 2))
+		goto fail;
+
+	for (int64_t now = 0; now <= 2000000; now += 1000) {
+		for (size_t track = 0; track < 2; track++) {
+			while (next_audio[track] * AUDIO_FRAMES * 1000000 /
+					SAMPLE_RATE <= now)
+				feed_audio(&h, track, next_audio[track]++);
+		}
+
+		while (next_video * 1000000 / 30 <= now)
+			feed_video(&h, next_video++, 30);
+
+		if (now < late_start_us && h.data->sent.num) {
+			printf("FAIL: %s: packets sent before every track "
+					"had started\n", test);
+			failures++;
+			goto fail;
+		}
+	}
+
+	check_order(&h, test);
+	check_sent(&h, test, OBS_ENCODER_AUDIO, 1, 8);
+
+	/* whatever was received before the late track started is dropped */
+	for (size_t i = 0; i < h.data->sent.num; i++) {
+		struct packet_info *sent = &h.data->sent.array[i];
+		struct packet_info *fed = &h.fed.array[sent->id - 1];
+
+		if (fed->dts_usec + 1000000 / 30 < late_first_dts) {
+			fail(test, "packet from before the late track sent",
+					i, fed);
+			break;
+		}
+	}
+
+	printf("%s: %zu of %zu packets sent\n", test, h.data->sent.num,
+			h.fed.num);
+
+fail:
+	harness_stop(&h);
+}
+
+/* millisecond timestamps, as from a muxer: 25 fps video and two audio tracks
+ * with 20 ms packets, so that every video packet ties with an audio packet of
+ * each track and the audio tracks tie with each other.  audio is received
+ * before the video with the same timestamp, and the audio tracks alternate
+ * which one is received first */
+static void test_dts_ties(void)
+{
+	static const char *test = "dts ties";
+	struct harness h;
+	size_t ties;
+
+	if (!harness_start(&h, 2))
+		goto fail;
+
+	for (int64_t ms = 0; ms <= 2000; ms += 20) {
+		size_t first = (ms / 20) % 2;
+
+		feed(&h, OBS_ENCODER_AUDIO, first, ms, 1000);
+		feed(&h, OBS_ENCODER_AUDIO, 1 - first, ms, 1000);
+
+		if (ms % 40 == 0)
+			feed(&h, OBS_ENCODER_VIDEO, 0, ms, 1000);
+	}
+
+	ties = check_order(&h, test);
+	check_sent(&h, test, OBS_ENCODER_VIDEO, 0, 4);
+	check_sent(&h, test, OBS_ENCODER_AUDIO, 0, 4);
+	check_sent(&h, test, OBS_ENCODER_AUDIO, 1, 4);
+
+	if (!ties) {
+		printf("FAIL: %s: no equal timestamps were sent\n", test);
+		failures++;
+	}
+
+	printf("%s: %zu of %zu packets sent, %zu ties\n", test,
+			h.data->sent.num, h.fed.num, ties);
+
+fail:
+	harness_stop(&h);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+	struct video_output_info voi = {
+		.name       = "interleave test",
+		.format     = VIDEO_FORMAT_NV12,
+		.fps_num    = 30,
+		.fps_den    = 1,
+		.width      = 64,
+		.height     = 64,
+		.cache_size = 2,
+		.colorspace = VIDEO_CS_DEFAULT,
+		.range      = VIDEO_RANGE_DEFAULT
+	};
+	struct audio_output_info aoi = {
+		.name            = "interleave test",
+		.samples_per_sec = SAMPLE_RATE,
+		.format          = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers        = SPEAKERS_STEREO,
+		.input_callback  = no_audio_input
+	};
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("FAIL: obs_startup failed\n");
+		return 1;
+	}
+
+	obs_register_output(&test_output_info);
+	obs_register_encoder(&test_video_encoder_info);
+	obs_register_encoder(&test_audio_encoder_info);
+
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS ||
+	    audio_output_open(&audio, &aoi) != AUDIO_OUTPUT_SUCCESS) {
+		printf("FAIL: could not open the test video/audio outputs\n");
+		failures++;
+		goto fail;
+	}
+
+	test_multi_track();
+	test_missing_track();
+	test_dts_ties();
+
+fail:
+	audio_output_close(audio);
+	video_output_close(video);
+	obs_shutdown();
+
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,387 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <media-io/video-frame.h>
+
+/*
+ * Runs a stream (with a stream delay), a recording and a replay buffer from
+ * one video and one audio encoder, and checks that every output gets every
+ * packet intact and in order while the encoders reuse their own buffers.
+ * Prints the bytes of packet data the encoders copied, and the bytes the
+ * outputs referenced, which they each used to copy.
+ *
+ * The video frames are posted to the video output by hand, and the audio
+ * output mixes silence.
+ */
+
+#define SAMPLE_RATE        48000
+#define AUDIO_FRAMES       1024
+#define FPS                60
+#define DURATION_FRAMES    (3 * FPS)
+#define VIDEO_PACKET_SIZE  16384
+#define AUDIO_PACKET_SIZE  384
+#define NUM_OUTPUTS        3
+
+struct test_output {
+	obs_output_t *output;
+	const char   *name;
+	uint32_t     last_seq[2];
+	size_t       packets[2];
+	uint64_t     bytes;
+	bool         error;
+};
+
+struct test_encoder {
+	uint8_t               buffer[VIDEO_PACKET_SIZE];
+	size_t                size;
+	enum obs_encoder_type type;
+	uint32_t              seq;
+};
+
+static struct test_output *outputs_data[NUM_OUTPUTS];
+static size_t num_outputs = 0;
+static video_t *video = NULL;
+static audio_t *audio = NULL;
+static int failures = 0;
+
+/* ------------------------------------------------------------------------- */
+/* test output */
+
+static const char *test_output_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Packet copy test output";
+}
+
+static void *test_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct test_output *data = bzalloc(sizeof(struct test_output));
+	data->output = output;
+	data->name = obs_output_get_name(output);
+	outputs_data[num_outputs++] = data;
+	UNUSED_PARAMETER(settings);
+	return data;
+}
+
+static void test_output_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool test_output_start(void *data)
+{
+	struct test_output *out = data;
+
+	if (!obs_output_initialize_encoders(out->output, 0))
+		return false;
+	return obs_output_begin_data_capture(out->output, 0);
+}
+
+static void test_output_stop(void *data, uint64_t ts)
+{
+	struct test_output *out = data;
+	obs_output_end_data_capture(out->output);
+	UNUSED_PARAMETER(ts);
+}
+
+static void test_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct test_output *out = data;
+	size_t type = packet->type == OBS_ENCODER_VIDEO ? 0 : 1;
+	uint32_t seq;
+
+	if (packet->size < sizeof(seq))
+		return;
+
+	memcpy(&seq, packet->data, sizeof(seq));
+
+	/* every byte after the sequence number is derived from it, so a
+	 * buffer the encoder reused shows up as a mismatch */
+	for (size_t i = sizeof(seq); i < packet->size; i++) {
+		if (packet->data[i] != (uint8_t)(seq + i)) {
+			if (!out->error)
+				printf("FAIL: %s: %s packet %"PRIu32" was "
+						"overwritten\n", out->name,
+						type ? "audio" : "video", seq);
+			out->error = true;
+			return;
+		}
+	}
+
+	if (out->packets[type] && seq != out->last_seq[type] + 1) {
+		if (!out->error)
+			printf("FAIL: %s: %s packet %"PRIu32" after %"PRIu32
+					"\n", out->name,
+					type ? "audio" : "video", seq,
+					out->last_seq[type]);
+		out->error = true;
+	}
+
+	out->last_seq[type] = seq;
+	out->packets[type]++;
+	out->bytes += packet->size;
+}
+
+static struct obs_output_info test_output_info = {
+	.id             = "packet_copy_test_output",
+	.flags          = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.get_name       = test_output_name,
+	.create         = test_output_create,
+	.destroy        = test_output_destroy,
+	.start          = test_output_start,
+	.stop           = test_output_stop,
+	.encoded_packet = test_output_packet
+};
+
+/* ------------------------------------------------------------------------- */
+/* test encoders, which fill the same buffer for every packet */
+
+static const char *test_encoder_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Packet copy test encoder";
+}
+
+static void *test_video_encoder_create(obs_data_t *settings,
+		obs_encoder_t *encoder)
+{
+	struct test_encoder *enc = bzalloc(sizeof(struct test_encoder));
+	enc->size = VIDEO_PACKET_SIZE;
+	enc->type = OBS_ENCODER_VIDEO;
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(encoder);
+	return enc;
+}
+
+static void *test_audio_encoder_create(obs_data_t *settings,
+		obs_encoder_t *encoder)
+{
+	struct test_encoder *enc = bzalloc(sizeof(struct test_encoder));
+	enc->size = AUDIO_PACKET_SIZE;
+	enc->type = OBS_ENCODER_AUDIO;
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(encoder);
+	return enc;
+}
+
+static void test_encoder_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool test_encoder_encode(void *data, struct encoder_frame *frame,
+		struct encoder_packet *packet, bool *received_packet)
+{
+	struct test_encoder *enc = data;
+	uint32_t seq = enc->seq++;
+
+	memcpy(enc->buffer, &seq, sizeof(seq));
+	for (size_t i = sizeof(seq); i < enc->size; i++)
+		enc->buffer[i] = (uint8_t)(seq + i);
+
+	packet->data     = enc->buffer;
+	packet->size     = enc->size;
+	packet->type     = enc->type;
+	packet->pts      = frame->pts;
+	packet->dts      = frame->pts;
+	packet->keyframe = true;
+	*received_packet = true;
+	return true;
+}
+
+static size_t test_encoder_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return AUDIO_FRAMES;
+}
+
+static struct obs_encoder_info test_video_encoder_info = {
+	.id       = "packet_copy_test_video",
+	.type     = OBS_ENCODER_VIDEO,
+	.codec    = "h264",
+	.get_name = test_encoder_name,
+	.create   = test_video_encoder_create,
+	.destroy  = test_encoder_destroy,
+	.encode   = test_encoder_encode
+};
+
+static struct obs_encoder_info test_audio_encoder_info = {
+	.id             = "packet_copy_test_audio",
+	.type           = OBS_ENCODER_AUDIO,
+	.codec          = "AAC",
+	.get_name       = test_encoder_name,
+	.create         = test_audio_encoder_create,
+	.destroy        = test_encoder_destroy,
+	.encode         = test_encoder_encode,
+	.get_frame_size = test_encoder_frame_size
+};
+
+static bool silent_audio_input(void *param, uint64_t start_ts,
+		uint64_t end_ts, uint64_t *new_ts, uint32_t active_mixers,
+		struct audio_output_data *mixes)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(end_ts);
+	UNUSED_PARAMETER(active_mixers);
+	UNUSED_PARAMETER(mixes);
+	*new_ts = start_ts;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void post_frames(void)
+{
+	uint64_t interval = 1000000000ULL / FPS;
+	uint64_t t = os_gettime_ns();
+
+	for (int i = 0; i < DURATION_FRAMES; i++) {
+		struct video_frame frame;
+
+		if (video_output_lock_frame(video, &frame, 1, t)) {
+			memset(frame.data[0], 0x10,
+					(size_t)frame.linesize[0] * 64);
+			video_output_unlock_frame(video);
+		}
+
+		t += interval;
+		os_sleepto_ns(t);
+	}
+}
+
+static void print_stats(obs_encoder_t *encoder, const char *type)
+{
+	uint64_t copied = obs_encoder_get_packet_bytes_copied(encoder);
+	uint64_t shared = obs_encoder_get_packet_bytes_shared(encoder);
+
+	printf("%s: copied %"PRIu64" bytes, outputs used to copy %"PRIu64
+			" bytes\n", type, copied, shared);
+
+	if (!copied) {
+		printf("FAIL: the %s encoder produced no packets\n", type);
+		failures++;
+	}
+
+	/* each output takes a reference to every packet once it has started,
+	 * where it used to take a copy */
+	if (shared < copied * 2) {
+		printf("FAIL: the %s outputs referenced %"PRIu64" bytes of "
+				"%"PRIu64"\n", type, shared, copied);
+		failures++;
+	}
+}
+
+static void run_outputs(void)
+{
+	static const char *names[NUM_OUTPUTS] = {
+		"stream", "recording", "replay buffer"
+	};
+	obs_output_t *outputs[NUM_OUTPUTS] = {0};
+	obs_encoder_t *video_encoder;
+	obs_encoder_t *audio_encoder;
+
+	video_encoder = obs_video_encoder_create("packet_copy_test_video",
+			"video", NULL, NULL);
+	audio_encoder = obs_audio_encoder_create("packet_copy_test_audio",
+			"audio", NULL, 0, NULL);
+	obs_encoder_set_video(video_encoder, video);
+	obs_encoder_set_audio(audio_encoder, audio);
+
+	for (size_t i = 0; i < NUM_OUTPUTS; i++) {
+		outputs[i] = obs_output_create("packet_copy_test_output",
+				names[i], NULL, NULL);
+		obs_output_set_video_encoder(outputs[i], video_encoder);
+		obs_output_set_audio_encoder(outputs[i], audio_encoder, 0);
+	}
+
+	obs_output_set_delay(outputs[0], 1, 0);
+
+	for (size_t i = 0; i < NUM_OUTPUTS; i++) {
+		if (!obs_output_start(outputs[i])) {
+			printf("FAIL: could not start the %s\n", names[i]);
+			failures++;
+			goto fail;
+		}
+	}
+
+	post_frames();
+
+	for (size_t i = 0; i < NUM_OUTPUTS; i++)
+		obs_output_force_stop(outputs[i]);
+
+	for (size_t i = 0; i < NUM_OUTPUTS; i++) {
+		struct test_output *out = outputs_data[i];
+
+		if (out->error)
+			failures++;
+		if (!out->packets[0] || !out->packets[1]) {
+			printf("FAIL: the %s got %zu video and %zu audio "
+					"packets\n", names[i], out->packets[0],
+					out->packets[1]);
+			failures++;
+		}
+
+		printf("%s: %zu video and %zu audio packets, %"PRIu64
+				" bytes\n", names[i], out->packets[0],
+				out->packets[1], out->bytes);
+	}
+
+	print_stats(video_encoder, "video");
+	print_stats(audio_encoder, "audio");
+
+fail:
+	for (size_t i = 0; i < NUM_OUTPUTS; i++)
+		obs_output_release(outputs[i]);
+	obs_encoder_release(video_encoder);
+	obs_encoder_release(audio_encoder);
+}
+
+int main(void)
+{
+	struct video_output_info voi = {
+		.name       = "packet copy test",
+		.format     = VIDEO_FORMAT_I420,
+		.fps_num    = FPS,
+		.fps_den    = 1,
+		.width      = 64,
+		.height     = 64,
+		.cache_size = 4,
+		.colorspace = VIDEO_CS_DEFAULT,
+		.range      = VIDEO_RANGE_DEFAULT
+	};
+	struct audio_output_info aoi = {
+		.name            = "packet copy test",
+		.samples_per_sec = SAMPLE_RATE,
+		.format          = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers        = SPEAKERS_STEREO,
+		.input_callback  = silent_audio_input
+	};
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("FAIL: obs_startup failed\n");
+		return 1;
+	}
+
+	obs_register_output(&test_output_info);
+	obs_register_encoder(&test_video_encoder_info);
+	obs_register_encoder(&test_audio_encoder_info);
+
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS ||
+	    audio_output_open(&audio, &aoi) != AUDIO_OUTPUT_SUCCESS) {
+		printf("FAIL: could not open the test video/audio outputs\n");
+		failures++;
+		goto fail;
+	}
+
+	run_outputs();
+
+fail:
+	audio_output_close(audio);
+	video_output_close(video);
+	obs_shutdown();
+
+	return failures ? 1 : 0;
+}
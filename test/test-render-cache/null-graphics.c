@@ -0,0 +1,890 @@
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <util/bmem.h>
+
+/*
+ * Graphics module that draws nothing, so render targets can be created and
+ * rendered to without a GPU or a window.  Textures only keep their size.
+ */
+
+struct gs_device {
+	gs_texture_t       *render_target;
+	gs_zstencil_t      *zstencil;
+	gs_shader_t        *vertex_shader;
+	gs_shader_t        *pixel_shader;
+	struct gs_rect     viewport;
+	enum gs_cull_mode  cull_mode;
+};
+
+struct gs_texture {
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             depth;
+};
+
+struct gs_stage_surface {
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+	uint8_t              *data;
+};
+
+struct gs_zstencil_buffer {
+	int unused;
+};
+
+struct gs_sampler_state {
+	int unused;
+};
+
+struct gs_swap_chain {
+	int unused;
+};
+
+struct gs_shader_param {
+	int unused;
+};
+
+struct gs_shader {
+	struct gs_shader_param param;
+};
+
+struct gs_vertex_buffer {
+	struct gs_vb_data *data;
+};
+
+struct gs_index_buffer {
+	enum gs_index_type type;
+	void               *indices;
+	size_t             num;
+};
+
+/* ------------------------------------------------------------------------- */
+
+const char *device_get_name(void)
+{
+	return "Null";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_OPENGL;
+}
+
+bool device_enum_adapters(
+		bool (*callback)(void *param, const char *name, uint32_t id),
+		void *param)
+{
+	return callback(param, "Null", 0);
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_NULL";
+}
+
+int device_create(gs_device_t **device, uint32_t adapter)
+{
+	UNUSED_PARAMETER(adapter);
+
+	*device = bzalloc(sizeof(struct gs_device));
+	return GS_SUCCESS;
+}
+
+void device_destroy(gs_device_t *device)
+{
+	bfree(device);
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+gs_swapchain_t *device_swapchain_create(gs_device_t *device,
+		const struct gs_init_data *data)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(data);
+	return bzalloc(sizeof(struct gs_swap_chain));
+}
+
+void device_resize(gs_device_t *device, uint32_t x, uint32_t y)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(x);
+	UNUSED_PARAMETER(y);
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *x, uint32_t *y)
+{
+	UNUSED_PARAMETER(device);
+	*x = 0;
+	*y = 0;
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return 0;
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return 0;
+}
+
+static gs_texture_t *create_texture(enum gs_texture_type type,
+		enum gs_color_format format, uint32_t width, uint32_t height,
+		uint32_t depth)
+{
+	struct gs_texture *tex = bzalloc(sizeof(struct gs_texture));
+	tex->type   = type;
+	tex->format = format;
+	tex->width  = width;
+	tex->height = height;
+	tex->depth  = depth;
+	return tex;
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format,
+		uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+	return create_texture(GS_TEXTURE_2D, color_format, width, height, 1);
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device,
+		uint32_t size, enum gs_color_format color_format,
+		uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+	return create_texture(GS_TEXTURE_CUBE, color_format, size, size, 1);
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device,
+		uint32_t width, uint32_t height, uint32_t depth,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+	return create_texture(GS_TEXTURE_3D, color_format, width, height,
+			depth);
+}
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device,
+		uint32_t width, uint32_t height,
+		enum gs_zstencil_format format)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(format);
+	return bzalloc(sizeof(struct gs_zstencil_buffer));
+}
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device,
+		uint32_t width, uint32_t height,
+		enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf = bzalloc(sizeof(*surf));
+	surf->format = color_format;
+	surf->width  = width;
+	surf->height = height;
+	surf->data   = bzalloc((size_t)width * height *
+			gs_get_format_bpp(color_format) / 8);
+	UNUSED_PARAMETER(device);
+	return surf;
+}
+
+gs_samplerstate_t *device_samplerstate_create(gs_device_t *device,
+		const struct gs_sampler_info *info)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(info);
+	return bzalloc(sizeof(struct gs_sampler_state));
+}
+
+gs_shader_t *device_vertexshader_create(gs_device_t *device,
+		const char *shader, const char *file,
+		char **error_string)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(shader);
+	UNUSED_PARAMETER(file);
+	UNUSED_PARAMETER(error_string);
+	return bzalloc(sizeof(struct gs_shader));
+}
+
+gs_shader_t *device_pixelshader_create(gs_device_t *device,
+		const char *shader, const char *file,
+		char **error_string)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(shader);
+	UNUSED_PARAMETER(file);
+	UNUSED_PARAMETER(error_string);
+	return bzalloc(sizeof(struct gs_shader));
+}
+
+gs_vertbuffer_t *device_vertexbuffer_create(gs_device_t *device,
+		struct gs_vb_data *data, uint32_t flags)
+{
+	struct gs_vertex_buffer *vb = bzalloc(sizeof(*vb));
+	vb->data = data;
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(flags);
+	return vb;
+}
+
+gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device,
+		enum gs_index_type type, void *indices, size_t num,
+		uint32_t flags)
+{
+	struct gs_index_buffer *ib = bzalloc(sizeof(*ib));
+	ib->type    = type;
+	ib->indices = indices;
+	ib->num     = num;
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(flags);
+	return ib;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+void device_load_vertexbuffer(gs_device_t *device,
+		gs_vertbuffer_t *vertbuffer)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(vertbuffer);
+}
+
+void device_load_indexbuffer(gs_device_t *device,
+		gs_indexbuffer_t *indexbuffer)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(indexbuffer);
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(tex);
+	UNUSED_PARAMETER(unit);
+}
+
+void device_load_samplerstate(gs_device_t *device,
+		gs_samplerstate_t *samplerstate, int unit)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(samplerstate);
+	UNUSED_PARAMETER(unit);
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	device->vertex_shader = vertshader;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	device->pixel_shader = pixelshader;
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d,
+		int unit)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(b_3d);
+	UNUSED_PARAMETER(unit);
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	return device->render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->zstencil;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex,
+		gs_zstencil_t *zstencil)
+{
+	device->render_target = tex;
+	device->zstencil = zstencil;
+}
+
+void device_set_cube_render_target(gs_device_t *device,
+		gs_texture_t *cubetex, int side, gs_zstencil_t *zstencil)
+{
+	UNUSED_PARAMETER(side);
+	device->render_target = cubetex;
+	device->zstencil = zstencil;
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+		gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(src);
+}
+
+void device_copy_texture_region(gs_device_t *device,
+		gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+		gs_texture_t *src, uint32_t src_x, uint32_t src_y,
+		uint32_t src_w, uint32_t src_h)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(dst_x);
+	UNUSED_PARAMETER(dst_y);
+	UNUSED_PARAMETER(src);
+	UNUSED_PARAMETER(src_x);
+	UNUSED_PARAMETER(src_y);
+	UNUSED_PARAMETER(src_w);
+	UNUSED_PARAMETER(src_h);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+		gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(src);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		uint32_t start_vert, uint32_t num_verts)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(draw_mode);
+	UNUSED_PARAMETER(start_vert);
+	UNUSED_PARAMETER(num_verts);
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(swapchain);
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags,
+		const struct vec4 *color, float depth, uint8_t stencil)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(clear_flags);
+	UNUSED_PARAMETER(color);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+}
+
+void device_present(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_flush(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green,
+		bool blue, bool alpha)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(red);
+	UNUSED_PARAMETER(green);
+	UNUSED_PARAMETER(blue);
+	UNUSED_PARAMETER(alpha);
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src,
+		enum gs_blend_type dest)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(src);
+	UNUSED_PARAMETER(dest);
+}
+
+void device_blend_function_separate(gs_device_t *device,
+		enum gs_blend_type src_c, enum gs_blend_type dest_c,
+		enum gs_blend_type src_a, enum gs_blend_type dest_a)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(src_c);
+	UNUSED_PARAMETER(dest_c);
+	UNUSED_PARAMETER(src_a);
+	UNUSED_PARAMETER(dest_a);
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side,
+		enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side,
+		enum gs_stencil_op_type fail, enum gs_stencil_op_type zfail,
+		enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width,
+		int height)
+{
+	device->viewport.x  = x;
+	device->viewport.y  = y;
+	device->viewport.cx = width;
+	device->viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(rect);
+}
+
+void device_ortho(gs_device_t *device, float left, float right, float top,
+		float bottom, float znear, float zfar)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(left);
+	UNUSED_PARAMETER(right);
+	UNUSED_PARAMETER(top);
+	UNUSED_PARAMETER(bottom);
+	UNUSED_PARAMETER(znear);
+	UNUSED_PARAMETER(zfar);
+}
+
+void device_frustum(gs_device_t *device, float left, float right, float top,
+		float bottom, float znear, float zfar)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(left);
+	UNUSED_PARAMETER(right);
+	UNUSED_PARAMETER(top);
+	UNUSED_PARAMETER(bottom);
+	UNUSED_PARAMETER(znear);
+	UNUSED_PARAMETER(zfar);
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	bfree(swapchain);
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	UNUSED_PARAMETER(tex);
+	UNUSED_PARAMETER(ptr);
+	UNUSED_PARAMETER(linesize);
+	return false;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	return tex;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	bfree(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	return cubetex->width;
+}
+
+enum gs_color_format gs_cubetexture_get_color_format(
+		const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	bfree(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	return voltex->width;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	return voltex->height;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	return voltex->depth;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(
+		const gs_texture_t *voltex)
+{
+	return voltex->format;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->data);
+		bfree(stagesurf);
+	}
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format gs_stagesurface_get_color_format(
+		const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+		uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->width *
+		gs_get_format_bpp(stagesurf->format) / 8;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zstencil)
+{
+	bfree(zstencil);
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	bfree(samplerstate);
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer)
+{
+	if (vertbuffer) {
+		gs_vbdata_destroy(vertbuffer->data);
+		bfree(vertbuffer);
+	}
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer)
+{
+	UNUSED_PARAMETER(vertbuffer);
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vertbuffer,
+		const struct gs_vb_data *data)
+{
+	UNUSED_PARAMETER(vertbuffer);
+	UNUSED_PARAMETER(data);
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
+{
+	return vertbuffer->data;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t *indexbuffer)
+{
+	if (indexbuffer) {
+		bfree(indexbuffer->indices);
+		bfree(indexbuffer);
+	}
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t *indexbuffer)
+{
+	UNUSED_PARAMETER(indexbuffer);
+}
+
+void gs_indexbuffer_flush_direct(gs_indexbuffer_t *indexbuffer,
+		const void *data)
+{
+	UNUSED_PARAMETER(indexbuffer);
+	UNUSED_PARAMETER(data);
+}
+
+void *gs_indexbuffer_get_data(const gs_indexbuffer_t *indexbuffer)
+{
+	return indexbuffer->indices;
+}
+
+size_t gs_indexbuffer_get_num_indices(const gs_indexbuffer_t *indexbuffer)
+{
+	return indexbuffer->num;
+}
+
+enum gs_index_type gs_indexbuffer_get_type(const gs_indexbuffer_t *indexbuffer)
+{
+	return indexbuffer->type;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void gs_shader_destroy(gs_shader_t *shader)
+{
+	bfree(shader);
+}
+
+int gs_shader_get_num_params(const gs_shader_t *shader)
+{
+	UNUSED_PARAMETER(shader);
+	return 0;
+}
+
+gs_sparam_t *gs_shader_get_param_by_idx(gs_shader_t *shader, uint32_t param)
+{
+	UNUSED_PARAMETER(param);
+	return &shader->param;
+}
+
+/* every parameter is the same one, which ignores what is set */
+gs_sparam_t *gs_shader_get_param_by_name(gs_shader_t *shader,
+		const char *name)
+{
+	UNUSED_PARAMETER(name);
+	return &shader->param;
+}
+
+gs_sparam_t *gs_shader_get_viewproj_matrix(const gs_shader_t *shader)
+{
+	UNUSED_PARAMETER(shader);
+	return NULL;
+}
+
+gs_sparam_t *gs_shader_get_world_matrix(const gs_shader_t *shader)
+{
+	UNUSED_PARAMETER(shader);
+	return NULL;
+}
+
+void gs_shader_get_param_info(const gs_sparam_t *param,
+		struct gs_shader_param_info *info)
+{
+	UNUSED_PARAMETER(param);
+	info->name = "";
+	info->type = GS_SHADER_PARAM_UNKNOWN;
+}
+
+void gs_shader_set_bool(gs_sparam_t *param, bool val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_float(gs_sparam_t *param, float val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_int(gs_sparam_t *param, int val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+}
+
+void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+	UNUSED_PARAMETER(size);
+}
+
+void gs_shader_set_default(gs_sparam_t *param)
+{
+	UNUSED_PARAMETER(param);
+}
+
+void gs_shader_set_next_sampler(gs_sparam_t *param,
+		gs_samplerstate_t *sampler)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(sampler);
+}
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <obs-internal.h>
+
+/*
+ * Checks the bookkeeping of obs_source_video_render_cached over passes of
+ * the scene render cache: a source drawn several times in a pass is rendered
+ * once, a static source isn't rendered again in later passes unless its
+ * content or size changes, other sources are rendered again every pass,
+ * renders nothing draws are dropped once they expire, and a source created
+ * at the address of a destroyed one doesn't get the destroyed one's render.
+ *
+ * Rendering goes through a graphics module that draws nothing, so the test
+ * runs without a GPU.
+ */
+
+#define WIDTH         64
+#define HEIGHT        48
+#define MAX_SOURCES   64
+
+struct test_source {
+	uint32_t      width;
+	uint32_t      height;
+	long          renders;
+};
+
+static int failures = 0;
+
+static const char *test_source_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "render cache test source";
+}
+
+static void *test_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct test_source *ts = bzalloc(sizeof(struct test_source));
+	ts->width  = WIDTH;
+	ts->height = HEIGHT;
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return ts;
+}
+
+static void test_source_destroy(void *data)
+{
+	bfree(data);
+}
+
+static uint32_t test_source_get_width(void *data)
+{
+	struct test_source *ts = data;
+	return ts->width;
+}
+
+static uint32_t test_source_get_height(void *data)
+{
+	struct test_source *ts = data;
+	return ts->height;
+}
+
+static void test_source_render(void *data, gs_effect_t *effect)
+{
+	struct test_source *ts = data;
+	ts->renders++;
+	UNUSED_PARAMETER(effect);
+}
+
+static struct obs_source_info test_source_info = {
+	.id           = "render_cache_test_source",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
+	                OBS_SOURCE_STATIC_VIDEO,
+	.get_name     = test_source_get_name,
+	.create       = test_source_create,
+	.destroy      = test_source_destroy,
+	.get_width    = test_source_get_width,
+	.get_height   = test_source_get_height,
+	.video_render = test_source_render
+};
+
+/* a source that isn't static has to be rendered again every pass */
+static struct obs_source_info test_dynamic_source_info = {
+	.id           = "render_cache_test_dynamic_source",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW,
+	.get_name     = test_source_get_name,
+	.create       = test_source_create,
+	.destroy      = test_source_destroy,
+	.get_width    = test_source_get_width,
+	.get_height   = test_source_get_height,
+	.video_render = test_source_render
+};
+
+static obs_source_t *create_source(void)
+{
+	return obs_source_create_private("render_cache_test_source",
+			"render cache test", NULL);
+}
+
+static inline struct test_source *get_data(obs_source_t *source)
+{
+	return source->context.data;
+}
+
+/* runs a pass that draws each source once, returns the renders it took */
+static uint32_t run_pass(obs_source_t **sources, size_t num)
+{
+	obs_scene_render_cache_begin(&obs->video);
+	for (size_t i = 0; i < num; i++)
+		obs_source_video_render_cached(sources[i]);
+	obs_scene_render_cache_end(&obs->video);
+
+	return obs->video.last_scene_renders;
+}
+
+static struct scene_render_cache_entry *find_entry(obs_source_t *source)
+{
+	for (size_t i = 0; i < obs->video.scene_render_cache.num; i++) {
+		struct scene_render_cache_entry *entry =
+			obs->video.scene_render_cache.array + i;
+
+		if (obs_weak_source_references_source(entry->source, source))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void expect(bool condition, const char *message)
+{
+	if (!condition) {
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void test_repeated_draws(obs_source_t *source)
+{
+	struct test_source *ts = get_data(source);
+	uint32_t renders, saved;
+
+	obs_scene_render_cache_begin(&obs->video);
+	obs_source_video_render_cached(source);
+	obs_source_video_render_cached(source);
+	obs_source_video_render_cached(source);
+	obs_scene_render_cache_end(&obs->video);
+
+	obs_get_scene_render_stats(&renders, &saved);
+	expect(ts->renders == 1, "a source drawn three times in a pass was "
+			"not rendered once");
+	expect(renders == 1 && saved == 2, "the stats of a pass with three "
+			"draws are not 1 render and 2 saved");
+
+	run_pass(&source, 1);
+	run_pass(&source, 1);
+	expect(ts->renders == 1, "an unchanged static source was rendered "
+			"again in later passes");
+
+	obs_source_content_changed(source);
+	run_pass(&source, 1);
+	expect(ts->renders == 2, "a source was not rendered again after its "
+			"content changed");
+
+	printf("repeated draws:  %ld render(s)\n", ts->renders);
+}
+
+static void test_dynamic(void)
+{
+	obs_source_t *source = obs_source_create_private(
+			"render_cache_test_dynamic_source",
+			"render cache dynamic test", NULL);
+	struct test_source *ts = get_data(source);
+	uint32_t renders, saved;
+
+	for (int i = 0; i < 3; i++) {
+		obs_scene_render_cache_begin(&obs->video);
+		obs_source_video_render_cached(source);
+		obs_source_video_render_cached(source);
+		obs_scene_render_cache_end(&obs->video);
+	}
+
+	obs_get_scene_render_stats(&renders, &saved);
+	expect(ts->renders == 3, "a source that isn't static was not "
+			"rendered once every pass");
+	expect(renders == 1 && saved == 1, "the stats of a pass with two "
+			"draws of a source that isn't static are not 1 render "
+			"and 1 saved");
+
+	printf("dynamic source:  %ld render(s) in 3 passes\n", ts->renders);
+	obs_source_release(source);
+}
+
+static void test_resize(obs_source_t *source)
+{
+	struct test_source *ts = get_data(source);
+	struct scene_render_cache_entry *entry;
+	gs_texture_t *tex;
+	long renders = ts->renders;
+
+	ts->width  = WIDTH * 2;
+	ts->height = HEIGHT / 2;
+	run_pass(&source, 1);
+	expect(ts->renders == renders + 1, "a resized source was not "
+			"rendered again");
+
+	entry = find_entry(source);
+	tex = entry ? gs_texrender_get_texture(entry->texrender) : NULL;
+	expect(tex && gs_texture_get_width(tex) == WIDTH * 2 &&
+			gs_texture_get_height(tex) == HEIGHT / 2,
+			"the render of a resized source has the old size");
+
+	run_pass(&source, 1);
+	expect(ts->renders == renders + 1, "a resized source was rendered "
+			"again while its size stayed the same");
+
+	printf("resize:          %ld render(s)\n", ts->renders - renders);
+}
+
+static void test_expiry(obs_source_t *source)
+{
+	obs_source_t *other = create_source();
+	size_t passes = 0;
+
+	run_pass(&other, 1);
+	expect(find_entry(other) != NULL, "a drawn source has no render");
+
+	/* draws only the first source, so the other one's render expires */
+	while (find_entry(other) && passes <= 1000) {
+		run_pass(&source, 1);
+		passes++;
+	}
+
+	expect(find_entry(other) == NULL, "a render that is no longer drawn "
+			"never expired");
+	expect(find_entry(source) != NULL, "the render of a source drawn "
+			"every pass expired");
+	expect(obs->video.scene_render_cache.num == 1, "expired renders are "
+			"still in the cache");
+
+	printf("expiry:          %zu pass(es)\n", passes);
+	obs_source_release(other);
+}
+
+static void test_address_reuse(void)
+{
+	obs_source_t *sources[MAX_SOURCES] = {0};
+	obs_source_t *first = create_source();
+	obs_source_t *reused = NULL;
+	void *address = first;
+	size_t num = 0;
+
+	run_pass(&first, 1);
+	obs_source_release(first);
+
+	/* keeps creating sources until one is allocated where the destroyed
+	 * one was, while its render is still in the cache */
+	while (num < MAX_SOURCES) {
+		obs_source_t *source = create_source();
+		sources[num++] = source;
+
+		if ((void*)source == address) {
+			reused = source;
+			break;
+		}
+	}
+
+	if (!reused) {
+		printf("address reuse:   skipped, no source was created at "
+				"the address of a destroyed one\n");
+	} else {
+		struct test_source *ts = get_data(reused);
+		struct scene_render_cache_entry *entry;
+
+		run_pass(&reused, 1);
+		expect(ts->renders == 1, "a source created at the address of "
+				"a destroyed one used the destroyed one's "
+				"render");
+
+		entry = find_entry(reused);
+		expect(entry && obs->video.scene_render_cache.num == 1,
+				"the render of a destroyed source was not "
+				"dropped");
+
+		printf("address reuse:   %ld render(s), %zu cached\n",
+				ts->renders,
+				obs->video.scene_render_cache.num);
+	}
+
+	for (size_t i = 0; i < num; i++)
+		obs_source_release(sources[i]);
+	run_pass(NULL, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+	graphics_t *graphics = NULL;
+	obs_source_t *source;
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("FAIL: obs_startup failed\n");
+		return 1;
+	}
+
+	if (gs_create(&graphics, NULL_GRAPHICS_MODULE, 0) != GS_SUCCESS) {
+		printf("FAIL: could not load " NULL_GRAPHICS_MODULE "\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	/* destroying a source enters and leaves the core's context */
+	obs->video.graphics = graphics;
+	obs_register_source(&test_source_info);
+	obs_register_source(&test_dynamic_source_info);
+	gs_enter_context(graphics);
+
+	source = create_source();
+	test_repeated_draws(source);
+	test_dynamic();
+	test_resize(source);
+	test_expiry(source);
+	obs_source_release(source);
+
+	run_pass(NULL, 0);
+	test_address_reuse();
+	expect(obs->video.scene_render_cache.num == 0, "the renders of "
+			"destroyed sources are still in the cache");
+
+	obs_free_scene_render_cache(&obs->video);
+	obs->video.graphics = NULL;
+	gs_leave_context();
+	gs_destroy(graphics);
+
+	obs_shutdown();
+	return failures ? 1 : 0;
+}
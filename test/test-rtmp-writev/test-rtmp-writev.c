@@ -0,0 +1,504 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/threading.h>
+
+#include "rtmp_sys.h"
+#include "log.h"
+
+/*
+ * Publishes random audio and video messages to a minimal RTMP server on the
+ * loopback interface, alternating between RTMP_Write (a copied FLV tag) and
+ * RTMP_WriteV (the message body in several buffers), and checks that the
+ * server receives every message intact with the right type and timestamp.
+ *
+ * The server is librtmp itself: RTMP_Serve does the handshake, and it answers
+ * connect, createStream and publish just enough for RTMP_ConnectStream to
+ * succeed.  Sessions are run with several chunk sizes, with extended
+ * timestamps, and with a custom send function that only sends a few bytes at
+ * a time like the async socket loop of rtmp-stream can.  The last session
+ * checks that a send returning 0 closes the connection.
+ */
+
+#define MESSAGES 400
+
+struct message {
+	uint8_t  type;
+	uint32_t timestamp;
+	uint8_t  *body;
+	uint32_t size;
+};
+
+struct server {
+	int                    listen_socket;
+	pthread_t              thread;
+	DARRAY(struct message) received;
+	bool                   failed;
+};
+
+static uint32_t rand_state = 1;
+static int failures = 0;
+
+static uint32_t next_rand(void)
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+static void free_messages(struct message *messages, size_t num)
+{
+	for (size_t i = 0; i < num; i++)
+		bfree(messages[i].body);
+}
+
+/* ------------------------------------------------------------------------- */
+/* server */
+
+#define SAVC(x) static const AVal av_##x = AVC(#x)
+
+SAVC(connect);
+SAVC(createStream);
+SAVC(publish);
+SAVC(_result);
+SAVC(onStatus);
+SAVC(fmsVer);
+SAVC(level);
+SAVC(status);
+SAVC(code);
+SAVC(description);
+
+static const AVal av_server_version = AVC("FMS/3,0,1,123");
+static const AVal av_connect_success = AVC("NetConnection.Connect.Success");
+static const AVal av_publish_start = AVC("NetStream.Publish.Start");
+
+static char *encode_object_end(char *enc)
+{
+	*enc++ = 0;
+	*enc++ = 0;
+	*enc++ = AMF_OBJECT_END;
+	return enc;
+}
+
+static bool send_invoke(RTMP *r, char *pbuf, char *end, int stream_id)
+{
+	RTMPPacket packet = {0};
+
+	packet.m_nChannel = 0x03;
+	packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+	packet.m_packetType = RTMP_PACKET_TYPE_INVOKE;
+	packet.m_nInfoField2 = stream_id;
+	packet.m_body = pbuf + RTMP_MAX_HEADER_SIZE;
+	packet.m_nBodySize = (uint32_t)(end - packet.m_body);
+
+	return RTMP_SendPacket(r, &packet, FALSE) != 0;
+}
+
+static bool send_result(RTMP *r, const AVal *method, double txn)
+{
+	char pbuf[512];
+	char *pend = pbuf + sizeof(pbuf);
+	char *enc = pbuf + RTMP_MAX_HEADER_SIZE;
+
+	enc = AMF_EncodeString(enc, pend, &av__result);
+	enc = AMF_EncodeNumber(enc, pend, txn);
+
+	if (AVMATCH(method, &av_connect)) {
+		*enc++ = AMF_OBJECT;
+		enc = AMF_EncodeNamedString(enc, pend, &av_fmsVer,
+				&av_server_version);
+		enc = encode_object_end(enc);
+
+		*enc++ = AMF_OBJECT;
+		enc = AMF_EncodeNamedString(enc, pend, &av_level, &av_status);
+		enc = AMF_EncodeNamedString(enc, pend, &av_code,
+				&av_connect_success);
+		enc = encode_object_end(enc);
+	} else {
+		/* createStream: the id of the new stream */
+		*enc++ = AMF_NULL;
+		enc = AMF_EncodeNumber(enc, pend, 1.0);
+	}
+
+	return send_invoke(r, pbuf, enc, 0);
+}
+
+static bool send_publish_start(RTMP *r, int stream_id)
+{
+	char pbuf[512];
+	char *pend = pbuf + sizeof(pbuf);
+	char *enc = pbuf + RTMP_MAX_HEADER_SIZE;
+
+	enc = AMF_EncodeString(enc, pend, &av_onStatus);
+	enc = AMF_EncodeNumber(enc, pend, 0.0);
+	*enc++ = AMF_NULL;
+
+	*enc++ = AMF_OBJECT;
+	enc = AMF_EncodeNamedString(enc, pend, &av_level, &av_status);
+	enc = AMF_EncodeNamedString(enc, pend, &av_code, &av_publish_start);
+	enc = AMF_EncodeNamedString(enc, pend, &av_description,
+			&av_publish_start);
+	enc = encode_object_end(enc);
+
+	return send_invoke(r, pbuf, enc, stream_id);
+}
+
+static bool handle_invoke(RTMP *r, RTMPPacket *packet)
+{
+	AMFObject obj;
+	AVal method;
+	double txn;
+	bool success = true;
+
+	if (AMF_Decode(&obj, packet->m_body, packet->m_nBodySize, FALSE) < 0)
+		return false;
+
+	AMFProp_GetString(AMF_GetProp(&obj, NULL, 0), &method);
+	txn = AMFProp_GetNumber(AMF_GetProp(&obj, NULL, 1));
+
+	if (AVMATCH(&method, &av_connect) ||
+	    AVMATCH(&method, &av_createStream))
+		success = send_result(r, &method, txn);
+	else if (AVMATCH(&method, &av_publish))
+		success = send_publish_start(r, packet->m_nInfoField2);
+
+	AMF_Reset(&obj);
+	return success;
+}
+
+static void *server_thread(void *data)
+{
+	struct server *server = data;
+	RTMPPacket packet = {0};
+	RTMP rtmp;
+
+	RTMP_Init(&rtmp);
+	rtmp.m_sb.sb_socket = accept(server->listen_socket, NULL, NULL);
+
+	if (!RTMP_Serve(&rtmp)) {
+		printf("FAIL: server handshake failed\n");
+		server->failed = true;
+		goto exit;
+	}
+
+	while (RTMP_IsConnected(&rtmp) && RTMP_ReadPacket(&rtmp, &packet)) {
+		if (!RTMPPacket_IsReady(&packet))
+			continue;
+
+		switch (packet.m_packetType) {
+		case RTMP_PACKET_TYPE_CHUNK_SIZE:
+			rtmp.m_inChunkSize = AMF_DecodeInt32(packet.m_body);
+			break;
+
+		case RTMP_PACKET_TYPE_INVOKE:
+			if (!handle_invoke(&rtmp, &packet)) {
+				printf("FAIL: server could not answer an "
+						"invoke\n");
+				server->failed = true;
+			}
+			break;
+
+		case RTMP_PACKET_TYPE_AUDIO:
+		case RTMP_PACKET_TYPE_VIDEO: {
+			struct message *msg = da_push_back_new(server->received);
+			msg->type      = packet.m_packetType;
+			msg->timestamp = packet.m_nTimeStamp;
+			msg->size      = packet.m_nBodySize;
+			msg->body      = bmemdup(packet.m_body, msg->size);
+			break;
+		}
+		}
+
+		RTMPPacket_Free(&packet);
+	}
+
+exit:
+	RTMPPacket_Free(&packet);
+	RTMP_Close(&rtmp);
+	return NULL;
+}
+
+static int start_server(struct server *server)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+
+	memset(server, 0, sizeof(*server));
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	server->listen_socket = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (bind(server->listen_socket, (struct sockaddr *)&addr,
+				sizeof(addr)) != 0 ||
+	    listen(server->listen_socket, 1) != 0 ||
+	    getsockname(server->listen_socket, (struct sockaddr *)&addr,
+				&addr_len) != 0) {
+		closesocket(server->listen_socket);
+		return 0;
+	}
+
+	pthread_create(&server->thread, NULL, server_thread, server);
+	return ntohs(addr.sin_port);
+}
+
+static void stop_server(struct server *server)
+{
+	pthread_join(server->thread, NULL);
+	closesocket(server->listen_socket);
+}
+
+static void free_server(struct server *server)
+{
+	free_messages(server->received.array, server->received.num);
+	da_free(server->received);
+}
+
+/* ------------------------------------------------------------------------- */
+/* client */
+
+static int send_partial(RTMPSockBuf *sb, const char *buf, int len, void *param)
+{
+	UNUSED_PARAMETER(param);
+	return send(sb->sb_socket, buf, len > 7 ? 7 : len, 0);
+}
+
+static int send_nothing(RTMPSockBuf *sb, const char *buf, int len,
+		void *param)
+{
+	UNUSED_PARAMETER(sb);
+	UNUSED_PARAMETER(buf);
+	UNUSED_PARAMETER(len);
+	UNUSED_PARAMETER(param);
+	return 0;
+}
+
+/*
+ * Equal timestamps, small steps and jumps that need an extended timestamp.
+ * The librtmp reader used by the server puts the 0xffffff marker back in
+ * place of an extended timestamp when a message continues in another chunk,
+ * so messages after a jump are kept to a single chunk.
+ */
+static uint32_t next_timestamp(uint32_t ts, bool *extended)
+{
+	uint32_t r = next_rand() % 100;
+
+	*extended = r >= 10 && r < 12;
+
+	if (r < 10)
+		return ts;
+	if (*extended)
+		return (ts + 0x1000000) & 0x7FFFFFFF;
+	return ts + next_rand() % 40;
+}
+
+static void random_message(struct message *msg, uint32_t timestamp,
+		bool single_chunk)
+{
+	bool video = (next_rand() & 1) != 0;
+	uint32_t size = next_rand() % 4 ?
+		next_rand() % 3000 : next_rand() % 40000;
+
+	if (single_chunk)
+		size %= RTMP_DEFAULT_CHUNKSIZE - 5;
+
+	msg->type      = video ? RTMP_PACKET_TYPE_VIDEO :
+	                         RTMP_PACKET_TYPE_AUDIO;
+	msg->timestamp = timestamp;
+	msg->size      = size + (video ? 5 : 2);
+	msg->body      = bmalloc(msg->size);
+
+	for (uint32_t i = 0; i < msg->size; i++)
+		msg->body[i] = (uint8_t)next_rand();
+}
+
+/* RTMP_Write takes whole FLV tags */
+static bool write_tag(RTMP *r, const struct message *msg)
+{
+	uint32_t tag_size = 11 + msg->size + 4;
+	uint8_t *tag = bzalloc(tag_size);
+	bool success;
+
+	tag[0] = msg->type;
+	tag[1] = (uint8_t)(msg->size >> 16);
+	tag[2] = (uint8_t)(msg->size >> 8);
+	tag[3] = (uint8_t)msg->size;
+	tag[4] = (uint8_t)(msg->timestamp >> 16);
+	tag[5] = (uint8_t)(msg->timestamp >> 8);
+	tag[6] = (uint8_t)msg->timestamp;
+	tag[7] = (uint8_t)(msg->timestamp >> 24);
+	memcpy(tag + 11, msg->body, msg->size);
+
+	success = RTMP_Write(r, (char *)tag, (int)tag_size, 0) >= 0;
+	bfree(tag);
+	return success;
+}
+
+/* RTMP_WriteV gets the tag body prefix, an empty buffer and the rest */
+static bool write_vectored(RTMP *r, const struct message *msg)
+{
+	int prefix = msg->type == RTMP_PACKET_TYPE_VIDEO ? 5 : 2;
+	RTMPBuf bufs[3] = {
+		{(const char *)msg->body, prefix},
+		{(const char *)msg->body + prefix, 0},
+		{(const char *)msg->body + prefix, (int)msg->size - prefix}
+	};
+
+	return RTMP_WriteV(r, msg->type, msg->timestamp, bufs, 3, 0) != 0;
+}
+
+static void check_received(const char *name, const struct message *sent,
+		size_t num_sent, const struct message *received,
+		size_t num_received)
+{
+	if (num_sent != num_received) {
+		printf("FAIL: %s: sent %zu messages, received %zu\n", name,
+				num_sent, num_received);
+		failures++;
+		return;
+	}
+
+	for (size_t i = 0; i < num_sent; i++) {
+		const struct message *a = &sent[i];
+		const struct message *b = &received[i];
+
+		if (a->type != b->type || a->timestamp != b->timestamp ||
+		    a->size != b->size || memcmp(a->body, b->body, a->size)) {
+			printf("FAIL: %s: message %zu (%s) differs: sent type "
+					"%d, ts %"PRIu32", %"PRIu32" bytes; "
+					"received type %d, ts %"PRIu32", "
+					"%"PRIu32" bytes\n",
+					name, i, i % 2 ? "RTMP_WriteV" :
+					"RTMP_Write",
+					a->type, a->timestamp, a->size,
+					b->type, b->timestamp, b->size);
+			failures++;
+			return;
+		}
+	}
+}
+
+static void run_session(const char *name, int chunk_size, bool partial_sends,
+		bool fail_last_send)
+{
+	struct message sent[MESSAGES];
+	struct server server;
+	char url[64];
+	uint32_t ts = 0;
+	size_t num_sent = 0;
+	RTMP rtmp;
+	int port;
+
+	port = start_server(&server);
+	if (!port) {
+		printf("FAIL: %s: could not listen on the loopback "
+				"interface\n", name);
+		failures++;
+		return;
+	}
+
+	snprintf(url, sizeof(url), "rtmp://127.0.0.1:%d/live", port);
+
+	RTMP_Init(&rtmp);
+	RTMP_SetupURL(&rtmp, url);
+	RTMP_EnableWrite(&rtmp);
+	RTMP_AddStream(&rtmp, "test");
+	rtmp.m_outChunkSize = chunk_size;
+	rtmp.m_bSendChunkSizeInfo = chunk_size != RTMP_DEFAULT_CHUNKSIZE;
+
+	if (!RTMP_Connect(&rtmp, NULL) || !RTMP_ConnectStream(&rtmp, 0)) {
+		printf("FAIL: %s: could not publish to the test server\n",
+				name);
+		failures++;
+		RTMP_Close(&rtmp);
+		stop_server(&server);
+		free_server(&server);
+		return;
+	}
+
+	if (partial_sends) {
+		rtmp.m_bCustomSend = TRUE;
+		rtmp.m_customSendFunc = send_partial;
+	}
+
+	for (; num_sent < MESSAGES; num_sent++) {
+		struct message *msg = &sent[num_sent];
+		bool extended;
+		bool success;
+
+		ts = next_timestamp(ts, &extended);
+		random_message(msg, ts, extended);
+
+		success = num_sent % 2 ?
+			write_vectored(&rtmp, msg) : write_tag(&rtmp, msg);
+		if (!success) {
+			printf("FAIL: %s: sending message %zu failed\n", name,
+					num_sent);
+			failures++;
+			bfree(msg->body);
+			break;
+		}
+	}
+
+	if (fail_last_send) {
+		struct message msg;
+		random_message(&msg, ts, false);
+
+		rtmp.m_bCustomSend = TRUE;
+		rtmp.m_customSendFunc = send_nothing;
+
+		if (write_vectored(&rtmp, &msg)) {
+			printf("FAIL: %s: RTMP_WriteV succeeded without "
+					"sending\n", name);
+			failures++;
+		}
+		if (RTMP_IsConnected(&rtmp)) {
+			printf("FAIL: %s: connection still open after a "
+					"failed send\n", name);
+			failures++;
+		}
+
+		bfree(msg.body);
+	}
+
+	/* closing makes the server thread exit */
+	RTMP_Close(&rtmp);
+	stop_server(&server);
+
+	if (server.failed)
+		failures++;
+	else
+		check_received(name, sent, num_sent, server.received.array,
+				server.received.num);
+
+	printf("%s: %zu messages sent, %zu received\n", name, num_sent,
+			server.received.num);
+
+	free_messages(sent, num_sent);
+	free_server(&server);
+}
+
+int main(void)
+{
+#ifdef _WIN32
+	WSADATA wsad;
+	WSAStartup(MAKEWORD(2, 2), &wsad);
+#endif
+
+	RTMP_LogSetLevel(RTMP_LOGERROR);
+
+	run_session("chunk size 128", RTMP_DEFAULT_CHUNKSIZE, false, false);
+	run_session("chunk size 4096", 4096, false, false);
+	run_session("chunk size 1000, partial sends", 1000, true, false);
+	run_session("chunk size 4096, failing send", 4096, false, true);
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+
+	printf("%d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <callback/signal.h>
+
+/*
+ * Checks deferred and coalesced delivery: callbacks run on the dispatcher
+ * thread and never on the signalling thread, coalesced callbacks end up with
+ * the latest parameters (including data parameters copied by value), and
+ * disconnecting discards queued calls while other threads keep signalling.
+ * Also covers signal_handler_remove_current inside a deferred callback, the
+ * last deferred callback disconnecting itself on the dispatcher thread, and
+ * destroying a handler with deferred callbacks still connected.
+ */
+
+#define EMITTERS           3
+#define CHURN_ITERATIONS   2000
+#define CHANNELS           8
+#define LEVEL_SIGNALS      1000
+#define WAIT_MS            5000
+
+struct watched {
+	volatile long alive;
+	volatile long calls;
+};
+
+static signal_handler_t *handler;
+static pthread_t main_thread;
+static volatile bool stop = false;
+static volatile long failures = 0;
+
+static void fail(const char *message)
+{
+	printf("FAIL: %s\n", message);
+	os_atomic_inc_long(&failures);
+}
+
+static bool wait_for(volatile long *val, long expected)
+{
+	for (int i = 0; i < WAIT_MS; i++) {
+		if (os_atomic_load_long(val) == expected)
+			return true;
+		os_sleep_ms(1);
+	}
+
+	return false;
+}
+
+static void watched_callback(void *data, calldata_t *cd)
+{
+	struct watched *w = data;
+	long long val = 0;
+
+	if (!os_atomic_load_long(&w->alive))
+		fail("callback called after it was disconnected");
+	if (pthread_equal(pthread_self(), main_thread))
+		fail("deferred callback called by the signalling thread");
+
+	calldata_get_int(cd, "val", &val);
+	os_atomic_inc_long(&w->calls);
+	if (val % 13 == 0)
+		os_sleep_ms(0);
+}
+
+static void *emit_thread(void *param)
+{
+	long long val = 0;
+	calldata_t cd;
+
+	UNUSED_PARAMETER(param);
+
+	calldata_init(&cd);
+	while (!os_atomic_load_bool(&stop)) {
+		calldata_set_int(&cd, "val", val++);
+		signal_handler_signal(handler, "value", &cd);
+	}
+	calldata_free(&cd);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static volatile long self_calls = 0;
+
+static void remove_self_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+
+	os_atomic_inc_long(&self_calls);
+	signal_handler_remove_current();
+}
+
+static void test_remove_current(void)
+{
+	calldata_t cd;
+
+	calldata_init(&cd);
+
+	signal_handler_connect_flags(handler, "value", remove_self_callback,
+			NULL, SIGNAL_DEFERRED);
+	for (int i = 0; i < 5; i++)
+		signal_handler_signal(handler, "value", &cd);
+
+	wait_for(&self_calls, 1);
+	os_sleep_ms(50);
+
+	if (os_atomic_load_long(&self_calls) != 1)
+		fail("deferred callback removing itself was called again");
+
+	calldata_free(&cd);
+	printf("remove_current:         %ld call(s)\n",
+			os_atomic_load_long(&self_calls));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static volatile long last_level = 0;
+
+static void levels_callback(void *data, calldata_t *cd)
+{
+	float peak[CHANNELS];
+	long long val = 0;
+
+	UNUSED_PARAMETER(data);
+
+	if (!calldata_get_data(cd, "peak", peak, sizeof(peak))) {
+		fail("coalesced data parameter missing");
+		return;
+	}
+
+	calldata_get_int(cd, "val", &val);
+	for (size_t i = 0; i < CHANNELS; i++) {
+		if (peak[i] != (float)val) {
+			fail("coalesced data parameter torn");
+			break;
+		}
+	}
+
+	os_atomic_set_long(&last_level, (long)val);
+	os_sleep_ms(1);
+}
+
+static void test_coalesce(void)
+{
+	float peak[CHANNELS];
+	calldata_t cd;
+
+	calldata_init(&cd);
+
+	signal_handler_connect_flags(handler, "levels", levels_callback, NULL,
+			SIGNAL_COALESCE);
+
+	for (long long val = 1; val <= LEVEL_SIGNALS; val++) {
+		for (size_t i = 0; i < CHANNELS; i++)
+			peak[i] = (float)val;
+
+		calldata_set_int(&cd, "val", val);
+		calldata_set_data(&cd, "peak", peak, sizeof(peak));
+		signal_handler_signal(handler, "levels", &cd);
+	}
+
+	if (!wait_for(&last_level, LEVEL_SIGNALS))
+		fail("coalesced callback never got the latest parameters");
+
+	signal_handler_disconnect(handler, "levels", levels_callback, NULL);
+
+	calldata_free(&cd);
+	printf("coalesce:               latest %ld of %d\n",
+			os_atomic_load_long(&last_level), LEVEL_SIGNALS);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* connects objects while other threads signal, and frees each one right
+ * after disconnecting it */
+static void test_churn(void)
+{
+	pthread_t threads[EMITTERS];
+	long calls = 0;
+
+	for (size_t i = 0; i < EMITTERS; i++) {
+		if (pthread_create(&threads[i], NULL, emit_thread, NULL) != 0) {
+			fail("could not create an emitting thread");
+			return;
+		}
+	}
+
+	for (int i = 0; i < CHURN_ITERATIONS; i++) {
+		struct watched *w = bzalloc(sizeof(*w));
+		w->alive = 1;
+
+		signal_handler_connect_flags(handler, "value",
+				watched_callback, w,
+				(i & 1) ? SIGNAL_DEFERRED : SIGNAL_COALESCE);
+		os_sleepto_ns(os_gettime_ns() + 200000);
+		signal_handler_disconnect(handler, "value", watched_callback,
+				w);
+
+		os_atomic_set_long(&w->alive, 0);
+		calls += os_atomic_load_long(&w->calls);
+		bfree(w);
+	}
+
+	os_atomic_set_bool(&stop, true);
+	for (size_t i = 0; i < EMITTERS; i++)
+		pthread_join(threads[i], NULL);
+
+	if (!calls)
+		fail("churned callbacks were never called");
+	printf("connect/disconnect:     %d objects, %ld calls\n",
+			CHURN_ITERATIONS, calls);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static signal_handler_t *last_handler;
+static volatile long last_done = 0;
+
+static void disconnect_last_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+
+	/* stops the dispatcher thread it's running on */
+	signal_handler_disconnect(last_handler, "last",
+			disconnect_last_callback, NULL);
+	os_atomic_set_long(&last_done, 1);
+}
+
+static void test_disconnect_last(void)
+{
+	calldata_t cd;
+
+	calldata_init(&cd);
+
+	last_handler = signal_handler_create();
+	signal_handler_add(last_handler, "void last()");
+	signal_handler_connect_flags(last_handler, "last",
+			disconnect_last_callback, NULL, SIGNAL_DEFERRED);
+	signal_handler_signal(last_handler, "last", &cd);
+
+	if (!wait_for(&last_done, 1))
+		fail("last deferred callback was never called");
+
+	os_sleep_ms(20);
+	signal_handler_destroy(last_handler);
+
+	calldata_free(&cd);
+	printf("last user disconnects:  ok\n");
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void test_destroy_connected(void)
+{
+	struct watched *w = bzalloc(sizeof(*w));
+	pthread_t thread;
+
+	w->alive = 1;
+	signal_handler_connect_flags(handler, "value", watched_callback, w,
+			SIGNAL_DEFERRED);
+
+	os_atomic_set_bool(&stop, false);
+	if (pthread_create(&thread, NULL, emit_thread, NULL) != 0) {
+		fail("could not create an emitting thread");
+	} else {
+		os_sleep_ms(5);
+		os_atomic_set_bool(&stop, true);
+		pthread_join(thread, NULL);
+	}
+
+	signal_handler_destroy(handler);
+	handler = NULL;
+
+	os_atomic_set_long(&w->alive, 0);
+	bfree(w);
+	printf("destroy while connected: ok\n");
+}
+
+int main(void)
+{
+	main_thread = pthread_self();
+
+	handler = signal_handler_create();
+	if (!handler) {
+		printf("FAIL: could not create the signal handler\n");
+		return 1;
+	}
+
+	signal_handler_add(handler, "void value(int val)");
+	if (!signal_handler_add(handler, "void levels(int val, data peak)"))
+		fail("could not add a signal with a data parameter");
+
+	test_remove_current();
+	test_coalesce();
+	test_churn();
+	test_disconnect_last();
+	test_destroy_connected();
+
+	/* the dispatcher thread frees what's left as it exits */
+	os_sleep_ms(20);
+
+	if (bnum_allocs() != 0) {
+		printf("FAIL: %ld allocations leaked\n", bnum_allocs());
+		failures++;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <callback/signal.h>
+
+/*
+ * Checks what disconnecting promises while other threads keep signalling:
+ * once signal_handler_disconnect returns the callback is not being called and
+ * is never called again, so its data can be freed right away.  Also checks
+ * that disconnecting returns in time while every emitting thread is always
+ * in the middle of a slow callback, and that callbacks can disconnect
+ * themselves and each other.
+ */
+
+#define EMITTERS           4
+#define CHURN_ITERATIONS   5000
+#define SLOW_DISCONNECTS   200
+#define MAX_DISCONNECT_NS  500000000ULL
+
+struct watched {
+	volatile long alive;
+	volatile long calls;
+};
+
+static signal_handler_t *handler;
+static volatile bool stop = false;
+static volatile long failures = 0;
+
+static void fail(const char *message)
+{
+	printf("FAIL: %s\n", message);
+	os_atomic_inc_long(&failures);
+}
+
+static void watched_callback(void *data, calldata_t *cd)
+{
+	struct watched *w = data;
+
+	UNUSED_PARAMETER(cd);
+
+	if (!os_atomic_load_long(&w->alive))
+		fail("callback called after it was disconnected");
+	os_atomic_inc_long(&w->calls);
+}
+
+static void global_callback(void *data, const char *signal, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(signal);
+	UNUSED_PARAMETER(cd);
+}
+
+static void slow_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+	os_sleep_ms(1);
+}
+
+static void *emit_thread(void *param)
+{
+	const char *signal = param;
+	calldata_t cd;
+
+	calldata_init(&cd);
+	while (!os_atomic_load_bool(&stop))
+		signal_handler_signal(handler, signal, &cd);
+	calldata_free(&cd);
+	return NULL;
+}
+
+static bool start_emitters(pthread_t *threads, const char *signal)
+{
+	os_atomic_set_bool(&stop, false);
+
+	for (size_t i = 0; i < EMITTERS; i++) {
+		if (pthread_create(&threads[i], NULL, emit_thread,
+					(void*)signal) != 0) {
+			fail("could not create an emitting thread");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void stop_emitters(pthread_t *threads)
+{
+	os_atomic_set_bool(&stop, true);
+	for (size_t i = 0; i < EMITTERS; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int self_calls = 0;
+static struct watched *victim = NULL;
+
+static void remove_self_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+
+	self_calls++;
+	signal_handler_remove_current();
+}
+
+static void remove_victim_callback(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(cd);
+
+	if (victim) {
+		signal_handler_disconnect(handler, "same", watched_callback,
+				victim);
+		os_atomic_set_long(&victim->alive, 0);
+	}
+}
+
+static void test_same_thread(void)
+{
+	calldata_t cd;
+
+	calldata_init(&cd);
+
+	victim = bzalloc(sizeof(*victim));
+	victim->alive = 1;
+
+	signal_handler_connect(handler, "same", remove_self_callback, NULL);
+	signal_handler_connect(handler, "same", remove_victim_callback, NULL);
+	signal_handler_connect(handler, "same", watched_callback, victim);
+
+	signal_handler_signal(handler, "same", &cd);
+	signal_handler_signal(handler, "same", &cd);
+
+	if (self_calls != 1)
+		fail("callback removing itself was called again");
+	if (victim->calls != 0)
+		fail("callback removed by an earlier callback was called");
+
+	signal_handler_disconnect(handler, "same", remove_victim_callback,
+			NULL);
+	bfree(victim);
+	victim = NULL;
+
+	calldata_free(&cd);
+	printf("same thread removal:    %d self call(s)\n", self_calls);
+}
+
+/* connects objects while other threads signal, and frees each one right
+ * after disconnecting it */
+static void test_churn(void)
+{
+	pthread_t threads[EMITTERS];
+	long calls = 0;
+
+	if (!start_emitters(threads, "churn"))
+		return;
+
+	signal_handler_connect_global(handler, global_callback, NULL);
+
+	for (int i = 0; i < CHURN_ITERATIONS; i++) {
+		struct watched *w = bzalloc(sizeof(*w));
+		w->alive = 1;
+
+		signal_handler_connect(handler, "churn", watched_callback, w);
+		if (i % 7 == 0)
+			signal_handler_connect(handler, "other",
+					watched_callback, w);
+
+		os_sleepto_ns(os_gettime_ns() + 2000);
+
+		signal_handler_disconnect(handler, "churn", watched_callback,
+				w);
+		if (i % 7 == 0)
+			signal_handler_disconnect(handler, "other",
+					watched_callback, w);
+
+		os_atomic_set_long(&w->alive, 0);
+		calls += w->calls;
+		bfree(w);
+
+		if (i % 100 == 0) {
+			signal_handler_disconnect_global(handler,
+					global_callback, NULL);
+			signal_handler_connect_global(handler,
+					global_callback, NULL);
+		}
+	}
+
+	stop_emitters(threads);
+	signal_handler_disconnect_global(handler, global_callback, NULL);
+
+	if (!calls)
+		fail("churned callbacks were never called");
+	printf("connect/disconnect:     %d objects, %ld calls\n",
+			CHURN_ITERATIONS, calls);
+}
+
+/* every emitting thread is always inside the slow callback, so there is
+ * never a moment with no signal in progress */
+static void test_disconnect_latency(void)
+{
+	pthread_t threads[EMITTERS];
+	uint64_t max_ns = 0;
+
+	signal_handler_connect(handler, "slow", slow_callback, NULL);
+
+	if (!start_emitters(threads, "slow"))
+		return;
+
+	for (int i = 0; i < SLOW_DISCONNECTS; i++) {
+		struct watched *w = bzalloc(sizeof(*w));
+		uint64_t start;
+		uint64_t ns;
+
+		w->alive = 1;
+		signal_handler_connect(handler, "slow", watched_callback, w);
+		os_sleep_ms(1);
+
+		start = os_gettime_ns();
+		signal_handler_disconnect(handler, "slow", watched_callback,
+				w);
+		ns = os_gettime_ns() - start;
+		if (ns > max_ns)
+			max_ns = ns;
+
+		os_atomic_set_long(&w->alive, 0);
+		bfree(w);
+	}
+
+	stop_emitters(threads);
+	signal_handler_disconnect(handler, "slow", slow_callback, NULL);
+
+	if (max_ns > MAX_DISCONNECT_NS)
+		fail("disconnecting waited for signals that started after it");
+	printf("disconnect under load:  %8.3f ms max\n", (double)max_ns / 1e6);
+}
+
+int main(void)
+{
+	handler = signal_handler_create();
+	if (!handler) {
+		printf("FAIL: could not create the signal handler\n");
+		return 1;
+	}
+
+	signal_handler_add(handler, "void same()");
+	signal_handler_add(handler, "void churn()");
+	signal_handler_add(handler, "void other()");
+	signal_handler_add(handler, "void slow()");
+
+	test_same_thread();
+	test_churn();
+	test_disconnect_latency();
+
+	signal_handler_destroy(handler);
+
+	if (bnum_allocs() != 0) {
+		printf("FAIL: %ld allocations leaked\n", bnum_allocs());
+		failures++;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <util/dstr.h>
+
+/*
+ * Checks that when several sources share a name, obs_get_source_by_name
+ * returns the most recently created one, as it did when it walked the source
+ * list, after the name index grows, after renames and after the newest one
+ * is removed.  Also checks that obs_scene_find_source follows renames.
+ */
+
+#define FILLER_SOURCES 300
+
+static const char *test_source_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "test source";
+}
+
+static void *test_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void test_source_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static uint32_t test_source_get_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 64;
+}
+
+static struct obs_source_info test_source_info = {
+	.id           = "test_source",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name     = test_source_get_name,
+	.create       = test_source_create,
+	.destroy      = test_source_destroy,
+	.get_width    = test_source_get_size,
+	.get_height   = test_source_get_size,
+};
+
+static int failures = 0;
+
+static void expect_source(const char *name, obs_source_t *expected,
+		const char *when)
+{
+	obs_source_t *source = obs_get_source_by_name(name);
+
+	if (source != expected) {
+		printf("FAIL: \"%s\" %s: got %p, expected %p\n", name, when,
+				(void*)source, (void*)expected);
+		failures++;
+	}
+
+	obs_source_release(source);
+}
+
+static obs_source_t *create(const char *name)
+{
+	return obs_source_create("test_source", name, NULL, NULL);
+}
+
+int main(void)
+{
+	obs_source_t *fillers[FILLER_SOURCES];
+	obs_source_t *first, *second, *third;
+	obs_sceneitem_t *item;
+	obs_scene_t *scene;
+	struct dstr name = {0};
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("FAIL: obs_startup failed\n");
+		return 1;
+	}
+
+	obs_register_source(&test_source_info);
+
+	first = create("dup");
+	second = create("dup");
+	third = create("dup");
+	expect_source("dup", third, "after creating");
+
+	/* grows the index several times */
+	for (size_t i = 0; i < FILLER_SOURCES; i++) {
+		dstr_printf(&name, "Filler %zu", i);
+		fillers[i] = create(name.array);
+	}
+	expect_source("dup", third, "after the index grew");
+
+	/* renaming doesn't change which one was created last */
+	obs_source_set_name(third, "renamed");
+	expect_source("dup", second, "with the newest one renamed");
+	obs_source_set_name(third, "dup");
+	expect_source("dup", third, "after renaming the newest one back");
+
+	obs_source_set_name(first, "renamed");
+	obs_source_set_name(first, "dup");
+	expect_source("dup", third, "after renaming the oldest one back");
+
+	/* scene lookups follow renames */
+	scene = obs_scene_create("Test scene");
+	item = obs_scene_add(scene, fillers[0]);
+	obs_source_set_name(fillers[0], "Moved filler");
+	if (obs_scene_find_source(scene, "Moved filler") != item) {
+		printf("FAIL: renamed scene item not found\n");
+		failures++;
+	}
+	if (obs_scene_find_source(scene, "Filler 0")) {
+		printf("FAIL: scene item found by its old name\n");
+		failures++;
+	}
+	obs_scene_release(scene);
+
+	obs_source_remove(third);
+	obs_source_release(third);
+	expect_source("dup", second, "after removing the newest one");
+
+	obs_source_remove(second);
+	obs_source_release(second);
+	expect_source("dup", first, "after removing all but the oldest one");
+
+	obs_source_remove(first);
+	obs_source_release(first);
+	expect_source("dup", NULL, "after removing all of them");
+
+	for (size_t i = 0; i < FILLER_SOURCES; i++) {
+		obs_source_remove(fillers[i]);
+		obs_source_release(fillers[i]);
+	}
+
+	dstr_free(&name);
+	obs_shutdown();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-io/video-frame.h>
+
+/*
+ * Checks threaded video delivery: an input that disconnects itself from
+ * within its own callback keeps using the output until the callback
+ * returns, so closing the output has to wait for it.
+ *
+ * Also checks that threaded and unthreaded inputs sharing a conversion, and
+ * a conversion cascaded from it, each get the frame scaled from the frame
+ * with their timestamp while some threaded inputs lag behind, and that
+ * scaled frames are reused rather than allocated once the inputs are done
+ * with them.
+ */
+
+#define WIDTH          256
+#define HEIGHT         256
+#define FPS            60
+#define SHARED_FRAMES  240
+#define SHARED_INPUTS  5
+
+static video_t *video = NULL;
+static int failures = 0;
+
+static void fail(const char *message)
+{
+	printf("FAIL: %s\n", message);
+	failures++;
+}
+
+static bool open_video(bool threaded)
+{
+	struct video_output_info voi = {
+		.name       = "video-io test",
+		.format     = VIDEO_FORMAT_I420,
+		.fps_num    = FPS,
+		.fps_den    = 1,
+		.width      = WIDTH,
+		.height     = HEIGHT,
+		.cache_size = 4,
+		.colorspace = VIDEO_CS_DEFAULT,
+		.range      = VIDEO_RANGE_DEFAULT
+	};
+
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS) {
+		fail("could not open the video output");
+		return false;
+	}
+
+	video_output_set_threaded_inputs(video, threaded);
+	return true;
+}
+
+/* posts a frame with a luma plane of a single value */
+static void post_frame(uint64_t timestamp, uint8_t value)
+{
+	struct video_frame frame;
+
+	if (!video_output_lock_frame(video, &frame, 1, timestamp))
+		return;
+
+	memset(frame.data[0], value, (size_t)frame.linesize[0] * HEIGHT);
+	video_output_unlock_frame(video);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static volatile long detached_calls = 0;
+static volatile long detached_done = 0;
+
+static void detach_callback(void *param, struct video_data *frame)
+{
+	UNUSED_PARAMETER(frame);
+
+	if (os_atomic_inc_long(&detached_calls) != 1)
+		return;
+
+	video_output_disconnect(video, detach_callback, param);
+
+	/* still running on the output's input thread */
+	os_sleep_ms(100);
+	os_atomic_set_long(&detached_done, 1);
+}
+
+static void test_detached_close(void)
+{
+	if (!open_video(true))
+		return;
+
+	video_output_connect(video, NULL, detach_callback, NULL);
+
+	for (uint8_t i = 0; !os_atomic_load_long(&detached_calls); i++) {
+		if (i == 100) {
+			fail("the input was never called");
+			break;
+		}
+
+		post_frame(os_gettime_ns(), 16);
+		os_sleep_ms(10);
+	}
+
+	video_output_close(video);
+	video = NULL;
+
+	if (!os_atomic_load_long(&detached_done))
+		fail("closed while a detached input was still running");
+
+	printf("detached input:         %ld call(s)\n",
+			os_atomic_load_long(&detached_calls));
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct shared_input {
+	const char    *name;
+	uint32_t      width;
+	uint32_t      height;
+	bool          threaded;
+	bool          slow;
+
+	volatile long calls;
+	volatile long errors;
+};
+
+static struct shared_input shared_inputs[SHARED_INPUTS] = {
+	{"threaded 128x128",          128, 128, true,  false},
+	{"slow threaded 128x128",     128, 128, true,  true},
+	{"unthreaded 128x128",        128, 128, false, false},
+	{"cascaded threaded 64x64",   64,  64,  true,  false},
+	{"cascaded unthreaded 64x64", 64,  64,  false, false},
+};
+
+static uint64_t first_timestamp;
+static uint64_t frame_interval;
+
+static inline uint8_t frame_value(uint64_t timestamp)
+{
+	uint64_t idx = (timestamp - first_timestamp) / frame_interval;
+	return (uint8_t)(16 + idx * 7 % 200);
+}
+
+static void shared_callback(void *param, struct video_data *frame)
+{
+	struct shared_input *input = param;
+	uint8_t expected = frame_value(frame->timestamp);
+	const uint8_t *last_row = frame->data[0] +
+		(size_t)frame->linesize[0] * (input->height - 1);
+	const uint8_t samples[] = {
+		frame->data[0][0],
+		frame->data[0][input->width - 1],
+		last_row[0],
+		last_row[input->width - 1]
+	};
+
+	for (size_t i = 0; i < sizeof(samples); i++) {
+		if (samples[i] + 2 < expected || samples[i] > expected + 2) {
+			if (os_atomic_inc_long(&input->errors) == 1)
+				printf("FAIL: %s: got %d for a frame of "
+						"%d\n", input->name,
+						samples[i], expected);
+			break;
+		}
+	}
+
+	os_atomic_inc_long(&input->calls);
+
+	/* falls behind every few frames, so its frames are scaled while
+	 * the other inputs already scale newer ones */
+	if (input->slow && os_atomic_load_long(&input->calls) % 4 == 0)
+		os_sleep_ms(30);
+}
+
+static void connect_shared_input(struct shared_input *input)
+{
+	struct video_scale_info info = {
+		.format     = VIDEO_FORMAT_I420,
+		.width      = input->width,
+		.height     = input->height,
+		.range      = VIDEO_RANGE_DEFAULT,
+		.colorspace = VIDEO_CS_DEFAULT
+	};
+
+	video_output_set_threaded_inputs(video, input->threaded);
+	if (!video_output_connect(video, &info, shared_callback, input))
+		printf("FAIL: could not connect %s\n", input->name);
+}
+
+static void test_shared_conversion(void)
+{
+	long allocs = 0;
+
+	if (!open_video(true))
+		return;
+
+	video_output_set_cascaded_scaling(video, true);
+	for (size_t i = 0; i < SHARED_INPUTS; i++)
+		connect_shared_input(&shared_inputs[i]);
+
+	frame_interval = video_output_get_frame_time(video);
+	first_timestamp = os_gettime_ns();
+
+	for (int i = 0; i < SHARED_FRAMES; i++) {
+		uint64_t ts = first_timestamp + frame_interval * i;
+
+		/* scaled frames are allocated up front or while warming up,
+		 * once every input is done with one it is reused */
+		if (i == SHARED_FRAMES / 4)
+			allocs = bnum_allocs();
+
+		post_frame(ts, frame_value(ts));
+		os_sleepto_ns(ts + frame_interval);
+	}
+
+	allocs = bnum_allocs() - allocs;
+
+	for (size_t i = 0; i < SHARED_INPUTS; i++)
+		video_output_disconnect(video, shared_callback,
+				&shared_inputs[i]);
+
+	video_output_close(video);
+	video = NULL;
+
+	for (size_t i = 0; i < SHARED_INPUTS; i++) {
+		struct shared_input *input = &shared_inputs[i];
+
+		if (input->errors)
+			failures++;
+		if (input->calls < SHARED_FRAMES / 4) {
+			printf("FAIL: %s only got %ld frames\n", input->name,
+					input->calls);
+			failures++;
+		}
+
+		printf("%-26s  %ld frames\n", input->name, input->calls);
+	}
+
+	if (allocs > SHARED_FRAMES / 4) {
+		printf("FAIL: %ld allocations while delivering %d frames, "
+				"scaled frames are not reused\n", allocs,
+				SHARED_FRAMES * 3 / 4);
+		failures++;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("FAIL: obs_startup failed\n");
+		return 1;
+	}
+
+	test_detached_close();
+	test_shared_conversion();
+
+	obs_shutdown();
+	return failures ? 1 : 0;
+}